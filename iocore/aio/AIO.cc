@@ -27,9 +27,11 @@
 
 #include "P_AIO.h"
 
-#if AIO_MODE == AIO_MODE_NATIVE
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
 #define AIO_PERIOD                                -HRTIME_MSECONDS(4)
-#else
+#endif
+
+#if AIO_MODE != AIO_MODE_NATIVE
 
 #define MAX_DISKS_POSSIBLE 100
 
@@ -46,9 +48,13 @@ volatile int num_filedes = 1;
 static ink_mutex insert_mutex;
 
 int thread_is_created = 0;
-#endif // AIO_MODE == AIO_MODE_NATIVE
+#endif // AIO_MODE != AIO_MODE_NATIVE
 RecInt cache_config_threads_per_disk = 12;
 RecInt api_config_threads_per_disk = 12;
+#if AIO_MODE == AIO_MODE_IO_URING
+RecInt aio_config_io_uring = 1;
+RecInt aio_config_io_uring_entries = MAX_AIO_EVENTS;
+#endif
 
 RecRawStatBlock *aio_rsb = NULL;
 Continuation *aio_err_callbck = 0;
@@ -164,6 +170,12 @@ ink_aio_init(ModuleVersion v)
   ink_mutex_init(&insert_mutex, NULL);
 #endif
   REC_ReadConfigInteger(cache_config_threads_per_disk, "proxy.config.cache.threads_per_disk");
+#if AIO_MODE == AIO_MODE_IO_URING
+  REC_ReadConfigInteger(aio_config_io_uring, "proxy.config.aio.io_uring.enabled");
+  REC_ReadConfigInteger(aio_config_io_uring_entries, "proxy.config.aio.io_uring.entries");
+  if (aio_config_io_uring_entries <= 0)
+    aio_config_io_uring_entries = MAX_AIO_EVENTS;
+#endif
 }
 
 int
@@ -395,6 +407,49 @@ aio_queue_req(AIOCallbackInternal *op, int fromAPI = 0)
   }
 }
 
+static void
+aio_report_error(AIOCallback *op)
+{
+  if (aio_err_callbck) {
+    AIOCallback *callback_op = new AIOCallbackInternal();
+    callback_op->aiocb.aio_fildes = op->aiocb.aio_fildes;
+    callback_op->mutex = aio_err_callbck->mutex;
+    callback_op->action = aio_err_callbck;
+    eventProcessor.schedule_imm(callback_op);
+  }
+}
+
+#if AIO_MODE == AIO_MODE_IO_URING
+/* queue the request on the calling thread's ring, returns false if the
+   thread has no ring and the request has to go to the AIO threads */
+static bool
+aio_uring_queue(AIOCallback *op)
+{
+  EThread *t = this_ethread();
+  DiskHandler *dh = t ? t->diskHandler : NULL;
+  if (!dh || !dh->ok)
+    return false;
+
+  int lio_opcode = op->aiocb.aio_lio_opcode;
+  int sz = 0;
+  for (AIOCallback *io = op; io; io = io->then) {
+    io->aiocb.aio_lio_opcode = lio_opcode;
+    io->aio_result = 0;
+    dh->ready_list.enqueue(io);
+    ++sz;
+  }
+
+  /* the threads complete a chain as a single operation, do the same */
+  if (sz > 1) {
+    ink_assert(op->action.continuation);
+    AIOVec *vec = new AIOVec(sz, op);
+    for (AIOCallback *io = op; io; io = io->then)
+      io->action = vec;
+  }
+  return true;
+}
+#endif
+
 static inline int
 cache_op(AIOCallbackInternal *op)
 {
@@ -442,6 +497,9 @@ ink_aio_read(AIOCallback *op, int fromAPI)
   op->action.continuation->handleEvent(AIO_EVENT_DONE, op);
 #elif (AIO_MODE == AIO_MODE_THREAD)
   aio_queue_req((AIOCallbackInternal *) op, fromAPI);
+#elif (AIO_MODE == AIO_MODE_IO_URING)
+  if (!aio_uring_queue(op))
+    aio_queue_req((AIOCallbackInternal *) op, fromAPI);
 #endif
 
   return 1;
@@ -465,6 +523,9 @@ ink_aio_write(AIOCallback *op, int fromAPI)
   op->action.continuation->handleEvent(AIO_EVENT_DONE, op);
 #elif (AIO_MODE == AIO_MODE_THREAD)
   aio_queue_req((AIOCallbackInternal *) op, fromAPI);
+#elif (AIO_MODE == AIO_MODE_IO_URING)
+  if (!aio_uring_queue(op))
+    aio_queue_req((AIOCallbackInternal *) op, fromAPI);
 #endif
 
   return 1;
@@ -511,15 +572,8 @@ aio_thread_main(void *arg)
         aio_bytes_read += op->aiocb.aio_nbytes;
       }
       ink_mutex_release(&current_req->aio_mutex);
-      if (cache_op((AIOCallbackInternal *) op) <= 0) {
-        if (aio_err_callbck) {
-          AIOCallback *callback_op = new AIOCallbackInternal();
-          callback_op->aiocb.aio_fildes = op->aiocb.aio_fildes;
-          callback_op->mutex = aio_err_callbck->mutex;
-          callback_op->action = aio_err_callbck;
-          eventProcessor.schedule_imm(callback_op);
-        }
-      }
+      if (cache_op((AIOCallbackInternal *) op) <= 0)
+        aio_report_error(op);
       ink_atomic_increment((int *) &current_req->requests_queued, -1);
 #ifdef AIO_STATS
       ink_atomic_increment((int *) &current_req->pending, -1);
@@ -542,6 +596,115 @@ aio_thread_main(void *arg)
   }
   return 0;
 }
+
+#if AIO_MODE == AIO_MODE_IO_URING
+int
+DiskHandler::startAIOEvent(int /* event ATS_UNUSED */, Event *e) {
+  if (!ok)
+    return EVENT_DONE;
+  SET_HANDLER(&DiskHandler::mainAIOEvent);
+  e->schedule_every(AIO_PERIOD);
+  trigger_event = e;
+  return EVENT_CONT;
+}
+
+static void
+aio_uring_complete(AIOCallback *op, EThread *t)
+{
+  op->link.prev = NULL;
+  op->link.next = NULL;
+  op->mutex = op->action.mutex;
+  if (op->thread == AIO_CALLBACK_THREAD_AIO || op->thread == AIO_CALLBACK_THREAD_ANY || op->thread == t) {
+    if (!op->mutex) {
+      op->handleEvent(EVENT_IMMEDIATE, 0);
+      return;
+    }
+    MUTEX_TRY_LOCK(lock, op->mutex, t);
+    if (lock)
+      op->handleEvent(EVENT_IMMEDIATE, 0);
+    else
+      t->schedule_imm(op);
+  } else
+    op->thread->schedule_imm_signal(op);
+}
+
+int
+DiskHandler::mainAIOEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */) {
+  AIOCallback *op = NULL;
+  EThread *t = this_ethread();
+
+  // submit everything queued since the last pass as one batch
+  int num = 0;
+  while ((op = ready_list.head) != NULL && inflight + num < aio_config_io_uring_entries) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+    if (!sqe)
+      break; // submission queue is full, the rest goes on the next pass
+    ready_list.dequeue();
+    ink_aiocb_t *a = &op->aiocb;
+    char *buf = ((char *) a->aio_buf) + op->aio_result;
+    size_t nbytes = a->aio_nbytes - op->aio_result;
+    off_t offset = a->aio_offset + op->aio_result;
+    if (a->aio_lio_opcode == LIO_WRITE)
+      io_uring_prep_write(sqe, a->aio_fildes, buf, nbytes, offset);
+    else
+      io_uring_prep_read(sqe, a->aio_fildes, buf, nbytes, offset);
+    io_uring_sqe_set_data(sqe, op);
+    ++num;
+  }
+  if (num > 0) {
+    // anything not accepted stays in the submission queue for the next pass
+    int ret = io_uring_submit(&ring);
+    if (ret < 0 && ret != -EAGAIN && ret != -EBUSY && ret != -EINTR)
+      Warning("io_uring_submit failed: %s", strerror(-ret));
+    else if (ret > 0)
+      inflight += ret;
+  }
+
+  // reap completions
+  Que(AIOCallback, link) complete_list;
+  struct io_uring_cqe *cqes[MAX_AIO_EVENTS];
+  unsigned n;
+  while (inflight > 0 && (n = io_uring_peek_batch_cqe(&ring, cqes, MAX_AIO_EVENTS)) > 0) {
+    for (unsigned i = 0; i < n; ++i) {
+      op = (AIOCallback *) io_uring_cqe_get_data(cqes[i]);
+      ink_aiocb_t *a = &op->aiocb;
+      int res = cqes[i]->res;
+      if (res < 0 && (res == -EINTR || res == -EAGAIN)) {
+        ready_list.enqueue(op);
+        continue;
+      }
+      if (res == 0 && a->aio_lio_opcode == LIO_READ) {
+        // end of file, hand the short read to the caller like pread() would
+      } else if (res <= 0) {
+        Warning("cache disk operation failed %s %d %d\n", (a->aio_lio_opcode == LIO_READ) ? "READ" : "WRITE", res, -res);
+        op->aio_result = res < 0 ? res : -EIO;
+        aio_report_error(op);
+      } else {
+        op->aio_result += res;
+        // short transfer, issue the remainder
+        if ((size_t) op->aio_result < a->aio_nbytes) {
+          ready_list.enqueue(op);
+          continue;
+        }
+        if (a->aio_lio_opcode == LIO_WRITE) {
+          aio_num_write++;
+          aio_bytes_written += a->aio_nbytes;
+        } else {
+          aio_num_read++;
+          aio_bytes_read += a->aio_nbytes;
+        }
+      }
+      complete_list.enqueue(op);
+    }
+    io_uring_cq_advance(&ring, n);
+    inflight -= n;
+  }
+
+  while ((op = complete_list.dequeue()) != NULL)
+    aio_uring_complete(op, t);
+  return EVENT_CONT;
+}
+#endif // AIO_MODE == AIO_MODE_IO_URING
 #else
 int
 DiskHandler::startAIOEvent(int /* event ATS_UNUSED */, Event *e) {
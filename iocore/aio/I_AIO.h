@@ -47,9 +47,12 @@
 #define AIO_MODE_SYNC            1
 #define AIO_MODE_THREAD          2
 #define AIO_MODE_NATIVE          3
+#define AIO_MODE_IO_URING        4
 
 #if TS_USE_LINUX_NATIVE_AIO
 #define AIO_MODE                 AIO_MODE_NATIVE
+#elif TS_USE_LINUX_IO_URING
+#define AIO_MODE                 AIO_MODE_IO_URING
 #else
 #define AIO_MODE                 AIO_MODE_THREAD
 #endif
@@ -73,6 +76,12 @@ typedef struct io_event ink_io_event_t;
 
 #else
 
+#if AIO_MODE == AIO_MODE_IO_URING
+#include <liburing.h>
+
+#define MAX_AIO_EVENTS 1024
+#endif
+
 typedef struct ink_aiocb
 {
   int aio_fildes;
@@ -113,7 +122,7 @@ struct AIOCallback: public Continuation
   }
 };
 
-#if AIO_MODE == AIO_MODE_NATIVE
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
 
 struct AIOVec: public Continuation
 {
@@ -131,6 +140,10 @@ struct AIOVec: public Continuation
   int mainEvent(int event, Event *e);
 };
 
+#endif
+
+#if AIO_MODE == AIO_MODE_NATIVE
+
 struct DiskHandler: public Continuation
 {
   Event *trigger_event;
@@ -149,6 +162,40 @@ struct DiskHandler: public Continuation
     }
   }
 };
+
+#elif AIO_MODE == AIO_MODE_IO_URING
+
+// Run time switch, when off (or when the ring cannot be set up) requests go to the thread pool
+extern RecInt aio_config_io_uring;
+extern RecInt aio_config_io_uring_entries;
+
+/**
+  Per ET_NET thread io_uring.
+
+  Requests issued on the thread are queued on @c ready_list and submitted
+  as one batch on each pass of the event loop, completions are reaped in
+  batches on the same pass. Requests issued from threads without a
+  DiskHandler fall back to the thread pool.
+*/
+struct DiskHandler: public Continuation
+{
+  Event *trigger_event;
+  struct io_uring ring;
+  bool ok; // ring was set up
+  int inflight;
+  Que(AIOCallback, link) ready_list;
+  int startAIOEvent(int event, Event *e);
+  int mainAIOEvent(int event, Event *e);
+  DiskHandler() : trigger_event(NULL), ok(false), inflight(0) {
+    SET_HANDLER(&DiskHandler::startAIOEvent);
+    memset(&ring, 0, sizeof(ring));
+    int ret = io_uring_queue_init(aio_config_io_uring_entries, &ring, 0);
+    if (ret < 0)
+      Warning("io_uring_queue_init failed: %s, falling back to AIO threads", strerror(-ret));
+    else
+      ok = true;
+  }
+};
 #endif
 
 void ink_aio_init(ModuleVersion version);
@@ -77,22 +77,6 @@ AIOCallbackInternal::io_complete(int event, void *data)
   return EVENT_DONE;
 }
 
-TS_INLINE int
-AIOVec::mainEvent(int /* event */, Event *) {
-  ++completed;
-  if (completed < size)
-    return EVENT_CONT;
-  else if (completed == size) {
-    MUTEX_LOCK(lock, action.mutex, this_ethread());
-    if (!action.cancelled)
-      action.continuation->handleEvent(AIO_EVENT_DONE, first);
-    delete this;
-    return EVENT_DONE;
-  }
-  ink_assert(!"AIOVec mainEvent err");
-  return EVENT_ERROR;
-}
-
 #else /* AIO_MODE != AIO_MODE_NATIVE */
 
 struct AIO_Reqs;
@@ -142,6 +126,27 @@ struct AIO_Reqs
 };
 
 #endif // AIO_MODE == AIO_MODE_NATIVE
+
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
+
+TS_INLINE int
+AIOVec::mainEvent(int /* event */, Event *) {
+  ++completed;
+  if (completed < size)
+    return EVENT_CONT;
+  else if (completed == size) {
+    MUTEX_LOCK(lock, action.mutex, this_ethread());
+    if (!action.cancelled)
+      action.continuation->handleEvent(AIO_EVENT_DONE, first);
+    delete this;
+    return EVENT_DONE;
+  }
+  ink_assert(!"AIOVec mainEvent err");
+  return EVENT_ERROR;
+}
+
+#endif // AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
+
 #ifdef AIO_STATS
 class AIOTestData:public Continuation
 {
@@ -26,6 +26,9 @@
 #include "I_Layout.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
 
 using std::cout;
 using std::endl;
@@ -158,6 +161,7 @@ int threads_per_disk = 1;
 int delete_disks = 0;
 int max_size = 0;
 int use_lseek = 0;
+int io_uring = 1;
 
 int chains = 1;
 double seq_read_percent = 0.0;
@@ -183,11 +187,14 @@ struct AIO_Device:public Continuation
   int hotset_idx;
   int mode;
   AIOCallback *io;
+  ink_hrtime io_start;
+  std::vector<ink_hrtime> latency;
     AIO_Device(ProxyMutex * m):Continuation(m)
   {
     hotset_idx = 0;
     io = new_AIOCallback();
     time_start = 0;
+    io_start = 0;
     SET_HANDLER(&AIO_Device::do_hotset);
   }
   int select_mode(double p)
@@ -233,6 +240,29 @@ struct AIO_Device:public Continuation
 
 };
 
+static const char *
+aio_backend(void)
+{
+#if AIO_MODE == AIO_MODE_NATIVE
+  return "native";
+#elif AIO_MODE == AIO_MODE_IO_URING
+  if (io_uring && this_ethread()->diskHandler && this_ethread()->diskHandler->ok)
+    return "io_uring";
+  return "thread";
+#else
+  return "thread";
+#endif
+}
+
+static double
+latency_percentile(std::vector<ink_hrtime> &v, double p)
+{
+  if (v.empty())
+    return 0.0;
+  size_t i = (size_t) (p * (v.size() - 1));
+  return (double) v[i] / HRTIME_USECOND;
+}
+
 void
 dump_summary(void)
 {
@@ -242,6 +272,7 @@ dump_summary(void)
   printf("----------\n");
   printf("parameters\n");
   printf("----------\n");
+  printf("%s backend\n", aio_backend());
   printf("%d disks\n", n_disk_path);
   printf("%d chains\n", chains);
   printf("%d threads_per_disk\n", threads_per_disk);
@@ -263,7 +294,9 @@ dump_summary(void)
   double total_seq_writes = 0;
   double total_rand_reads = 0;
   double total_secs = 0.0;
+  std::vector<ink_hrtime> latency;
   for (int i = 0; i < orig_n_accessors; i++) {
+    latency.insert(latency.end(), dev[i]->latency.begin(), dev[i]->latency.end());
     double secs = (dev[i]->time_end - dev[i]->time_start) / 1000000000.0;
     double ops_sec = (dev[i]->seq_reads + dev[i]->seq_writes + dev[i]->rand_reads) / secs;
     printf("%s: #sr:%d #sw:%d #rr:%d %0.1f secs %0.1f ops/sec\n",
@@ -290,6 +323,10 @@ dump_summary(void)
   printf("%f ops %0.2f mbytes/sec %0.1f ops/sec %0.1f ops/sec/disk rand_read\n",
          total_rand_reads, rr, total_rand_reads / total_secs, total_rand_reads / total_secs / n_disk_path);
   printf("%0.2f total mbytes/sec\n", sr + sw + rr);
+  std::sort(latency.begin(), latency.end());
+  printf("%zu ops latency usecs p50 %0.1f p99 %0.1f p99.9 %0.1f max %0.1f\n", latency.size(),
+         latency_percentile(latency, 0.5), latency_percentile(latency, 0.99),
+         latency_percentile(latency, 0.999), latency_percentile(latency, 1.0));
   printf("----------------------------------------------------------\n");
 
   if (delete_disks)
@@ -333,6 +370,10 @@ AIO_Device::do_fd(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
     time_start = ink_get_hrtime();
     fprintf(stderr, "Starting the aio_testing \n");
   }
+  if (io_start) {
+    latency.push_back(ink_get_hrtime() - io_start);
+    io_start = 0;
+  }
   if ((ink_get_hrtime() - time_start) > (run_time * HRTIME_SECOND)) {
     time_end = ink_get_hrtime();
     ink_atomic_increment(&n_accessors, -1);
@@ -357,6 +398,7 @@ AIO_Device::do_fd(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
   io->aiocb.aio_buf = buf;
   io->action = this;
   io->thread = mutex->thread_holding;
+  io_start = ink_get_hrtime();
 
   switch (select_mode(drand48())) {
   case READ_MODE:
@@ -413,20 +455,12 @@ AIO_Device::do_fd(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
                  << _s << endl; \
 				  }
 
-int
-read_config(const char *config_filename)
+static void
+read_params(std::istream & fin)
 {
-  std::ifstream fin(config_filename);
   char field_name[256];
   char field_value[256];
 
-  if (!fin.rdbuf()->is_open()) {
-    fin.open("sample.cfg");
-    if (!fin.rdbuf()->is_open()) {
-      cout << "cannot open config files " << config_filename << endl;
-      return (0);
-    }
-  }
   while (!fin.eof()) {
     field_name[0] = '\0';
     fin >> field_name;
@@ -449,6 +483,7 @@ read_config(const char *config_filename)
       PARAM(chains)
       PARAM(threads_per_disk)
       PARAM(delete_disks)
+      PARAM(io_uring)
       else if (strcmp(field_name, "disk_path") == 0) {
       assert(n_disk_path < MAX_DISK_THREADS);
       fin >> field_value;
@@ -457,6 +492,27 @@ read_config(const char *config_filename)
       n_disk_path++;
     }
   }
+}
+
+// Parameters given after the file name, as "name value" pairs, override
+// the ones of the file.
+int
+read_config(const char *config_filename, int noverrides, char *overrides[])
+{
+  std::ifstream fin(config_filename);
+  std::stringstream sin;
+
+  if (!fin.rdbuf()->is_open()) {
+    fin.open("sample.cfg");
+    if (!fin.rdbuf()->is_open()) {
+      cout << "cannot open config files " << config_filename << endl;
+      return (0);
+    }
+  }
+  read_params(fin);
+  for (int i = 0; i < noverrides; i++)
+    sin << overrides[i] << ' ';
+  read_params(sin);
   assert(read_size > 0);
   int t = seq_read_size + seq_write_size + rand_read_size;
   real_seq_read_percent = seq_read_percent;
@@ -476,7 +532,7 @@ read_config(const char *config_filename)
 }
 
 int
-main(int /* argc ATS_UNUSED */, char *argv[])
+main(int argc, char *argv[])
 {
   int i;
 
@@ -485,23 +541,30 @@ main(int /* argc ATS_UNUSED */, char *argv[])
   RecProcessInit(RECM_STAND_ALONE);
   ink_event_system_init(EVENT_SYSTEM_MODULE_VERSION);
   eventProcessor.start(ink_number_of_processors());
-#if AIO_MODE == AIO_MODE_NATIVE
-  int etype = ET_NET;
-  int n_netthreads = eventProcessor.n_threads_for_type[etype];
-  EThread **netthreads = eventProcessor.eventthread[etype];
-  for (int i = 0; i < n_netthreads; ++i) {
-    netthreads[i]->diskHandler = new DiskHandler();
-    netthreads[i]->schedule_imm(netthreads[i]->diskHandler);
-  }
-#endif
 
   RecProcessStart();
   ink_aio_init(AIO_MODULE_VERSION);
   srand48(time(NULL));
   printf("input file %s\n", argv[1]);
-  if (!read_config(argv[1]))
+  if (!read_config(argv[1], argc - 2, argv + 2))
     exit(1);
 
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
+#if AIO_MODE == AIO_MODE_IO_URING
+  aio_config_io_uring = io_uring;
+  if (aio_config_io_uring)
+#endif
+  {
+    int etype = ET_NET;
+    int n_netthreads = eventProcessor.n_threads_for_type[etype];
+    EThread **netthreads = eventProcessor.eventthread[etype];
+    for (int i = 0; i < n_netthreads; ++i) {
+      netthreads[i]->diskHandler = new DiskHandler();
+      netthreads[i]->schedule_imm(netthreads[i]->diskHandler);
+    }
+  }
+#endif
+
   max_size = seq_read_size;
   if (seq_write_size > max_size)
     max_size = seq_write_size;
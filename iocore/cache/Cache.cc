@@ -60,9 +60,13 @@ int64_t cache_config_ram_cache_size = AUTO_SIZE_RAM_CACHE;
 int cache_config_ram_cache_algorithm = 0;
 int cache_config_ram_cache_compress = 0;
 int cache_config_ram_cache_compress_percent = 90;
+int cache_config_ram_cache_compress_threads = 0;
+EventType ET_RAM_CACHE_COMPRESS = ET_CALL;
 int cache_config_ram_cache_use_seen_filter = 0;
 int cache_config_http_max_alts = 3;
 int cache_config_dir_sync_frequency = 60;
+int cache_config_dir_sync_max_bandwidth = 0;
+int cache_config_serve_while_recovering = 0;
 int cache_config_permit_pinning = 0;
 int cache_config_vary_on_user_agent = 0;
 int cache_config_select_alternate = 1;
@@ -98,6 +102,7 @@ Cache *theCache = 0;
 CacheDisk **gdisks = NULL;
 int gndisks = 0;
 static volatile int initialize_disk = 0;
+static ink_mutex vol_init_mutex = PTHREAD_MUTEX_INITIALIZER; // serializes Cache::vol_initialized()
 Cache *caches[NUM_CACHE_FRAG_TYPES] = { 0 };
 CacheSync *cacheDirSync = 0;
 Store theCacheStore;
@@ -150,7 +155,6 @@ struct VolInitInfo
   }
 };
 
-#if AIO_MODE == AIO_MODE_NATIVE
 struct VolInit : public Continuation
 {
   Vol *vol;
@@ -172,6 +176,7 @@ struct VolInit : public Continuation
   }
 };
 
+#if AIO_MODE == AIO_MODE_NATIVE
 struct DiskInit : public Continuation
 {
   CacheDisk *disk;
@@ -576,8 +581,10 @@ Vol::close_read(CacheVC *cont)
 // Cache Processor
 
 int
-CacheProcessor::start(int, size_t)
+CacheProcessor::start(int, size_t stacksize)
 {
+  if (cache_config_ram_cache_compress && cache_config_ram_cache_compress_threads > 0)
+    ET_RAM_CACHE_COMPRESS = eventProcessor.spawn_event_threads(cache_config_ram_cache_compress_threads, "ET_RAMC", stacksize);
   return start_internal(0);
 }
 
@@ -600,13 +607,19 @@ CacheProcessor::start_internal(int flags)
   ink_assert((int)TS_EVENT_CACHE_SCAN_OPERATION_FAILED == (int)CACHE_EVENT_SCAN_OPERATION_FAILED);
   ink_assert((int)TS_EVENT_CACHE_SCAN_DONE == (int)CACHE_EVENT_SCAN_DONE);
 
-#if AIO_MODE == AIO_MODE_NATIVE
-  int etype = ET_NET;
-  int n_netthreads = eventProcessor.n_threads_for_type[etype];
-  EThread **netthreads = eventProcessor.eventthread[etype];
-  for (int i = 0; i < n_netthreads; ++i) {
-    netthreads[i]->diskHandler = new DiskHandler();
-    netthreads[i]->schedule_imm(netthreads[i]->diskHandler);
+#if AIO_MODE == AIO_MODE_NATIVE || AIO_MODE == AIO_MODE_IO_URING
+#if AIO_MODE == AIO_MODE_IO_URING
+  // without a DiskHandler on the thread the request goes to the AIO threads
+  if (aio_config_io_uring)
+#endif
+  {
+    int etype = ET_NET;
+    int n_netthreads = eventProcessor.n_threads_for_type[etype];
+    EThread **netthreads = eventProcessor.eventthread[etype];
+    for (int i = 0; i < n_netthreads; ++i) {
+      netthreads[i]->diskHandler = new DiskHandler();
+      netthreads[i]->schedule_imm(netthreads[i]->diskHandler);
+    }
   }
 #endif
 
@@ -889,6 +902,73 @@ CacheProcessor::diskInitialized()
   }
 }
 
+/*
+   Give a volume its RAM cache and add it to the size and directory stats.
+   The totals are accumulated for the caller to publish.
+   */
+static void
+cache_vol_online(Vol *vol, int64_t total_size, int64_t *ram_cache_bytes, uint64_t *total_cache_bytes,
+                 uint64_t *total_direntries, uint64_t *used_direntries)
+{
+  ProxyMutex *mutex = this_ethread()->mutex;
+
+  switch (cache_config_ram_cache_algorithm) {
+    default:
+    case RAM_CACHE_ALGORITHM_CLFUS:
+      vol->ram_cache = new_RamCacheCLFUS();
+      break;
+    case RAM_CACHE_ALGORITHM_LRU:
+      vol->ram_cache = new_RamCacheLRU();
+      break;
+    case RAM_CACHE_ALGORITHM_S3FIFO:
+      vol->ram_cache = new_RamCacheS3FIFO();
+      break;
+  }
+
+  if (cache_config_ram_cache_size == AUTO_SIZE_RAM_CACHE) {
+    vol->ram_cache->init(vol_dirlen(vol) * DEFAULT_RAM_CACHE_MULTIPLIER, vol);
+    *ram_cache_bytes += vol_dirlen(vol);
+    CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) vol_dirlen(vol));
+  } else {
+    // TODO, should we check the available system memories, or you will
+    //   OOM or swapout, that is not a good situation for the server
+    int64_t http_ram_cache_size =
+      (theCache) ? (int64_t) (((double) theCache->cache_size / total_size) * cache_config_ram_cache_size) : 0;
+    int64_t stream_ram_cache_size = cache_config_ram_cache_size - http_ram_cache_size;
+    Cache *cache = vol->cache == theCache ? theCache : theStreamCache;
+    int64_t size = vol->cache == theCache ? http_ram_cache_size : stream_ram_cache_size;
+    double factor = (double) (int64_t) (vol->len >> STORE_BLOCK_SHIFT) / (int64_t) cache->cache_size;
+    Debug("cache_init", "cache_vol_online - factor = %f", factor);
+    vol->ram_cache->init((int64_t) (size * factor), vol);
+    *ram_cache_bytes += (int64_t) (size * factor);
+    CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) (size * factor));
+  }
+  Debug("cache_init", "cache_vol_online - ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
+        *ram_cache_bytes, *ram_cache_bytes / (1024 * 1024));
+#if TS_USE_INTERIM_CACHE == 1
+  vol->history.init(1<<20, 2097143);
+#endif
+
+  uint64_t vol_total_cache_bytes = vol->len - vol_dirlen(vol);
+  *total_cache_bytes += vol_total_cache_bytes;
+  CACHE_VOL_SUM_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
+  Debug("cache_init", "cache_vol_online - total_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
+        *total_cache_bytes, *total_cache_bytes / (1024 * 1024));
+
+  uint64_t vol_total_direntries = vol->buckets * vol->segments * DIR_DEPTH;
+  *total_direntries += vol_total_direntries;
+  CACHE_VOL_SUM_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
+
+  uint64_t vol_used_direntries = dir_entries_used(vol);
+  CACHE_VOL_SUM_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
+  *used_direntries += vol_used_direntries;
+
+  if (vol->header->version < cacheProcessor.min_stripe_version)
+    cacheProcessor.min_stripe_version = vol->header->version;
+  if (cacheProcessor.max_stripe_version < vol->header->version)
+    cacheProcessor.max_stripe_version = vol->header->version;
+}
+
 void
 CacheProcessor::cacheInitialized()
 {
@@ -905,12 +985,6 @@ CacheProcessor::cacheInitialized()
   uint64_t total_cache_bytes = 0;       // bytes that can used in total_size
   uint64_t total_direntries = 0;        // all the direntries in the cache
   uint64_t used_direntries = 0;         //   and used
-  uint64_t vol_total_cache_bytes = 0;
-  uint64_t vol_total_direntries = 0;
-  uint64_t vol_used_direntries = 0;
-  Vol *vol;
-
-  ProxyMutex *mutex = this_ethread()->mutex;
 
   if (theCache) {
     total_size += theCache->cache_size;
@@ -945,17 +1019,9 @@ CacheProcessor::cacheInitialized()
     }
   }
 
-  // Update stripe version data.
+  // Update stripe version data, cache_vol_online() scans the rest of the stripes.
   if (gnvol) // start with whatever the first stripe is.
     cacheProcessor.min_stripe_version = cacheProcessor.max_stripe_version = gvol[0]->header->version;
-  // scan the rest of the stripes.
-  for (i = 1; i < gnvol; i++) {
-    Vol* v = gvol[i];
-    if (v->header->version < cacheProcessor.min_stripe_version)
-      cacheProcessor.min_stripe_version = v->header->version;
-    if (cacheProcessor.max_stripe_version < v->header->version)
-      cacheProcessor.max_stripe_version = v->header->version;
-  }
 
 
   if (caches_ready) {
@@ -965,106 +1031,10 @@ CacheProcessor::cacheInitialized()
     int64_t ram_cache_bytes = 0;
 
     if (gnvol) {
-      // new ram_caches, with algorithm from the config
-      for (i = 0; i < gnvol; i++) {
-        switch (cache_config_ram_cache_algorithm) {
-          default:
-          case RAM_CACHE_ALGORITHM_CLFUS:
-            gvol[i]->ram_cache = new_RamCacheCLFUS();
-            break;
-          case RAM_CACHE_ALGORITHM_LRU:
-            gvol[i]->ram_cache = new_RamCacheLRU();
-            break;
-        }
-      }
-      // let us calculate the Size
-      if (cache_config_ram_cache_size == AUTO_SIZE_RAM_CACHE) {
-        Debug("cache_init", "CacheProcessor::cacheInitialized - cache_config_ram_cache_size == AUTO_SIZE_RAM_CACHE");
-        for (i = 0; i < gnvol; i++) {
-          vol = gvol[i];
-          gvol[i]->ram_cache->init(vol_dirlen(vol) * DEFAULT_RAM_CACHE_MULTIPLIER, vol);
-#if TS_USE_INTERIM_CACHE == 1
-          gvol[i]->history.init(1<<20, 2097143);
-#endif
-          ram_cache_bytes += vol_dirlen(gvol[i]);
-          Debug("cache_init", "CacheProcessor::cacheInitialized - ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                ram_cache_bytes, ram_cache_bytes / (1024 * 1024));
-          CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) vol_dirlen(gvol[i]));
-
-          vol_total_cache_bytes = gvol[i]->len - vol_dirlen(gvol[i]);
-          total_cache_bytes += vol_total_cache_bytes;
-          Debug("cache_init", "CacheProcessor::cacheInitialized - total_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                total_cache_bytes, total_cache_bytes / (1024 * 1024));
-
-          CACHE_VOL_SUM_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
-
-
-          vol_total_direntries = gvol[i]->buckets * gvol[i]->segments * DIR_DEPTH;
-          total_direntries += vol_total_direntries;
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
-
-
-          vol_used_direntries = dir_entries_used(gvol[i]);
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
-          used_direntries += vol_used_direntries;
-        }
-
-      } else {
-        // we got configured memory size
-        // TODO, should we check the available system memories, or you will
-        //   OOM or swapout, that is not a good situation for the server
-        Debug("cache_init", "CacheProcessor::cacheInitialized - %" PRId64 " != AUTO_SIZE_RAM_CACHE",
-              cache_config_ram_cache_size);
-        int64_t http_ram_cache_size =
-          (theCache) ? (int64_t) (((double) theCache->cache_size / total_size) * cache_config_ram_cache_size) : 0;
-        Debug("cache_init", "CacheProcessor::cacheInitialized - http_ram_cache_size = %" PRId64 " = %" PRId64 "Mb",
-              http_ram_cache_size, http_ram_cache_size / (1024 * 1024));
-        int64_t stream_ram_cache_size = cache_config_ram_cache_size - http_ram_cache_size;
-        Debug("cache_init", "CacheProcessor::cacheInitialized - stream_ram_cache_size = %" PRId64 " = %" PRId64 "Mb",
-              stream_ram_cache_size, stream_ram_cache_size / (1024 * 1024));
-
-        // Dump some ram_cache size information in debug mode.
-        Debug("ram_cache", "config: size = %" PRId64 ", cutoff = %" PRId64 "",
-              cache_config_ram_cache_size, cache_config_ram_cache_cutoff);
-
-        for (i = 0; i < gnvol; i++) {
-          vol = gvol[i];
-          double factor;
-          if (gvol[i]->cache == theCache) {
-            factor = (double) (int64_t) (gvol[i]->len >> STORE_BLOCK_SHIFT) / (int64_t) theCache->cache_size;
-            Debug("cache_init", "CacheProcessor::cacheInitialized - factor = %f", factor);
-            gvol[i]->ram_cache->init((int64_t) (http_ram_cache_size * factor), vol);
-            ram_cache_bytes += (int64_t) (http_ram_cache_size * factor);
-            CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) (http_ram_cache_size * factor));
-          } else {
-            factor = (double) (int64_t) (gvol[i]->len >> STORE_BLOCK_SHIFT) / (int64_t) theStreamCache->cache_size;
-            Debug("cache_init", "CacheProcessor::cacheInitialized - factor = %f", factor);
-            gvol[i]->ram_cache->init((int64_t) (stream_ram_cache_size * factor), vol);
-            ram_cache_bytes += (int64_t) (stream_ram_cache_size * factor);
-            CACHE_VOL_SUM_DYN_STAT(cache_ram_cache_bytes_total_stat, (int64_t) (stream_ram_cache_size * factor));
-          }
-          Debug("cache_init", "CacheProcessor::cacheInitialized[%d] - ram_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                i, ram_cache_bytes, ram_cache_bytes / (1024 * 1024));
-#if TS_USE_INTERIM_CACHE == 1
-          gvol[i]->history.init(1<<20, 2097143);
-#endif
-          vol_total_cache_bytes = gvol[i]->len - vol_dirlen(gvol[i]);
-          total_cache_bytes += vol_total_cache_bytes;
-          CACHE_VOL_SUM_DYN_STAT(cache_bytes_total_stat, vol_total_cache_bytes);
-          Debug("cache_init", "CacheProcessor::cacheInitialized - total_cache_bytes = %" PRId64 " = %" PRId64 "Mb",
-                total_cache_bytes, total_cache_bytes / (1024 * 1024));
-
-          vol_total_direntries = gvol[i]->buckets * gvol[i]->segments * DIR_DEPTH;
-          total_direntries += vol_total_direntries;
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_total_stat, vol_total_direntries);
-
-
-          vol_used_direntries = dir_entries_used(gvol[i]);
-          CACHE_VOL_SUM_DYN_STAT(cache_direntries_used_stat, vol_used_direntries);
-          used_direntries += vol_used_direntries;
-
-        }
-      }
+      Debug("ram_cache", "config: size = %" PRId64 ", cutoff = %" PRId64 "",
+            cache_config_ram_cache_size, cache_config_ram_cache_cutoff);
+      for (i = 0; i < gnvol; i++)
+        cache_vol_online(gvol[i], total_size, &ram_cache_bytes, &total_cache_bytes, &total_direntries, &used_direntries);
       switch (cache_config_ram_cache_compress) {
         default:
           Fatal("unknown RAM cache compression type: %d", cache_config_ram_cache_compress);
@@ -1079,6 +1049,16 @@ CacheProcessor::cacheInitialized()
         case CACHE_COMPRESSION_LIBLZMA:
 #if ! TS_HAS_LZMA
           Fatal("lzma not available for RAM cache compression");
+#endif
+          break;
+        case CACHE_COMPRESSION_LZ4:
+#if ! TS_HAS_LZ4
+          Fatal("lz4 not available for RAM cache compression");
+#endif
+          break;
+        case CACHE_COMPRESSION_ZSTD:
+#if ! TS_HAS_ZSTD
+          Fatal("zstd not available for RAM cache compression");
 #endif
           break;
       }
@@ -1297,6 +1277,13 @@ Vol::init(char *s, off_t blocks, off_t dir_skip, bool clear)
   dir = (Dir *) (raw_dir + vol_headerlen(this));
   header = (VolHeaderFooter *) raw_dir;
   footer = (VolHeaderFooter *) (raw_dir + vol_dirlen(this) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter)));
+  dir_seq = (volatile uint32_t *)ats_malloc(segments * sizeof(uint32_t));
+  memset((void *) dir_seq, 0, segments * sizeof(uint32_t));
+  // nothing is known to be on disk yet, the first sync of each copy writes it all
+  dir_dirty = (uint8_t *)ats_malloc(segments);
+  memset(dir_dirty, DIR_SEGMENT_DIRTY_ALL, segments);
+  dir_seg_checksum = (uint32_t *)ats_malloc(2 * segments * sizeof(uint32_t));
+  memset(dir_seg_checksum, 0, 2 * segments * sizeof(uint32_t));
 
 #if TS_USE_INTERIM_CACHE == 1
   num_interim_vols = good_interim_disks;
@@ -1399,6 +1386,19 @@ Vol::handle_dir_read(int event, void *data)
   }
   CHECK_DIR(this);
 
+  // directories synced before the checksum was kept have it as 0
+  if (header->dir_checksum) {
+    uint32_t sum = dir_checksum(this);
+    if (sum != header->dir_checksum) {
+      Warning("cache directory checksum mismatch for '%s' (%u != %u), clearing", hash_text.get(), sum, header->dir_checksum);
+      GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_directory_checksum_failure_stat, 1);
+      Note("clearing cache directory '%s'", hash_text.get());
+      clear_dir();
+      return EVENT_DONE;
+    }
+    GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_directory_checksum_verified_stat, 1);
+  }
+
   sector_size = header->sector_size;
 
 #if TS_USE_INTERIM_CACHE == 1
@@ -1685,6 +1685,7 @@ Ldone:{
     size_t dirlen = vol_dirlen(this);
     int B = header->sync_serial & 1;
     off_t ss = skip + (B ? dirlen : 0);
+    header->dir_checksum = dir_checksum(this, B);
 
     init_info->vol_aio[0].aiocb.aio_buf = raw_dir;
     init_info->vol_aio[0].aiocb.aio_nbytes = footerlen;
@@ -1788,14 +1789,8 @@ Vol::dir_init_done(int /* event ATS_UNUSED */, void * /* data ATS_UNUSED */ )
     eventProcessor.schedule_in(this, HRTIME_MSECONDS(5), ET_CALL);
     return EVENT_CONT;
   } else {
-    int vol_no = ink_atomic_increment(&gnvol, 1);
-    ink_assert(!gvol[vol_no]);
-    gvol[vol_no] = this;
     SET_HANDLER(&Vol::aggWrite);
-    if (fd == -1)
-      cache->vol_initialized(0);
-    else
-      cache->vol_initialized(1);
+    cache->vol_initialized(this, fd != -1);
     return EVENT_DONE;
   }
 }
@@ -2047,7 +2042,7 @@ build_vol_hash_table(CacheHostRecord *cp)
   uint64_t used = 0;
   // initialize number of elements per vol
   for (int i = 0; i < num_vols; i++) {
-    if (DISK_BAD(cp->vols[i]->disk)) {
+    if (DISK_BAD(cp->vols[i]->disk) || cp->vols[i]->recovering) {
       bad_vols++;
       continue;
     }
@@ -2134,12 +2129,49 @@ build_vol_hash_table(CacheHostRecord *cp)
   ats_free(rtable);
 }
 
+/*
+   Called once per volume when its directory has been read (or cleared)
+   and recovered. Normally the cache opens after the last volume. With
+   proxy.config.cache.serve_while_recovering it opens with the first good
+   volume and the rest are added to the vol hash tables as they finish.
+   */
 void
-Cache::vol_initialized(bool result) {
+Cache::vol_initialized(Vol *vol, bool result) {
+  ink_scoped_mutex lock(vol_init_mutex);
+
+  Note("cache volume '%s' %s in %.3f seconds", vol->hash_text.get(), result ? "initialized" : "failed",
+       (double) (ink_get_hrtime() - vol->init_start) / HRTIME_SECOND);
   if (result)
     ink_atomic_increment(&total_good_nvol, 1);
-  if (total_nvol == ink_atomic_increment(&total_initialized_vol, 1) + 1)
-    open_done();
+  bool all = total_nvol == ink_atomic_increment(&total_initialized_vol, 1) + 1;
+
+  if (hosttable && ready != CACHE_INITIALIZING && CacheProcessor::initialized == CACHE_INITIALIZED) {
+    // the cache is serving, set the volume up before it is mapped
+    int64_t ram_cache_bytes = 0;
+    uint64_t total_cache_bytes = 0, total_direntries = 0, used_direntries = 0;
+    int64_t total_size = (theCache ? theCache->cache_size : 0) + (theStreamCache ? theStreamCache->cache_size : 0);
+
+    cache_vol_online(vol, total_size, &ram_cache_bytes, &total_cache_bytes, &total_direntries, &used_direntries);
+    GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_ram_cache_bytes_total_stat, ram_cache_bytes);
+    GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_bytes_total_stat, total_cache_bytes);
+    GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_direntries_total_stat, total_direntries);
+    GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_direntries_used_stat, used_direntries);
+  }
+  gvol[gnvol] = vol;
+  ink_atomic_increment(&gnvol, 1);
+  vol->recovering = false;
+
+  if (!hosttable) {
+    if (all || (result && cache_config_serve_while_recovering))
+      open_done();
+    return;
+  }
+  rebuild_host_table(this);
+  if (ready == CACHE_INITIALIZING && (all || hosttable->gen_host_rec.vol_hash_table)) {
+    ready = CACHE_INITIALIZED;
+    cacheProcessor.cacheInitialized();
+  }
+  // otherwise cacheInitialized() has yet to run and picks this volume up from gvol
 }
 
 /** Set the state of a disk programmatically.
@@ -2280,6 +2312,8 @@ Cache::open_done() {
 
   if (hosttable->gen_host_rec.num_cachevols == 0)
     ready = CACHE_INIT_FAILED;
+  else if (!hosttable->gen_host_rec.vol_hash_table && total_initialized_vol < total_nvol)
+    return 0; // only volumes still recovering, vol_initialized() finishes the job
   else
     ready = CACHE_INITIALIZED;
   cacheProcessor.cacheInitialized();
@@ -2318,11 +2352,10 @@ Cache::open(bool clear, bool /* fix ATS_UNUSED */) {
             blocks = q->b->len;
 
             bool vol_clear = clear || d->cleared || q->new_block;
-#if AIO_MODE == AIO_MODE_NATIVE
+            // spread the directory reads, clears and recovery over the event threads
+            cp->vols[vol_no]->recovering = true;
+            cp->vols[vol_no]->init_start = ink_get_hrtime();
             eventProcessor.schedule_imm(new VolInit(cp->vols[vol_no], d->path, blocks, q->b->offset, vol_clear));
-#else
-            cp->vols[vol_no]->init(d->path, blocks, q->b->offset, vol_clear);
-#endif
             vol_no++;
             cache_size += blocks;
           }
@@ -2782,6 +2815,12 @@ Cache::lookup(Continuation *cont, CacheKey *key, CacheFragType type, char const*
 
   Vol *vol = key_to_vol(key, hostname, host_len);
   ProxyMutex *mutex = cont->mutex;
+  Dir result;
+  if (!dir_probe_shared(key, vol, &result) && !vol->open_dir.may_have_writer(key)) {
+    CACHE_INCREMENT_DYN_STAT(cache_lookup_failure_stat);
+    cont->handleEvent(CACHE_EVENT_LOOKUP_FAILED, (void *) -ECACHE_NO_DOC);
+    return ACTION_RESULT_DONE;
+  }
   CacheVC *c = new_CacheVC(cont);
   SET_CONTINUATION_HANDLER(c, &CacheVC::openReadStartHead);
   c->vio.op = VIO::READ;
@@ -3471,6 +3510,23 @@ register_cache_stats(RecRawStatBlock *rsb, const char *prefix)
   REG_INT("hdr_marshal_bytes", cache_hdr_marshal_bytes_stat);
   REG_INT("gc_bytes_evacuated", cache_gc_bytes_evacuated_stat);
   REG_INT("gc_frags_evacuated", cache_gc_frags_evacuated_stat);
+  REG_INT("directory_sync.bytes", cache_directory_sync_bytes_stat);
+  REG_INT("directory_sync.segments", cache_directory_sync_segments_stat);
+  REG_INT("directory_checksum.verified", cache_directory_checksum_verified_stat);
+  REG_INT("directory_checksum.failure", cache_directory_checksum_failure_stat);
+
+  static const char *compress_names[CACHE_COMPRESSION_TYPES] = { "none", "fastlz", "libz", "liblzma", "lz4", "zstd" };
+  for (int i = CACHE_COMPRESSION_FASTLZ; i < CACHE_COMPRESSION_TYPES; i++) {
+    char name[64];
+    snprintf(name, sizeof(name), "ram_cache.compress.%s.bytes_in", compress_names[i]);
+    REG_INT(name, cache_ram_cache_compress_bytes_in_stat + i);
+    snprintf(name, sizeof(name), "ram_cache.compress.%s.bytes_out", compress_names[i]);
+    REG_INT(name, cache_ram_cache_compress_bytes_out_stat + i);
+    snprintf(name, sizeof(name), "ram_cache.compress.%s.compress_time", compress_names[i]);
+    REG_INT(name, cache_ram_cache_compress_time_stat + i);
+    snprintf(name, sizeof(name), "ram_cache.compress.%s.decompress_time", compress_names[i]);
+    REG_INT(name, cache_ram_cache_decompress_time_stat + i);
+  }
 }
 
 
@@ -3488,6 +3544,7 @@ ink_cache_init(ModuleVersion v)
   REC_EstablishStaticConfigInt32(cache_config_ram_cache_algorithm, "proxy.config.cache.ram_cache.algorithm");
   REC_EstablishStaticConfigInt32(cache_config_ram_cache_compress, "proxy.config.cache.ram_cache.compress");
   REC_EstablishStaticConfigInt32(cache_config_ram_cache_compress_percent, "proxy.config.cache.ram_cache.compress_percent");
+  REC_EstablishStaticConfigInt32(cache_config_ram_cache_compress_threads, "proxy.config.cache.ram_cache.compress_threads");
   REC_EstablishStaticConfigInt32(cache_config_ram_cache_use_seen_filter, "proxy.config.cache.ram_cache.use_seen_filter");
 
   REC_EstablishStaticConfigInt32(cache_config_http_max_alts, "proxy.config.cache.limits.http.max_alts");
@@ -3502,6 +3559,10 @@ ink_cache_init(ModuleVersion v)
 
   REC_EstablishStaticConfigInt32(cache_config_dir_sync_frequency, "proxy.config.cache.dir.sync_frequency");
   Debug("cache_init", "proxy.config.cache.dir.sync_frequency = %d", cache_config_dir_sync_frequency);
+  REC_EstablishStaticConfigInt32(cache_config_dir_sync_max_bandwidth, "proxy.config.cache.dir.sync_max_bandwidth");
+  Debug("cache_init", "proxy.config.cache.dir.sync_max_bandwidth = %d", cache_config_dir_sync_max_bandwidth);
+  REC_EstablishStaticConfigInt32(cache_config_serve_while_recovering, "proxy.config.cache.serve_while_recovering");
+  Debug("cache_init", "proxy.config.cache.serve_while_recovering = %d", cache_config_serve_while_recovering);
 
   REC_EstablishStaticConfigInt32(cache_config_vary_on_user_agent, "proxy.config.cache.vary_on_user_agent");
   Debug("cache_init", "proxy.config.cache.vary_on_user_agent = %d", cache_config_vary_on_user_agent);
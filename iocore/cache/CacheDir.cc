@@ -171,6 +171,28 @@ OpenDirEntry::wait(CacheVC *cont, int msec)
 // Cache Directory
 //
 
+// Segment writers hold the volume lock and make the segment's sequence
+// number odd while they change it, see dir_probe_shared(). Nested
+// writers (e.g. dir_insert -> freelist_clean) leave it to the outermost.
+struct DirSegmentWriter
+{
+  Vol *vol;
+  int seg;
+  bool owner;
+
+  DirSegmentWriter(Vol *d, int s) : vol(d), seg(s), owner(!(d->dir_seq[s] & 1))
+  {
+    vol->dir_dirty[seg] = DIR_SEGMENT_DIRTY_ALL;
+    if (owner)
+      ink_atomic_increment(&vol->dir_seq[seg], 1);
+  }
+  ~DirSegmentWriter()
+  {
+    if (owner)
+      ink_atomic_increment(&vol->dir_seq[seg], 1);
+  }
+};
+
 // return value 1 means no loop
 // zero indicates loop
 int
@@ -203,6 +225,7 @@ dir_bucket_loop_check(Dir *start_dir, Dir *seg)
 void
 dir_init_segment(int s, Vol *d)
 {
+  DirSegmentWriter w(d, s);
   d->header->freelist[s] = 0;
   Dir *seg = dir_segment(s, d);
   int l, b;
@@ -356,6 +379,7 @@ dir_clean_bucket(Dir *b, int s, Vol *vol)
 void
 dir_clean_segment(int s, Vol *d)
 {
+  DirSegmentWriter w(d, s);
   Dir *seg = dir_segment(s, d);
   for (int64_t i = 0; i < d->buckets; i++) {
     dir_clean_bucket(dir_bucket(i, seg), s, d);
@@ -391,6 +415,7 @@ void
 clear_interimvol_dir(Vol *v, int offset)
 {
   for (int i = 0; i < v->segments; i++) {
+    DirSegmentWriter w(v, i);
     Dir *seg = dir_segment(i, v);
     for (int j = 0; j < v->buckets; j++) {
       interim_dir_clean_bucket(dir_bucket(j, seg), i, v, offset);
@@ -430,6 +455,7 @@ dir_clean_bucket(Dir *b, int s, InterimCacheVol *d)
 void
 dir_clean_segment(int s, InterimCacheVol *d)
 {
+  DirSegmentWriter w(d->vol, s);
   Dir *seg = dir_segment(s, d->vol);
   for (int i = 0; i < d->vol->buckets; i++) {
     dir_clean_bucket(dir_bucket(i, seg), s, d);
@@ -466,14 +492,18 @@ dir_clean_range_interimvol(off_t start, off_t end, InterimCacheVol *svol)
 void
 dir_clear_range(off_t start, off_t end, Vol *vol)
 {
-  for (off_t i = 0; i < vol->buckets * DIR_DEPTH * vol->segments; i++) {
-    Dir *e = dir_index(vol, i);
-    if (!dir_token(e) && dir_offset(e) >= (int64_t)start && dir_offset(e) < (int64_t)end) {
-      CACHE_DEC_DIR_USED(vol->mutex);
-      dir_set_offset(e, 0);     // delete
+  for (int s = 0; s < vol->segments; s++) {
+    DirSegmentWriter w(vol, s);
+    Dir *seg = dir_segment(s, vol);
+    for (off_t i = 0; i < vol->buckets * DIR_DEPTH; i++) {
+      Dir *e = dir_in_seg(seg, i);
+      if (!dir_token(e) && dir_offset(e) >= (int64_t)start && dir_offset(e) < (int64_t)end) {
+        CACHE_DEC_DIR_USED(vol->mutex);
+        dir_set_offset(e, 0);     // delete
+      }
     }
+    dir_clean_segment(s, vol);
   }
-  dir_clean_vol(vol);
 }
 
 void
@@ -491,6 +521,7 @@ check_bucket_not_contains(Dir *b, Dir *e, Dir *seg)
 void
 freelist_clean(int s, Vol *vol)
 {
+  DirSegmentWriter w(vol, s);
   dir_clean_segment(s, vol);
   if (vol->header->freelist[s])
     return;
@@ -578,6 +609,7 @@ dir_segment_accounted(int s, Vol *d, int offby, int *f, int *u, int *et, int *v,
 void
 dir_free_entry(Dir *e, int s, Vol *d)
 {
+  DirSegmentWriter w(d, s);
   Dir *seg = dir_segment(s, d);
   unsigned int fo = d->header->freelist[s];
   unsigned int eo = dir_to_offset(e, seg);
@@ -633,6 +665,7 @@ Lagain:
           return 1;
         } else {                // delete the invalid entry
           CACHE_DEC_DIR_USED(d->mutex);
+          DirSegmentWriter w(d, s);
           e = dir_delete_entry(e, p, s, d);
           continue;
         }
@@ -653,6 +686,55 @@ Lagain:
   return 0;
 }
 
+/*
+   Probe the directory without the volume lock. The segment is read
+   between two loads of its sequence number and the read is retried if a
+   writer was active. Returns 1 and fills in result on a hit, 0 on a miss
+   and -1 if no stable view could be had (or the bucket is corrupt), in
+   which case the caller should fall back to dir_probe() under the lock.
+   Unlike dir_probe() this never cleans up invalid entries and does not
+   track collisions.
+   */
+int
+dir_probe_shared(CacheKey *key, Vol *d, Dir *result)
+{
+  int s = key->slice32(0) % d->segments;
+  int b = key->slice32(1) % d->buckets;
+  Dir *seg = dir_segment(s, d);
+  Dir *seg_end = dir_in_seg(seg, d->buckets * DIR_DEPTH);
+
+  for (int retry = 0; retry < DIR_PROBE_SHARED_RETRIES; retry++) {
+    // back off while a writer is in the segment, longer each time
+    if (retry)
+      for (int i = 0; i < (1 << retry); i++)
+        ink_pause();
+    uint32_t seq = d->dir_seq[s];
+    if (seq & 1)
+      continue;
+    __sync_synchronize();
+    int res = 0, n = 0;
+    Dir *e = dir_bucket(b, seg);
+    if (dir_offset(e))
+      do {
+        if (dir_compare_tag(e, key) && dir_valid(d, e)) {
+          dir_assign(result, e);
+          res = 1;
+          break;
+        }
+        e = next_dir(e, seg);
+        // a torn read can leave the chain pointing anywhere
+        if (e >= seg_end || ++n > d->buckets * DIR_DEPTH) {
+          res = -1;
+          break;
+        }
+      } while (e);
+    __sync_synchronize();
+    if (d->dir_seq[s] == seq)
+      return res;
+  }
+  return -1;
+}
+
 int
 dir_insert(CacheKey *key, Vol *d, Dir *to_part)
 {
@@ -664,6 +746,7 @@ dir_insert(CacheKey *key, Vol *d, Dir *to_part)
   Dir *e = NULL;
   Dir *b = dir_bucket(bi, seg);
   Vol *vol = d;
+  DirSegmentWriter w(d, s);
 #if defined(DEBUG) && defined(DO_CHECK_DIR_FAST)
   unsigned int t = DIR_MASK_TAG(key->slice32(2));
   Dir *col = b;
@@ -731,6 +814,7 @@ dir_overwrite(CacheKey *key, Vol *d, Dir *dir, Dir *overwrite, bool must_overwri
   bool loop_possible = true;
 #endif
   Vol *vol = d;
+  DirSegmentWriter w(d, s);
   CHECK_DIR(d);
 
   ink_assert((unsigned int) dir_approx_size(dir) <= (unsigned int) (MAX_FRAG_SIZE + sizeofDoc));        // XXX - size should be unsigned
@@ -804,6 +888,7 @@ dir_delete(CacheKey *key, Vol *d, Dir *del)
   int loop_count = 0;
 #endif
   Vol *vol = d;
+  DirSegmentWriter w(d, s);
   CHECK_DIR(d);
 
   e = dir_bucket(b, seg);
@@ -993,6 +1078,45 @@ dir_entries_used(Vol *d)
   return full;
 }
 
+static uint32_t
+dir_segment_checksum(Vol *d, int s)
+{
+  // segments are DIR_DEPTH * SIZEOF_DIR * buckets long, always a multiple of 8
+  const uint64_t *p = (const uint64_t *) dir_segment(s, d);
+  const uint64_t *e = p + (d->buckets * DIR_DEPTH * SIZEOF_DIR) / sizeof(uint64_t);
+  uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t) s;
+  while (p < e)
+    h = (h ^ *p++) * 0x100000001b3ULL;
+  return (uint32_t) (h ^ (h >> 32));
+}
+
+static uint32_t
+dir_checksum_fold(Vol *d, int copy)
+{
+  uint32_t sum = 0;
+  for (int s = 0; s < d->segments; s++)
+    sum += d->dir_seg_checksum[copy * d->segments + s];
+  return sum ? sum : 1;
+}
+
+/*
+ * Checksum of the in memory directory segments as stored in the header
+ * dir_checksum. If copy is given the per segment checksums are recorded
+ * for that copy, the caller is about to write the whole directory there.
+ */
+uint32_t
+dir_checksum(Vol *d, int copy)
+{
+  uint32_t sum = 0;
+  for (int s = 0; s < d->segments; s++) {
+    uint32_t c = dir_segment_checksum(d, s);
+    if (copy >= 0)
+      d->dir_seg_checksum[copy * d->segments + s] = c;
+    sum += c;
+  }
+  return sum ? sum : 1;
+}
+
 /*
  * this function flushes the cache meta data to disk when
  * the cache is shutdown. Must *NOT* be used during regular
@@ -1091,8 +1215,9 @@ sync_cache_dir_on_shutdown(void)
     }
 #endif
     CHECK_DIR(d);
-    memcpy(buf, d->raw_dir, dirlen);
     size_t B = d->header->sync_serial & 1;
+    d->header->dir_checksum = dir_checksum(d, B);
+    memcpy(buf, d->raw_dir, dirlen);
     off_t start = d->skip + (B ? dirlen : 0);
     B = pwrite(d->fd, buf, dirlen, start);
     ink_assert(B == dirlen);
@@ -1105,6 +1230,84 @@ sync_cache_dir_on_shutdown(void)
 
 
 
+/*
+   Copy the header, footer and every segment which is stale in the given
+   on disk copy into buf, at the same offsets as in raw_dir. Ranges are
+   widened to STORE_BLOCK_SIZE, segments pulled in that way are clean for
+   this copy so rewriting them is harmless. Returns the number of
+   segments captured.
+   */
+int
+CacheSync::snapshot(Vol *d, int copy)
+{
+  size_t dirlen = vol_dirlen(d);
+  off_t headerlen = vol_headerlen(d);
+  off_t footerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
+  off_t body_end = dirlen - footerlen;
+  off_t seglen = d->buckets * DIR_DEPTH * SIZEOF_DIR;
+  int n = 0;
+
+  if (buflen < dirlen) {
+    if (buf)
+      ats_memalign_free(buf);
+    buf = (char *)ats_memalign(ats_pagesize(), dirlen);
+    buflen = dirlen;
+  }
+  if (nsegs < d->segments) {
+    segs = (uint8_t *)ats_realloc(segs, d->segments);
+    nsegs = d->segments;
+  }
+  for (int s = 0; s < d->segments; s++) {
+    segs[s] = d->dir_dirty[s] & DIR_SEGMENT_DIRTY(copy);
+    if (!segs[s])
+      continue;
+    d->dir_dirty[s] &= ~DIR_SEGMENT_DIRTY(copy);
+    d->dir_seg_checksum[copy * d->segments + s] = dir_segment_checksum(d, s);
+    off_t a = ROUND_DOWN_TO_STORE_BLOCK(headerlen + s * seglen);
+    off_t e = ROUND_TO_STORE_BLOCK(headerlen + (s + 1) * seglen);
+    if (e > body_end)
+      e = body_end;
+    memcpy(buf + a, d->raw_dir + a, e - a);
+    n++;
+  }
+  d->header->dir_checksum = dir_checksum_fold(d, copy);
+  memcpy(buf, d->raw_dir, headerlen);
+  memcpy(buf + body_end, d->raw_dir + body_end, footerlen);
+  return n;
+}
+
+/*
+   Find the next run of captured segments at or after writepos, coalesced
+   up to SYNC_MAX_WRITE. Returns false if there is nothing left to write
+   before the footer.
+   */
+bool
+CacheSync::next_write(Vol *d, off_t *pos, int *len)
+{
+  off_t headerlen = vol_headerlen(d);
+  off_t body_end = vol_dirlen(d) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
+  off_t seglen = d->buckets * DIR_DEPTH * SIZEOF_DIR;
+  int s = (writepos - headerlen) / seglen;
+
+  while (s < d->segments && !segs[s])
+    s++;
+  if (s >= d->segments)
+    return false;
+  off_t a = ROUND_DOWN_TO_STORE_BLOCK(headerlen + s * seglen);
+  if (a < writepos)
+    a = writepos;
+  off_t e = a;
+  for (; s < d->segments && segs[s] && e - a < SYNC_MAX_WRITE; s++)
+    e = ROUND_TO_STORE_BLOCK(headerlen + (s + 1) * seglen);
+  if (e > body_end)
+    e = body_end;
+  if (e - a > SYNC_MAX_WRITE)
+    e = a + SYNC_MAX_WRITE;
+  *pos = a;
+  *len = (int)(e - a);
+  return e > a;
+}
+
 int
 CacheSync::mainEvent(int event, Event *e)
 {
@@ -1132,10 +1335,15 @@ Lrestart:
     // AIO Thread
     if (io.aio_result != (int64_t)io.aiocb.aio_nbytes) {
       Warning("vol write error during directory sync '%s'", gvol[vol]->hash_text.get());
-      event = EVENT_NONE;
-      goto Ldone;
+      write_error = true;
+      trigger = eventProcessor.schedule_imm(this);
+      return EVENT_CONT;
     }
-    trigger = eventProcessor.schedule_in(this, SYNC_DELAY);
+    GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_directory_sync_bytes_stat, io.aiocb.aio_nbytes);
+    ink_hrtime delay = SYNC_DELAY;
+    if (cache_config_dir_sync_max_bandwidth > 0)
+      delay = HRTIME_SECONDS(1) * (int64_t)io.aiocb.aio_nbytes / cache_config_dir_sync_max_bandwidth;
+    trigger = eventProcessor.schedule_in(this, delay);
     return EVENT_CONT;
   }
   {
@@ -1152,8 +1360,20 @@ Lrestart:
     if (DISK_BAD(d->disk))
       goto Ldone;
 
-    int headerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
+    off_t headerlen = vol_headerlen(d);
+    off_t footerlen = ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter));
     size_t dirlen = vol_dirlen(d);
+    size_t B = d->header->sync_serial & 1;
+    off_t start = d->skip + (B ? dirlen : 0);
+
+    if (write_error) {
+      // the copy on disk is unusable until rewritten in full
+      for (int s = 0; s < d->segments; s++)
+        d->dir_dirty[s] |= DIR_SEGMENT_DIRTY(B);
+      d->dir_sync_in_progress = 0;
+      write_error = false;
+      goto Ldone;
+    }
     if (!writepos) {
       // start
       Debug("cache_dir_sync", "sync started");
@@ -1184,12 +1404,6 @@ Lrestart:
       }
       Debug("cache_dir_sync", "pos: %" PRIu64 " Dir %s dirty...syncing to disk", d->header->write_pos, d->hash_text.get());
       d->header->dirty = 0;
-      if (buflen < dirlen) {
-        if (buf)
-          ats_memalign_free(buf);
-        buf = (char *)ats_memalign(ats_pagesize(), dirlen);
-        buflen = dirlen;
-      }
       d->header->sync_serial++;
       d->footer->sync_serial = d->header->sync_serial;
 #if TS_USE_INTERIM_CACHE == 1
@@ -1198,28 +1412,30 @@ Lrestart:
       }
 #endif
       CHECK_DIR(d);
-      memcpy(buf, d->raw_dir, dirlen);
+      B = d->header->sync_serial & 1;
+      start = d->skip + (B ? dirlen : 0);
+      int n = snapshot(d, B);
+      GLOBAL_CACHE_SUM_GLOBAL_DYN_STAT(cache_directory_sync_segments_stat, n);
+      Debug("cache_dir_sync", "Dir %s: %d of %d segments dirty, checksum %u", d->hash_text.get(), n, d->segments,
+            d->header->dir_checksum);
       d->dir_sync_in_progress = 1;
     }
-    size_t B = d->header->sync_serial & 1;
-    off_t start = d->skip + (B ? dirlen : 0);
 
+    off_t pos;
+    int l;
     if (!writepos) {
       // write header
-      aio_write(d->fd, buf + writepos, headerlen, start + writepos);
-      writepos += headerlen;
-    } else if (writepos < (off_t)dirlen - headerlen) {
-      // write part of body
-      int l = SYNC_MAX_WRITE;
-      if (writepos + l > (off_t)dirlen - headerlen)
-        l = dirlen - headerlen - writepos;
-      aio_write(d->fd, buf + writepos, l, start + writepos);
-      writepos += l;
+      aio_write(d->fd, buf, headerlen, start);
+      writepos = headerlen;
+    } else if (writepos < (off_t)dirlen - footerlen && next_write(d, &pos, &l)) {
+      // write a run of dirty segments
+      aio_write(d->fd, buf + pos, l, start + pos);
+      writepos = pos + l;
     } else if (writepos < (off_t)dirlen) {
-      ink_assert(writepos == (off_t)dirlen - headerlen);
       // write footer
-      aio_write(d->fd, buf + writepos, headerlen, start + writepos);
-      writepos += headerlen;
+      writepos = dirlen - footerlen;
+      aio_write(d->fd, buf + writepos, footerlen, start + writepos);
+      writepos += footerlen;
     } else {
       d->dir_sync_in_progress = 0;
       goto Ldone;
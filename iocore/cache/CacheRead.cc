@@ -30,6 +30,25 @@
 #define READ_WHILE_WRITER 1
 extern int cache_config_compatibility_4_2_0_fixup;
 
+// Look the first fragment up in the RAM cache without the volume lock.
+// Only engines whose get() is internally synchronized can be asked.
+#if TS_USE_INTERIM_CACHE == 1
+static inline bool
+ram_hit_unlocked(Vol *, CacheKey *, Dir *, Ptr<IOBufferData> *)
+{
+  return false;
+}
+#else
+static bool
+ram_hit_unlocked(Vol *vol, CacheKey *key, Dir *dir, Ptr<IOBufferData> *data)
+{
+  if (!vol->ram_cache->lock_free_get() || vol->open_dir.may_have_writer(key))
+    return false;
+  int64_t o = dir_offset(dir);
+  return vol->ram_cache->get(key, data, (uint32_t)(o >> 32), (uint32_t)o) != 0;
+}
+#endif
+
 Action *
 Cache::open_read(Continuation * cont, CacheKey * key, CacheFragType type, char *hostname, int host_len)
 {
@@ -44,6 +63,26 @@ Cache::open_read(Continuation * cont, CacheKey * key, CacheFragType type, char *
   ProxyMutex *mutex = cont->mutex;
   OpenDirEntry *od = NULL;
   CacheVC *c = NULL;
+  Ptr<IOBufferData> ram_data;
+
+  // most misses can be answered without taking the volume lock
+  int probe = dir_probe_shared(key, vol, &result);
+  if (!probe && !vol->open_dir.may_have_writer(key))
+    goto Lmiss;
+  // and so can hits on the RAM cache
+  if (probe > 0 && ram_hit_unlocked(vol, key, &result, &ram_data)) {
+    c = new_CacheVC(cont);
+    SET_CONTINUATION_HANDLER(c, &CacheVC::openReadRamHit);
+    c->vio.op = VIO::READ;
+    c->base_stat = cache_read_active_stat;
+    CACHE_INCREMENT_DYN_STAT(c->base_stat + CACHE_STAT_ACTIVE);
+    c->first_key = c->key = c->earliest_key = *key;
+    c->vol = vol;
+    c->frag_type = type;
+    c->dir = result;
+    c->buf = ram_data;
+    goto Lcallreturn;
+  }
   {
     CACHE_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
     if (!lock || (od = vol->open_read(key)) || dir_probe(key, vol, &result, &last_collision)) {
@@ -105,6 +144,28 @@ Cache::open_read(Continuation * cont, CacheKey * key, CacheHTTPHdr * request,
   ProxyMutex *mutex = cont->mutex;
   OpenDirEntry *od = NULL;
   CacheVC *c = NULL;
+  Ptr<IOBufferData> ram_data;
+
+  // most misses can be answered without taking the volume lock
+  int probe = dir_probe_shared(key, vol, &result);
+  if (!probe && !vol->open_dir.may_have_writer(key))
+    goto Lmiss;
+  // and so can hits on the RAM cache
+  if (probe > 0 && ram_hit_unlocked(vol, key, &result, &ram_data)) {
+    c = new_CacheVC(cont);
+    SET_CONTINUATION_HANDLER(c, &CacheVC::openReadRamHit);
+    c->first_key = c->key = c->earliest_key = *key;
+    c->vol = vol;
+    c->vio.op = VIO::READ;
+    c->base_stat = cache_read_active_stat;
+    CACHE_INCREMENT_DYN_STAT(c->base_stat + CACHE_STAT_ACTIVE);
+    c->request.copy_shallow(request);
+    c->frag_type = CACHE_FRAG_TYPE_HTTP;
+    c->params = params;
+    c->dir = c->first_dir = result;
+    c->buf = ram_data;
+    goto Lcallreturn;
+  }
 
   {
     CACHE_TRY_LOCK(lock, vol->mutex, mutex->thread_holding);
@@ -1005,6 +1066,71 @@ Lrestart:
 }
 #endif
 
+/*
+  Fast path for Cache::open_read: buf holds the first fragment, found
+  in the RAM cache without the volume lock. Only the simple case (a
+  single fragment document with unmarshalled headers, outside the
+  evacuation windows) is completed here, everything else is handed
+  to openReadStartHead which takes the lock and probes again.
+*/
+int
+CacheVC::openReadRamHit(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+{
+  Doc *doc = (Doc *) buf->data();
+  io.aiocb.aio_nbytes = io.aio_result = dir_approx_size(&dir);
+  f.doc_from_ram_cache = true;
+  read_key = &key;
+  doc_pos = 0;
+#ifdef CACHE_STAT_PAGES
+  goto Llocked;
+#endif
+  if (doc->magic != DOC_MAGIC || !(doc->first_key == key) || !dir_agg_valid(vol, &dir) ||
+      vol->within_hit_evacuate_window(&dir))
+    goto Llocked;
+#ifdef HTTP_CACHE
+  if (frag_type == CACHE_FRAG_TYPE_HTTP) {
+    // compressed or marshalled headers are rewritten while being read
+    if (!doc->hlen || cache_config_ram_cache_compress || cache_config_compatibility_4_2_0_fixup)
+      goto Llocked;
+    if (load_http_info(&vector, doc) != doc->hlen)
+      goto Llocked;
+    alternate_index = cache_config_select_alternate ?
+      HttpTransactCache::SelectFromAlternates(&vector, &request, params) : 0;
+    if (alternate_index < 0 || !vector.get(alternate_index)->valid())
+      goto Llocked;
+    CacheKey object_key;
+    vector.get(alternate_index)->object_key_get(&object_key);
+    if (!(object_key == doc->key) || !doc->single_fragment())
+      goto Llocked;
+    alternate.copy_shallow(vector.get(alternate_index));
+    key = object_key;
+    doc_len = alternate.object_size_get();
+  } else
+#endif
+  {
+    if (!doc->single_fragment())
+      goto Llocked;
+    doc_len = doc->total_len;
+  }
+  f.single_fragment = true;
+  doc_pos = doc->prefix_len();
+  next_CacheKey(&key, &doc->key);
+  earliest_dir = dir;
+  first_buf = buf;
+  SET_HANDLER(&CacheVC::openReadMain);
+  return callcont(CACHE_EVENT_OPEN_READ);
+
+Llocked:
+#ifdef HTTP_CACHE
+  vector.clear(false);
+#endif
+  alternate_index = CACHE_ALT_INDEX_DEFAULT;
+  buf = NULL;
+  f.doc_from_ram_cache = false;
+  SET_HANDLER(&CacheVC::openReadStartHead);
+  return openReadStartHead(EVENT_IMMEDIATE, 0);
+}
+
 /*
   This code follows CacheVC::openReadStartEarliest closely,
   if you change this you might have to change that.
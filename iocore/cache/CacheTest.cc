@@ -487,3 +487,356 @@ REGRESSION_TEST(cache_disk_replacement_stability)(RegressionTest *t, int level,
   hr1.vols = 0;
   hr2.vols = 0;
 }
+
+// Replay a Zipf distributed trace against each RAM cache engine and report
+// hit rate and throughput.  A sequential scan is interleaved with the hot set
+// to show how well each policy protects popular objects.
+//
+// run -R 3 -r ram_cache
+
+#define RAM_CACHE_TEST_ZIPF_SIZE (1 << 18)
+#define RAM_CACHE_TEST_OBJECT_SIZE 16384
+
+static double *ram_cache_zipf_table = NULL;
+
+static void
+build_zipf(double alpha)
+{
+  ram_cache_zipf_table = (double *)ats_malloc(RAM_CACHE_TEST_ZIPF_SIZE * sizeof(double));
+  for (int i = 0; i < RAM_CACHE_TEST_ZIPF_SIZE; i++)
+    ram_cache_zipf_table[i] = 1.0 / pow(i + 2, alpha);
+  for (int i = 1; i < RAM_CACHE_TEST_ZIPF_SIZE; i++)
+    ram_cache_zipf_table[i] = ram_cache_zipf_table[i - 1] + ram_cache_zipf_table[i];
+  double x = ram_cache_zipf_table[RAM_CACHE_TEST_ZIPF_SIZE - 1];
+  for (int i = 0; i < RAM_CACHE_TEST_ZIPF_SIZE; i++)
+    ram_cache_zipf_table[i] = ram_cache_zipf_table[i] / x;
+}
+
+static int
+get_zipf(double v)
+{
+  int l = 0, r = RAM_CACHE_TEST_ZIPF_SIZE - 1, m;
+  do {
+    m = (r + l) / 2;
+    if (v < ram_cache_zipf_table[m])
+      r = m - 1;
+    else
+      l = m + 1;
+  } while (l < r);
+  return m;
+}
+
+static bool
+test_RamCache(RegressionTest *t, RamCache *cache, const char *name, int64_t cache_size, Vol *vol, int requests)
+{
+  InkRand rand(13);
+  int64_t hits = 0, scan = 0;
+  Ptr<IOBufferData> data;
+
+  cache->init(cache_size, vol);
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < requests; i++) {
+    uint32_t k = (i % 4) ? get_zipf(rand.drandom()) : RAM_CACHE_TEST_ZIPF_SIZE + scan++;
+    INK_MD5 key;
+    MD5Context().hash_immediate(key, &k, sizeof(k));
+    if (cache->get(&key, &data)) {
+      if (i % 4)
+        hits++;
+      continue;
+    }
+    IOBufferData *d = new_IOBufferData(iobuffer_size_to_index(RAM_CACHE_TEST_OBJECT_SIZE, MAX_BUFFER_SIZE_INDEX), MEMALIGNED);
+    cache->put(&key, d, RAM_CACHE_TEST_OBJECT_SIZE);
+  }
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+  double hit_rate = (double)hits / (requests - requests / 4);
+  rprintf(t, "RamCache %s: %d requests, cache %" PRId64 " MB, hot set hit rate %.2f%%, %.0f ops/sec\n", name, requests,
+          cache_size >> 20, hit_rate * 100.0, elapsed ? requests / ((double)elapsed / HRTIME_SECOND) : 0.0);
+  data = NULL;
+  return hit_rate > 0.1;
+}
+
+REGRESSION_TEST(ram_cache)(RegressionTest *t, int level, int *pstatus) {
+  // Only run at the highest levels.
+  if (REGRESSION_TEST_EXTENDED > level) {
+    *pstatus = REGRESSION_TEST_PASSED;
+    return;
+  }
+  if (cacheProcessor.IsCacheEnabled() != CACHE_INITIALIZED) {
+    rprintf(t, "cache not initialized");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  CacheKey key;
+  Vol *vol = theCache->key_to_vol(&key, "example.com", sizeof("example.com") - 1);
+  int64_t cache_size = 16LL * 1024 * 1024;
+  build_zipf(1.2);
+  for (int s = 0; s < 2; s++, cache_size <<= 2) {
+    RamCache *cache[] = { new_RamCacheLRU(), new_RamCacheCLFUS(), new_RamCacheS3FIFO() };
+    const char *name[] = { "LRU", "CLFUS", "S3FIFO" };
+    for (unsigned i = 0; i < countof(cache); i++) {
+      if (!test_RamCache(t, cache[i], name[i], cache_size, vol, 1 << 20))
+        *pstatus = REGRESSION_TEST_FAILED;
+      delete cache[i];
+    }
+  }
+  ats_free(ram_cache_zipf_table);
+  ram_cache_zipf_table = NULL;
+}
+
+// Lookups per second through the locked dir_probe() and the lock free
+// dir_probe_shared() as the number of threads grows. A writer keeps
+// rewriting the same entries under the volume lock so the lock free
+// readers have to validate against concurrent segment updates.
+//
+// run -R 3 -r cache_dir_lookup
+
+#define DIR_LOOKUP_TEST_KEYS (1 << 16)
+#define DIR_LOOKUP_TEST_SEGMENTS 4
+#define DIR_LOOKUP_TEST_TIME HRTIME_SECONDS(1)
+
+struct DirLookupTest: public Continuation
+{
+  Vol *vol;
+  CacheKey *keys;
+  bool shared;
+  bool writer;
+  ink_hrtime end;
+  int64_t ops;
+  int64_t misses;
+  volatile int *running;
+
+  int mainEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    EThread *t = this_ethread();
+    Dir dir;
+    uint32_t i = (uint32_t) (uintptr_t) this;
+    while (ink_get_hrtime_internal() < end) {
+      if (writer) {
+        MUTEX_LOCK(lock, vol->mutex, t);
+        for (int j = 0; j < 16; j++, i++) {
+          uint32_t k = i % DIR_LOOKUP_TEST_KEYS;
+          Dir *last_collision = NULL;
+          if (dir_probe(&keys[k], vol, &dir, &last_collision))
+            dir_overwrite(&keys[k], vol, &dir, &dir, true);
+        }
+        ops += 16;
+        continue;
+      }
+      for (int j = 0; j < 1024; j++, i++) {
+        CacheKey *key = &keys[i % DIR_LOOKUP_TEST_KEYS];
+        int r = shared ? dir_probe_shared(key, vol, &dir) : -1;
+        if (r < 0) {
+          Dir *last_collision = NULL;
+          MUTEX_LOCK(lock, vol->mutex, t);
+          r = dir_probe(key, vol, &dir, &last_collision);
+        }
+        if (!r)
+          misses++;
+      }
+      ops += 1024;
+    }
+    ink_atomic_increment(running, -1);
+    return EVENT_DONE;
+  }
+
+  DirLookupTest(Vol *v, CacheKey *k, bool s, bool w, ink_hrtime e, volatile int *r)
+    : Continuation(NULL), vol(v), keys(k), shared(s), writer(w), end(e), ops(0), misses(0), running(r)
+  {
+    SET_HANDLER(&DirLookupTest::mainEvent);
+  }
+};
+
+// A volume with only a directory, the stats go to an existing volume.
+static Vol *
+dir_lookup_test_vol(Vol *stats)
+{
+  Vol *d = new Vol;
+  d->segments = DIR_LOOKUP_TEST_SEGMENTS;
+  d->buckets = (1 << 16) / DIR_DEPTH;
+  d->skip = d->start = 0;
+  d->len = MAX_VOL_SIZE;
+  d->cache_vol = stats->cache_vol;
+  d->raw_dir = (char *)ats_memalign(ats_pagesize(), vol_dirlen(d));
+  memset(d->raw_dir, 0, vol_dirlen(d));
+  d->dir = (Dir *) (d->raw_dir + vol_headerlen(d));
+  d->header = (VolHeaderFooter *) d->raw_dir;
+  d->footer = (VolHeaderFooter *) (d->raw_dir + vol_dirlen(d) - ROUND_TO_STORE_BLOCK(sizeof(VolHeaderFooter)));
+  d->dir_seq = (volatile uint32_t *)ats_malloc(d->segments * sizeof(uint32_t));
+  memset((void *) d->dir_seq, 0, d->segments * sizeof(uint32_t));
+  d->dir_dirty = (uint8_t *)ats_malloc(d->segments);
+  memset(d->dir_dirty, DIR_SEGMENT_DIRTY_ALL, d->segments);
+  d->dir_seg_checksum = (uint32_t *)ats_malloc(2 * d->segments * sizeof(uint32_t));
+  memset(d->dir_seg_checksum, 0, 2 * d->segments * sizeof(uint32_t));
+  d->header->write_pos = (off_t) (DIR_LOOKUP_TEST_KEYS + 2) * CACHE_BLOCK_SIZE;
+  vol_init_dir(d);
+  return d;
+}
+
+static void
+free_dir_test_vol(Vol *vol)
+{
+  ats_memalign_free(vol->raw_dir);
+  delete vol;
+}
+
+static int64_t
+run_DirLookupTest(RegressionTest *t, Vol *vol, CacheKey *keys, bool shared, int nthreads, int64_t *misses)
+{
+  volatile int running = nthreads + 1;
+  ink_hrtime end = ink_get_hrtime_internal() + DIR_LOOKUP_TEST_TIME;
+  DirLookupTest **test = (DirLookupTest **)ats_malloc((nthreads + 1) * sizeof(DirLookupTest *));
+  char name[MAX_THREAD_NAME_LENGTH];
+
+  for (int i = 0; i <= nthreads; i++) {
+    test[i] = new DirLookupTest(vol, keys, shared, i == nthreads, end, &running);
+    snprintf(name, sizeof(name), "[DIR_LOOKUP %d]", i);
+    eventProcessor.spawn_thread(test[i], name, DEFAULT_STACKSIZE);
+  }
+  while (running > 0)
+    usleep(10000);
+
+  int64_t ops = 0;
+  for (int i = 0; i < nthreads; i++) {
+    ops += test[i]->ops;
+    *misses += test[i]->misses;
+  }
+  rprintf(t, "dir lookup %s: %d threads, %.0f lookups/sec, %" PRId64 " overwrites\n", shared ? "lock free" : "locked",
+          nthreads, (double) ops / ((double) DIR_LOOKUP_TEST_TIME / HRTIME_SECOND), test[nthreads]->ops);
+  for (int i = 0; i <= nthreads; i++)
+    delete test[i];
+  ats_free(test);
+  return ops;
+}
+
+REGRESSION_TEST(cache_dir_lookup)(RegressionTest *t, int level, int *pstatus) {
+  // Only run at the highest levels.
+  if (REGRESSION_TEST_EXTENDED > level) {
+    *pstatus = REGRESSION_TEST_PASSED;
+    return;
+  }
+  if (cacheProcessor.IsCacheEnabled() != CACHE_INITIALIZED || gnvol < 1) {
+    rprintf(t, "cache not initialized");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  Vol *vol = dir_lookup_test_vol(gvol[0]);
+  CacheKey *keys = (CacheKey *)ats_malloc(DIR_LOOKUP_TEST_KEYS * sizeof(CacheKey));
+  {
+    MUTEX_LOCK(lock, vol->mutex, this_ethread());
+    for (uint32_t k = 0; k < DIR_LOOKUP_TEST_KEYS; k++) {
+      Dir dir;
+      dir_clear(&dir);
+      dir_set_phase(&dir, 0);
+      dir_set_head(&dir, true);
+      dir_set_offset(&dir, k + 1);
+      MD5Context().hash_immediate(keys[k], &k, sizeof(k));
+      dir_insert(&keys[k], vol, &dir);
+    }
+  }
+
+  int max_threads = ink_number_of_processors();
+  if (max_threads > 16)
+    max_threads = 16;
+  for (int n = 1; n <= max_threads; n <<= 1) {
+    int64_t misses = 0;
+    run_DirLookupTest(t, vol, keys, false, n, &misses);
+    run_DirLookupTest(t, vol, keys, true, n, &misses);
+    if (misses) {
+      rprintf(t, "dir lookup: %" PRId64 " inserted keys not found\n", misses);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  {
+    MUTEX_LOCK(lock, vol->mutex, this_ethread());
+    for (uint32_t k = 0; k < DIR_LOOKUP_TEST_KEYS; k++) {
+      Dir dir, *last_collision = NULL;
+      while (dir_probe(&keys[k], vol, &dir, &last_collision))
+        dir_delete(&keys[k], vol, &dir);
+    }
+  }
+  ats_free(keys);
+  free_dir_test_vol(vol);
+}
+
+REGRESSION_TEST(cache_dir_sync_dirty)(RegressionTest *t, int /* level ATS_UNUSED */, int *pstatus) {
+  if (cacheProcessor.IsCacheEnabled() != CACHE_INITIALIZED || gnvol < 1) {
+    rprintf(t, "cache not initialized");
+    *pstatus = REGRESSION_TEST_FAILED;
+    return;
+  }
+
+  *pstatus = REGRESSION_TEST_PASSED;
+
+  Vol *vol = dir_lookup_test_vol(gvol[0]);
+  CacheSync *sync = new CacheSync;
+  MUTEX_TAKE_LOCK(vol->mutex, this_ethread());
+
+  // pretend both copies were just written in full
+  sync->snapshot(vol, 0);
+  sync->snapshot(vol, 1);
+  for (int s = 0; s < vol->segments; s++) {
+    if (vol->dir_dirty[s]) {
+      rprintf(t, "dir sync: segment %d still dirty after snapshot\n", s);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  CacheKey key;
+  uint32_t k = 0;
+  Dir dir;
+  dir_clear(&dir);
+  dir_set_head(&dir, true);
+  dir_set_offset(&dir, 1);
+  MD5Context().hash_immediate(key, &k, sizeof(k));
+  dir_insert(&key, vol, &dir);
+  int seg = key.slice32(0) % vol->segments;
+
+  for (int s = 0; s < vol->segments; s++) {
+    if (!vol->dir_dirty[s] != (s != seg)) {
+      rprintf(t, "dir sync: segment %d dirty %d after insert into segment %d\n", s, vol->dir_dirty[s], seg);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  // only the touched segment is captured and written
+  int n = sync->snapshot(vol, 1);
+  if (n != 1 || vol->dir_dirty[seg] != DIR_SEGMENT_DIRTY(0)) {
+    rprintf(t, "dir sync: captured %d segments, segment %d dirty %d\n", n, seg, vol->dir_dirty[seg]);
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+  off_t seglen = vol->buckets * DIR_DEPTH * SIZEOF_DIR;
+  off_t pos;
+  int len;
+  sync->writepos = vol_headerlen(vol);
+  if (!sync->next_write(vol, &pos, &len) || pos > vol_headerlen(vol) + seg * seglen ||
+      pos + len < vol_headerlen(vol) + (seg + 1) * seglen) {
+    rprintf(t, "dir sync: segment %d not covered by the first write\n", seg);
+    *pstatus = REGRESSION_TEST_FAILED;
+  } else {
+    sync->writepos = pos + len;
+    if (sync->next_write(vol, &pos, &len)) {
+      rprintf(t, "dir sync: unexpected write at %" PRId64 "\n", (int64_t) pos);
+      *pstatus = REGRESSION_TEST_FAILED;
+    }
+  }
+
+  // the incremental checksum has to match what recovery computes
+  if (vol->header->dir_checksum != dir_checksum(vol)) {
+    rprintf(t, "dir sync: checksum %u, recomputed %u\n", vol->header->dir_checksum, dir_checksum(vol));
+    *pstatus = REGRESSION_TEST_FAILED;
+  }
+
+  dir_delete(&key, vol, &dir);
+  ats_memalign_free(sync->buf);
+  ats_free(sync->segs);
+  delete sync;
+  MUTEX_UNTAKE_LOCK(vol->mutex, this_ethread());
+  free_dir_test_vol(vol);
+}
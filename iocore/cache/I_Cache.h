@@ -45,11 +45,15 @@
 
 #define RAM_CACHE_ALGORITHM_CLFUS        0
 #define RAM_CACHE_ALGORITHM_LRU          1
+#define RAM_CACHE_ALGORITHM_S3FIFO       2
 
 #define CACHE_COMPRESSION_NONE           0
 #define CACHE_COMPRESSION_FASTLZ         1
 #define CACHE_COMPRESSION_LIBZ           2
 #define CACHE_COMPRESSION_LIBLZMA        3
+#define CACHE_COMPRESSION_LZ4            4
+#define CACHE_COMPRESSION_ZSTD           5
+#define CACHE_COMPRESSION_TYPES          6
 
 struct CacheVC;
 struct CacheDisk;
@@ -215,8 +215,6 @@ struct Store
 
 extern Store theStore;
 
-// store either free or in the cache, can be stolen for reconfiguration
-void stealStore(Store & s, int blocks);
 int initialize_store();
 
 struct storageConfigFile {
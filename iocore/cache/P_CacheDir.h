@@ -44,6 +44,7 @@ struct CacheVC;
 
 #define MAX_DIR_SEGMENTS                (32 * (1<<16))
 #define DIR_DEPTH                       4
+#define DIR_PROBE_SHARED_RETRIES        8
 #define DIR_SIZE_WIDTH                  6
 #define DIR_BLOCK_SIZES                 4
 #define DIR_BLOCK_SHIFT(_i)             (3*(_i))
@@ -54,6 +55,8 @@ struct CacheVC;
 
 #define SYNC_MAX_WRITE                  (2 * 1024 * 1024)
 #define SYNC_DELAY                      HRTIME_MSECONDS(500)
+#define DIR_SEGMENT_DIRTY(_copy)        (1 << (_copy))
+#define DIR_SEGMENT_DIRTY_ALL           (DIR_SEGMENT_DIRTY(0) | DIR_SEGMENT_DIRTY(1))
 #define DO_NOT_REMOVE_THIS              0
 
 // Debugging Options
@@ -291,6 +294,8 @@ struct OpenDir: public Continuation
   int close_write(CacheVC *c);
   OpenDirEntry *open_read(CryptoHash *key);
   int signal_readers(int event, Event *e);
+  // Unlocked check used by the lock free miss path, false means no writer
+  bool may_have_writer(CryptoHash *key) { return bucket[key->slice32(0) % OPEN_DIR_BUCKETS].head != NULL; }
 
   OpenDir();
 };
@@ -301,12 +306,17 @@ struct CacheSync: public Continuation
   char *buf;
   size_t buflen;
   off_t writepos;
+  uint8_t *segs;                // segments captured in buf for this sync
+  int nsegs;
+  bool write_error;
   AIOCallbackInternal io;
   Event *trigger;
   int mainEvent(int event, Event *e);
   void aio_write(int fd, char *b, int n, off_t o);
+  int snapshot(Vol *d, int copy);
+  bool next_write(Vol *d, off_t *pos, int *len);
 
-  CacheSync():Continuation(new_ProxyMutex()), vol(0), buf(0), buflen(0), writepos(0), trigger(0)
+  CacheSync():Continuation(new_ProxyMutex()), vol(0), buf(0), buflen(0), writepos(0), segs(0), nsegs(0), write_error(false), trigger(0)
   {
     SET_HANDLER(&CacheSync::mainEvent);
   }
@@ -317,6 +327,7 @@ struct CacheSync: public Continuation
 void vol_init_dir(Vol *d);
 int dir_token_probe(CacheKey *, Vol *, Dir *);
 int dir_probe(CacheKey *, Vol *, Dir *, Dir **);
+int dir_probe_shared(CacheKey *, Vol *, Dir *);
 int dir_insert(CacheKey *key, Vol *d, Dir *to_part);
 int dir_overwrite(CacheKey *key, Vol *d, Dir *to_part, Dir *overwrite, bool must_overwrite = true);
 int dir_delete(CacheKey *key, Vol *d, Dir *del);
@@ -334,6 +345,7 @@ int dir_segment_accounted(int s, Vol *d, int offby = 0,
                           int *free = 0, int *used = 0,
                           int *empty = 0, int *valid = 0, int *agg_valid = 0, int *avg_size = 0);
 uint64_t dir_entries_used(Vol *d);
+uint32_t dir_checksum(Vol *d, int copy = -1);
 void sync_cache_dir_on_shutdown();
 
 // Global Data
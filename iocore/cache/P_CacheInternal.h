@@ -156,10 +156,20 @@ enum
   cache_read_busy_failure_stat,
   cache_gc_bytes_evacuated_stat,
   cache_gc_frags_evacuated_stat,
+  // per compression type, indexed by CACHE_COMPRESSION_*
+  cache_ram_cache_compress_bytes_in_stat,
+  cache_ram_cache_compress_bytes_out_stat = cache_ram_cache_compress_bytes_in_stat + CACHE_COMPRESSION_TYPES,
+  cache_ram_cache_compress_time_stat = cache_ram_cache_compress_bytes_out_stat + CACHE_COMPRESSION_TYPES,
+  cache_ram_cache_decompress_time_stat = cache_ram_cache_compress_time_stat + CACHE_COMPRESSION_TYPES,
+  cache_ram_cache_compress_last_stat = cache_ram_cache_decompress_time_stat + CACHE_COMPRESSION_TYPES - 1,
   cache_write_bytes_stat,
   cache_hdr_vector_marshal_stat,
   cache_hdr_marshal_stat,
   cache_hdr_marshal_bytes_stat,
+  cache_directory_sync_bytes_stat,
+  cache_directory_sync_segments_stat,
+  cache_directory_checksum_verified_stat,
+  cache_directory_checksum_failure_stat,
   cache_stat_count
 };
 
@@ -209,6 +219,8 @@ do { \
 
 // Configuration
 extern int cache_config_dir_sync_frequency;
+extern int cache_config_dir_sync_max_bandwidth;
+extern int cache_config_serve_while_recovering;
 extern int cache_config_http_max_alts;
 extern int cache_config_permit_pinning;
 extern int cache_config_select_alternate;
@@ -224,6 +236,8 @@ extern int cache_config_agg_write_backlog;
 extern int cache_config_ram_cache_compress;
 extern int cache_config_ram_cache_compress_percent;
 extern int cache_config_ram_cache_use_seen_filter;
+extern int cache_config_ram_cache_compress_threads;
+extern EventType ET_RAM_CACHE_COMPRESS;
 extern int cache_config_hit_evacuate_percent;
 extern int cache_config_hit_evacuate_size_limit;
 extern int cache_config_force_sector_size;
@@ -304,6 +318,7 @@ struct CacheVC: public CacheVConnection
   int openReadVecWrite(int event, Event *e);
 #endif
   int openReadStartHead(int event, Event *e);
+  int openReadRamHit(int event, Event *e);
   int openReadFromWriter(int event, Event *e);
   int openReadFromWriterMain(int event, Event *e);
   int openReadFromWriterFailure(int event, Event *);
@@ -1055,7 +1070,7 @@ struct Cache
   Action *link(Continuation *cont, CacheKey *from, CacheKey *to, CacheFragType type, char *hostname, int host_len);
   Action *deref(Continuation *cont, CacheKey *key, CacheFragType type, char *hostname, int host_len);
 
-  void vol_initialized(bool result);
+  void vol_initialized(Vol *vol, bool result);
 
   int open_done();
 
@@ -113,7 +113,7 @@ struct VolHeaderFooter
   uint32_t write_serial;
   uint32_t dirty;
   uint32_t sector_size;
-  uint32_t unused;                // pad out to 8 byte boundary
+  uint32_t dir_checksum;          // folded segment checksums, 0 if not recorded
 #if TS_USE_INTERIM_CACHE == 1
   InterimVolHeaderFooter interim_header[8];
 #endif
@@ -427,6 +427,9 @@ struct Vol: public Continuation
   VolHeaderFooter *footer;
   int segments;
   off_t buckets;
+  volatile uint32_t *dir_seq; // per segment sequence numbers, see dir_probe_shared()
+  uint8_t *dir_dirty;         // per segment, DIR_SEGMENT_DIRTY(copy) set if that on disk copy is stale
+  uint32_t *dir_seg_checksum; // per copy and segment, checksum last written to that copy
   off_t recover_pos;
   off_t prev_recover_pos;
   off_t scan_pos;
@@ -465,6 +468,8 @@ struct Vol: public Continuation
   bool dir_sync_waiting;
   bool dir_sync_in_progress;
   bool writing_end_marker;
+  bool recovering;          // not yet mapped by the vol hash tables
+  ink_hrtime init_start;
 
   CacheKey first_fragment_key;
   int64_t first_fragment_offset;
@@ -580,10 +585,10 @@ struct Vol: public Continuation
 
   Vol()
     : Continuation(new_ProxyMutex()), path(NULL), fd(-1),
-      dir(0), buckets(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
+      dir(0), buckets(0), dir_seq(0), dir_dirty(0), dir_seg_checksum(0), recover_pos(0), prev_recover_pos(0), scan_pos(0), skip(0), start(0),
       len(0), data_blocks(0), hit_evacuate_window(0), agg_todo_size(0), agg_buf_pos(0), trigger(0),
       evacuate_size(0), disk(NULL), last_sync_serial(0), last_write_serial(0), recover_wrapped(false),
-      dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0) {
+      dir_sync_waiting(0), dir_sync_in_progress(0), writing_end_marker(0), recovering(false), init_start(0) {
     open_dir.mutex = mutex;
     agg_buffer = (char *)ats_memalign(ats_pagesize(), AGG_SIZE);
     memset(agg_buffer, 0, AGG_SIZE);
@@ -592,6 +597,9 @@ struct Vol: public Continuation
 
   ~Vol() {
     ats_memalign_free(agg_buffer);
+    ats_free((void *) dir_seq);
+    ats_free(dir_dirty);
+    ats_free(dir_seg_checksum);
   }
 };
 
@@ -34,11 +34,15 @@ struct RamCache {
   virtual int put(INK_MD5 *key, IOBufferData *data, uint32_t len, bool copy = false, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0) = 0;
   virtual int fixup(INK_MD5 *key, uint32_t old_auxkey1, uint32_t old_auxkey2, uint32_t new_auxkey1, uint32_t new_auxkey2) = 0;
 
+  // true if get() can be called without holding the Vol mutex
+  virtual bool lock_free_get() { return false; }
+
   virtual void init(int64_t max_bytes, Vol *vol) = 0;
   virtual ~RamCache() {};
 };
 
 RamCache *new_RamCacheLRU();
 RamCache *new_RamCacheCLFUS();
+RamCache *new_RamCacheS3FIFO();
 
 #endif /* _P_RAM_CACHE_H__ */
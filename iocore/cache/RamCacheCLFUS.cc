@@ -32,12 +32,19 @@
 #if TS_HAS_LZMA
 #include <lzma.h>
 #endif
+#if TS_HAS_LZ4
+#include <lz4.h>
+#endif
+#if TS_HAS_ZSTD
+#include <zstd.h>
+#endif
 
 #define REQUIRED_COMPRESSION 0.9 // must get to this size or declared incompressible
 #define REQUIRED_SHRINK 0.8 // must get to this size or keep orignal buffer (with padding)
 #define HISTORY_HYSTERIA 10 // extra temporary history
 #define ENTRY_OVERHEAD 256 // per-entry overhead to consider when computing cache value/size
 #define LZMA_BASE_MEMLIMIT (64 * 1024 * 1024)
+#define ZSTD_LEVEL 1 // favor speed, the RAM cache is latency sensitive
 //#define CHECK_ACOUNTING 1 // very expensive double checking of all sizes
 
 #define REQUEUE_HITS(_h) ((_h) ? 1 : 0)
@@ -66,6 +73,8 @@ struct RamCacheCLFUSEntry {
   Ptr<IOBufferData> data;
 };
 
+class RamCacheCLFUSCompressor;
+
 struct RamCacheCLFUS : public RamCache {
   int64_t max_bytes;
   int64_t bytes;
@@ -88,7 +97,16 @@ struct RamCacheCLFUS : public RamCache {
   uint16_t *seen;
   int ncompressed;
   RamCacheCLFUSEntry *compressed; // first uncompressed lru[0] entry
-  void compress_entries(EThread *thread, int do_at_most = INT_MAX);
+  RamCacheCLFUSCompressor *compressor;
+  // a compression that finished while the volume lock was busy, installed by the next pass
+  char *pending_b;
+  uint32_t pending_l;
+  int pending_ctype;
+  bool pending_failed;
+  INK_MD5 pending_key;
+  Ptr<IOBufferData> pending_edata;
+  void clear_pending() { ats_free(pending_b); pending_b = NULL; pending_edata = NULL; }
+  bool compress_entries(EThread *thread, int do_at_most = INT_MAX);
   void resize_hashtable();
   void victimize(RamCacheCLFUSEntry *e);
   void move_compressed(RamCacheCLFUSEntry *e);
@@ -96,16 +114,20 @@ struct RamCacheCLFUS : public RamCache {
   void requeue_victims(RamCacheCLFUS *c, Que(RamCacheCLFUSEntry, lru_link) &victims);
   void tick(); // move CLOCK on history
   RamCacheCLFUS(): max_bytes(0), bytes(0), objects(0), vol(0), history(0), ibuckets(0), nbuckets(0), bucket(0),
-              seen(0), ncompressed(0), compressed(0) { }
+              seen(0), ncompressed(0), compressed(0), compressor(0), pending_b(0), pending_l(0), pending_ctype(0),
+              pending_failed(false) { }
+  ~RamCacheCLFUS();
 };
 
 class RamCacheCLFUSCompressor : public Continuation {
 public:
   RamCacheCLFUS *rc;
+  Event *event;
   int mainEvent(int event, Event *e);
 
+  // its own lock makes the periodic event safe to cancel from any thread
   RamCacheCLFUSCompressor(RamCacheCLFUS *arc)
-    : rc(arc)
+    : Continuation(new_ProxyMutex()), rc(arc), event(NULL)
   { 
     SET_HANDLER(&RamCacheCLFUSCompressor::mainEvent); 
   }
@@ -128,16 +150,38 @@ RamCacheCLFUSCompressor::mainEvent(int /* event ATS_UNUSED */, Event *e)
     case CACHE_COMPRESSION_LIBLZMA:
 #if ! TS_HAS_LZMA
       Warning("lzma not available for RAM cache compression");
+#endif
+      break;
+    case CACHE_COMPRESSION_LZ4:
+#if ! TS_HAS_LZ4
+      Warning("lz4 not available for RAM cache compression");
+#endif
+      break;
+    case CACHE_COMPRESSION_ZSTD:
+#if ! TS_HAS_ZSTD
+      Warning("zstd not available for RAM cache compression");
 #endif
       break;
   }
-  if (cache_config_ram_cache_compress_percent)
-    rc->compress_entries(e->ethread);
+  // never block the compressor thread on the volume, come back shortly instead
+  if (cache_config_ram_cache_compress_percent && !rc->compress_entries(e->ethread))
+    e->schedule_in(HRTIME_MSECONDS(cache_config_mutex_retry_delay));
+  else
+    e->schedule_in(HRTIME_SECOND);
   return EVENT_CONT;
 }
 
 ClassAllocator<RamCacheCLFUSEntry> ramCacheCLFUSEntryAllocator("RamCacheCLFUSEntry");
 
+// CPU time consumed by the calling thread, for the per algorithm (de)compression stats
+static inline ink_hrtime
+thread_cpu_time()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ink_hrtime_from_timespec(&ts);
+}
+
 static const int bucket_sizes[] = {
   127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139,
   524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859,
@@ -180,7 +224,29 @@ RamCacheCLFUS::init(int64_t abytes, Vol *avol)
   if (!max_bytes)
     return;
   resize_hashtable();
-  eventProcessor.schedule_every(new RamCacheCLFUSCompressor(this), HRTIME_SECOND, ET_TASK);
+  // with compress_threads each volume's compressor is pinned to one of the ET_RAMC threads
+  compressor = new RamCacheCLFUSCompressor(this);
+  // ET_RAM_CACHE_COMPRESS is only spawned when compression is enabled
+  compressor->event = eventProcessor.schedule_in(compressor, HRTIME_SECOND,
+                                                 ET_RAM_CACHE_COMPRESS != ET_CALL ? ET_RAM_CACHE_COMPRESS : ET_TASK);
+}
+
+RamCacheCLFUS::~RamCacheCLFUS()
+{
+  if (compressor) {
+    EThread *thread = this_ethread();
+    MUTEX_TAKE_LOCK(compressor->mutex, thread);
+    compressor->event->cancel(compressor);
+    MUTEX_UNTAKE_LOCK(compressor->mutex, thread);
+    delete compressor;
+  }
+  clear_pending();
+  while (lru[0].head)
+    destroy(lru[0].head);
+  while (lru[1].head)
+    destroy(lru[1].head);
+  ats_free(bucket);
+  ats_free(seen);
 }
 
 #ifdef CHECK_ACOUNTING
@@ -216,6 +282,7 @@ RamCacheCLFUS::get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1,
         e->hits++;
         if (e->flag_bits.compressed) {
           b = (char*)ats_malloc(e->len);
+          ink_hrtime start = thread_cpu_time();
           switch (e->flag_bits.compressed) {
             default: goto Lfailed;
             case CACHE_COMPRESSION_FASTLZ: {
@@ -241,8 +308,26 @@ RamCacheCLFUS::get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1,
                 goto Lfailed;
               break;
             }
+#endif
+#if TS_HAS_LZ4
+            case CACHE_COMPRESSION_LZ4: {
+              int l = (int)e->len;
+              if (l != LZ4_decompress_safe(e->data->data(), b, (int)e->compressed_len, l))
+                goto Lfailed;
+              break;
+            }
+#endif
+#if TS_HAS_ZSTD
+            case CACHE_COMPRESSION_ZSTD: {
+              size_t l = ZSTD_decompress(b, e->len, e->data->data(), e->compressed_len);
+              if (ZSTD_isError(l) || l != e->len)
+                goto Lfailed;
+              break;
+            }
 #endif
           }
+          CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_decompress_time_stat + e->flag_bits.compressed,
+                                    thread_cpu_time() - start);
           IOBufferData *data = new_xmalloc_IOBufferData(b, e->len);
           data->_mem_type = DEFAULT_ALLOC;
           if (!e->flag_bits.copy) { // don't bother if we have to copy anyway
@@ -352,13 +437,15 @@ RamCacheCLFUS::destroy(RamCacheCLFUSEntry *e)
   return ret;
 }
 
-void
+// Returns false if the volume lock was busy and the caller should retry.
+bool
 RamCacheCLFUS::compress_entries(EThread *thread, int do_at_most)
 {
   if (!cache_config_ram_cache_compress)
-    return;
+    return true;
   ink_assert(vol != 0);
-  MUTEX_TAKE_LOCK(vol->mutex, thread);
+  if (!MUTEX_TAKE_TRY_LOCK(vol->mutex, thread))
+    return false;
   if (!compressed) {
     compressed = lru[0].head;
     ncompressed = 0;
@@ -385,43 +472,94 @@ RamCacheCLFUS::compress_entries(EThread *thread, int do_at_most)
 #endif
 #if TS_HAS_LZMA
         case CACHE_COMPRESSION_LIBLZMA: l = e->len; break;
+#endif
+#if TS_HAS_LZ4
+        case CACHE_COMPRESSION_LZ4: l = (uint32_t)LZ4_compressBound(e->len); break;
+#endif
+#if TS_HAS_ZSTD
+        case CACHE_COMPRESSION_ZSTD: l = (uint32_t)ZSTD_compressBound(e->len); break;
 #endif
       }
       // store transient data for lock release
       Ptr<IOBufferData> edata = e->data;
       uint32_t elen = e->len;
       INK_MD5 key = e->key;
-      MUTEX_UNTAKE_LOCK(vol->mutex, thread);
-      b = (char*)ats_malloc(l);
       bool failed = false;
-      switch (ctype) {
-        default: goto Lfailed;
-        case CACHE_COMPRESSION_FASTLZ:
-          if (e->len < 16) goto Lfailed;
-          if ((l = fastlz_compress(edata->data(), elen, b)) <= 0)
+      if (pending_b && pending_key == key && pending_edata == edata) {
+        // compressed by the last pass, which could not take the lock back
+        b = pending_b;
+        l = pending_l;
+        ctype = pending_ctype;
+        failed = pending_failed;
+        pending_b = NULL;
+        pending_edata = NULL;
+      } else {
+        clear_pending();
+        MUTEX_UNTAKE_LOCK(vol->mutex, thread);
+        b = (char*)ats_malloc(l);
+        ink_hrtime start = thread_cpu_time();
+        switch (ctype) {
+          default:
             failed = true;
-          break;
+            break;
+          case CACHE_COMPRESSION_FASTLZ:
+            if (elen < 16 || (l = fastlz_compress(edata->data(), elen, b)) <= 0)
+              failed = true;
+            break;
 #if TS_HAS_LIBZ
-        case CACHE_COMPRESSION_LIBZ: {
-          uLongf ll = l;
-          if ((Z_OK != compress((Bytef*)b, &ll, (Bytef*)edata->data(), elen)))
-            failed = true;
-          l = (int)ll;
-          break;
-        }
+          case CACHE_COMPRESSION_LIBZ: {
+            uLongf ll = l;
+            if ((Z_OK != compress((Bytef*)b, &ll, (Bytef*)edata->data(), elen)))
+              failed = true;
+            l = (int)ll;
+            break;
+          }
 #endif
 #if TS_HAS_LZMA
-        case CACHE_COMPRESSION_LIBLZMA: {
-          size_t pos = 0, ll = l;
-          if (LZMA_OK != lzma_easy_buffer_encode(LZMA_PRESET_DEFAULT, LZMA_CHECK_NONE, NULL,
-                                                 (uint8_t*)edata->data(), elen, (uint8_t*)b, &pos, ll))
-            failed = true;
-          l = (int)pos;
-          break;
-        }
+          case CACHE_COMPRESSION_LIBLZMA: {
+            size_t pos = 0, ll = l;
+            if (LZMA_OK != lzma_easy_buffer_encode(LZMA_PRESET_DEFAULT, LZMA_CHECK_NONE, NULL,
+                                                   (uint8_t*)edata->data(), elen, (uint8_t*)b, &pos, ll))
+              failed = true;
+            l = (int)pos;
+            break;
+          }
+#endif
+#if TS_HAS_LZ4
+          case CACHE_COMPRESSION_LZ4: {
+            int ll = LZ4_compress_default(edata->data(), b, (int)elen, (int)l);
+            if (ll <= 0)
+              failed = true;
+            l = (uint32_t)ll;
+            break;
+          }
 #endif
+#if TS_HAS_ZSTD
+          case CACHE_COMPRESSION_ZSTD: {
+            size_t ll = ZSTD_compress(b, l, edata->data(), elen, ZSTD_LEVEL);
+            if (ZSTD_isError(ll))
+              failed = true;
+            l = (uint32_t)ll;
+            break;
+          }
+#endif
+        }
+        if (!failed) {
+          CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_compress_time_stat + ctype, thread_cpu_time() - start);
+          CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_compress_bytes_in_stat + ctype, elen);
+          CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_compress_bytes_out_stat + ctype, l);
+        }
+        if (!MUTEX_TAKE_TRY_LOCK(vol->mutex, thread)) {
+          // keep the result, the entry is picked up again on the next pass
+          pending_b = b;
+          pending_l = l;
+          pending_ctype = ctype;
+          pending_failed = failed;
+          pending_key = key;
+          pending_edata = edata;
+          return false;
+        }
       }
-      MUTEX_TAKE_LOCK(vol->mutex, thread);
       // see if the entry is till around
       {
         uint32_t i = key.slice32(3) % nbuckets;
@@ -431,6 +569,7 @@ RamCacheCLFUS::compress_entries(EThread *thread, int do_at_most)
           ee = ee->hash_link.next;
         }
         if (!ee || ee != e) {
+          ats_free(b);
           e = compressed;
           goto Lcontinue;
         }
@@ -442,7 +581,7 @@ RamCacheCLFUS::compress_entries(EThread *thread, int do_at_most)
       if (l > REQUIRED_SHRINK * e->size)
         goto Lfailed;
       if (l < e->len) {
-        e->flag_bits.compressed = cache_config_ram_cache_compress;
+        e->flag_bits.compressed = ctype;
         bb = (char*)ats_malloc(l);
         memcpy(bb, b, l);
         ats_free(b);
@@ -481,7 +620,7 @@ RamCacheCLFUS::compress_entries(EThread *thread, int do_at_most)
     ncompressed++;
   }
   MUTEX_UNTAKE_LOCK(vol->mutex, thread);
-  return;
+  return true;
 }
 
 void
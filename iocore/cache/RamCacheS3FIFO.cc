@@ -0,0 +1,337 @@
+/** @file
+
+  A brief file description
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+// Lock striped S3-FIFO (Simple, Scalable, Static FIFO) replacement policy.
+//
+// New objects enter a small probationary FIFO (~10% of the space).  Objects
+// which are hit while in the small FIFO are promoted to the main FIFO on
+// eviction, the rest are dropped and their fingerprint is remembered in a
+// ghost table so that a quick re-reference is admitted directly to main.
+// The main FIFO is a CLOCK: hits only bump a 2 bit counter, so a hit never
+// relinks an entry.  The key space is split into independently locked shards
+// which makes get/put/fixup safe without holding the Vol mutex.
+
+#include "P_Cache.h"
+
+#define RAM_CACHE_S3FIFO_SHARDS 16      // must be a power of 2
+#define S3FIFO_SMALL_PERCENT 10         // share of the bytes given to the probationary FIFO
+#define S3FIFO_MAX_FREQ 3
+#define ENTRY_OVERHEAD 256 // per-entry overhead to consider when computing cache size
+
+enum { S3FIFO_SMALL = 0, S3FIFO_MAIN = 1 };
+
+struct RamCacheS3FIFOEntry {
+  INK_MD5 key;
+  uint32_t auxkey1;
+  uint32_t auxkey2;
+  uint32_t size;
+  uint8_t freq;
+  uint8_t queue;
+  LINK(RamCacheS3FIFOEntry, lru_link);
+  LINK(RamCacheS3FIFOEntry, hash_link);
+  Ptr<IOBufferData> data;
+};
+
+struct RamCacheS3FIFOShard {
+  ink_mutex lock;
+  int64_t max_bytes;
+  int64_t bytes;
+  int64_t small_bytes;
+  int64_t objects;
+  int ibuckets;
+  int nbuckets;
+  DList(RamCacheS3FIFOEntry, hash_link) *bucket;
+  Que(RamCacheS3FIFOEntry, lru_link) fifo[2];
+  uint32_t *ghost; // fingerprints of entries recently evicted from the small FIFO
+  uint16_t *seen;
+
+  RamCacheS3FIFOShard(): max_bytes(0), bytes(0), small_bytes(0), objects(0), ibuckets(0), nbuckets(0), bucket(0),
+                         ghost(0), seen(0) { }
+};
+
+struct RamCacheS3FIFO : public RamCache {
+  int64_t max_bytes;
+
+  // returns 1 on found/stored, 0 on not found/stored, if provided auxkey1 and auxkey2 must match
+  int get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0);
+  int put(INK_MD5 *key, IOBufferData *data, uint32_t len, bool copy = false, uint32_t auxkey1 = 0, uint32_t auxkey2 = 0);
+  int fixup(INK_MD5 *key, uint32_t old_auxkey1, uint32_t old_auxkey2, uint32_t new_auxkey1, uint32_t new_auxkey2);
+
+  void init(int64_t max_bytes, Vol *vol);
+
+  // private
+  Vol *vol; // for stats
+  RamCacheS3FIFOShard shard[RAM_CACHE_S3FIFO_SHARDS];
+
+  RamCacheS3FIFOShard *shard_for(INK_MD5 *key) { return &shard[key->slice32(2) & (RAM_CACHE_S3FIFO_SHARDS - 1)]; }
+  void resize_hashtable(RamCacheS3FIFOShard *s);
+  void evict(RamCacheS3FIFOShard *s);
+  RamCacheS3FIFOEntry *destroy(RamCacheS3FIFOShard *s, RamCacheS3FIFOEntry *e);
+
+  bool lock_free_get() { return true; }
+
+  RamCacheS3FIFO(): max_bytes(0), vol(0) { }
+  ~RamCacheS3FIFO();
+};
+
+ClassAllocator<RamCacheS3FIFOEntry> ramCacheS3FIFOEntryAllocator("RamCacheS3FIFOEntry");
+
+static const int bucket_sizes[] = {
+  127, 251, 509, 1021, 2039, 4093, 8191, 16381, 32749, 65521, 131071, 262139,
+  524287, 1048573, 2097143, 4194301, 8388593, 16777213, 33554393, 67108859,
+  134217689, 268435399, 536870909
+};
+
+static inline uint32_t
+ghost_fingerprint(INK_MD5 *key)
+{
+  return key->slice32(1) | 1; // never 0, which marks an empty slot
+}
+
+void
+RamCacheS3FIFO::resize_hashtable(RamCacheS3FIFOShard *s)
+{
+  int anbuckets = bucket_sizes[s->ibuckets];
+  DDebug("ram_cache", "resize hashtable %d", anbuckets);
+  int64_t size = anbuckets * sizeof(DList(RamCacheS3FIFOEntry, hash_link));
+  DList(RamCacheS3FIFOEntry, hash_link) *new_bucket = (DList(RamCacheS3FIFOEntry, hash_link) *)ats_malloc(size);
+  memset(new_bucket, 0, size);
+  if (s->bucket) {
+    for (int64_t i = 0; i < s->nbuckets; i++) {
+      RamCacheS3FIFOEntry *e = 0;
+      while ((e = s->bucket[i].pop()))
+        new_bucket[e->key.slice32(3) % anbuckets].push(e);
+    }
+    ats_free(s->bucket);
+  }
+  s->bucket = new_bucket;
+  s->nbuckets = anbuckets;
+  // the ghost table is only a hint, losing it on resize is harmless
+  ats_free(s->ghost);
+  size = anbuckets * sizeof(uint32_t);
+  s->ghost = (uint32_t*)ats_malloc(size);
+  memset(s->ghost, 0, size);
+  ats_free(s->seen);
+  s->seen = 0;
+  if (cache_config_ram_cache_use_seen_filter) {
+    size = anbuckets * sizeof(uint16_t);
+    s->seen = (uint16_t*)ats_malloc(size);
+    memset(s->seen, 0, size);
+  }
+}
+
+void
+RamCacheS3FIFO::init(int64_t abytes, Vol *avol)
+{
+  ink_assert(avol != 0);
+  vol = avol;
+  max_bytes = abytes;
+  DDebug("ram_cache", "initializing ram_cache %" PRId64 " bytes in %d shards", abytes, RAM_CACHE_S3FIFO_SHARDS);
+  if (!max_bytes)
+    return;
+  for (int i = 0; i < RAM_CACHE_S3FIFO_SHARDS; i++) {
+    ink_mutex_init(&shard[i].lock, "RamCacheS3FIFOShard");
+    shard[i].max_bytes = max_bytes / RAM_CACHE_S3FIFO_SHARDS;
+    resize_hashtable(&shard[i]);
+  }
+}
+
+RamCacheS3FIFO::~RamCacheS3FIFO()
+{
+  if (!max_bytes)
+    return;
+  for (int i = 0; i < RAM_CACHE_S3FIFO_SHARDS; i++) {
+    RamCacheS3FIFOShard *s = &shard[i];
+    for (int q = S3FIFO_SMALL; q <= S3FIFO_MAIN; q++)
+      while (s->fifo[q].head)
+        destroy(s, s->fifo[q].head);
+    ats_free(s->bucket);
+    ats_free(s->ghost);
+    ats_free(s->seen);
+    ink_mutex_destroy(&s->lock);
+  }
+}
+
+int
+RamCacheS3FIFO::get(INK_MD5 *key, Ptr<IOBufferData> *ret_data, uint32_t auxkey1, uint32_t auxkey2)
+{
+  if (!max_bytes)
+    return 0;
+  RamCacheS3FIFOShard *s = shard_for(key);
+  {
+    ink_scoped_mutex lock(s->lock);
+    RamCacheS3FIFOEntry *e = s->bucket[key->slice32(3) % s->nbuckets].head;
+    while (e) {
+      if (e->key == *key && e->auxkey1 == auxkey1 && e->auxkey2 == auxkey2) {
+        if (e->freq < S3FIFO_MAX_FREQ)
+          e->freq++;
+        (*ret_data) = e->data;
+        break;
+      }
+      e = e->hash_link.next;
+    }
+    if (!e) {
+      DDebug("ram_cache", "get %X %d %d MISS", key->slice32(3), auxkey1, auxkey2);
+      CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_misses_stat, 1);
+      return 0;
+    }
+  }
+  DDebug("ram_cache", "get %X %d %d HIT", key->slice32(3), auxkey1, auxkey2);
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_hits_stat, 1);
+  return 1;
+}
+
+RamCacheS3FIFOEntry *
+RamCacheS3FIFO::destroy(RamCacheS3FIFOShard *s, RamCacheS3FIFOEntry *e)
+{
+  RamCacheS3FIFOEntry *ret = e->hash_link.next;
+  s->bucket[e->key.slice32(3) % s->nbuckets].remove(e);
+  s->fifo[e->queue].remove(e);
+  if (e->queue == S3FIFO_SMALL)
+    s->small_bytes -= e->size + ENTRY_OVERHEAD;
+  s->bytes -= e->size + ENTRY_OVERHEAD;
+  s->objects--;
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_bytes_stat, -(int64_t)e->size);
+  DDebug("ram_cache", "put %X %d %d FREED", e->key.slice32(3), e->auxkey1, e->auxkey2);
+  e->data = NULL;
+  THREAD_FREE(e, ramCacheS3FIFOEntryAllocator, this_thread());
+  return ret;
+}
+
+void
+RamCacheS3FIFO::evict(RamCacheS3FIFOShard *s)
+{
+  int64_t small_max = s->max_bytes * S3FIFO_SMALL_PERCENT / 100;
+  while (s->bytes > s->max_bytes) {
+    if (s->small_bytes > small_max || !s->fifo[S3FIFO_MAIN].head) {
+      RamCacheS3FIFOEntry *e = s->fifo[S3FIFO_SMALL].head;
+      if (!e)
+        break;
+      if (e->freq) { // re-referenced while on probation, promote
+        s->fifo[S3FIFO_SMALL].remove(e);
+        s->small_bytes -= e->size + ENTRY_OVERHEAD;
+        e->queue = S3FIFO_MAIN;
+        e->freq = 0;
+        s->fifo[S3FIFO_MAIN].enqueue(e);
+      } else {
+        s->ghost[e->key.slice32(3) % s->nbuckets] = ghost_fingerprint(&e->key);
+        destroy(s, e);
+      }
+    } else {
+      RamCacheS3FIFOEntry *e = s->fifo[S3FIFO_MAIN].head;
+      if (e->freq) { // second chance
+        e->freq--;
+        s->fifo[S3FIFO_MAIN].remove(e);
+        s->fifo[S3FIFO_MAIN].enqueue(e);
+      } else
+        destroy(s, e);
+    }
+  }
+}
+
+// ignore 'copy' since we don't touch the data
+int
+RamCacheS3FIFO::put(INK_MD5 *key, IOBufferData *data, uint32_t len, bool, uint32_t auxkey1, uint32_t auxkey2)
+{
+  if (!max_bytes)
+    return 0;
+  RamCacheS3FIFOShard *s = shard_for(key);
+  ink_scoped_mutex lock(s->lock);
+  uint32_t i = key->slice32(3) % s->nbuckets;
+  if (s->seen) {
+    uint16_t k = key->slice32(3) >> 16;
+    uint16_t kk = s->seen[i];
+    s->seen[i] = k;
+    if ((kk != (uint16_t)k)) {
+      DDebug("ram_cache", "put %X %d %d len %d UNSEEN", key->slice32(3), auxkey1, auxkey2, len);
+      return 0;
+    }
+  }
+  RamCacheS3FIFOEntry *e = s->bucket[i].head;
+  while (e) {
+    if (e->key == *key) {
+      if (e->auxkey1 == auxkey1 && e->auxkey2 == auxkey2) {
+        if (e->freq < S3FIFO_MAX_FREQ)
+          e->freq++;
+        return 1;
+      } else { // discard when aux keys conflict
+        e = destroy(s, e);
+        continue;
+      }
+    }
+    e = e->hash_link.next;
+  }
+  e = THREAD_ALLOC(ramCacheS3FIFOEntryAllocator, this_ethread());
+  e->key = *key;
+  e->auxkey1 = auxkey1;
+  e->auxkey2 = auxkey2;
+  e->size = data->block_size();
+  e->freq = 0;
+  e->data = data;
+  if (s->ghost[i] == ghost_fingerprint(key)) {
+    s->ghost[i] = 0;
+    e->queue = S3FIFO_MAIN;
+  } else {
+    e->queue = S3FIFO_SMALL;
+    s->small_bytes += e->size + ENTRY_OVERHEAD;
+  }
+  s->bucket[i].push(e);
+  s->fifo[e->queue].enqueue(e);
+  s->bytes += e->size + ENTRY_OVERHEAD;
+  s->objects++;
+  CACHE_SUM_DYN_STAT_THREAD(cache_ram_cache_bytes_stat, e->size);
+  DDebug("ram_cache", "put %X %d %d INSERTED %s", key->slice32(3), auxkey1, auxkey2,
+         e->queue == S3FIFO_MAIN ? "MAIN" : "SMALL");
+  evict(s);
+  if (s->objects > s->nbuckets) {
+    ++s->ibuckets;
+    resize_hashtable(s);
+  }
+  return 1;
+}
+
+int
+RamCacheS3FIFO::fixup(INK_MD5 *key, uint32_t old_auxkey1, uint32_t old_auxkey2, uint32_t new_auxkey1,
+                      uint32_t new_auxkey2)
+{
+  if (!max_bytes)
+    return 0;
+  RamCacheS3FIFOShard *s = shard_for(key);
+  ink_scoped_mutex lock(s->lock);
+  RamCacheS3FIFOEntry *e = s->bucket[key->slice32(3) % s->nbuckets].head;
+  while (e) {
+    if (e->key == *key && e->auxkey1 == old_auxkey1 && e->auxkey2 == old_auxkey2) {
+      e->auxkey1 = new_auxkey1;
+      e->auxkey2 = new_auxkey2;
+      return 1;
+    }
+    e = e->hash_link.next;
+  }
+  return 0;
+}
+
+RamCache *
+new_RamCacheS3FIFO()
+{
+  return new RamCacheS3FIFO;
+}
@@ -46,6 +46,8 @@ int dns_failover_number = DEFAULT_FAILOVER_NUMBER;
 int dns_failover_period = DEFAULT_FAILOVER_PERIOD;
 int dns_failover_try_period = DEFAULT_FAILOVER_TRY_PERIOD;
 int dns_max_dns_in_flight = MAX_DNS_IN_FLIGHT;
+int dns_connections_per_server = 1;
+int dns_thread_handlers = 0;
 int dns_validate_qname = 0;
 unsigned int dns_handler_initialized = 0;
 int dns_ns_rr = 0;
@@ -83,12 +85,6 @@ static void dns_result(DNSHandler *h, DNSEntry *e, HostEnt *ent, bool retry);
 static void write_dns(DNSHandler *h);
 static bool write_dns_event(DNSHandler *h, DNSEntry *e);
 
-// "reliable" name to try. need to build up first.
-static int try_servers = 0;
-static int local_num_entries = 1;
-static int attempt_num_entries = 1;
-char try_server_names[DEFAULT_NUM_TRY_SERVER][MAXDNAME];
-
 static inline char *
 strnchr(char *s, char c, int len) {
   while (*s && *s != c && len)
@@ -181,6 +177,8 @@ DNSProcessor::start(int, size_t stacksize) {
   REC_ReadConfigStringAlloc(dns_local_ipv6, "proxy.config.dns.local_ipv6");
   REC_ReadConfigStringAlloc(dns_resolv_conf, "proxy.config.dns.resolv_conf");
   REC_EstablishStaticConfigInt32(dns_thread, "proxy.config.dns.dedicated_thread");
+  REC_ReadConfigInt32(dns_connections_per_server, "proxy.config.dns.connections_per_server");
+  REC_ReadConfigInt32(dns_thread_handlers, "proxy.config.dns.thread_handlers");
 
   if (dns_thread > 0) {
     // TODO: Hmmm, should we just get a single thread some other way?
@@ -203,6 +201,15 @@ DNSProcessor::start(int, size_t stacksize) {
   dns_init();
   open();
 
+  // The default handler stays, for the queries from other threads and
+  // until the thread handlers are started.
+  if (dns_thread_handlers) {
+    n_thread_handlers = eventProcessor.n_threads_for_type[ET_CALL];
+    thread_handlers = (DNSHandler **) ats_calloc(n_thread_handlers, sizeof(DNSHandler *));
+    for (int i = 0; i < n_thread_handlers; i++)
+      open_thread_handler(eventProcessor.eventthread[ET_CALL][i], &l_res, true);
+  }
+
   return 0;
 }
 
@@ -229,14 +236,45 @@ DNSProcessor::open(sockaddr const* target, int aoptions)
   thread->schedule_imm(h);
 }
 
+DNSHandler *
+DNSProcessor::open_thread_handler(EThread *t, ink_res_state res, bool per_thread)
+{
+  DNSHandler *h = new DNSHandler;
+
+  h->options = res->options;
+  h->mutex = t->mutex;
+  h->thread = t;
+  h->per_thread = per_thread;
+  h->m_res = res;
+  ats_ip_copy(&h->local_ipv4.sa, &local_ipv4.sa);
+  ats_ip_copy(&h->local_ipv6.sa, &local_ipv6.sa);
+  ats_ip_invalidate(&h->ip); // use the default of res.
+
+  SET_CONTINUATION_HANDLER(h, &DNSHandler::startEvent_thread);
+  t->schedule_imm(h);
+  return h;
+}
+
+DNSHandler *
+DNSProcessor::handler_for(EThread *t)
+{
+  DNSHandler *h = NULL;
+
+  if (thread_handlers && t && t->id >= 0 && t->id < n_thread_handlers)
+    h = thread_handlers[t->id];
+  return h ? h : handler;
+}
+
 //
 // Initialization
 //
 void
 DNSProcessor::dns_init()
 {
-  gethostname(try_server_names[0], 255);
-  Debug("dns", "localhost=%s\n", try_server_names[0]);
+  char localhost[MAXDNAME];
+
+  gethostname(localhost, sizeof(localhost));
+  Debug("dns", "localhost=%s\n", localhost);
   Debug("dns", "Round-robin nameservers = %d\n", dns_ns_rr);
 
   IpEndpoint nameserver[MAX_NAMED];
@@ -339,7 +377,7 @@ ink_dn_expand(const u_char *msg, const u_char *eom, const u_char *comp_dn, u_cha
 }
 
 DNSProcessor::DNSProcessor()
-  : thread(NULL), handler(NULL)
+  : thread(NULL), handler(NULL), thread_handlers(NULL), n_thread_handlers(0)
 {
   ink_zero(l_res);
   ink_zero(local_ipv6);
@@ -366,15 +404,8 @@ DNSEntry::init(const char *x, int len, int qtype_arg, Continuation* acont,
   action = acont;
   submit_thread = acont->mutex->thread_holding;
 
-#ifdef SPLIT_DNS
-  if (SplitDNSConfig::gsplit_dns_enabled) {
-    dnsH = opt.handler ? opt.handler : dnsProcessor.handler;
-  } else {
-    dnsH = dnsProcessor.handler;
-  }
-#else
-  dnsH = dnsProcessor.handler;
-#endif // SPLIT_DNS
+  // HostDB sets a handler only for the servers picked by split DNS
+  dnsH = opt.handler ? opt.handler : dnsProcessor.handler_for(submit_thread);
 
   dnsH->txn_lookup_timeout = opt.timeout;
 
@@ -398,6 +429,7 @@ DNSEntry::init(const char *x, int len, int qtype_arg, Continuation* acont,
       make_ipv4_ptr(ip->_addr._ip4, qname);
     else
       ink_assert(!"T_PTR query to DNS must be IP address.");
+    qname_len = strlen(qname);
   }
 
   SET_HANDLER((DNSEntryHandler) & DNSEntry::mainEvent);
@@ -412,7 +444,7 @@ void
 DNSHandler::open_con(sockaddr const* target, bool failed, int icon)
 {
   ip_port_text_buffer ip_text;
-  PollDescriptor *pd = get_PollDescriptor(dnsProcessor.thread);
+  PollDescriptor *pd = get_PollDescriptor(thread ? thread : dnsProcessor.thread);
 
   if (!icon && target) {
     ats_ip_copy(&ip, target);
@@ -453,6 +485,77 @@ DNSHandler::open_con(sockaddr const* target, bool failed, int icon)
       Debug("dns", "opening connection %s SUCCEEDED for %d", ip_text, icon);
     }
   }
+
+  // The other source ports to the same server. A port that fails to open
+  // is skipped by send_con().
+  if (n_ports > 1 && !ports[icon]) {
+    ports[icon] = new DNSConnection[n_ports - 1];
+    for (int p = 0; p < n_ports - 1; p++)
+      ports[icon][p].handler = this;
+  }
+  for (int p = 0; p < n_ports - 1; p++) {
+    DNSConnection & c = ports[icon][p];
+
+    if (c.fd != NO_FD) {
+      c.eio.stop();
+      c.close();
+    }
+    if (c.connect(target, DNSConnection::Options()
+                  .setNonBlockingConnect(true)
+                  .setNonBlockingIo(true)
+                  .setUseTcp(false)
+                  .setBindRandomPort(true)
+                  .setLocalIpv6(&local_ipv6.sa)
+                  .setLocalIpv4(&local_ipv4.sa)) < 0) {
+      Debug("dns", "opening connection %s FAILED for %d port %d", ip_text, icon, p + 1);
+    } else if (c.eio.start(pd, &c, EVENTIO_READ) < 0) {
+      Error("[iocore_dns] open_con: Failed to add %d server port %d to epoll list\n", icon, p + 1);
+      c.close();
+    } else {
+      c.num = icon;
+    }
+  }
+}
+
+/** The connection to send the next query to name server @a ndx on. */
+DNSConnection *
+DNSHandler::send_con(int ndx)
+{
+  if (n_ports > 1 && ports[ndx]) {
+    int p = next_port++ % n_ports;
+
+    if (p && ports[ndx][p - 1].fd != NO_FD)
+      return &ports[ndx][p - 1];
+  }
+  return &con[ndx];
+}
+
+/** Open the connections to the name servers of m_res, or to ip. */
+void
+DNSHandler::open_cons()
+{
+  if (dns_ns_rr) {
+    int max_nscount = m_res->nscount;
+    if (max_nscount > MAX_NAMED)
+      max_nscount = MAX_NAMED;
+    n_con = 0;
+    for (int i = 0; i < max_nscount; i++) {
+      ip_port_text_buffer buff;
+      sockaddr *sa = &m_res->nsaddr_list[i].sa;
+      if (ats_is_ip(sa)) {
+        open_con(sa, false, n_con);
+        ++n_con;
+        Debug("dns_pas", "opened connection to %s, n_con = %d",
+          ats_ip_nptop(sa, buff, sizeof(buff)),
+          n_con
+        );
+      }
+    }
+    dns_ns_rr_init_down = 0;
+  } else {
+    open_con(0); // use current target address.
+    n_con = 1;
+  }
 }
 
 void
@@ -487,28 +590,7 @@ DNSHandler::startEvent(int /* event ATS_UNUSED */, Event *e)
     //
     dns_handler_initialized = 1;
     SET_HANDLER(&DNSHandler::mainEvent);
-    if (dns_ns_rr) {
-      int max_nscount = m_res->nscount;
-      if (max_nscount > MAX_NAMED)
-        max_nscount = MAX_NAMED;
-      n_con = 0;
-      for (int i = 0; i < max_nscount; i++) {
-        ip_port_text_buffer buff;
-        sockaddr *sa = &m_res->nsaddr_list[i].sa;
-        if (ats_is_ip(sa)) {
-          open_con(sa, false, n_con);
-          ++n_con;
-          Debug("dns_pas", "opened connection to %s, n_con = %d",
-            ats_ip_nptop(sa, buff, sizeof(buff)),
-            n_con
-          );
-        }
-      }
-      dns_ns_rr_init_down = 0;
-    } else {
-      open_con(0); // use current target address.
-      n_con = 1;
-    }
+    open_cons();
     e->ethread->schedule_every(this, DNS_PERIOD);
 
     return EVENT_CONT;
@@ -536,6 +618,25 @@ DNSHandler::startEvent_sdns(int /* event ATS_UNUSED */, Event *e)
   return EVENT_CONT;
 }
 
+/**
+  Initial state of a handler of an event thread, see
+  DNSProcessor::open_thread_handler().
+*/
+int
+DNSHandler::startEvent_thread(int /* event ATS_UNUSED */, Event *e)
+{
+  Debug("dns", "DNSHandler::startEvent_thread: on thread %d\n", e->ethread->id);
+  this->validate_ip();
+
+  SET_HANDLER(&DNSHandler::mainEvent);
+  open_cons();
+  if (per_thread)
+    dnsProcessor.thread_handlers[e->ethread->id] = this;
+
+  e->schedule_every(DNS_PERIOD);
+  return EVENT_CONT;
+}
+
 static inline int
 _ink_res_mkquery(ink_res_state res, char *qname, int qtype, char *buffer)
 {
@@ -609,7 +710,7 @@ void
 DNSHandler::switch_named(int ndx)
 {
   for (DNSEntry *e = entries.head; e; e = (DNSEntry *) e->link.next) {
-    e->written_flag = 0;
+    unwrite(e);
     if (e->retries < dns_retries)
       ++(e->retries);           // give them another chance
   }
@@ -689,7 +790,7 @@ DNSHandler::rr_failure(int ndx)
     // actual retries will be done in retry_named called from mainEvent
     // mark any outstanding requests as not sent for later retry
     for (DNSEntry *e = entries.head; e; e = (DNSEntry *) e->link.next) {
-      e->written_flag = 0;
+      unwrite(e);
       if (e->retries < dns_retries)
         ++(e->retries);         // give them another chance
       --in_flight;
@@ -699,7 +800,7 @@ DNSHandler::rr_failure(int ndx)
     // move outstanding requests that were sent to this nameserver to another
     for (DNSEntry *e = entries.head; e; e = (DNSEntry *) e->link.next) {
       if (e->which_ns == ndx) {
-        e->written_flag = 0;
+        unwrite(e);
         if (e->retries < dns_retries)
           ++(e->retries);       // give them another chance
         --in_flight;
@@ -842,39 +943,129 @@ DNSHandler::mainEvent(int event, Event *e)
   return EVENT_CONT;
 }
 
-/** Find a DNSEntry by id. */
+/** Find a DNSEntry by id. Each id sent for an entry maps to it until it is done. */
 inline static DNSEntry *
 get_dns(DNSHandler *h, uint16_t id)
 {
-  for (DNSEntry *e = h->entries.head; e; e = (DNSEntry *) e->link.next) {
-    if (e->once_written_flag) {
-      for (int j = 0; j < MAX_DNS_RETRIES; j++) {
-        if (e->id[j] == id) {
-          return e;
-        } else if (e->id[j] < 0) {
-          goto Lnext;
-        }
-      }
+  DNSEntry *e = h->entries_by_id.get(id);
+
+  return e && e->once_written_flag ? e : NULL;
+}
+
+void
+DNSIdMap::resize(int size)
+{
+  Slot *old = slots;
+  int old_size = mask + 1;
+
+  slots = (Slot *) ats_calloc(size, sizeof(Slot));
+  mask = size - 1;
+  for (int i = 0; i < old_size; i++) {
+    if (old[i].e) {
+      int j = old[i].id & mask;
+
+      while (slots[j].e)
+        j = (j + 1) & mask;
+      slots[j] = old[i];
     }
-  Lnext:;
   }
-  return NULL;
+  ats_free(old);
 }
 
-/** Find a DNSEntry by query name and type. */
-inline static DNSEntry *
-get_entry(DNSHandler *h, char *qname, int qtype)
+void
+DNSIdMap::put(uint16_t id, DNSEntry *e)
 {
-  for (DNSEntry *e = h->entries.head; e; e = (DNSEntry *) e->link.next) {
-    if (e->qtype == qtype) {
-      if (is_addr_query(qtype)) {
-        if (!strcmp(qname, e->qname))
-          return e;
-      } else if (0 == memcmp(qname, e->qname, e->qname_len))
-        return e;
+  // keep the table at most half full, starting at twice the queries in flight
+  if (2 * (count + 1) > mask + 1) {
+    int size = slots ? 2 * (mask + 1) : 64;
+
+    while (size < 2 * dns_max_dns_in_flight && size <= USHRT_MAX)
+      size *= 2;
+    resize(size);
+  }
+
+  int i = id & mask;
+
+  for (; slots[i].e; i = (i + 1) & mask) {
+    if (slots[i].id == id) {
+      slots[i].e = e;
+      return;
     }
   }
-  return NULL;
+  slots[i].id = id;
+  slots[i].e = e;
+  count++;
+}
+
+void
+DNSIdMap::remove(uint16_t id)
+{
+  int i;
+
+  if (!slots)
+    return;
+  for (i = id & mask; slots[i].id != id; i = (i + 1) & mask)
+    if (!slots[i].e)
+      return;
+  if (!slots[i].e)
+    return;
+  count--;
+
+  // move back the entries after i that probed past it
+  for (int j = (i + 1) & mask; slots[j].e; j = (j + 1) & mask) {
+    int home = slots[j].id & mask;
+
+    if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+      continue;
+    slots[i] = slots[j];
+    i = j;
+  }
+  slots[i].e = NULL;
+}
+
+DNSHandler::NameHashing::ID
+DNSHandler::NameHashing::hash(Key key)
+{
+  ATSHash32FNV1a h;
+
+  h.update(key.name, key.len);
+  h.update(&key.type, sizeof(key.type));
+  h.final();
+  return h.get();
+}
+
+/** Find a DNSEntry by query name and type. */
+DNSEntry *
+DNSHandler::find_entry(char const* qname, int qname_len, int qtype)
+{
+  return entries_by_name.find(DNSQueryKey(qname, qname_len, qtype));
+}
+
+void
+DNSHandler::add_entry(DNSEntry *e)
+{
+  entries.enqueue(e);
+  entries_by_name.insert(e);
+  if (!e->written_flag)
+    unwritten.enqueue(e);
+}
+
+void
+DNSHandler::remove_entry(DNSEntry *e)
+{
+  entries.remove(e);
+  entries_by_name.remove(entries_by_name.find(e));
+  if (!e->written_flag)
+    unwritten.remove(e);
+}
+
+void
+DNSHandler::unwrite(DNSEntry *e)
+{
+  if (e->written_flag) {
+    e->written_flag = false;
+    unwritten.enqueue(e);
+  }
 }
 
 /** Write up to dns_max_dns_in_flight entries. */
@@ -892,9 +1083,9 @@ write_dns(DNSHandler *h)
   h->in_write_dns = true;
   // Debug("dns", "in_flight: %d, dns_max_dns_in_flight: %d", h->in_flight, dns_max_dns_in_flight);
   if (h->in_flight < dns_max_dns_in_flight) {
-    DNSEntry *e = h->entries.head;
+    DNSEntry *e = h->unwritten.head;
     while (e) {
-      DNSEntry *n = (DNSEntry *) e->link.next;
+      DNSEntry *n = e->write_link.next;
       if (!e->written_flag) {
         if (dns_ns_rr) {
           int ns_start = h->name_server;
@@ -975,9 +1166,12 @@ write_dns_event(DNSHandler *h, DNSEntry *e)
     h->release_query_id(e->id[dns_retries - e->retries]);
   }
   e->id[dns_retries - e->retries] = i;
-  Debug("dns", "send query (qtype=%d) for %s to fd %d", e->qtype, e->qname, h->con[h->name_server].fd);
+  h->entries_by_id.put(i, e);
+
+  DNSConnection *c = h->send_con(h->name_server);
+  Debug("dns", "send query (qtype=%d) for %s to fd %d", e->qtype, e->qname, c->fd);
 
-  int s = socketManager.send(h->con[h->name_server].fd, blob._b, r, 0);
+  int s = socketManager.send(c->fd, blob._b, r, 0);
   if (s != r) {
     Debug("dns", "send() failed: qname = %s, %d != %d, nameserver= %d", e->qname, s, r, h->name_server);
     // changed if condition from 'r < 0' to 's < 0' - 8/2001 pas
@@ -991,6 +1185,7 @@ write_dns_event(DNSHandler *h, DNSEntry *e)
   }
 
   e->written_flag = true;
+  h->unwritten.remove(e);
   e->which_ns = h->name_server;
   e->once_written_flag = true;
   ++h->in_flight;
@@ -1057,13 +1252,13 @@ DNSEntry::mainEvent(int event, Event *e)
         domains = NULL;
       }
       Debug("dns", "enqueing query %s", qname);
-      DNSEntry *dup = get_entry(dnsH, qname, qtype);
+      DNSEntry *dup = dnsH->find_entry(qname, qname_len, qtype);
       if (dup) {
         Debug("dns", "collapsing NS request");
         dup->dups.enqueue(this);
       } else {
         Debug("dns", "adding first to collapsing queue");
-        dnsH->entries.enqueue(this);
+        dnsH->add_entry(this);
         write_dns(dnsH);
       }
       return EVENT_DONE;
@@ -1077,7 +1272,7 @@ DNSEntry::mainEvent(int event, Event *e)
     }
     if (written_flag) {
       Debug("dns", "marking %s as not-written", qname);
-      written_flag = false;
+      dnsH->unwrite(this);
       --(dnsH->in_flight);
       DNS_DECREMENT_DYN_STAT(dns_in_flight_stat);
     }
@@ -1099,7 +1294,7 @@ DNSProcessor::getby(const char *x, int len, int type, Continuation *cont, Option
   e->init(x, len, type, cont, opt);
   MUTEX_TRY_LOCK(lock, e->mutex, this_ethread());
   if (!lock)
-    thread->schedule_imm(e);
+    (e->dnsH && e->dnsH->thread ? e->dnsH->thread : thread)->schedule_imm(e);
   else
     e->handleEvent(EVENT_IMMEDIATE, 0);
   return &e->action;
@@ -1132,9 +1327,12 @@ dns_result(DNSHandler *h, DNSEntry *e, HostEnt *ent, bool retry) {
         if (e->orig_qname_len + strlen(*e->domains) + 2 > MAXDNAME) {
           Debug("dns", "domain too large %.*s + %s", e->orig_qname_len, e->qname, *e->domains);
         } else {
+          // the name is the key of the entry
+          h->entries_by_name.remove(h->entries_by_name.find(e));
           e->qname[e->orig_qname_len] = '.';
           e->qname_len = e->orig_qname_len + 1 + ink_strlcpy(e->qname + e->orig_qname_len + 1, *e->domains,
                                                              MAXDNAME - (e->orig_qname_len + 1));
+          h->entries_by_name.insert(e);
           ++(e->domains);
           e->retries = dns_retries;
           Debug("dns", "new name = %s retries = %d", e->qname, e->retries);
@@ -1167,7 +1365,7 @@ dns_result(DNSHandler *h, DNSEntry *e, HostEnt *ent, bool retry) {
       DNS_SUM_DYN_STAT(dns_success_time_stat, ink_get_hrtime() - e->submit_time);
     }
   }
-  h->entries.remove(e);
+  h->remove_entry(e);
 
   if (is_debug_tag_set("dns")) {
     if (is_addr_query(e->qtype)) {
@@ -1297,7 +1495,7 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
   //
   // It is no longer in flight
   //
-  e->written_flag = false;
+  handler->unwrite(e);
   --(handler->in_flight);
   DNS_DECREMENT_DYN_STAT(dns_in_flight_stat);
 
@@ -1406,19 +1604,19 @@ dns_process(DNSHandler *handler, HostEnt *buf, int len)
 
     // TODO: Why do we do strlen(e->qname) ? That should be available in
     // e->qname_len, no ?
-    if (local_num_entries >= DEFAULT_NUM_TRY_SERVER) {
-      if ((attempt_num_entries % 50) == 0) {
-        try_servers = (try_servers + 1) % countof(try_server_names);
-        ink_strlcpy(try_server_names[try_servers], e->qname, MAXDNAME);
-        memset(&try_server_names[try_servers][strlen(e->qname)], 0, 1);
-        attempt_num_entries = 0;
+    if (handler->local_num_entries >= DEFAULT_NUM_TRY_SERVER) {
+      if ((handler->attempt_num_entries % 50) == 0) {
+        handler->try_servers = (handler->try_servers + 1) % countof(handler->try_server_names);
+        ink_strlcpy(handler->try_server_names[handler->try_servers], e->qname, MAXDNAME);
+        memset(&handler->try_server_names[handler->try_servers][strlen(e->qname)], 0, 1);
+        handler->attempt_num_entries = 0;
       }
-      ++attempt_num_entries;
+      ++handler->attempt_num_entries;
     } else {
       // fill up try_server_names for try_primary_named
-      try_servers = local_num_entries++;
-      ink_strlcpy(try_server_names[try_servers], e->qname, MAXDNAME);
-      memset(&try_server_names[try_servers][strlen(e->qname)], 0, 1);
+      handler->try_servers = handler->local_num_entries++;
+      ink_strlcpy(handler->try_server_names[handler->try_servers], e->qname, MAXDNAME);
+      memset(&handler->try_server_names[handler->try_servers][strlen(e->qname)], 0, 1);
     }
 
     /* added for SRV support [ebalsa]
@@ -1718,4 +1916,259 @@ REGRESSION_TEST(DNS) (RegressionTest *t, int atype, int *pstatus) {
                              HRTIME_SECONDS(1));
 }
 
+// A stub resolver on the loopback, answering every query with 127.0.0.1.
+struct DNSStubResolver
+{
+  int fd;
+  IpEndpoint addr;
+  volatile int stop;
+  volatile int64_t answered;
+  ink_thread tid;
+};
+
+static void *
+dns_stub_resolver(void *arg)
+{
+  DNSStubResolver *stub = static_cast<DNSStubResolver *>(arg);
+  unsigned char buf[MAX_DNS_PACKET_LEN];
+
+  while (!stub->stop) {
+    IpEndpoint from;
+    socklen_t from_len = sizeof(from);
+    int n = recvfrom(stub->fd, buf, sizeof(buf) - 64, 0, &from.sa, &from_len);
+
+    if (n < HFIXEDSZ)
+      continue;                 // timed out, or garbage
+    int qlen = dn_skipname(buf + HFIXEDSZ, buf + n);
+    if (qlen < 0 || HFIXEDSZ + qlen + QFIXEDSZ > n)
+      continue;
+
+    // keep the question, drop anything after it and append the answer
+    HEADER *h = reinterpret_cast<HEADER *>(buf);
+    unsigned char *cp = buf + HFIXEDSZ + qlen + QFIXEDSZ;
+
+    h->qr = 1;
+    h->ra = 1;
+    h->rcode = NOERROR;
+    h->ancount = htons(1);
+    h->nscount = 0;
+    h->arcount = 0;
+    *cp++ = 0xC0;               // the name of the question
+    *cp++ = HFIXEDSZ;
+    NS_PUT16(T_A, cp);
+    NS_PUT16(C_IN, cp);
+    NS_PUT32(60, cp);
+    NS_PUT16(4, cp);
+    *cp++ = 127;
+    *cp++ = 0;
+    *cp++ = 0;
+    *cp++ = 1;
+    sendto(stub->fd, buf, cp - buf, 0, &from.sa, from_len);
+    ink_atomic_increment(&stub->answered, 1);
+  }
+  return NULL;
+}
+
+#define DNS_LOAD_QUERIES  20000 // per thread
+#define DNS_LOAD_WINDOW   128   // queries in flight per thread
+
+struct DNSLoadContinuation;
+typedef int (DNSLoadContinuation::*DNSLoadContHandler) (int, void *);
+
+// Keeps DNS_LOAD_WINDOW queries in flight through one handler.
+struct DNSLoadContinuation: public Continuation
+{
+  DNSHandler *dnsH;
+  int id;
+  int sent;
+  volatile int done;
+  volatile int found;
+
+  int mainEvent(int event, HostEnt *he)
+  {
+    if (event == DNS_EVENT_LOOKUP) {
+      if (he)
+        ++found;
+      ++done;
+    }
+    while (sent < DNS_LOAD_QUERIES && sent - done < DNS_LOAD_WINDOW) {
+      char name[64];
+
+      // each name is asked twice in a row, so half of the queries are collapsed
+      snprintf(name, sizeof(name), "h%d-%d.load.test.", id, sent / 2);
+      ++sent;
+      dnsProcessor.gethostbyname(this, name, DNSProcessor::Options().setHandler(dnsH)
+                                 .setHostResStyle(HOST_RES_IPV4_ONLY));
+    }
+    return EVENT_CONT;
+  }
+
+  DNSLoadContinuation(ProxyMutex *amutex, DNSHandler *h, int aid)
+    : Continuation(amutex), dnsH(h), id(aid), sent(0), done(0), found(0)
+  {
+    SET_HANDLER((DNSLoadContHandler) & DNSLoadContinuation::mainEvent);
+  }
+};
+
+struct DNSLoadTest;
+typedef int (DNSLoadTest::*DNSLoadTestHandler) (int, void *);
+
+// Runs the load through the DNS thread, then through a handler per thread,
+// with one and with four connections to the stub.
+struct DNSLoadTest: public Continuation
+{
+  RegressionTest *test;
+  int *pstatus;
+  DNSStubResolver stub;
+  ts_imp_res_state *res;
+  int run;
+  int nclients;
+  DNSLoadContinuation **clients;
+  ink_hrtime start;
+
+  void start_run()
+  {
+    bool per_thread = run >= 2;
+    int nports = (run & 1) ? 4 : 1;
+    int saved = dns_connections_per_server;
+    DNSHandler *h = NULL;
+
+    dns_connections_per_server = nports;
+    for (int i = 0; i < nclients; i++) {
+      EThread *t = eventProcessor.eventthread[ET_CALL][i];
+
+      if (per_thread) {
+        h = dnsProcessor.open_thread_handler(t, res, false);
+        clients[i] = new DNSLoadContinuation(t->mutex, h, i);
+      } else {
+        if (!h)
+          h = dnsProcessor.open_thread_handler(dnsProcessor.thread, res, false);
+        clients[i] = new DNSLoadContinuation(new_ProxyMutex(), h, i);
+      }
+      // give the handlers time to open their connections
+      t->schedule_in(clients[i], HRTIME_MSECONDS(100));
+    }
+    dns_connections_per_server = saved;
+    start = ink_get_hrtime_internal() + HRTIME_MSECONDS(100);
+  }
+
+  int mainEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    int done = 0, found = 0;
+
+    for (int i = 0; i < nclients; i++) {
+      done += clients[i]->done;
+      found += clients[i]->found;
+    }
+
+    ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+    if (done < nclients * DNS_LOAD_QUERIES && elapsed < HRTIME_SECONDS(60))
+      return EVENT_CONT;
+
+    rprintf(test, "%s, %d connection(s) per server: %d threads, %d of %d lookups, %.0f lookups/sec\n",
+            run >= 2 ? "handler per thread" : "DNS thread", (run & 1) ? 4 : 1, nclients, found,
+            nclients * DNS_LOAD_QUERIES, (double) done * HRTIME_SECOND / (elapsed ? elapsed : 1));
+    if (found != nclients * DNS_LOAD_QUERIES)
+      *pstatus = REGRESSION_TEST_FAILED;
+
+    // a client that is not done may still be called back
+    if (done == nclients * DNS_LOAD_QUERIES) {
+      for (int i = 0; i < nclients; i++)
+        delete clients[i];
+    }
+
+    if (++run < 4 && *pstatus != REGRESSION_TEST_FAILED) {
+      start_run();
+      return EVENT_CONT;
+    }
+
+    e->cancel();
+    stub.stop = 1;
+    ink_thread_join(stub.tid);
+    close(stub.fd);
+    rprintf(test, "stub resolver answered %" PRId64 " queries\n", stub.answered);
+    if (*pstatus != REGRESSION_TEST_FAILED)
+      *pstatus = REGRESSION_TEST_PASSED;
+    // the handlers, and so res, are never freed
+    ats_free(clients);
+    delete this;
+    return EVENT_DONE;
+  }
+
+  DNSLoadTest(RegressionTest *t, int *astatus)
+    : Continuation(new_ProxyMutex()), test(t), pstatus(astatus), res(NULL), run(0), clients(NULL), start(0)
+  {
+    SET_HANDLER((DNSLoadTestHandler) & DNSLoadTest::mainEvent);
+  }
+};
+
+REGRESSION_TEST(DNS_load) (RegressionTest *t, int level, int *pstatus) {
+  // Only run at the highest levels.
+  if (REGRESSION_TEST_EXTENDED > level) {
+    *pstatus = REGRESSION_TEST_PASSED;
+    return;
+  }
+
+  DNSLoadTest *lt = new DNSLoadTest(t, pstatus);
+  DNSStubResolver & stub = lt->stub;
+  socklen_t addrlen = sizeof(stub.addr);
+  struct timeval tv = { 0, 100000 };
+
+  stub.stop = 0;
+  stub.answered = 0;
+  ats_ip4_set(&stub.addr, htonl(INADDR_LOOPBACK), 0);
+  stub.fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (stub.fd < 0 || bind(stub.fd, &stub.addr.sa, ats_ip_size(&stub.addr.sa)) < 0 ||
+      getsockname(stub.fd, &stub.addr.sa, &addrlen) < 0) {
+    rprintf(t, "unable to open the stub resolver socket\n");
+    *pstatus = REGRESSION_TEST_FAILED;
+    delete lt;
+    return;
+  }
+  setsockopt(stub.fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  stub.tid = ink_thread_create(dns_stub_resolver, &stub, 0);
+
+  lt->res = (ts_imp_res_state *) ats_malloc(sizeof(ts_imp_res_state));
+  *lt->res = dnsProcessor.l_res;
+  lt->res->nscount = 1;
+  ats_ip_copy(&lt->res->nsaddr_list[0].sa, &stub.addr.sa);
+
+  lt->nclients = eventProcessor.n_threads_for_type[ET_CALL];
+  lt->clients = (DNSLoadContinuation **) ats_calloc(lt->nclients, sizeof(DNSLoadContinuation *));
+  lt->start_run();
+  eventProcessor.schedule_every(lt, HRTIME_MSECONDS(100));
+}
+
+REGRESSION_TEST(DNS_id_map) (RegressionTest *t, int /* level ATS_UNUSED */, int *pstatus) {
+  static const int NIDS = 4096;
+  DNSIdMap map;
+  bool *in = (bool *) ats_calloc(USHRT_MAX + 1, sizeof(bool));
+  InkRand rand(42);
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  for (int round = 0; round < 16; round++) {
+    // add ids, with collisions in the low bits, then take most of them out again
+    for (int i = 0; i < NIDS; i++) {
+      uint16_t id = (uint16_t) rand.random();
+
+      map.put(id, reinterpret_cast<DNSEntry *>((uintptr_t) id + 1));
+      in[id] = true;
+    }
+    for (int id = 0; id <= USHRT_MAX; id++) {
+      DNSEntry *expect = in[id] ? reinterpret_cast<DNSEntry *>((uintptr_t) id + 1) : NULL;
+
+      if (map.get(id) != expect) {
+        rprintf(t, "round %d: id %d is %p, expected %p\n", round, id, map.get(id), expect);
+        *pstatus = REGRESSION_TEST_FAILED;
+        break;
+      }
+      if (in[id] && rand.random() % 8) {
+        map.remove(id);
+        in[id] = false;
+      }
+    }
+  }
+  ats_free(in);
+}
+
 #endif
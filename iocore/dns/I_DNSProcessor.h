@@ -124,12 +124,23 @@ struct DNSProcessor: public Processor
   //
   void open(sockaddr const* ns = 0, int options = _res.options);
 
+  /** Start a handler polling its connections to the name servers of @a res on @a t.
+      If @a per_thread is set it serves the queries submitted on @a t once started.
+   */
+  DNSHandler *open_thread_handler(EThread *t, ink_res_state res, bool per_thread);
+
+  /// The handler for a query submitted on @a t.
+  DNSHandler *handler_for(EThread *t);
+
   DNSProcessor();
 
   // private:
   //
   EThread *thread;
   DNSHandler *handler;
+  /// Handler of each ET_NET thread, by thread id, if proxy.config.dns.thread_handlers is set.
+  DNSHandler **thread_handlers;
+  int n_thread_handlers;
   ts_imp_res_state l_res;
   IpEndpoint local_ipv6;
   IpEndpoint local_ipv4;
@@ -38,6 +38,7 @@
 #define MAX_DNS_RETRIES                     9
 #define DEFAULT_DNS_TIMEOUT                 30
 #define MAX_DNS_IN_FLIGHT                   2048
+#define MAX_DNS_CONNECTIONS_PER_SERVER      16
 #define DEFAULT_FAILOVER_NUMBER             (DEFAULT_DNS_RETRIES + 1)
 #define DEFAULT_FAILOVER_PERIOD             (DEFAULT_DNS_TIMEOUT + 30)
 // how many seconds before FAILOVER_PERIOD to try the primary with
@@ -57,6 +58,8 @@ extern int dns_failover_number;
 extern int dns_failover_period;
 extern int dns_failover_try_period;
 extern int dns_max_dns_in_flight;
+extern int dns_connections_per_server;
+extern int dns_thread_handlers;
 extern unsigned int dns_sequence_number;
 
 //
@@ -108,6 +111,16 @@ enum DNS_Stats
 struct HostEnt;
 struct DNSHandler;
 
+/// Query name and type of an in-flight DNSEntry.
+struct DNSQueryKey
+{
+  const char *name;
+  int len;
+  int type;
+
+  DNSQueryKey(const char *aname, int alen, int atype) : name(aname), len(alen), type(atype) { }
+};
+
 struct RecRawStatBlock;
 extern RecRawStatBlock *dns_rsb;
 
@@ -168,6 +181,8 @@ struct DNSEntry: public Continuation
   bool last;
   LINK(DNSEntry, dup_link);
   Que(DNSEntry, dup_link) dups;
+  LINK(DNSEntry, name_hash_link);
+  LINK(DNSEntry, write_link);
 
   int mainEvent(int event, Event *e);
   int delayEvent(int event, Event *e);
@@ -195,13 +210,71 @@ typedef int (DNSEntry::*DNSEntryHandler) (int, void *);
 
 struct DNSEntry;
 
+/**
+  The entries of the query ids in use. A handler has at most a few
+  hundred queries out, so rather than a slot for each of the 64K ids this
+  is a small open addressing table, grown as needed. The ids are random,
+  so their low bits serve as the hash.
+*/
+struct DNSIdMap
+{
+  struct Slot
+  {
+    DNSEntry *e;
+    uint16_t id;
+  };
+
+  Slot *slots;
+  int mask;
+  int count;
+
+  DNSEntry *get(uint16_t id) const
+  {
+    if (slots)
+      for (int i = id & mask; slots[i].e; i = (i + 1) & mask)
+        if (slots[i].id == id)
+          return slots[i].e;
+    return NULL;
+  }
+  void put(uint16_t id, DNSEntry *e);
+  void remove(uint16_t id);
+
+  DNSIdMap() : slots(NULL), mask(-1), count(0) { }
+  ~DNSIdMap() { ats_free(slots); }
+
+private:
+  void resize(int size);
+};
+
 /**
   One DNSHandler is allocated to handle all DNS traffic by polling a
-  UDP port.
+  UDP port, or one per ET_NET thread if proxy.config.dns.thread_handlers
+  is set.
+
+  The entries in flight are indexed by query id and by query name and
+  type, so that neither a response nor a new query has to walk them.
 
 */
 struct DNSHandler: public Continuation
 {
+  /// Interface class for the map of the entries by query name and type.
+  struct NameHashing
+  {
+    typedef uint32_t ID;
+    typedef DNSQueryKey Key;
+    typedef DNSEntry Value;
+    typedef DList(DNSEntry, name_hash_link) ListHead;
+
+    static ID hash(Key key);
+    static Key key(Value const* value) { return DNSQueryKey(value->qname, value->qname_len, value->qtype); }
+    static bool equal(Key lhs, Key rhs)
+    {
+      return lhs.type == rhs.type && lhs.len == rhs.len && 0 == memcmp(lhs.name, rhs.name, lhs.len);
+    }
+  };
+
+  typedef TSHashTable<NameHashing> NameHashTable; ///< Entries by query name and type.
+
   /// This is used as the target if round robin isn't set.
   IpEndpoint ip;
   IpEndpoint local_ipv6; ///< Local V6 address if set.
@@ -209,13 +282,30 @@ struct DNSHandler: public Continuation
   int ifd[MAX_NAMED];
   int n_con;
   DNSConnection con[MAX_NAMED];
+  /// Additional connections (source ports) to each name server, @c n_ports - 1 of them.
+  DNSConnection *ports[MAX_NAMED];
+  int n_ports;
+  int next_port;
   int options;
   Queue<DNSEntry> entries;
+  Que(DNSEntry, write_link) unwritten; ///< Entries waiting to be (re)sent, in order.
+  NameHashTable entries_by_name;
+  DNSIdMap entries_by_id; ///< Entry of each query id in use.
   Queue<DNSConnection> triggered;
   int in_flight;
   int name_server;
   int in_write_dns;
   HostEnt *hostent_cache;
+  /// Thread polling the connections, @c NULL for the DNS thread.
+  EThread *thread;
+  /// Serves the queries submitted on @c thread.
+  bool per_thread;
+
+  // "reliable" names to try, built up from the successful queries.
+  char try_server_names[DEFAULT_NUM_TRY_SERVER][MAXDNAME];
+  int try_servers;
+  int local_num_entries;
+  int attempt_num_entries;
 
   int ns_down[MAX_NAMED];
   int failover_number[MAX_NAMED];
@@ -264,9 +354,12 @@ struct DNSHandler: public Continuation
   void recv_dns(int event, Event *e);
   int startEvent(int event, Event *e);
   int startEvent_sdns(int event, Event *e);
+  int startEvent_thread(int event, Event *e);
   int mainEvent(int event, Event *e);
 
   void open_con(sockaddr const* addr, bool failed = false, int icon = 0);
+  void open_cons();
+  DNSConnection *send_con(int ndx);
   void failover();
   void rr_failure(int ndx);
   void recover();
@@ -277,6 +370,7 @@ struct DNSHandler: public Continuation
 
   void release_query_id(uint16_t qid) {
     qid_in_flight[qid >> 6] &= (uint64_t)~(0x1ULL << (qid & 0x3F));
+    entries_by_id.remove(qid);
   };
 
   void set_query_id_in_use(uint16_t qid) {
@@ -287,6 +381,12 @@ struct DNSHandler: public Continuation
     return (qid_in_flight[(uint16_t)(qid) >> 6] & (uint64_t)(0x1ULL << ((uint16_t)(qid) & 0x3F))) != 0;
   };
 
+  void add_entry(DNSEntry *e);
+  void remove_entry(DNSEntry *e);
+  DNSEntry *find_entry(char const* qname, int qname_len, int qtype);
+  /// Mark @a e as not written, so that write_dns() sends it again.
+  void unwrite(DNSEntry *e);
+
   DNSHandler();
 
 private:
@@ -322,8 +422,10 @@ struct DNSServer
 
 
 TS_INLINE DNSHandler::DNSHandler()
- : Continuation(NULL), n_con(0), options(0), in_flight(0), name_server(0), in_write_dns(0),
-  hostent_cache(0), last_primary_retry(0), last_primary_reopen(0),
+ : Continuation(NULL), n_con(0), n_ports(dns_connections_per_server), next_port(0), options(0),
+  in_flight(0), name_server(0),
+  in_write_dns(0), hostent_cache(0), thread(NULL), per_thread(false), try_servers(0), local_num_entries(1),
+  attempt_num_entries(1), last_primary_retry(0), last_primary_reopen(0),
   m_res(0), txn_lookup_timeout(0), generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t)this))
 {
   ats_ip_invalidate(&ip);
@@ -334,7 +436,14 @@ TS_INLINE DNSHandler::DNSHandler()
     crossed_failover_number[i] = 0;
     ns_down[i] = 1;
     con[i].handler = this;
+    ports[i] = NULL;
   }
+  if (n_ports < 1)
+    n_ports = 1;
+  else if (n_ports > MAX_DNS_CONNECTIONS_PER_SERVER)
+    n_ports = MAX_DNS_CONNECTIONS_PER_SERVER;
+  memset(try_server_names, 0, sizeof(try_server_names));
+  gethostname(try_server_names[0], MAXDNAME);
   memset(&qid_in_flight, 0, sizeof(qid_in_flight));  
   SET_HANDLER(&DNSHandler::startEvent);
   Debug("net_epoll", "inline DNSHandler::DNSHandler()");
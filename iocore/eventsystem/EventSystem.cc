@@ -37,6 +37,7 @@ ink_event_system_init(ModuleVersion v)
   int config_max_iobuffer_size = DEFAULT_MAX_BUFFER_SIZE;
 
   REC_EstablishStaticConfigInt32(thread_freelist_size, "proxy.config.allocator.thread_freelist_size");
+  REC_ReadConfigInteger(ink_freelist_magazines, "proxy.config.allocator.magazines");
   REC_ReadConfigInteger(config_max_iobuffer_size, "proxy.config.io.max_buffer_size");
 
   max_iobuffer_size = buffer_size_to_index(config_max_iobuffer_size, DEFAULT_BUFFER_SIZES - 1);
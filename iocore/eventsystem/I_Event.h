@@ -62,7 +62,7 @@
 #define DNS_EVENT_EVENTS_START                    600
 #define CONFIG_EVENT_EVENTS_START                 800
 #define LOG_EVENT_EVENTS_START	                  900
-#define MULTI_CACHE_EVENT_EVENTS_START            1000
+#define HOSTDB_TABLE_EVENT_EVENTS_START           1000
 #define CACHE_EVENT_EVENTS_START                  1100
 #define CACHE_DIRECTORY_EVENT_EVENTS_START        1200
 #define CACHE_DB_EVENT_EVENTS_START               1300
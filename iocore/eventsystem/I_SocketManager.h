@@ -66,6 +66,9 @@ struct SocketManager
 
   int recv(int s, void *buf, int len, int flags);
   int recvfrom(int fd, void *buf, int size, int flags, struct sockaddr *addr, socklen_t *addrlen);
+#if HAVE_RECVMMSG
+  int recvmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
 
   int64_t write(int fd, void *buf, int len, void *pOLP = NULL);
   int64_t writev(int fd, struct iovec *vector, size_t count);
@@ -75,6 +78,9 @@ struct SocketManager
   int send(int fd, void *buf, int len, int flags);
   int sendto(int fd, void *buf, int len, int flags, struct sockaddr const* to, int tolen);
   int sendmsg(int fd, struct msghdr *m, int flags, void *pOLP = 0);
+#if HAVE_SENDMMSG
+  int sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+#endif
   int64_t lseek(int fd, off_t offset, int whence);
   int fstat(int fd, struct stat *);
   int unlink(char *buf);
@@ -195,6 +195,20 @@ SocketManager::recvfrom(int fd, void *buf, int size, int flags, struct sockaddr
   return r;
 }
 
+#if HAVE_RECVMMSG
+TS_INLINE int
+SocketManager::recvmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  int r;
+  do {
+    r =::recvmmsg(fd, msgvec, vlen, flags, NULL);
+    if (unlikely(r < 0))
+      r = -errno;
+  } while (r == -EINTR);
+  return r;
+}
+#endif
+
 TS_INLINE int64_t
 SocketManager::write(int fd, void *buf, int size, void * /* pOLP ATS_UNUSED */)
 {
@@ -270,6 +284,19 @@ SocketManager::sendmsg(int fd, struct msghdr *m, int flags, void * /* pOLP ATS_U
   return r;
 }
 
+#if HAVE_SENDMMSG
+TS_INLINE int
+SocketManager::sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  int r;
+  do {
+    if (unlikely((r =::sendmmsg(fd, msgvec, vlen, flags)) < 0))
+      r = -errno;
+  } while (r == -EINTR);
+  return r;
+}
+#endif
+
 TS_INLINE int64_t
 SocketManager::lseek(int fd, off_t offset, int whence)
 {
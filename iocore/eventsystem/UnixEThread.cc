@@ -41,6 +41,7 @@ struct AIOCallback;
 
 EThread::EThread()
   : generator((uint64_t)ink_get_hrtime_internal() ^ (uint64_t)(uintptr_t)this),
+   diskHandler(NULL),
    ethreads_to_be_signalled(NULL),
    n_ethreads_to_be_signalled(0),
    main_accept_index(-1),
@@ -53,6 +54,7 @@ EThread::EThread()
 
 EThread::EThread(ThreadType att, int anid)
   : generator((uint64_t)ink_get_hrtime_internal() ^ (uint64_t)(uintptr_t)this),
+    diskHandler(NULL),
     ethreads_to_be_signalled(NULL),
     n_ethreads_to_be_signalled(0),
     main_accept_index(-1),
@@ -92,6 +94,7 @@ EThread::EThread(ThreadType att, int anid)
 
 EThread::EThread(ThreadType att, Event * e)
  : generator((uint32_t)((uintptr_t)time(NULL) ^ (uintptr_t) this)),
+   diskHandler(NULL),
    ethreads_to_be_signalled(NULL),
    n_ethreads_to_be_signalled(0),
    main_accept_index(-1),
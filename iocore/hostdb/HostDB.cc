@@ -55,6 +55,7 @@ unsigned int hostdb_serve_stale_but_revalidate = 0;
 char hostdb_filename[PATH_NAME_MAX + 1] = DEFAULT_HOST_DB_FILENAME;
 int hostdb_size = DEFAULT_HOST_DB_SIZE;
 int hostdb_sync_frequency = 120;
+int hostdb_storage_size = 33554432; // 32MB default
 int hostdb_srv_enabled = 0;
 int hostdb_disable_reverse_lookup = 0;
 
@@ -64,7 +65,7 @@ ClassAllocator<HostDBContinuation> hostDBContAllocator("hostDBContAllocator");
 
 HostDBCache hostDB;
 
-static  Queue <HostDBContinuation > remoteHostDBQueue[MULTI_CACHE_PARTITIONS];
+static  Queue <HostDBContinuation > remoteHostDBQueue[HOST_DB_TABLE_PARTITIONS];
 
 char *
 HostDBInfo::srvname(HostDBRoundRobin *rr)
@@ -75,12 +76,11 @@ HostDBInfo::srvname(HostDBRoundRobin *rr)
   return (char *) rr + data.srv.srv_offset;
 }
 
-static inline int
-corrupt_debugging_callout(HostDBInfo * e, RebuildMC & r)
+static inline bool
+corrupt_debugging_callout(HostDBInfo * e)
 {
-  Debug("hostdb", "corrupt %ld part %d",
-    (long)((char *) &e->app.rr.offset - r.data), r.partition);
-  return -1;
+  Debug("hostdb", "corrupt snapshot record %" PRIx64, e->md5_high);
+  return false;
 }
 
 static inline bool
@@ -188,61 +188,40 @@ HostDBMD5::HostDBMD5()
 
 HostDBCache::HostDBCache()
 {
-  tag_bits = HOST_DB_TAG_BITS;
-  max_hits = (1 << HOST_DB_HITS_BITS) - 1;
   version.ink_major = HOST_DB_CACHE_MAJOR_VERSION;
   version.ink_minor = HOST_DB_CACHE_MINOR_VERSION;
 }
 
 
-int
-HostDBCache::rebuild_callout(HostDBInfo * e, RebuildMC & r)
+// Check a record of the snapshot before it is loaded.
+bool
+HostDBCache::snapshot_callout(HostDBInfo * e, char *payload, int size)
 {
   if (e->round_robin && e->reverse_dns)
-    return corrupt_debugging_callout(e, r);
-  if (e->reverse_dns) {
-    if (e->data.hostname_offset < 0)
-      return 0;
-    if (e->data.hostname_offset > 0) {
-      if (!valid_offset(e->data.hostname_offset - 1))
-        return corrupt_debugging_callout(e, r);
-      char *p = (char *) ptr(&e->data.hostname_offset, r.partition);
-      if (!p)
-        return corrupt_debugging_callout(e, r);
-      char *s = p;
-      while (*p && p - s < MAXDNAME) {
-        if (!valid_heap_pointer(p))
-          return corrupt_debugging_callout(e, r);
-        p++;
-      }
-      if (p - s >= MAXDNAME)
-        return corrupt_debugging_callout(e, r);
-    }
+    return corrupt_debugging_callout(e);
+  if (e->reverse_dns && payload) {
+    if (!memchr(payload, 0, size) || strlen(payload) >= MAXDNAME)
+      return corrupt_debugging_callout(e);
   }
   if (e->round_robin) {
-    if (e->app.rr.offset < 0)
-      return 0;
-    if (!valid_offset(e->app.rr.offset - 1))
-      return corrupt_debugging_callout(e, r);
-    HostDBRoundRobin *rr = (HostDBRoundRobin *) ptr(&e->app.rr.offset, r.partition);
-    if (!rr)
-      return corrupt_debugging_callout(e, r);
+    HostDBRoundRobin *rr = (HostDBRoundRobin *) payload;
+    if (!rr || size < (int) sizeof(HostDBRoundRobin))
+      return corrupt_debugging_callout(e);
     if (rr->rrcount > HOST_DB_MAX_ROUND_ROBIN_INFO || rr->rrcount <= 0 ||
-        rr->good > HOST_DB_MAX_ROUND_ROBIN_INFO || rr->good <= 0 || rr->good > rr->rrcount)
-      return corrupt_debugging_callout(e, r);
+        rr->good > HOST_DB_MAX_ROUND_ROBIN_INFO || rr->good <= 0 || rr->good > rr->rrcount ||
+        HostDBRoundRobin::size(rr->rrcount) > (unsigned) size || rr->length > size)
+      return corrupt_debugging_callout(e);
     for (int i = 0; i < rr->good; i++) {
-      if (!valid_heap_pointer(((char *) &rr->info[i + 1]) - 1))
-        return -1;
-      if (!ats_is_ip(rr->info[i].ip()))
-        return corrupt_debugging_callout(e, r);
+      if (!e->is_srv && !ats_is_ip(rr->info[i].ip()))
+        return corrupt_debugging_callout(e);
       if (rr->info[i].md5_high != e->md5_high ||
           rr->info[i].md5_low != e->md5_low || rr->info[i].md5_low_low != e->md5_low_low)
-        return corrupt_debugging_callout(e, r);
+        return corrupt_debugging_callout(e);
     }
   }
-  if (e->is_ip_timeout())
-    return 0;
-  return 1;
+  if (e->is_ip_timeout() && !e->serve_stale_but_revalidate())
+    return false;
+  return true;
 }
 
 
@@ -342,6 +321,8 @@ HostDBSyncer::sync_event(int, void *)
 {
   SET_HANDLER(&HostDBSyncer::wait_event);
   start_time = ink_get_hrtime();
+  // proxy.config.hostdb.storage_size can change at any time
+  hostDBProcessor.cache()->snapshot_max_bytes = hostdb_storage_size;
   hostDBProcessor.cache()->sync_partitions(this);
   return EVENT_DONE;
 }
@@ -364,13 +345,9 @@ HostDBSyncer::wait_event(int, void *)
 int
 HostDBCache::start(int flags)
 {
-  Store *hostDBStore;
-  Span *hostDBSpan;
   char storage_path[PATH_NAME_MAX + 1];
-  int storage_size = 33554432; // 32MB default
 
   bool reconfigure = ((flags & PROCESSOR_RECONFIGURE) ? true : false);
-  bool fix = ((flags & PROCESSOR_FIX) ? true : false);
 
   storage_path[0] = '\0';
 
@@ -382,7 +359,8 @@ HostDBCache::start(int flags)
   REC_ReadConfigInt32(hostdb_size, "proxy.config.hostdb.size");
   REC_ReadConfigInt32(hostdb_srv_enabled, "proxy.config.srv_enabled");
   REC_ReadConfigString(storage_path, "proxy.config.hostdb.storage_path", PATH_NAME_MAX);
-  REC_ReadConfigInt32(storage_size, "proxy.config.hostdb.storage_size");
+  REC_ReadConfigInt32(hostdb_storage_size, "proxy.config.hostdb.storage_size");
+  REC_ReadConfigInt32(hostdb_sync_frequency, "proxy.config.cache.hostdb.sync_frequency");
 
   // If proxy.config.hostdb.storage_path is not set, use the local state dir. If it is set to
   // a relative path, make it relative to the prefix.
@@ -400,37 +378,20 @@ HostDBCache::start(int flags)
     Warning("Please set 'proxy.config.hostdb.storage_path' or 'proxy.config.local_state_dir'");
   }
 
-  hostDBStore = new Store;
-  hostDBSpan = new Span;
-  hostDBSpan->init(storage_path, storage_size);
-  hostDBStore->add(hostDBSpan);
-
-  Debug("hostdb", "Opening %s, size=%d", hostdb_filename, hostdb_size);
-  if (open(hostDBStore, "hostdb.config", hostdb_filename, hostdb_size, reconfigure, fix, false /* slient */ ) < 0) {
-    ats_scoped_str rundir(RecConfigReadRuntimeDir());
-    ats_scoped_str config(Layout::relative_to(rundir, "hostdb.config"));
-
-    Note("reconfiguring host database");
+  Layout::relative_to(snapshot_path, sizeof(snapshot_path), storage_path, hostdb_filename);
+  snapshot_max_bytes = hostdb_storage_size;
+  set_max_entries(hostdb_size);
 
-    if (unlink(config) < 0)
-      Debug("hostdb", "unable to unlink %s", (const char *)config);
+  // The records of the snapshot are timed against this.
+  hostdb_current_interval = (unsigned int)(ink_get_based_hrtime() / HOST_DB_TIMEOUT_INTERVAL);
 
-    delete hostDBStore;
-    hostDBStore = new Store;
-    hostDBSpan = new Span;
-    hostDBSpan->init(storage_path, storage_size);
-    hostDBStore->add(hostDBSpan);
+  if (hostdb_sync_frequency > 0 && !reconfigure) {
+    int loaded = load(snapshot_path);
 
-    if (open(hostDBStore, "hostdb.config", hostdb_filename, hostdb_size, true, fix) < 0) {
-      Warning("could not initialize host database. Host database will be disabled");
-      hostdb_enable = 0;
-      delete hostDBStore;
-      return -1;
-    }
+    if (loaded >= 0)
+      Note("loaded %d host database records from %s", loaded, snapshot_path);
   }
-  HOSTDB_SET_DYN_COUNT(hostdb_bytes_stat, totalsize);
-  //  XXX I don't see this being reference in the previous function calls, so I am going to delete it -bcall
-  delete hostDBStore;
+  Debug("hostdb", "Snapshot %s, size=%d", snapshot_path, hostdb_size);
   return 0;
 }
 
@@ -451,7 +412,8 @@ HostDBProcessor::start(int, size_t)
   if (auto_clear_hostdb_flag)
     hostDB.clear();
 
-  HOSTDB_SET_DYN_COUNT(hostdb_total_entries_stat, hostDB.totalelements);
+  HOSTDB_SET_DYN_COUNT(hostdb_total_entries_stat, hostDB.entries());
+  HOSTDB_SET_DYN_COUNT(hostdb_bytes_stat, hostDB.bytes());
 
   statPagesManager.register_http("hostdb", register_ShowHostDB);
 
@@ -472,11 +434,8 @@ HostDBProcessor::start(int, size_t)
   REC_EstablishStaticConfigInt32U(hostdb_ip_fail_timeout_interval, "proxy.config.hostdb.fail.timeout");
   REC_EstablishStaticConfigInt32U(hostdb_serve_stale_but_revalidate, "proxy.config.hostdb.serve_stale_for");
   REC_EstablishStaticConfigInt32(hostdb_sync_frequency, "proxy.config.cache.hostdb.sync_frequency");
-
-  //
-  // Set up hostdb_current_interval
-  //
-  hostdb_current_interval = (unsigned int)(ink_get_based_hrtime() / HOST_DB_TIMEOUT_INTERVAL);
+  REC_EstablishStaticConfigInt32(hostdb_size, "proxy.config.hostdb.size");
+  REC_EstablishStaticConfigInt32(hostdb_storage_size, "proxy.config.hostdb.storage_size");
 
   HostDBContinuation *b = hostDBContAllocator.alloc();
   SET_CONTINUATION_HANDLER(b, (HostDBContHandler) & HostDBContinuation::backgroundEvent);
@@ -509,7 +468,7 @@ HostDBContinuation::init(HostDBMD5 const& the_md5, Options const& opt)
 
   host_res_style = opt.host_res_style;
   dns_lookup_timeout = opt.timeout;
-  mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  mutex = hostDB.lock_for(md5.hash);
   if (opt.cont) {
     action = opt.cont;
   } else {
@@ -520,14 +479,14 @@ HostDBContinuation::init(HostDBMD5 const& the_md5, Options const& opt)
 
 void
 HostDBContinuation::refresh_MD5() {
-  ProxyMutex* old_bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  ProxyMutex* old_bucket_mutex = hostDB.lock_for(md5.hash);
   // We're not pending DNS anymore.
   remove_trigger_pending_dns();
   md5.refresh();
   // Update the mutex if it's from the bucket.
   // Some call sites modify this after calling @c init so need to check.
   if (old_bucket_mutex == mutex)
-    mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+    mutex = hostDB.lock_for(md5.hash);
 }
 
 void
@@ -559,7 +518,7 @@ reply_to_cont(Continuation * cont, HostDBInfo * r, bool is_srv = false)
       ink_assert(!"missing hostname");
       cont->handleEvent(is_srv ? EVENT_SRV_LOOKUP : EVENT_HOST_DB_LOOKUP, NULL);
       Warning("bogus entry deleted from HostDB: missing hostname");
-      hostDB.delete_block(r);
+      hostDB.remove(r);
       return false;
     }
     Debug("hostdb", "hostname = %s", r->hostname());
@@ -570,7 +529,7 @@ reply_to_cont(Continuation * cont, HostDBInfo * r, bool is_srv = false)
       ink_assert(!"missing round-robin");
       cont->handleEvent(is_srv ? EVENT_SRV_LOOKUP : EVENT_HOST_DB_LOOKUP, NULL);
       Warning("bogus entry deleted from HostDB: missing round-robin");
-      hostDB.delete_block(r);
+      hostDB.remove(r);
       return false;
     }
     ip_text_buffer ipb;
@@ -581,7 +540,7 @@ reply_to_cont(Continuation * cont, HostDBInfo * r, bool is_srv = false)
 
   if (!r->full) {
     Warning("bogus entry deleted from HostDB: none");
-    hostDB.delete_block(r);
+    hostDB.remove(r);
     return false;
   }
 
@@ -619,13 +578,12 @@ db_mark_for(sockaddr const* ip) {
 HostDBInfo *
 probe(ProxyMutex *mutex, HostDBMD5 const& md5, bool ignore_timeout)
 {
-  ink_assert(this_ethread() == hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets))->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(md5.hash)->thread_holding);
   if (hostdb_enable) {
-    uint64_t folded_md5 = fold_md5(md5.hash);
-    HostDBInfo *r = hostDB.lookup_block(folded_md5, hostDB.levels);
+    HostDBInfo *r = hostDB.lookup(md5.hash);
     Debug("hostdb", "probe %.*s %" PRIx64 " %d [ignore_timeout = %d]",
-          md5.host_len, md5.host_name, folded_md5, !!r, ignore_timeout);
-    if (r && md5.hash[1] == r->md5_high) {
+          md5.host_len, md5.host_name, md5.hash.fold(), !!r, ignore_timeout);
+    if (r) {
 
       // Check for timeout (fail probe)
       //
@@ -646,12 +604,12 @@ probe(ProxyMutex *mutex, HostDBMD5 const& md5, bool ignore_timeout)
 //error conditions
       if (r->reverse_dns && !r->hostname()) {
         Debug("hostdb", "missing reverse dns");
-        hostDB.delete_block(r);
+        hostDB.remove(r);
         return NULL;
       }
       if (r->round_robin && !r->rr()) {
         Debug("hostdb", "missing round-robin");
-        hostDB.delete_block(r);
+        hostDB.remove(r);
         return NULL;
       }
       // Check for stale (revalidate offline if we are the owner)
@@ -689,22 +647,15 @@ probe(ProxyMutex *mutex, HostDBMD5 const& md5, bool ignore_timeout)
 HostDBInfo *
 HostDBContinuation::insert(unsigned int attl)
 {
-  uint64_t folded_md5 = fold_md5(md5.hash);
-  int bucket = folded_md5 % hostDB.buckets;
-
-  ink_assert(this_ethread() == hostDB.lock_for_bucket(bucket)->thread_holding);
-  // remove the old one to prevent buildup
-  HostDBInfo *old_r = hostDB.lookup_block(folded_md5, 3);
-  if (old_r)
-    hostDB.delete_block(old_r);
-  HostDBInfo *r = hostDB.insert_block(folded_md5, NULL, 0);
-  r->md5_high = md5.hash[1];
+  ink_assert(this_ethread() == hostDB.lock_for(md5.hash)->thread_holding);
+  // this replaces the old one, if any
+  HostDBInfo *r = hostDB.insert(md5.hash);
   if (attl > HOST_DB_MAX_TTL)
     attl = HOST_DB_MAX_TTL;
   r->ip_timeout_interval = attl;
   r->ip_timestamp = hostdb_current_interval;
-  Debug("hostdb", "inserting for: %.*s: (md5: %" PRIx64 ") bucket: %d now: %u timeout: %u ttl: %u", md5.host_len, md5.host_name, folded_md5, bucket, r->ip_timestamp,
-        r->ip_timeout_interval, attl);
+  Debug("hostdb", "inserting for: %.*s: (md5: %" PRIx64 ") partition: %d now: %u timeout: %u ttl: %u", md5.host_len, md5.host_name,
+        md5.hash.fold(), hostDB.partition_of(md5.hash), r->ip_timestamp, r->ip_timeout_interval, attl);
   return r;
 }
 
@@ -761,7 +712,7 @@ HostDBProcessor::getby(Continuation * cont,
       // find the partition lock
       //
       // TODO: Could we reuse the "mutex" above safely? I think so but not sure.
-      ProxyMutex *bmutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+      ProxyMutex *bmutex = hostDB.lock_for(md5.hash);
       MUTEX_TRY_LOCK(lock, bmutex, thread);
       MUTEX_TRY_LOCK(lock2, cont->mutex, thread);
 
@@ -874,7 +825,7 @@ HostDBProcessor::getSRVbyname_imm(Continuation * cont, process_srv_info_pfn proc
   // Attempt to find the result in-line, for level 1 hits
   if (!force_dns) {
     // find the partition lock
-    ProxyMutex *bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+    ProxyMutex *bucket_mutex = hostDB.lock_for(md5.hash);
     MUTEX_TRY_LOCK(lock, bucket_mutex, thread);
 
     // If we can get the lock and a level 1 probe succeeds, return
@@ -962,7 +913,7 @@ HostDBProcessor::getbyname_imm(Continuation * cont, process_hostdb_info_pfn proc
     do {
       loop = false; // loop only on explicit set for retry
       // find the partition lock
-      ProxyMutex *bucket_mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+      ProxyMutex *bucket_mutex = hostDB.lock_for(md5.hash);
       MUTEX_LOCK(lock, bucket_mutex, thread);
 
       if (lock) {
@@ -1056,7 +1007,7 @@ HostDBProcessor::setby(const char *hostname, int len, sockaddr const* ip, HostDB
 
   // Attempt to find the result in-line, for level 1 hits
 
-  ProxyMutex *mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  ProxyMutex *mutex = hostDB.lock_for(md5.hash);
   EThread *thread = this_ethread();
   MUTEX_TRY_LOCK(lock, mutex, thread);
 
@@ -1131,7 +1082,7 @@ remove_round_robin(HostDBInfo * r, const char *hostname, IpAddr const& ip)
         rr->info[rr->good - 1] = tmp;
         rr->good--;
         if (rr->good <= 0) {
-          hostDB.delete_block(r);
+          hostDB.remove(r);
           return false;
         } else {
           if (diags->on("hostdb")) {
@@ -1176,7 +1127,7 @@ HostDBProcessor::failed_connect_on_ip_for_name(Continuation * cont, sockaddr con
 #endif // SPLIT_DNS
   md5.refresh();
 
-  ProxyMutex *mutex = hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets));
+  ProxyMutex *mutex = hostDB.lock_for(md5.hash);
   EThread *thread = this_ethread();
   MUTEX_TRY_LOCK(lock, mutex, thread);
   if (lock) {
@@ -1238,7 +1189,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
 {
   HostDBInfo *i = NULL;
 
-  ink_assert(this_ethread() == hostDB.lock_for_bucket((int) (fold_md5(md5.hash) % hostDB.buckets))->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(md5.hash)->thread_holding);
   if (!ip.isValid() || !aname || !aname[0]) {
     if (is_byname()) {
       Debug("hostdb", "lookup_done() failed for '%.*s'", md5.host_len, md5.host_name);
@@ -1301,7 +1252,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
     } else {
       Debug("hostdb", "done '%s' TTL %d", aname, ttl_seconds);
       const size_t s_size = strlen(aname) + 1;
-      void *s = hostDB.alloc(&i->data.hostname_offset, s_size);
+      void *s = hostDB.alloc_payload(i, &i->data.hostname_handle, s_size);
       if (s) {
         ink_strlcpy((char *) s, aname, s_size);
         i->round_robin = false;
@@ -1310,7 +1261,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
       } else {
         ink_assert(!"out of room in hostdb data area");
         Warning("out of room in hostdb for reverse DNS data");
-        hostDB.delete_block(i);
+        hostDB.remove(i);
         return NULL;
       }
     }
@@ -1325,7 +1276,7 @@ HostDBContinuation::lookup_done(IpAddr const& ip, char const* aname, bool around
 int
 HostDBContinuation::dnsPendingEvent(int event, Event * e)
 {
-  ink_assert(this_ethread() == hostDB.lock_for_bucket(fold_md5(md5.hash) % hostDB.buckets)->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(md5.hash)->thread_holding);
   if (timeout) {
     timeout->cancel(this);
     timeout = NULL;
@@ -1371,7 +1322,7 @@ restore_info(HostDBInfo * r, HostDBInfo * old_r, HostDBInfo & old_info, HostDBRo
 int
 HostDBContinuation::dnsEvent(int event, HostEnt * e)
 {
-  ink_assert(this_ethread() == hostDB.lock_for_bucket(fold_md5(md5.hash) % hostDB.buckets)->thread_holding);
+  ink_assert(this_ethread() == hostDB.lock_for(md5.hash)->thread_holding);
   if (timeout) {
     timeout->cancel(this);
     timeout = NULL;
@@ -1420,6 +1371,8 @@ HostDBContinuation::dnsEvent(int event, HostEnt * e)
     if (old_r)
       old_info = *old_r;
     HostDBRoundRobin *old_rr_data = old_r ? old_r->rr() : NULL;
+    // lookup_done() replaces old_r, hold on to its round robin data until it is restored
+    HostDBPayload *old_payload = old_rr_data ? hostDB.retain_payload(old_r->app.rr.handle) : NULL;
 #ifdef DEBUG
     if (old_rr_data) {
       for (int i = 0; i < old_rr_data->rrcount; ++i) {
@@ -1487,9 +1440,9 @@ HostDBContinuation::dnsEvent(int event, HostEnt * e)
 
     if (rr) {
       const int rrsize = HostDBRoundRobin::size(n, e->srv_hosts.srv_hosts_length);
-      HostDBRoundRobin *rr_data = (HostDBRoundRobin *) hostDB.alloc(&r->app.rr.offset, rrsize);
+      HostDBRoundRobin *rr_data = (HostDBRoundRobin *) hostDB.alloc_payload(r, &r->app.rr.handle, rrsize);
 
-      Debug("hostdb", "allocating %d bytes for %d RR at %p %d", rrsize, n, rr_data, r->app.rr.offset);
+      Debug("hostdb", "allocating %d bytes for %d RR at %p %d", rrsize, n, rr_data, r->app.rr.handle);
 
       if (rr_data) {
         rr_data->length = rrsize;
@@ -1590,7 +1543,9 @@ HostDBContinuation::dnsEvent(int event, HostEnt * e)
     if (!failed && !rr && !is_srv())
       restore_info(r, old_r, old_info, old_rr_data);
     ink_assert(!r || !r->round_robin || !r->reverse_dns);
-    ink_assert(failed || !r->round_robin || r->app.rr.offset);
+    ink_assert(failed || !r->round_robin || r->app.rr.handle);
+    if (old_payload)
+      hostDB.release_payload(old_payload);
 
     // if we are not the owner, put on the owner
     //
@@ -2090,7 +2045,7 @@ get_hostinfo_ClusterFunction(ClusterHandler *ch, void *data, int /* len ATS_UNUS
 
   copt.host_res_style = host_res_style_for(&msg->ip.sa);
   c->init(md5, copt);
-  c->mutex = hostDB.lock_for_bucket(fold_md5(msg->md5) % hostDB.buckets);
+  c->mutex = hostDB.lock_for(msg->md5);
   c->action.mutex = c->mutex;
   dnsProcessor.thread->schedule_imm(c);
 }
@@ -2113,7 +2068,7 @@ put_hostinfo_ClusterFunction(ClusterHandler *ch, void *data, int /* len ATS_UNUS
   md5.db_mark = db_mark_for(&msg->ip.sa);
   copt.host_res_style = host_res_style_for(&msg->ip.sa);
   c->init(md5, copt);
-  c->mutex = hostDB.lock_for_bucket(fold_md5(msg->md5) % hostDB.buckets);
+  c->mutex = hostDB.lock_for(msg->md5);
   c->from_cont = msg->cont;     // cannot use action if cont freed due to timeout
   c->missing = msg->missing;
   c->round_robin = msg->round_robin;
@@ -2125,7 +2080,8 @@ put_hostinfo_ClusterFunction(ClusterHandler *ch, void *data, int /* len ATS_UNUS
 
 //
 // Background event
-// Just increment the current_interval.  Might do other stuff
+// Increment the current_interval, free the records removed long
+// enough ago and update the size of the table.  Might do other stuff
 // here, like move records to the current position in the cluster.
 //
 int
@@ -2133,40 +2089,22 @@ HostDBContinuation::backgroundEvent(int /* event ATS_UNUSED */, Event * /* e ATS
 {
   hostdb_current_interval++;
 
-  return EVENT_CONT;
-}
-
-bool HostDBInfo::match(INK_MD5 & md5, int /* bucket ATS_UNUSED */, int buckets)
-{
-  if (md5[1] != md5_high)
-    return false;
-
-  uint64_t folded_md5 = fold_md5(md5);
-  uint64_t ttag = folded_md5 / buckets;
+  // proxy.config.hostdb.size can change at any time
+  hostDB.set_max_entries(hostdb_size);
+  hostDB.reclaim(ink_get_hrtime_internal());
+  HOSTDB_SET_DYN_COUNT(hostdb_total_entries_stat, hostDB.entries());
+  HOSTDB_SET_DYN_COUNT(hostdb_bytes_stat, hostDB.bytes());
 
-  if (!ttag)
-    ttag = 1;
-
-  struct
-  {
-    unsigned int md5_low_low:24;
-    unsigned int md5_low;
-  } tmp;
-
-  tmp.md5_low_low = (unsigned int) ttag;
-  tmp.md5_low = (unsigned int) (ttag >> 24);
-
-  return tmp.md5_low_low == md5_low_low && tmp.md5_low == md5_low;
+  return EVENT_CONT;
 }
 
-
 char *
 HostDBInfo::hostname()
 {
   if (!reverse_dns)
     return NULL;
 
-  return (char *) hostDB.ptr(&data.hostname_offset, hostDB.ptr_to_partition((char *) this));
+  return (char *) hostDB.payload(data.hostname_handle);
 }
 
 
@@ -2176,7 +2114,7 @@ HostDBInfo::rr()
   if (!round_robin)
     return NULL;
 
-  HostDBRoundRobin *r = (HostDBRoundRobin *) hostDB.ptr(&app.rr.offset, hostDB.ptr_to_partition((char *) this));
+  HostDBRoundRobin *r = (HostDBRoundRobin *) hostDB.payload(app.rr.handle);
 
   if (r && (r->rrcount > HOST_DB_MAX_ROUND_ROBIN_INFO || r->rrcount <= 0 || r->good > HOST_DB_MAX_ROUND_ROBIN_INFO || r->good <= 0)) {
     ink_assert(!"bad round-robin");
@@ -2186,37 +2124,6 @@ HostDBInfo::rr()
 }
 
 
-int
-HostDBInfo::heap_size()
-{
-  if (reverse_dns) {
-    char *h = hostname();
-
-    if (h)
-      return strlen(h) + 1;
-  } else if (round_robin) {
-    HostDBRoundRobin *r = rr();
-
-    if (r)
-      return r->length;
-  }
-  return 0;
-}
-
-
-int *
-HostDBInfo::heap_offset_ptr()
-{
-  if (reverse_dns)
-    return &data.hostname_offset;
-
-  if (round_robin)
-    return &app.rr.offset;
-
-  return NULL;
-}
-
-
 ClusterMachine *
 HostDBContinuation::master_machine(ClusterConfiguration * cc)
 {
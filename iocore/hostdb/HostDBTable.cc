@@ -0,0 +1,742 @@
+/** @file
+
+  In-memory table of HostDB records, see P_HostDBTable.h.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "P_HostDB.h"
+
+ClassAllocator<HostDBTableEntry> hostDBTableEntryAllocator("hostDBTableEntryAllocator");
+
+#define PAYLOAD_HEADER_SIZE INK_ALIGN(sizeof(HostDBPayload), 8)
+
+HostDBTable::HostDBTable()
+  : snapshot_max_bytes(0), max_partition_entries(INT_MAX), allocated_bytes(0), payload_free(0), payload_next(1)
+{
+  version.ink_major = 0;
+  version.ink_minor = 0;
+  snapshot_path[0] = '\0';
+  for (int i = 0; i < HOST_DB_PAYLOAD_CHUNKS; i++)
+    payload_chunks[i] = NULL;
+  ink_mutex_init(&payload_lock, "HostDBTable payloads");
+}
+
+// The table is a global, and event threads may still use it while the
+// process exits: reset() is what frees it.
+HostDBTable::~HostDBTable()
+{
+}
+
+void
+HostDBTable::alloc_mutexes()
+{
+  for (int i = 0; i < HOST_DB_TABLE_PARTITIONS; i++)
+    locks[i] = new_ProxyMutex();
+}
+
+//
+// Records
+//
+
+HostDBTableEntry *
+HostDBTable::find(HostDBTablePartition & p, INK_MD5 const& md5, uint32_t *pslot)
+{
+  if (!p.slots)
+    return NULL;
+
+  // the table is never full, so there is always a free slot to stop at
+  for (uint32_t i = md5[0] & p.mask;; i = (i + 1) & p.mask) {
+    HostDBTablePartition::Slot & s = p.slots[i];
+
+    if (!s.entry)
+      return NULL;
+    if (s.hash == md5[0] && s.entry->key == md5) {
+      if (pslot)
+        *pslot = i;
+      return s.entry;
+    }
+  }
+}
+
+// Free the slot, moving back the records that probed past it so that no
+// lookup stops early (no tombstones).
+void
+HostDBTable::unlink(HostDBTablePartition & p, uint32_t slot)
+{
+  uint32_t j = slot;
+
+  for (;;) {
+    j = (j + 1) & p.mask;
+    if (!p.slots[j].entry)
+      break;
+    uint32_t home = p.slots[j].hash & p.mask;
+    // the record at j may move to the free slot if that is not before its home slot
+    if (((j - home) & p.mask) >= ((j - slot) & p.mask)) {
+      p.slots[slot] = p.slots[j];
+      slot = j;
+    }
+  }
+  p.slots[slot].hash = 0;
+  p.slots[slot].entry = NULL;
+  p.count--;
+}
+
+void
+HostDBTable::grow(HostDBTablePartition & p)
+{
+  uint32_t nslots = p.slots ? (p.mask + 1) * 2 : HOST_DB_TABLE_MIN_SLOTS;
+  uint32_t mask = nslots - 1;
+  HostDBTablePartition::Slot *slots = (HostDBTablePartition::Slot *) ats_malloc(nslots * sizeof(*slots));
+
+  memset(slots, 0, nslots * sizeof(*slots));
+  if (p.slots) {
+    for (uint32_t i = 0; i <= p.mask; i++) {
+      if (p.slots[i].entry) {
+        uint32_t j = p.slots[i].hash & mask;
+
+        while (slots[j].entry)
+          j = (j + 1) & mask;
+        slots[j] = p.slots[i];
+      }
+    }
+    ats_free(p.slots);
+    ink_atomic_increment(&allocated_bytes, -(int64_t) ((p.mask + 1) * sizeof(*slots)));
+  }
+  ink_atomic_increment(&allocated_bytes, (int64_t) (nslots * sizeof(*slots)));
+  p.slots = slots;
+  p.mask = mask;
+  p.hand = 0;
+}
+
+// CLOCK: sweep the hits counters down and evict the first record at zero,
+// or the least used of the records looked at.
+void
+HostDBTable::evict(HostDBTablePartition & p)
+{
+  HostDBTableEntry *victim = NULL;
+  uint32_t victim_slot = 0;
+  int seen = 0;
+
+  for (uint32_t n = 0; n <= p.mask && seen < HOST_DB_TABLE_EVICT_SCAN; n++) {
+    uint32_t i = p.hand;
+    HostDBTableEntry *e = p.slots[i].entry;
+
+    p.hand = (p.hand + 1) & p.mask;
+    if (!e)
+      continue;
+    seen++;
+    if (!victim || e->hits < victim->hits) {
+      victim = e;
+      victim_slot = i;
+    }
+    if (!e->hits)
+      break;
+    e->hits--;
+  }
+  if (victim) {
+    unlink(p, victim_slot);
+    retire(victim);
+  }
+}
+
+void
+HostDBTable::retire(HostDBTableEntry *e)
+{
+  e->full = 0;
+  e->retired_at = ink_get_hrtime_internal();
+  retired_entries.push(e);
+}
+
+HostDBInfo *
+HostDBTable::lookup(INK_MD5 const& md5)
+{
+  return find(partitions[partition_of(md5)], md5, NULL);
+}
+
+HostDBInfo *
+HostDBTable::insert(INK_MD5 const& md5)
+{
+  HostDBTablePartition & p = partitions[partition_of(md5)];
+  uint32_t slot;
+  HostDBTableEntry *e = find(p, md5, &slot);
+
+  if (e) {
+    unlink(p, slot);
+    retire(e);
+  }
+  // a few at a time if proxy.config.hostdb.size was lowered
+  for (int n = 0; n < 8 && p.count > 0 && p.count >= max_partition_entries; n++)
+    evict(p);
+  if (!p.slots || (uint32_t) (p.count + 1) * 4 > (p.mask + 1) * 3)
+    grow(p);
+
+  e = hostDBTableEntryAllocator.alloc();
+  memset(static_cast<HostDBInfo *>(e), 0, sizeof(HostDBInfo));
+  e->reset();
+  e->key = md5;
+  e->payload = NULL;
+  e->retired_at = 0;
+  // the round robin items are stamped with these, see HostDBContinuation::dnsEvent()
+  e->md5_high = md5[1];
+  e->md5_low = (unsigned int) (md5[0] >> 24);
+  e->md5_low_low = (unsigned int) (md5[0] & 0xFFFFFF);
+  e->full = 1;
+  ink_atomic_increment(&allocated_bytes, (int64_t) sizeof(HostDBTableEntry));
+
+  slot = md5[0] & p.mask;
+  while (p.slots[slot].entry)
+    slot = (slot + 1) & p.mask;
+  p.slots[slot].hash = md5[0];
+  p.slots[slot].entry = e;
+  p.count++;
+  return e;
+}
+
+void
+HostDBTable::remove(HostDBInfo *r)
+{
+  HostDBTableEntry *e = static_cast<HostDBTableEntry *>(r);
+  HostDBTablePartition & p = partitions[partition_of(e->key)];
+  uint32_t slot;
+
+  // already removed, or replaced by a newer record
+  if (find(p, e->key, &slot) != e)
+    return;
+  unlink(p, slot);
+  retire(e);
+}
+
+void
+HostDBTable::set_max_entries(int n)
+{
+  max_partition_entries = MAX(1, n / HOST_DB_TABLE_PARTITIONS);
+}
+
+int
+HostDBTable::entries() const
+{
+  int n = 0;
+
+  for (int i = 0; i < HOST_DB_TABLE_PARTITIONS; i++)
+    n += partitions[i].count;
+  return n;
+}
+
+//
+// Payloads
+//
+
+HostDBTable::PayloadSlot *
+HostDBTable::payload_slot(int index)
+{
+  PayloadSlot *chunk = payload_chunks[index / HOST_DB_PAYLOAD_CHUNK_SIZE];
+
+  return chunk ? &chunk[index % HOST_DB_PAYLOAD_CHUNK_SIZE] : NULL;
+}
+
+int
+HostDBTable::register_payload(HostDBPayload *p)
+{
+  int index = 0;
+
+  ink_mutex_acquire(&payload_lock);
+  if (payload_free) {
+    index = payload_free;
+    payload_free = payload_slot(index)->next_free;
+  } else if (payload_next <= HOST_DB_PAYLOAD_INDEX_MASK) {
+    index = payload_next++;
+    if (!payload_chunks[index / HOST_DB_PAYLOAD_CHUNK_SIZE]) {
+      PayloadSlot *chunk = (PayloadSlot *) ats_malloc(HOST_DB_PAYLOAD_CHUNK_SIZE * sizeof(PayloadSlot));
+
+      memset(chunk, 0, HOST_DB_PAYLOAD_CHUNK_SIZE * sizeof(PayloadSlot));
+      ink_atomic_swap(&payload_chunks[index / HOST_DB_PAYLOAD_CHUNK_SIZE], chunk);
+    }
+  }
+  if (index) {
+    PayloadSlot *s = payload_slot(index);
+
+    p->handle = (s->generation << HOST_DB_PAYLOAD_INDEX_BITS) | index;
+    // readers do not lock: the payload is complete before it is published
+    ink_atomic_swap(&s->payload, p);
+  }
+  ink_mutex_release(&payload_lock);
+  return index ? p->handle : 0;
+}
+
+void
+HostDBTable::unregister_payload(HostDBPayload *p)
+{
+  int index = p->handle & HOST_DB_PAYLOAD_INDEX_MASK;
+
+  ink_mutex_acquire(&payload_lock);
+  PayloadSlot *s = payload_slot(index);
+  if (s && s->payload == p) {
+    s->payload = NULL;
+    s->generation = (s->generation + 1) & HOST_DB_PAYLOAD_GENERATION_MASK;
+    s->next_free = payload_free;
+    payload_free = index;
+  }
+  ink_mutex_release(&payload_lock);
+}
+
+void *
+HostDBTable::alloc_payload(HostDBInfo *r, int *phandle, int size)
+{
+  HostDBTableEntry *e = static_cast<HostDBTableEntry *>(r);
+  int64_t total = PAYLOAD_HEADER_SIZE + size;
+  HostDBPayload *p = (HostDBPayload *) ats_malloc(total);
+
+  memset(p, 0, total);
+  p->refcount = 1;
+  p->size = size;
+  if (!register_payload(p)) {
+    ats_free(p);
+    return NULL;
+  }
+  ink_atomic_increment(&allocated_bytes, total);
+
+  if (e->payload)
+    release_payload(e->payload);
+  e->payload = p;
+  *phandle = p->handle;
+  return p->data();
+}
+
+void *
+HostDBTable::payload(int handle)
+{
+  if (handle <= 0)
+    return NULL;
+
+  PayloadSlot *s = payload_slot(handle & HOST_DB_PAYLOAD_INDEX_MASK);
+  HostDBPayload *p = s ? s->payload : NULL;
+
+  // a retired payload stays readable, and its handle no longer matches the slot
+  return p && p->handle == handle ? p->data() : NULL;
+}
+
+HostDBPayload *
+HostDBTable::retain_payload(int handle)
+{
+  if (!payload(handle))
+    return NULL;
+
+  HostDBPayload *p = payload_slot(handle & HOST_DB_PAYLOAD_INDEX_MASK)->payload;
+  ink_atomic_increment(&p->refcount, 1);
+  return p;
+}
+
+void
+HostDBTable::release_payload(HostDBPayload *p)
+{
+  if (ink_atomic_increment(&p->refcount, -1) == 1) {
+    unregister_payload(p);
+    p->retired_at = ink_get_hrtime_internal();
+    retired_payloads.push(p);
+  }
+}
+
+//
+// Reclaiming
+//
+
+int
+HostDBTable::reclaim(ink_hrtime now, ink_hrtime delay)
+{
+  int freed = 0;
+  HostDBTableEntry *e = retired_entries.popall();
+
+  while (e) {
+    HostDBTableEntry *next = e->retire_link.next;
+
+    if (e->retired_at + delay <= now) {
+      // the payload in turn stays readable for a while
+      if (e->payload)
+        release_payload(e->payload);
+      ink_atomic_increment(&allocated_bytes, -(int64_t) sizeof(HostDBTableEntry));
+      hostDBTableEntryAllocator.free(e);
+      freed++;
+    } else {
+      retired_entries.push(e);
+    }
+    e = next;
+  }
+
+  HostDBPayload *p = retired_payloads.popall();
+
+  while (p) {
+    HostDBPayload *next = p->retire_link.next;
+
+    if (p->retired_at + delay <= now) {
+      ink_atomic_increment(&allocated_bytes, -(int64_t) (PAYLOAD_HEADER_SIZE + p->size));
+      ats_free(p);
+      freed++;
+    } else {
+      retired_payloads.push(p);
+    }
+    p = next;
+  }
+  return freed;
+}
+
+void
+HostDBTable::clear()
+{
+  for (int i = 0; i < HOST_DB_TABLE_PARTITIONS; i++) {
+    HostDBTablePartition & p = partitions[i];
+
+    for (uint32_t j = 0; p.slots && j <= p.mask; j++) {
+      if (p.slots[j].entry)
+        retire(p.slots[j].entry);
+    }
+    if (p.slots)
+      ink_atomic_increment(&allocated_bytes, -(int64_t) ((p.mask + 1) * sizeof(*p.slots)));
+    ats_free(p.slots);
+    p.slots = NULL;
+    p.mask = 0;
+    p.count = 0;
+    p.hand = 0;
+  }
+  // twice, as freeing the records releases their payloads
+  reclaim(ink_get_hrtime_internal(), 0);
+  reclaim(ink_get_hrtime_internal(), 0);
+}
+
+void
+HostDBTable::reset()
+{
+  clear();
+  for (int i = 0; i < HOST_DB_PAYLOAD_CHUNKS; i++) {
+    ats_free(payload_chunks[i]);
+    payload_chunks[i] = NULL;
+  }
+  payload_free = 0;
+  payload_next = 1;
+}
+
+//
+// Snapshots
+//
+
+void
+HostDBTable::serialize_partition(int part, HostDBSnapshotBuffer & b)
+{
+  HostDBTablePartition & p = partitions[part];
+
+  for (uint32_t i = 0; p.slots && i <= p.mask; i++) {
+    HostDBTableEntry *e = p.slots[i].entry;
+
+    if (!e)
+      continue;
+
+    int psize = e->payload ? e->payload->size : 0;
+    int64_t rsize = sizeof(HostDBSnapshotRecord) + INK_ALIGN(psize, 8);
+
+    if (b.max_bytes > 0 && b.written + b.used + rsize > b.max_bytes) {
+      b.truncated = true;
+      continue;
+    }
+    if (b.used + rsize > b.size) {
+      b.size = MAX(b.size * 2, b.used + rsize + 65536);
+      b.data = (char *) ats_realloc(b.data, b.size);
+    }
+
+    HostDBSnapshotRecord *rec = (HostDBSnapshotRecord *) (b.data + b.used);
+
+    memset(rec, 0, rsize);
+    rec->key = e->key;
+    rec->info = *e;
+    rec->payload_size = psize;
+    if (psize)
+      memcpy(rec + 1, e->payload->data(), psize);
+    b.used += rsize;
+    b.count++;
+  }
+}
+
+static bool
+snapshot_write(int fd, const char *buf, int64_t len)
+{
+  while (len > 0) {
+    ssize_t n = ::write(fd, buf, len);
+
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+// The snapshot is written next to its final name and renamed over it once
+// complete, so a crash never leaves a partial snapshot to load.
+static int
+snapshot_create(const char *tmp_path)
+{
+  HostDBSnapshotHeader h;
+  int fd = ::open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if (fd < 0) {
+    Warning("unable to create HostDB snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+    return -1;
+  }
+  // the real header goes in last
+  memset(&h, 0, sizeof(h));
+  if (!snapshot_write(fd, (char *) &h, sizeof(h))) {
+    Warning("unable to write HostDB snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+    ::close(fd);
+    ::unlink(tmp_path);
+    return -1;
+  }
+  return fd;
+}
+
+static int
+snapshot_commit(int fd, HostDBSnapshotHeader & h, const char *tmp_path, const char *path)
+{
+  if (pwrite(fd, &h, sizeof(h), 0) != (ssize_t) sizeof(h) || fsync(fd) < 0) {
+    Warning("unable to write HostDB snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+    ::close(fd);
+    ::unlink(tmp_path);
+    return -1;
+  }
+  ::close(fd);
+  if (::rename(tmp_path, path) < 0) {
+    Warning("unable to rename HostDB snapshot '%s' to '%s': %d, %s", tmp_path, path, errno, strerror(errno));
+    ::unlink(tmp_path);
+    return -1;
+  }
+  return 0;
+}
+
+static void
+snapshot_header(HostDBSnapshotHeader & h, VersionNumber const& version, int count)
+{
+  memset(&h, 0, sizeof(h));
+  h.magic = HOST_DB_SNAPSHOT_MAGIC_NUMBER;
+  h.version = version;
+  h.info_size = sizeof(HostDBInfo);
+  h.count = count;
+}
+
+int
+HostDBTable::save(const char *path, int64_t max_bytes)
+{
+  char tmp_path[PATH_NAME_MAX + 1];
+  HostDBSnapshotBuffer b(max_bytes);
+  HostDBSnapshotHeader h;
+  int fd;
+
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+  if ((fd = snapshot_create(tmp_path)) < 0)
+    return -1;
+  for (int i = 0; i < HOST_DB_TABLE_PARTITIONS; i++) {
+    serialize_partition(i, b);
+    if (!snapshot_write(fd, b.data, b.used)) {
+      Warning("unable to write HostDB snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+      ::close(fd);
+      ::unlink(tmp_path);
+      return -1;
+    }
+    b.written += b.used;
+    b.used = 0;
+  }
+  snapshot_header(h, version, b.count);
+  return snapshot_commit(fd, h, tmp_path, path) < 0 ? -1 : b.count;
+}
+
+int
+HostDBTable::load(const char *path)
+{
+  struct stat st;
+  HostDBSnapshotHeader *h;
+  int fd = ::open(path, O_RDONLY);
+
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(HostDBSnapshotHeader)) {
+    ::close(fd);
+    return -1;
+  }
+
+  char *buf = (char *) ats_malloc(st.st_size);
+  int64_t size = 0;
+
+  while (size < st.st_size) {
+    ssize_t n = ::read(fd, buf + size, st.st_size - size);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    size += n;
+  }
+  ::close(fd);
+
+  h = (HostDBSnapshotHeader *) buf;
+  if (size < (int64_t) sizeof(HostDBSnapshotHeader) || h->magic != HOST_DB_SNAPSHOT_MAGIC_NUMBER ||
+      h->version.ink_major != version.ink_major || h->info_size != (int) sizeof(HostDBInfo)) {
+    Debug("hostdb", "'%s' is not a HostDB snapshot of this version", path);
+    ats_free(buf);
+    return -1;
+  }
+
+  int loaded = 0;
+  int64_t pos = sizeof(HostDBSnapshotHeader);
+
+  for (int i = 0; i < h->count && pos + (int64_t) sizeof(HostDBSnapshotRecord) <= size; i++) {
+    HostDBSnapshotRecord *rec = (HostDBSnapshotRecord *) (buf + pos);
+    int psize = rec->payload_size;
+    char *data = (char *) (rec + 1);
+
+    if (psize < 0 || pos + (int64_t) sizeof(HostDBSnapshotRecord) + INK_ALIGN(psize, 8) > size)
+      break;
+    pos += sizeof(HostDBSnapshotRecord) + INK_ALIGN(psize, 8);
+    if (!snapshot_callout(&rec->info, psize ? data : NULL, psize))
+      continue;
+
+    HostDBInfo *r = insert(rec->key);
+    bool full = r->full;
+    unsigned int md5_low = r->md5_low, md5_low_low = r->md5_low_low;
+    uint64_t md5_high = r->md5_high;
+
+    *r = rec->info;
+    r->full = full;
+    r->md5_high = md5_high;
+    r->md5_low = md5_low;
+    r->md5_low_low = md5_low_low;
+
+    // the handle in the snapshot means nothing now
+    int *phandle = r->payload_handle();
+    if (phandle) {
+      *phandle = 0;
+      if (psize) {
+        void *p = alloc_payload(r, phandle, psize);
+
+        if (!p) {
+          remove(r);
+          continue;
+        }
+        memcpy(p, data, psize);
+      }
+    }
+    loaded++;
+  }
+  ats_free(buf);
+  return loaded;
+}
+
+//
+// Writes a snapshot in the background: each partition is copied under its
+// lock, then written out on the task thread without any lock held.
+//
+struct HostDBTableSync;
+typedef int (HostDBTableSync::*HostDBTableSyncHandler) (int, void *);
+
+struct HostDBTableSync: public Continuation
+{
+  HostDBTable *table;
+  Continuation *cont;
+  int partition;
+  int fd;
+  ink_hrtime start_time;
+  HostDBSnapshotBuffer b;
+  char tmp_path[PATH_NAME_MAX + 1];
+
+  int copyEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    table->serialize_partition(partition, b);
+    mutex = e->ethread->mutex;
+    SET_HANDLER((HostDBTableSyncHandler) & HostDBTableSync::writeEvent);
+    e->schedule_imm();
+    return EVENT_CONT;
+  }
+
+  int writeEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    if (!snapshot_write(fd, b.data, b.used)) {
+      Warning("unable to write HostDB snapshot '%s': %d, %s", tmp_path, errno, strerror(errno));
+      ::close(fd);
+      ::unlink(tmp_path);
+      return finish(e);
+    }
+    b.written += b.used;
+    b.used = 0;
+    if (++partition < HOST_DB_TABLE_PARTITIONS) {
+      mutex = table->locks[partition];
+      SET_HANDLER((HostDBTableSyncHandler) & HostDBTableSync::copyEvent);
+      e->schedule_imm();
+      return EVENT_CONT;
+    }
+
+    HostDBSnapshotHeader h;
+
+    snapshot_header(h, table->version, b.count);
+    if (snapshot_commit(fd, h, tmp_path, table->snapshot_path) == 0) {
+      if (b.truncated)
+        Warning("HostDB snapshot truncated to %" PRId64 " bytes, see proxy.config.hostdb.storage_size", b.max_bytes);
+      Debug("hostdb", "wrote %d records (%" PRId64 " bytes) to %s in %.3f s", b.count, b.written, table->snapshot_path,
+            (double) (ink_get_hrtime() - start_time) / HRTIME_SECOND);
+    }
+    return finish(e);
+  }
+
+  int finish(Event *e)
+  {
+    mutex = cont->mutex;
+    SET_HANDLER((HostDBTableSyncHandler) & HostDBTableSync::doneEvent);
+    e->schedule_imm();
+    return EVENT_CONT;
+  }
+
+  int doneEvent(int /* event ATS_UNUSED */, Event * /* e ATS_UNUSED */)
+  {
+    cont->handleEvent(HOST_DB_TABLE_EVENT_SYNC, 0);
+    delete this;
+    return EVENT_DONE;
+  }
+
+  HostDBTableSync(Continuation *acont, HostDBTable *atable)
+    : Continuation(atable->locks[0]), table(atable), cont(acont), partition(0), fd(-1),
+      start_time(ink_get_hrtime()), b(atable->snapshot_max_bytes)
+  {
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", table->snapshot_path);
+    SET_HANDLER((HostDBTableSyncHandler) & HostDBTableSync::copyEvent);
+  }
+};
+
+void
+HostDBTable::sync_partitions(Continuation *cont)
+{
+  // don't try to sync if there is nowhere to write to
+  if (!snapshot_path[0])
+    return;
+
+  HostDBTableSync *s = new HostDBTableSync(cont, this);
+
+  if ((s->fd = snapshot_create(s->tmp_path)) < 0) {
+    s->mutex = cont->mutex;
+    SET_CONTINUATION_HANDLER(s, (HostDBTableSyncHandler) & HostDBTableSync::doneEvent);
+  }
+  eventProcessor.schedule_imm(s, ET_TASK);
+}
@@ -131,7 +131,7 @@ union HostDBApplicationInfo
 
   struct application_data_rr
   {
-    int offset;
+    int handle;                 // of the HostDBRoundRobin payload
   } rr;
 };
 
@@ -223,7 +223,7 @@ struct HostDBInfo
 
   union {
     IpEndpoint ip; ///< IP address / port data.
-    int hostname_offset; ///< Some hostname thing.
+    int hostname_handle; ///< Payload handle of the host name (reverse DNS).
     SRVInfo srv;
   } data;
 
@@ -232,7 +232,7 @@ struct HostDBInfo
   unsigned int ip_timeout_interval:31;
 
   unsigned int full:1;
-  unsigned int backed:1;        // duplicated in lower level
+  unsigned int backed:1;        // unused
   unsigned int deleted:1;
   unsigned int hits:3;
 
@@ -246,13 +246,13 @@ struct HostDBInfo
   uint64_t md5_high;
 
   bool failed() {
-    return !((is_srv && data.srv.srv_offset) || (reverse_dns && data.hostname_offset) || ats_is_ip(ip()));
+    return !((is_srv && data.srv.srv_offset) || (reverse_dns && data.hostname_handle) || ats_is_ip(ip()));
   }
   void set_failed() {
     if (is_srv)
       data.srv.srv_offset = 0;
     else if (reverse_dns)
-      data.hostname_offset = 0;
+      data.hostname_handle = 0;
     else
       ats_ip_invalidate(ip());
   }
@@ -262,25 +262,6 @@ struct HostDBInfo
 
   bool is_empty() const { return !full; }
 
-  void set_empty()
-  {
-    full = 0;
-    md5_high = 0;
-    md5_low = 0;
-    md5_low_low = 0;
-  }
-
-  void set_full(uint64_t folded_md5, int buckets)
-  {
-    uint64_t ttag = folded_md5 / buckets;
-
-    if (!ttag)
-      ttag = 1;
-    md5_low_low = (unsigned int) ttag;
-    md5_low = (unsigned int) (ttag >> 24);
-    full = 1;
-  }
-
   void reset()
   {
     ats_ip_invalidate(ip());
@@ -294,14 +275,15 @@ struct HostDBInfo
     is_srv = 0;
   }
 
-  uint64_t tag() {
-    uint64_t f = md5_low;
-    return (f << 24) + md5_low_low;
+  /// The field holding the handle of the payload, if the record has one.
+  int *payload_handle()
+  {
+    if (reverse_dns)
+      return &data.hostname_handle;
+    if (round_robin)
+      return &app.rr.handle;
+    return NULL;
   }
-
-  bool match(INK_MD5 &, int, int);
-  int heap_size();
-  int *heap_offset_ptr();
 };
 
 
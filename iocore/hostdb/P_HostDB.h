@@ -44,7 +44,7 @@
 
 // HostDB files
 #include "P_DNS.h"
-#include "P_MultiCache.h"
+#include "P_HostDBTable.h"
 #include "P_HostDBProcessor.h"
 
 
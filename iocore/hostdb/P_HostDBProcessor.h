@@ -57,6 +57,7 @@ extern char hostdb_filename[PATH_NAME_MAX + 1];
 
 //extern int hostdb_timestamp;
 extern int hostdb_sync_frequency;
+extern int hostdb_storage_size;
 extern int hostdb_disable_reverse_lookup;
 
 // Static configuration information
@@ -104,15 +105,12 @@ inline unsigned int HOSTDB_CLIENT_IP_HASH(
 // Constants
 //
 
-#define HOST_DB_HITS_BITS           3
-#define HOST_DB_TAG_BITS            56
-
 #define CONFIGURATION_HISTORY_PROBE_DEPTH   1
 
 // Bump this any time hostdb format is changed
-#define HOST_DB_CACHE_MAJOR_VERSION         3
+#define HOST_DB_CACHE_MAJOR_VERSION         4
 #define HOST_DB_CACHE_MINOR_VERSION         0
-// 2.2: IP family split 2.1 : IPv6
+// 4.0: snapshot of HostDBTable 2.2: IP family split 2.1 : IPv6
 
 #define DEFAULT_HOST_DB_FILENAME             "host.db"
 #define DEFAULT_HOST_DB_SIZE                 (1<<14)
@@ -139,11 +137,6 @@ inline unsigned int HOSTDB_CLIENT_IP_HASH(
 //#define TEST(_x) _x
 #define TEST(_x)
 
-
-#ifdef _HOSTDB_CC_
-template struct MultiCache <HostDBInfo >;
-#endif /* _HOSTDB_CC_ */
-
 struct ClusterMachine;
 struct HostEnt;
 struct ClusterConfiguration;
@@ -197,20 +190,12 @@ RecSetRawStatCount(hostdb_rsb, _x, _count);
 //
 // HostDBCache (Private)
 //
-struct HostDBCache: public MultiCache<HostDBInfo>
+struct HostDBCache: public HostDBTable
 {
-  int rebuild_callout(HostDBInfo * e, RebuildMC & r);
+  bool snapshot_callout(HostDBInfo * r, char *payload, int size);
   int start(int flags = 0);
-  MultiCacheBase *dup()
-  {
-    return new HostDBCache;
-  }
-
-  // This accounts for an average of 2 HostDBInfo per DNS cache (for round-robin etc.)
-  // In addition, we can do a padding for additional SRV records storage.
-  virtual size_t estimated_heap_bytes_per_entry() const { return sizeof(HostDBInfo) * 2 + 512 * hostdb_srv_enabled; }
 
-  Queue<HostDBContinuation, Continuation::Link_link> pending_dns[MULTI_CACHE_PARTITIONS];
+  Queue<HostDBContinuation, Continuation::Link_link> pending_dns[HOST_DB_TABLE_PARTITIONS];
   Queue<HostDBContinuation, Continuation::Link_link> &pending_dns_for_hash(INK_MD5 & md5);
   HostDBCache();
 };
@@ -531,7 +516,7 @@ HostDBContinuation():
   }
 };
 
-//extern Queue<HostDBContinuation>  remoteHostDBQueue[MULTI_CACHE_PARTITIONS];
+//extern Queue<HostDBContinuation>  remoteHostDBQueue[HOST_DB_TABLE_PARTITIONS];
 
 inline unsigned int
 master_hash(INK_MD5 const& md5)
@@ -548,13 +533,13 @@ is_dotted_form_hostname(const char *c)
 inline Queue<HostDBContinuation> &
 HostDBCache::pending_dns_for_hash(INK_MD5 & md5)
 {
-  return pending_dns[partition_of_bucket((int) (fold_md5(md5) % hostDB.buckets))];
+  return pending_dns[partition_of(md5)];
 }
 
 inline int
 HostDBContinuation::key_partition()
 {
-  return hostDB.partition_of_bucket(fold_md5(md5.hash) % hostDB.buckets);
+  return hostDB.partition_of(md5.hash);
 }
 
 #endif /* _P_HostDBProcessor_h_ */
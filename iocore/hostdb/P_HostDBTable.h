@@ -0,0 +1,254 @@
+/** @file
+
+  In-memory table of HostDB records.
+
+  The records live in a hash table split in HOST_DB_TABLE_PARTITIONS
+  partitions, each of them an open addressing table with its own lock,
+  which grows by doubling when it is three quarters full and evicts
+  the least used records (CLOCK over the hits counter) when it holds
+  more than its share of proxy.config.hostdb.size. Growing a partition
+  only holds the lock of that partition.
+
+  Round robin and reverse DNS data are separate, reference counted,
+  payloads. A record refers to its payload by a handle (the int that
+  used to hold a heap offset) which resolves without locks and stops
+  resolving once the payload is released, so a copy of a HostDBInfo
+  can outlive its record safely.
+
+  Removed records and released payloads are not freed right away:
+  callers may still hold pointers to them (a lookup result is valid
+  until the callback returns), so they are retired and reclaim()
+  frees them once HOST_DB_TABLE_RECLAIM_DELAY has passed. Nothing ever
+  stops the table to collect garbage.
+
+  The table can be written to a snapshot file and loaded back at
+  start, so that a restart does not begin with an empty HostDB.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _P_HostDBTable_h_
+#define _P_HostDBTable_h_
+
+#include "I_EventSystem.h"
+#include "I_HostDBProcessor.h"
+#include "I_Version.h"
+
+//
+// Constants
+//
+
+#define HOST_DB_TABLE_PARTITIONS        64
+
+#define HOST_DB_TABLE_EVENT_SYNC        HOSTDB_TABLE_EVENT_EVENTS_START
+
+// Smallest number of slots of a partition, a power of two
+#define HOST_DB_TABLE_MIN_SLOTS         16
+// Slots looked at to find a record to evict
+#define HOST_DB_TABLE_EVICT_SCAN        64
+
+// How long a removed record or a released payload stays readable
+#define HOST_DB_TABLE_RECLAIM_DELAY     HRTIME_SECONDS(10)
+
+// A payload handle is the index of the payload in the registry
+// (24 bits, 0 is never used) and a 7 bit generation, so a stale
+// handle does not resolve to the payload that reused its index.
+#define HOST_DB_PAYLOAD_INDEX_BITS      24
+#define HOST_DB_PAYLOAD_INDEX_MASK      ((1 << HOST_DB_PAYLOAD_INDEX_BITS) - 1)
+#define HOST_DB_PAYLOAD_GENERATION_MASK 0x7F
+#define HOST_DB_PAYLOAD_CHUNK_SIZE      4096
+#define HOST_DB_PAYLOAD_CHUNKS          ((1 << HOST_DB_PAYLOAD_INDEX_BITS) / HOST_DB_PAYLOAD_CHUNK_SIZE)
+
+#define HOST_DB_SNAPSHOT_MAGIC_NUMBER   0x0BAD2D9
+
+//
+// Types
+//
+
+struct HostDBPayload
+{
+  volatile int refcount;
+  int size;
+  int handle;
+  ink_hrtime retired_at;
+  SLINK(HostDBPayload, retire_link);
+
+  char *data() { return reinterpret_cast<char *>(this) + INK_ALIGN(sizeof(HostDBPayload), 8); }
+};
+
+struct HostDBTableEntry: public HostDBInfo
+{
+  INK_MD5 key;
+  HostDBPayload *payload;
+  ink_hrtime retired_at;
+  SLINK(HostDBTableEntry, retire_link);
+};
+
+struct HostDBTablePartition
+{
+  struct Slot
+  {
+    uint64_t hash;              // key[0], so probing does not touch the entries
+    HostDBTableEntry *entry;    // NULL if the slot is free
+  };
+
+  Slot *slots;
+  uint32_t mask;                // number of slots - 1
+  int count;
+  uint32_t hand;                // CLOCK hand for eviction
+
+  HostDBTablePartition() : slots(NULL), mask(0), count(0), hand(0) { }
+};
+
+struct HostDBSnapshotHeader
+{
+  unsigned int magic;
+  VersionNumber version;
+  int info_size;                // sizeof(HostDBInfo) when written
+  int count;
+};
+
+// Each record of a snapshot is a HostDBSnapshotRecord followed by
+// payload_size bytes of payload, padded to 8 bytes.
+struct HostDBSnapshotRecord
+{
+  INK_MD5 key;
+  HostDBInfo info;
+  int payload_size;
+  int pad;
+};
+
+// Records copied out of the table, waiting to be written.
+struct HostDBSnapshotBuffer
+{
+  char *data;
+  int64_t size;
+  int64_t used;
+  int64_t written;              // bytes already in the file
+  int64_t max_bytes;            // 0 for no limit
+  int count;
+  bool truncated;
+
+  HostDBSnapshotBuffer(int64_t amax_bytes)
+    : data(NULL), size(0), used(0), written(sizeof(HostDBSnapshotHeader)), max_bytes(amax_bytes), count(0),
+      truncated(false)
+  { }
+  ~HostDBSnapshotBuffer() { ats_free(data); }
+};
+
+struct HostDBTable
+{
+  Ptr<ProxyMutex> locks[HOST_DB_TABLE_PARTITIONS];
+  VersionNumber version;
+  char snapshot_path[PATH_NAME_MAX + 1];
+  int64_t snapshot_max_bytes;
+
+  void alloc_mutexes();
+
+  int partition_of(INK_MD5 const& md5) const { return (int) (md5[1] % HOST_DB_TABLE_PARTITIONS); }
+  ProxyMutex *lock_for(INK_MD5 const& md5) { return locks[partition_of(md5)]; }
+
+  // The following must be called with the lock of the partition of the
+  // record held (or before the table is shared).
+
+  /// The record for @a md5, or @c NULL.
+  HostDBInfo *lookup(INK_MD5 const& md5);
+  /// A new, empty, record for @a md5, replacing the current one if any.
+  HostDBInfo *insert(INK_MD5 const& md5);
+  /// Remove @a r from the table. It stays readable for a while.
+  void remove(HostDBInfo *r);
+  /** Give @a r a zeroed payload of @a size bytes, releasing the one it had.
+      The handle is stored in @a phandle, which must be a field of @a r.
+      @return The payload data, or @c NULL if there is no room.
+  */
+  void *alloc_payload(HostDBInfo *r, int *phandle, int size);
+  /// Take a reference to the payload of @a handle, or return @c NULL.
+  HostDBPayload *retain_payload(int handle);
+
+  // The following can be called from any thread.
+
+  /// The payload data of @a handle, or @c NULL if it was released.
+  void *payload(int handle);
+  void release_payload(HostDBPayload *p);
+
+  /// Maximum number of records of the whole table, applied as they are inserted.
+  void set_max_entries(int n);
+  int entries() const;
+  int64_t bytes() const { return allocated_bytes; }
+
+  /// Free the records and payloads retired long enough ago.
+  int reclaim(ink_hrtime now, ink_hrtime delay = HOST_DB_TABLE_RECLAIM_DELAY);
+  /// Remove every record. Not safe while the table is in use.
+  void clear();
+  /// Remove every record and free all the memory of the table.
+  void reset();
+
+  /// Write a snapshot to @a snapshot_path in the background and call back
+  /// @a cont with HOST_DB_TABLE_EVENT_SYNC.
+  void sync_partitions(Continuation *cont);
+  /// Write a snapshot to @a path now. Not safe while the table is in use.
+  int save(const char *path, int64_t max_bytes);
+  /** Insert the records of the snapshot at @a path that
+      snapshot_callout() accepts.
+      @return The number of records loaded, or -1 if the file is not a usable snapshot.
+  */
+  int load(const char *path);
+  virtual bool snapshot_callout(HostDBInfo * /* r ATS_UNUSED */, char * /* payload ATS_UNUSED */,
+                                int /* size ATS_UNUSED */)
+  {
+    return true;
+  }
+
+  /// Copy the records of partition @a part to @a b. Needs the lock of the partition.
+  void serialize_partition(int part, HostDBSnapshotBuffer & b);
+
+  HostDBTable();
+  virtual ~HostDBTable();
+
+private:
+  struct PayloadSlot
+  {
+    HostDBPayload *volatile payload;
+    int generation;
+    int next_free;
+  };
+
+  HostDBTablePartition partitions[HOST_DB_TABLE_PARTITIONS];
+  volatile int max_partition_entries;
+  volatile int64_t allocated_bytes;
+
+  PayloadSlot *volatile payload_chunks[HOST_DB_PAYLOAD_CHUNKS];
+  ink_mutex payload_lock;
+  int payload_free;
+  int payload_next;
+
+  ASLL(HostDBTableEntry, retire_link) retired_entries;
+  ASLL(HostDBPayload, retire_link) retired_payloads;
+
+  HostDBTableEntry *find(HostDBTablePartition & p, INK_MD5 const& md5, uint32_t *pslot);
+  void unlink(HostDBTablePartition & p, uint32_t slot);
+  void grow(HostDBTablePartition & p);
+  void evict(HostDBTablePartition & p);
+  void retire(HostDBTableEntry *e);
+  int register_payload(HostDBPayload *p);
+  void unregister_payload(HostDBPayload *p);
+  PayloadSlot *payload_slot(int index);
+};
+
+#endif /* _P_HostDBTable_h_ */
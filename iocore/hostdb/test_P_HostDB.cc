@@ -1,6 +1,18 @@
 /** @file
 
-  A brief file description
+  Tests and benchmark of the HostDB record table.
+
+  Without arguments this checks the table: lookups against a reference
+  set of keys while records come and go, eviction, payload handles, the
+  reclaiming of removed records and snapshots. With arguments
+
+    test_P_HostDB bench [records [threads]]
+
+  it fills a table with 1M records (one in four with round robin data),
+  or the given number, and prints the lookups per second of 1, 2, 4 and
+  8 threads, or the given number, each thread owning a share of the
+  partitions as it would by holding their locks. It then replaces
+  records for a while and prints how long reclaim() and insert() paused.
 
   @section license License
 
@@ -22,62 +34,461 @@
  */
 
 #include "P_HostDB.h"
+#include "ts/TestBox.h"
 
 Diags *diags;
-struct NetTesterSM:public Continuation
+
+static INK_MD5
+make_key(InkRand & rand)
+{
+  INK_MD5 md5;
+
+  md5.u64[0] = rand.random();
+  md5.u64[1] = rand.random();
+  return md5;
+}
+
+// keys that collide in their home slot and partition
+static INK_MD5
+make_key(uint64_t low, uint64_t high)
 {
-  VIO *read_vio;
-  IOBufferReader *reader;
-  NetVConnection *vc;
-  MIOBuffer *buf;
-
-    NetTesterSM(ProxyMutex * _mutex, NetVConnection * _vc):Continuation(_mutex)
-  {
-    MUTEX_TRY_LOCK(lock, mutex, _vc->thread);
-    ink_release_assert(lock);
-    vc = _vc;
-    SET_HANDLER(&NetTesterSM::handle_read);
-    buf = new_MIOBuffer(8);
-    reader = buf->alloc_reader();
-    read_vio = vc->do_io_read(this, INT64_MAX, buf);
+  INK_MD5 md5;
+
+  md5.u64[0] = low;
+  md5.u64[1] = high;
+  return md5;
+}
+
+REGRESSION_TEST(HostDBTable_Basic)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  HostDBTable table;
+  INK_MD5 a = make_key(1, 7), b = make_key(1 + 16, 7), c = make_key(2, 7);
+
+  box.check(table.lookup(a) == NULL && table.entries() == 0, "empty table finds something");
+
+  HostDBInfo *ra = table.insert(a);
+  HostDBInfo *rb = table.insert(b);
+  HostDBInfo *rc = table.insert(c);
+
+  box.check(ra && rb && rc && table.entries() == 3, "entries is %d", table.entries());
+  box.check(table.lookup(a) == ra && table.lookup(b) == rb && table.lookup(c) == rc, "lookup after insert");
+  box.check(ra->full && ra->md5_high == a[1], "new record is not full");
+
+  // b probed past a: removing a must not hide b
+  table.remove(ra);
+  box.check(table.lookup(a) == NULL && table.lookup(b) == rb && table.lookup(c) == rc, "lookup after remove");
+  box.check(!ra->full, "removed record is still full");
+  table.remove(ra);
+  box.check(table.entries() == 2, "removing twice, entries is %d", table.entries());
+
+  // insert replaces, and removing the replaced record does nothing
+  HostDBInfo *rb2 = table.insert(b);
+  box.check(rb2 != rb && table.lookup(b) == rb2, "insert did not replace");
+  table.remove(rb);
+  box.check(table.lookup(b) == rb2 && table.entries() == 2, "removing a replaced record");
+
+  table.reset();
+  box.check(table.entries() == 0 && table.bytes() == 0, "reset left %d records, %" PRId64 " bytes", table.entries(),
+            table.bytes());
+}
+
+REGRESSION_TEST(HostDBTable_Random)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  static const int NKEYS = 20000;
+  InkRand rand(17);
+  INK_MD5 *keys = (INK_MD5 *) ats_malloc(NKEYS * sizeof(INK_MD5));
+  HostDBInfo **records = (HostDBInfo **) ats_malloc(NKEYS * sizeof(HostDBInfo *));
+  HostDBTable table;
+  int present = 0;
+
+  for (int i = 0; i < NKEYS; i++) {
+    // a few partitions and home slots, for long probe sequences
+    keys[i] = (i % 3) ? make_key(rand) : make_key(((uint64_t) i << 32) | (rand.random() % 64), rand.random() % 4);
+    records[i] = NULL;
   }
 
+  for (int round = 0; round < 4; round++) {
+    for (int n = 0; n < NKEYS; n++) {
+      int i = rand.random() % NKEYS;
 
-  int handle_read(int event, void *data)
-  {
-    int r;
-    char *str;
-    switch (event) {
-    case VC_EVENT_READ_READY:
-      r = reader->read_avail();
-      str = new char[r + 10];
-      reader->read(str, r);
-      printf("%s", str);
-      fflush(stdout);
-      break;
-    case VC_EVENT_READ_COMPLETE:
-      /* FALLSTHROUGH */
-    case VC_EVENT_EOS:
-      r = reader->read_avail();
-      str = new char[r + 10];
-      reader->read(str, r);
-      printf("%s", str);
-      fflush(stdout);
-    case VC_EVENT_ERROR:
-      vc->do_io_close();
-      // fixme
-      // handle timeout events
-      break;
-    default:
-      ink_release_assert(!"unknown event");
+      if (records[i] && rand.random() % 2) {
+        table.remove(records[i]);
+        records[i] = NULL;
+        present--;
+      } else {
+        if (!records[i])
+          present++;
+        records[i] = table.insert(keys[i]);
+      }
+    }
+    for (int i = 0; i < NKEYS; i++) {
+      HostDBInfo *r = table.lookup(keys[i]);
 
+      if (!box.check(r == records[i], "round %d key %d: found %p, expected %p", round, i, r, records[i]))
+        break;
     }
-    return EVENT_CONT;
+    box.check(table.entries() == present, "round %d: %d entries, expected %d", round, table.entries(), present);
   }
 
+  table.reset();
+  ats_free(keys);
+  ats_free(records);
+}
+
+REGRESSION_TEST(HostDBTable_Evict)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  static const int MAX_ENTRIES = HOST_DB_TABLE_PARTITIONS * 32;
+  static const int NKEYS = MAX_ENTRIES * 8;
+  InkRand rand(5);
+  INK_MD5 hot[64];
+  HostDBTable table;
+
+  table.set_max_entries(MAX_ENTRIES);
+  for (unsigned i = 0; i < countof(hot); i++)
+    hot[i] = make_key(rand);
+
+  for (int n = 0; n < NKEYS; n++) {
+    // the hot records are hit between each insert, like probe() does
+    if (n % 16 == 0) {
+      for (unsigned i = 0; i < countof(hot); i++) {
+        HostDBInfo *r = table.lookup(hot[i]);
+
+        if (!r)
+          r = table.insert(hot[i]);
+        r->hits = (1 << 3) - 1;
+      }
+    }
+    table.insert(make_key(rand));
+  }
+  box.check(table.entries() <= MAX_ENTRIES, "%d entries, max %d", table.entries(), MAX_ENTRIES);
+
+  int survived = 0;
+  for (unsigned i = 0; i < countof(hot); i++)
+    survived += table.lookup(hot[i]) != NULL;
+  box.check(survived > (int) countof(hot) * 3 / 4, "only %d of %d hot records survived", survived, (int) countof(hot));
+
+  // lowering the maximum shrinks the table as records come in
+  table.set_max_entries(MAX_ENTRIES / 4);
+  for (int n = 0; n < MAX_ENTRIES; n++)
+    table.insert(make_key(rand));
+  box.check(table.entries() <= MAX_ENTRIES / 4, "%d entries after lowering the max to %d", table.entries(),
+            MAX_ENTRIES / 4);
+
+  table.reset();
+}
+
+REGRESSION_TEST(HostDBTable_Payload)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  HostDBTable table;
+  INK_MD5 a = make_key(11, 12), b = make_key(13, 14);
+  HostDBInfo *ra = table.insert(a);
+
+  ra->round_robin = 1;
+  char *p1 = (char *) table.alloc_payload(ra, &ra->app.rr.handle, 100);
+  int h1 = ra->app.rr.handle;
+
+  box.check(p1 && h1 > 0 && table.payload(h1) == p1, "payload of a new handle");
+  box.check(p1[0] == 0 && p1[99] == 0, "payload is not zeroed");
+  box.check(ra->payload_handle() == &ra->app.rr.handle, "payload_handle() of a round robin record");
+  strcpy(p1, "first");
+
+  // a copy of the record resolves its payload too
+  HostDBInfo copy = *ra;
+  box.check(table.payload(copy.app.rr.handle) == p1, "payload of a copy");
+
+  // replacing the payload: the old handle stops resolving, the old data stays readable
+  HostDBPayload *held = table.retain_payload(h1);
+  char *p2 = (char *) table.alloc_payload(ra, &ra->app.rr.handle, 50);
+  int h2 = ra->app.rr.handle;
+
+  box.check(held && p2 && h2 != h1 && table.payload(h2) == p2, "second payload");
+  box.check(table.payload(h1) == p1 && strcmp(p1, "first") == 0, "retained payload went away");
+  table.release_payload(held);
+  box.check(table.payload(h1) == NULL, "released handle still resolves");
+  box.check(strcmp(p1, "first") == 0, "released payload was freed before its time");
+
+  // the index of the released payload is reused, with another generation
+  HostDBInfo *rb = table.insert(b);
+  rb->reverse_dns = 1;
+  char *p3 = (char *) table.alloc_payload(rb, &rb->data.hostname_handle, 10);
+  int h3 = rb->data.hostname_handle;
+
+  box.check(p3 && h3 != h1 && (h3 & HOST_DB_PAYLOAD_INDEX_MASK) == (h1 & HOST_DB_PAYLOAD_INDEX_MASK),
+            "handle %x reuses %x", h3, h1);
+  box.check(table.payload(h1) == NULL && table.payload(h3) == p3, "stale handle resolves");
+  box.check(table.payload(0) == NULL && table.payload(-1) == NULL, "null handle resolves");
+
+  // the payload of a removed record lives as long as the record
+  table.remove(ra);
+  box.check(table.payload(h2) == p2, "payload of a removed record went away");
+  table.reclaim(ink_get_hrtime_internal(), 0);
+  box.check(table.payload(h2) == NULL, "payload of a reclaimed record still resolves");
+
+  table.reset();
+  box.check(table.bytes() == 0, "%" PRId64 " bytes left after reset", table.bytes());
+}
+
+REGRESSION_TEST(HostDBTable_Reclaim)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  HostDBTable table;
+  InkRand rand(3);
+  HostDBInfo *r = NULL;
 
+  for (int i = 0; i < 1000; i++) {
+    r = table.insert(make_key(rand));
+    r->round_robin = 1;
+    table.alloc_payload(r, &r->app.rr.handle, 64);
+  }
+  int64_t full = table.bytes();
+
+  table.clear();
+  box.check(table.entries() == 0 && table.bytes() < full, "clear() left %d entries, %" PRId64 " bytes",
+            table.entries(), table.bytes());
+
+  // records removed now are not freed until the delay is over
+  INK_MD5 key = make_key(rand);
+  r = table.insert(key);
+  table.remove(r);
+
+  ink_hrtime now = ink_get_hrtime_internal();
+  box.check(table.reclaim(now, HRTIME_SECONDS(10)) == 0, "reclaimed a record before its time");
+  box.check(table.reclaim(now + HRTIME_SECONDS(11), HRTIME_SECONDS(10)) == 1, "did not reclaim the record");
+
+  table.reset();
+}
+
+REGRESSION_TEST(HostDBTable_Snapshot)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  char path[PATH_NAME_MAX + 1];
+  InkRand rand(9);
+  INK_MD5 keys[300];
+  HostDBTable table, loaded, rejected;
+
+  snprintf(path, sizeof(path), "/tmp/test_P_HostDB.%d", (int) getpid());
+  table.version.ink_major = loaded.version.ink_major = 4;
+  for (unsigned i = 0; i < countof(keys); i++) {
+    HostDBInfo *r = table.insert(keys[i] = make_key(rand));
+
+    r->ip_timestamp = i;
+    if (i % 3 == 1) {
+      r->round_robin = 1;
+      char *p = (char *) table.alloc_payload(r, &r->app.rr.handle, 20 + i);
+      snprintf(p, 20 + i, "rr %u", i);
+    } else if (i % 3 == 2) {
+      r->reverse_dns = 1;
+      char *p = (char *) table.alloc_payload(r, &r->data.hostname_handle, 20);
+      snprintf(p, 20, "host%u.example.com", i);
+    }
+  }
+
+  box.check(table.save(path, 0) == (int) countof(keys), "save");
+  box.check(loaded.load(path) == (int) countof(keys), "load");
+  box.check(loaded.entries() == (int) countof(keys), "%d entries loaded", loaded.entries());
+  for (unsigned i = 0; i < countof(keys); i++) {
+    HostDBInfo *r = loaded.lookup(keys[i]);
+    char expected[32];
+
+    box.check(r && r->ip_timestamp == i, "record %u", i);
+    if (!r)
+      continue;
+    if (i % 3 == 1) {
+      snprintf(expected, sizeof(expected), "rr %u", i);
+      box.check(r->round_robin && strcmp((char *) loaded.payload(r->app.rr.handle), expected) == 0, "round robin %u", i);
+    } else if (i % 3 == 2) {
+      snprintf(expected, sizeof(expected), "host%u.example.com", i);
+      box.check(r->reverse_dns && strcmp((char *) loaded.payload(r->data.hostname_handle), expected) == 0, "hostname %u", i);
+    }
+  }
+
+  // a snapshot of another version, or a truncated one, is not loaded
+  rejected.version.ink_major = 3;
+  box.check(rejected.load(path) == -1 && rejected.entries() == 0, "loaded a snapshot of another version");
+  box.check(truncate(path, 10) == 0 && loaded.load(path) == -1, "loaded a truncated snapshot");
+
+  // the size limit drops records, it does not break the snapshot
+  int n = table.save(path, 4096);
+  box.check(n > 0 && n < (int) countof(keys), "saved %d records in 4 KB", n);
+  rejected.version.ink_major = 4;
+  box.check(rejected.load(path) == n, "loaded a snapshot of %d records", n);
+
+  unlink(path);
+  table.reset();
+  loaded.reset();
+  rejected.reset();
+}
+
+//
+// Benchmark
+//
+
+struct BenchThread
+{
+  HostDBTable *table;
+  INK_MD5 *keys;
+  int nkeys;
+  int thread;
+  int nthreads;
+  int64_t lookups;
+  int64_t hits;
+  ink_hrtime elapsed;
 };
 
-main()
+static void *
+bench_lookups(void *arg)
+{
+  static const int ROUNDS = 4;
+  BenchThread *b = (BenchThread *) arg;
+  ink_hrtime start = ink_get_hrtime_internal();
+
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int i = 0; i < b->nkeys; i++) {
+      // the partitions of this thread only, as if it held their locks
+      if (b->table->partition_of(b->keys[i]) % b->nthreads != b->thread)
+        continue;
+      if (b->table->lookup(b->keys[i]))
+        b->hits++;
+      b->lookups++;
+    }
+  }
+  b->elapsed = ink_get_hrtime_internal() - start;
+  return NULL;
+}
+
+static void
+bench(int nrecords, int nthreads)
+{
+  InkRand rand(nrecords);
+  HostDBTable table;
+  int nkeys = nrecords + nrecords / 10;
+  INK_MD5 *keys = (INK_MD5 *) ats_malloc(nkeys * sizeof(INK_MD5));
+  ink_hrtime worst = 0;
+
+  table.set_max_entries(nrecords);
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int i = 0; i < nkeys; i++) {
+    keys[i] = make_key(rand);
+    // one key in eleven is not in the table
+    if (i >= nrecords)
+      continue;
+
+    ink_hrtime t = ink_get_hrtime_internal();
+    HostDBInfo *r = table.insert(keys[i]);
+
+    if (i % 4 == 0) {
+      r->round_robin = 1;
+      table.alloc_payload(r, &r->app.rr.handle, HostDBRoundRobin::size(4));
+    }
+    worst = MAX(worst, ink_get_hrtime_internal() - t);
+  }
+  ink_hrtime filled = ink_get_hrtime_internal() - start;
+
+  printf("%d records: fill %.1f ms, worst insert %.3f ms, %.1f bytes per record\n", table.entries(),
+         (double) filled / HRTIME_MSECOND, (double) worst / HRTIME_MSECOND, (double) table.bytes() / table.entries());
+
+  // shuffle so that lookups do not follow the insertion order
+  for (int i = nkeys - 1; i > 0; i--) {
+    int j = rand.random() % (i + 1);
+    INK_MD5 tmp = keys[i];
+
+    keys[i] = keys[j];
+    keys[j] = tmp;
+  }
+
+  for (int n = 1; n <= 8; n *= 2) {
+    int threads = nthreads ? nthreads : n;
+    BenchThread *b = (BenchThread *) ats_malloc(threads * sizeof(BenchThread));
+    ink_thread *tids = (ink_thread *) ats_malloc(threads * sizeof(ink_thread));
+    int64_t lookups = 0, hits = 0;
+    ink_hrtime elapsed = 0;
+
+    for (int t = 0; t < threads; t++) {
+      BenchThread bt = { &table, keys, nkeys, t, threads, 0, 0, 0 };
+
+      b[t] = bt;
+      tids[t] = ink_thread_create(bench_lookups, &b[t], 0);
+    }
+    for (int t = 0; t < threads; t++) {
+      ink_thread_join(tids[t]);
+      lookups += b[t].lookups;
+      hits += b[t].hits;
+      elapsed = MAX(elapsed, b[t].elapsed);
+    }
+    printf("  %d threads: %6.1f M lookups/s (%d%% hits)\n", threads, (double) lookups / elapsed * HRTIME_SECOND / 1000000,
+           (int) (hits * 100 / lookups));
+    ats_free(b);
+    ats_free(tids);
+    if (nthreads)
+      break;
+  }
+
+  // Replace records as DNS answers come in, reclaiming every "second".
+  static const int ROUNDS = 20;
+  ink_hrtime reclaim_total = 0, reclaim_worst = 0, now = ink_get_hrtime_internal();
+  int reclaimed = 0;
+
+  worst = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    for (int n = 0; n < nrecords / ROUNDS; n++) {
+      int i = rand.random() % nrecords;
+      ink_hrtime t = ink_get_hrtime_internal();
+      HostDBInfo *r = table.insert(keys[i]);
+
+      if (i % 4 == 0) {
+        r->round_robin = 1;
+        table.alloc_payload(r, &r->app.rr.handle, HostDBRoundRobin::size(4));
+      }
+      worst = MAX(worst, ink_get_hrtime_internal() - t);
+    }
+    now += HRTIME_SECOND;
+
+    ink_hrtime t = ink_get_hrtime_internal();
+    reclaimed += table.reclaim(now, HRTIME_SECONDS(10));
+    t = ink_get_hrtime_internal() - t;
+    reclaim_total += t;
+    reclaim_worst = MAX(reclaim_worst, t);
+  }
+  printf("  churn: %d inserts, worst insert %.3f ms, %d freed, reclaim %.3f ms on average, %.3f ms at worst\n",
+         nrecords / ROUNDS * ROUNDS, (double) worst / HRTIME_MSECOND, reclaimed,
+         (double) reclaim_total / ROUNDS / HRTIME_MSECOND, (double) reclaim_worst / HRTIME_MSECOND);
+
+  table.reset();
+  ats_free(keys);
+}
+
+int
+main(int argc, char **argv)
 {
+  diags = new Diags(NULL, NULL);
+
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    bench(argc > 2 ? atoi(argv[2]) : 1000000, argc > 3 ? atoi(argv[3]) : 0);
+    return 0;
+  }
+
+  RegressionTest::run((char *) "HostDBTable_.*");
+  return RegressionTest::final_status == REGRESSION_TEST_PASSED ? 0 : 1;
 }
@@ -235,6 +235,12 @@ Server::setup_fd_for_listen(
     goto Lerror;
   }
 
+#ifdef SO_REUSEPORT
+  if (f_reuseport && (res = safe_setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, SOCKOPT_ON, sizeof(int))) < 0) {
+    goto Lerror;
+  }
+#endif
+
 #ifdef SET_TCP_NO_DELAY
   if ((res = safe_setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, SOCKOPT_ON, sizeof(int))) < 0) {
     goto Lerror;
@@ -488,6 +488,35 @@ public:
 
   virtual SOCKET get_socket() = 0;
 
+  /** Move data read from this connection directly to @a peer.
+
+      Once the read buffer of this connection has drained, data is moved
+      from its socket to the socket of @a peer without being copied into
+      user space. The read VIO of this connection and the write VIO of
+      @a peer must already be set up, share a mutex and use the same
+      buffer. Splicing ends when either VIO is replaced or completes.
+
+      @return @c true if splicing was set up.
+  */
+  virtual bool splice_to(NetVConnection *peer) { (void) peer; return false; }
+
+  /** Move an idle connection to the net thread @a t.
+
+      The socket is handed to a new NetVConnection owned by @a t, with
+      @a cont's mutex, and this connection is closed on its original
+      thread without closing the socket. The caller must hold the mutex
+      of this connection's read VIO and no I/O may be pending.
+
+      @return The connection to use from now on, or @c NULL if it
+      could not be moved, in which case this connection is unchanged.
+  */
+  virtual NetVConnection *migrate_to_thread(Continuation *cont, EThread *t) { (void) cont; (void) t; return NULL; }
+
+  /** Check whether this connection is in a state migrate_to_thread() can
+      move, without moving it. The move can still fail on lock contention.
+  */
+  virtual bool can_migrate() const { return false; }
+
   /** Set the TCP initial congestion window */
   virtual int set_tcp_init_cwnd(int init_cwnd) = 0;
 
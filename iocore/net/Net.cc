@@ -32,6 +32,7 @@
 #include "P_Net.h"
 
 RecRawStatBlock *net_rsb = NULL;
+RecRawStatBlock *net_accept_thread_rsb = NULL;
 int net_config_poll_timeout = -1; // This will get set via either command line or records.config.
 
 static inline void
@@ -39,6 +40,11 @@ configure_net(void)
 {
   REC_RegisterConfigUpdateFunc("proxy.config.net.connections_throttle", change_net_connections_throttle, NULL);
   REC_ReadConfigInteger(fds_throttle, "proxy.config.net.connections_throttle");
+  REC_ReadConfigInteger(net_splice_enabled, "proxy.config.net.splice_tunnel");
+  if (net_splice_enabled)
+    net_splice_calibrate();
+  REC_ReadConfigInteger(net_default_inactivity_timeout, "proxy.config.net.default_inactivity_timeout");
+  Debug("iocore_net", "default inactivity timeout is set to: %d", net_default_inactivity_timeout);
 }
 
 
@@ -108,9 +114,17 @@ register_net_stats()
                      RECD_INT, RECP_NON_PERSISTENT, (int) socks_connections_currently_open_stat, RecRawStatSyncSum);
   NET_CLEAR_DYN_STAT(socks_connections_currently_open_stat);
 
-  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.net.inactivity_cop_lock_acquire_failure",
-                     RECD_INT, RECP_PERSISTENT, (int) inactivity_cop_lock_acquire_failure_stat,
-                     RecRawStatSyncSum);
+  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.net.splice.tunnels",
+                     RECD_INT, RECP_PERSISTENT, (int) net_splice_tunnels_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(net_splice_tunnels_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.net.splice.bytes",
+                     RECD_INT, RECP_PERSISTENT, (int) net_splice_bytes_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(net_splice_bytes_stat);
+
+  RecRegisterRawStat(net_rsb, RECT_PROCESS, "proxy.process.net.splice.cpu_saved",
+                     RECD_INT, RECP_PERSISTENT, (int) net_splice_cpu_saved_stat, RecRawStatSyncSum);
+  NET_CLEAR_DYN_STAT(net_splice_cpu_saved_stat);
 }
 
 void
@@ -0,0 +1,271 @@
+/** @file
+
+  Timer wheel for NetVConnection timeouts.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "P_Net.h"
+
+NetTimerWheel::NetTimerWheel(ink_hrtime tick)
+  : tick_size(tick), now_tick(0), count(0)
+{
+}
+
+void
+NetTimerWheel::init(ink_hrtime now)
+{
+  ink_assert(!count);
+  now_tick = now / tick_size;
+}
+
+void
+NetTimerWheel::insert(NetTimer *timer)
+{
+  uint64_t when = deadline_tick(timer->at);
+  int level = 0;
+
+  if (when <= now_tick)
+    when = now_tick + 1;
+  while (level < LEVELS - 1 && when - now_tick >= ((uint64_t) 1 << (LEVEL_BITS * (level + 1))))
+    ++level;
+  // Beyond the last level, park it as far out as possible. It's filed again from there.
+  if (when - now_tick >= ((uint64_t) 1 << (LEVEL_BITS * LEVELS)))
+    when = now_tick + ((uint64_t) 1 << (LEVEL_BITS * LEVELS)) - 1;
+
+  DLL<NetTimer> *slot = &slots[level][(when >> (LEVEL_BITS * level)) & SLOT_MASK];
+  timer->tick = when;
+  timer->list = slot;
+  slot->push(timer);
+  ++count;
+}
+
+void
+NetTimerWheel::schedule(NetTimer *timer)
+{
+  if (!timer->at) {
+    remove(timer);
+    return;
+  }
+  // A later deadline can wait in the current slot, it is filed again when the slot comes up.
+  if (timer->list && timer->list != &expired && deadline_tick(timer->at) >= timer->tick)
+    return;
+  remove(timer);
+  insert(timer);
+}
+
+// Move the timers of the slot of @a level that starts at the current tick
+// down to the lower levels, or to the expired list if they are due.
+void
+NetTimerWheel::cascade(int level)
+{
+  DLL<NetTimer> *slot = &slots[level][(now_tick >> (LEVEL_BITS * level)) & SLOT_MASK];
+  DLL<NetTimer> list = *slot;
+  NetTimer *timer;
+
+  slot->clear();
+  while ((timer = list.pop())) {
+    --count;
+    timer->list = NULL;
+    if (deadline_tick(timer->at) <= now_tick) {
+      timer->list = &expired;
+      expired.push(timer);
+    } else {
+      insert(timer);
+    }
+  }
+}
+
+int
+NetTimerWheel::advance(ink_hrtime now)
+{
+  uint64_t target = now / tick_size;
+  int fired = 0;
+
+  if (!count) {
+    if (target > now_tick)
+      now_tick = target;
+    return 0;
+  }
+
+  while (now_tick < target) {
+    ++now_tick;
+    for (int level = 1; level < LEVELS && !((now_tick >> (LEVEL_BITS * (level - 1))) & SLOT_MASK); ++level)
+      cascade(level);
+
+    DLL<NetTimer> *slot = &slots[0][now_tick & SLOT_MASK];
+    DLL<NetTimer> list = *slot;
+    NetTimer *timer;
+
+    slot->clear();
+    while ((timer = list.pop())) {
+      --count;
+      timer->list = NULL;
+      if (deadline_tick(timer->at) <= now_tick) {
+        timer->list = &expired;
+        expired.push(timer);
+        ++fired;
+      } else {
+        insert(timer);
+      }
+    }
+  }
+  return fired;
+}
+
+#if TS_HAS_TESTS
+
+#include "ts/TestBox.h"
+
+// Advance @a wheel one tick at a time from @a start until @a timer fires.
+// Returns the tick it fired on, or -1 if it did not within @a limit ticks.
+static int64_t
+timer_wheel_fire_tick(NetTimerWheel &wheel, NetTimer *timer, ink_hrtime start, int64_t limit)
+{
+  for (int64_t i = 1; i <= limit; ++i) {
+    wheel.advance(start + i * NET_TIMER_WHEEL_TICK);
+    while (NetTimer *t = wheel.pop_expired()) {
+      if (t == timer)
+        return i;
+    }
+  }
+  return -1;
+}
+
+REGRESSION_TEST(NetTimerWheel)(RegressionTest * t, int /* level ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+  ink_hrtime start = HRTIME_SECONDS(1000);
+  int64_t fired;
+
+  box = REGRESSION_TEST_PASSED;
+
+  {
+    NetTimerWheel wheel;
+    NetTimer timer;
+    wheel.init(start);
+    timer.at = start + 5 * NET_TIMER_WHEEL_TICK;
+    wheel.schedule(&timer);
+    fired = timer_wheel_fire_tick(wheel, &timer, start, 1000);
+    box.check(fired == 5, "short timer fired at tick %" PRId64 ", expected 5", fired);
+    box.check(wheel.size() == 0, "wheel not empty after the timer fired");
+  }
+
+  {
+    // Filed on the third level, cascaded down twice.
+    NetTimerWheel wheel;
+    NetTimer timer;
+    wheel.init(start);
+    timer.at = start + 100000 * NET_TIMER_WHEEL_TICK;
+    wheel.schedule(&timer);
+    fired = timer_wheel_fire_tick(wheel, &timer, start, 200000);
+    box.check(fired == 100000, "long timer fired at tick %" PRId64 ", expected 100000", fired);
+  }
+
+  {
+    // A later deadline set directly must be honored without re-filing.
+    NetTimerWheel wheel;
+    NetTimer timer;
+    wheel.init(start);
+    timer.at = start + 10 * NET_TIMER_WHEEL_TICK;
+    wheel.schedule(&timer);
+    timer.at = start + 700 * NET_TIMER_WHEEL_TICK;
+    fired = timer_wheel_fire_tick(wheel, &timer, start, 1000);
+    box.check(fired == 700, "postponed timer fired at tick %" PRId64 ", expected 700", fired);
+  }
+
+  {
+    // An earlier deadline goes through schedule().
+    NetTimerWheel wheel;
+    NetTimer timer;
+    wheel.init(start);
+    timer.at = start + 5000 * NET_TIMER_WHEEL_TICK;
+    wheel.schedule(&timer);
+    timer.at = start + 3 * NET_TIMER_WHEEL_TICK;
+    wheel.schedule(&timer);
+    fired = timer_wheel_fire_tick(wheel, &timer, start, 10000);
+    box.check(fired == 3, "advanced timer fired at tick %" PRId64 ", expected 3", fired);
+  }
+
+  {
+    NetTimerWheel wheel;
+    NetTimer timer;
+    wheel.init(start);
+    timer.at = start + 20 * NET_TIMER_WHEEL_TICK;
+    wheel.schedule(&timer);
+    wheel.cancel(&timer);
+    fired = timer_wheel_fire_tick(wheel, &timer, start, 1000);
+    box.check(fired == -1 && wheel.size() == 0, "cancelled timer fired at tick %" PRId64, fired);
+  }
+}
+
+// Cost of one tick with @a n idle connections whose timeouts are spread over
+// 30 to 90 seconds, against a scan of all of them like the old inactivity cop.
+REGRESSION_TEST(NetTimerWheel_benchmark)(RegressionTest * t, int level, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+  // Only run at the highest levels.
+  if (REGRESSION_TEST_EXTENDED > level)
+    return;
+
+  static const int sizes[] = { 10000, 100000, 1000000 };
+  const int ticks = 1000;
+
+  for (unsigned i = 0; i < countof(sizes); ++i) {
+    int n = sizes[i];
+    NetTimer *timers = new NetTimer[n];
+    NetTimerWheel wheel;
+    ink_hrtime start = HRTIME_SECONDS(1000);
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    int fired = 0;
+
+    wheel.init(start);
+    for (int k = 0; k < n; ++k) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      timers[k].at = start + HRTIME_SECONDS(30) + (ink_hrtime) ((seed >> 33) % HRTIME_SECONDS(60));
+      wheel.schedule(&timers[k]);
+    }
+
+    ink_hrtime begin = ink_get_hrtime_internal();
+    for (int k = 1; k <= ticks; ++k) {
+      fired += wheel.advance(start + k * NET_TIMER_WHEEL_TICK);
+      while (wheel.pop_expired())
+        ;
+    }
+    ink_hrtime wheel_cost = (ink_get_hrtime_internal() - begin) / ticks;
+
+    begin = ink_get_hrtime_internal();
+    for (int k = 1; k <= ticks / 100; ++k) {
+      ink_hrtime now = start + k * NET_TIMER_WHEEL_TICK;
+      for (int j = 0; j < n; ++j) {
+        if (timers[j].at && timers[j].at < now)
+          ++fired;
+      }
+    }
+    ink_hrtime scan_cost = (ink_get_hrtime_internal() - begin) / (ticks / 100);
+
+    rprintf(t, "%d idle connections: %" PRId64 " ns per wheel tick, %" PRId64 " ns per full scan\n", n, wheel_cost, scan_cost);
+    box.check(fired == 0, "%d timers fired early", fired);
+    delete[] timers;
+  }
+}
+
+#endif
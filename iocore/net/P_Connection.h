@@ -164,6 +164,10 @@ struct Server: public Connection
   /// If set, a kernel HTTP accept filter
   bool http_accept_filter;
 
+  /// If set, the listen socket is opened with SO_REUSEPORT so several
+  /// sockets can be bound to the same address.
+  bool f_reuseport;
+
   //
   // Use this call for the main proxy accept
   //
@@ -188,6 +192,7 @@ struct Server: public Connection
   Server()
     : Connection()
     , f_inbound_transparent(false)
+    , f_reuseport(false)
   {
     ink_zero(accept_addr);
   }
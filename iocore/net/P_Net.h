@@ -50,12 +50,16 @@ enum Net_Stats
   socks_connections_successful_stat,
   socks_connections_unsuccessful_stat,
   socks_connections_currently_open_stat,
-  inactivity_cop_lock_acquire_failure_stat,
+  net_splice_tunnels_stat,
+  net_splice_bytes_stat,
+  net_splice_cpu_saved_stat,
   Net_Stat_Count
 };
 
 struct RecRawStatBlock;
 extern RecRawStatBlock *net_rsb;
+// Accepted connections per ET_NET thread, indexed by the thread's position.
+extern RecRawStatBlock *net_accept_thread_rsb;
 #define SSL_HANDSHAKE_WANT_READ   6
 #define SSL_HANDSHAKE_WANT_WRITE  7
 #define SSL_HANDSHAKE_WANT_ACCEPT 8
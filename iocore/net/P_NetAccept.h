@@ -97,6 +97,7 @@ struct NetAccept:public Continuation
   uint32_t packet_mark;
   uint32_t packet_tos;
   EventType etype;
+  int thread_index;             // ET_NET thread for per-thread accepts, -1 otherwise
   UnixNetVConnection *epoll_vc; // only storage for epoll events
   EventIO ep;
 
@@ -109,6 +110,8 @@ struct NetAccept:public Continuation
   virtual NetAccept *clone() const;
   // 0 == success
   int do_listen(bool non_blocking, bool transparent = false);
+  void do_listen_reuseport();
+  void setup_listen_sockopts();
 
   int do_blocking_accept(EThread * t);
   virtual int acceptEvent(int event, void *e);
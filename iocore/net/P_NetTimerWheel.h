@@ -0,0 +1,132 @@
+/** @file
+
+  Timer wheel for NetVConnection timeouts.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#if !defined (_P_NetTimerWheel_h_)
+#define _P_NetTimerWheel_h_
+
+#include "List.h"
+#include "ink_hrtime.h"
+
+class UnixNetVConnection;
+
+#define NET_TIMER_WHEEL_TICK HRTIME_MSECONDS(10)
+
+/** A timeout of a connection, filed in a NetTimerWheel.
+
+    @a at is the deadline. Moving it later does not need the wheel, the
+    timer is filed again when its old slot comes up. Moving it earlier
+    or clearing it must go through NetTimerWheel::schedule().
+*/
+struct NetTimer
+{
+  ink_hrtime at;                ///< Deadline, 0 if not armed.
+  uint64_t tick;                ///< Tick of the slot the timer is filed in.
+  UnixNetVConnection *vc;       ///< Connection to signal.
+  LINK(NetTimer, link);
+  DList(NetTimer, link) *list;  ///< Slot or expired list holding the timer, NULL if none.
+
+  NetTimer() : at(0), tick(0), vc(NULL), list(NULL)
+  { }
+};
+
+/** Hierarchical timing wheel.
+
+    Four levels of 256 slots, the first covering 256 ticks and each
+    next one 256 times as much. Filing, re-filing and removing a timer
+    are O(1), and advancing looks only at the slots that come due, so
+    idle timers cost nothing until they are close to expiring.
+
+    Not thread safe, a wheel belongs to one NetHandler.
+*/
+class NetTimerWheel
+{
+public:
+  NetTimerWheel(ink_hrtime tick = NET_TIMER_WHEEL_TICK);
+
+  /// Start counting ticks from @a now. Only valid while the wheel is empty.
+  void init(ink_hrtime now);
+
+  /// File @a timer according to its deadline, or remove it if the deadline is 0.
+  void schedule(NetTimer *timer);
+
+  /// Clear the deadline of @a timer and remove it.
+  void cancel(NetTimer *timer)
+  {
+    timer->at = 0;
+    remove(timer);
+  }
+
+  /** Advance to @a now.
+
+      Timers whose deadline has passed are moved to the expired list.
+
+      @return The number of timers that expired.
+  */
+  int advance(ink_hrtime now);
+
+  /// Take the next timer from the expired list, @c NULL if it's empty.
+  NetTimer *pop_expired()
+  {
+    NetTimer *timer = expired.pop();
+    if (timer)
+      timer->list = NULL;
+    return timer;
+  }
+
+  /// Number of timers filed, not counting the expired ones.
+  int size() const { return count; }
+
+private:
+  enum
+  {
+    LEVEL_BITS = 8,
+    SLOTS = 1 << LEVEL_BITS,
+    SLOT_MASK = SLOTS - 1,
+    LEVELS = 4
+  };
+
+  void insert(NetTimer *timer);
+  void remove(NetTimer *timer)
+  {
+    if (timer->list) {
+      if (timer->list != &expired)
+        --count;
+      timer->list->remove(timer);
+      timer->list = NULL;
+    }
+  }
+  void cascade(int level);
+
+  uint64_t deadline_tick(ink_hrtime at) const
+  {
+    return (uint64_t) ((at + tick_size - 1) / tick_size);
+  }
+
+  ink_hrtime tick_size;
+  uint64_t now_tick;            ///< Last tick processed.
+  int count;
+  DLL<NetTimer> slots[LEVELS][SLOTS];
+  DLL<NetTimer> expired;
+};
+
+#endif
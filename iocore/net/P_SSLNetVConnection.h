@@ -65,6 +65,10 @@ class SSLNetVConnection:public UnixNetVConnection
 public:
   virtual int sslStartHandShake(int event, int &err);
   virtual void free(EThread * t);
+  virtual bool splice_to(NetVConnection * /* peer ATS_UNUSED */) { return false; }
+  // The SSL session state is tied to this object, so never move it.
+  virtual NetVConnection *migrate_to_thread(Continuation * /* cont ATS_UNUSED */, EThread * /* t ATS_UNUSED */) { return NULL; }
+  virtual bool can_migrate() const { return false; }
   virtual void enableRead()
   {
     read.enabled = 1;
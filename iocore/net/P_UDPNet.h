@@ -58,6 +58,12 @@ extern UDPNetProcessorInternal udpNetInternal;
 
 
 
+// Datagrams read by one recvmmsg(2) and sent by one sendmmsg(2) call.
+#define UDP_READ_BATCH 16
+#define UDP_SEND_BATCH 32
+// Largest datagram read by udp_read_from_net().
+#define UDP_MAX_DATAGRAM 65536
+
 // 20 ms slots; 2048 slots  => 40 sec. into the future
 #define SLOT_TIME_MSEC 20
 #define SLOT_TIME HRTIME_MSECONDS(SLOT_TIME_MSEC)
@@ -289,6 +295,7 @@ public:
 
   void SendPackets();
   void SendUDPPacket(UDPPacketInternal * p, int32_t pktLen);
+  void SendMultipleUDPPackets(UDPPacketInternal ** p, uint16_t n);
 
   // Interface exported to the outside world
   void send(UDPPacket * p);
@@ -318,6 +325,8 @@ public:
   Event *trigger_event;
   ink_hrtime nextCheck;
   ink_hrtime lastCheck;
+  // receive buffers for batched reads, allocated on first read
+  char *read_ring;
 
   int startNetEvent(int event, Event * data);
   int mainNetEvent(int event, Event * data);
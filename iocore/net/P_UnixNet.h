@@ -127,12 +127,16 @@ extern ink_hrtime last_shedding_warning;
 extern ink_hrtime emergency_throttle_time;
 extern int net_connections_throttle;
 extern int fds_throttle;
+extern int net_splice_enabled;
+extern ink_hrtime net_splice_copy_cost;
+extern int net_default_inactivity_timeout;
 extern int fds_limit;
 extern ink_hrtime last_transient_accept_error;
 extern int http_accept_port_number;
 
+void net_splice_calibrate();
+
 
-//#define INACTIVITY_TIMEOUT
 //
 // Configuration Parameter had to move here to share
 // between UnixNet and UnixUDPNet or SSLNet modules.
@@ -189,9 +193,11 @@ public:
   QueM(UnixNetVConnection, NetState, read, ready_link) read_ready_list;
   QueM(UnixNetVConnection, NetState, write, ready_link) write_ready_list;
   Que(UnixNetVConnection, link) open_list;
-  DList(UnixNetVConnection, cop_link) cop_list;
   ASLLM(UnixNetVConnection, NetState, read, enable_link) read_enable_list;
   ASLLM(UnixNetVConnection, NetState, write, enable_link) write_enable_list;
+  NetTimerWheel timer_wheel;
+  ASLL(UnixNetVConnection, timer_link) timer_rearm_list;
+  ASLL(UnixNetVConnection, close_link) close_list;
 
   time_t sec;
   int cycles;
@@ -200,6 +206,8 @@ public:
   int mainNetEvent(int event, Event * data);
   int mainNetEventExt(int event, Event * data);
   void process_enabled_list(NetHandler *);
+  void process_timers(Event *e);
+  void process_close_list();
 
   NetHandler();
 };
@@ -383,23 +391,22 @@ check_transient_accept_error(int res)
   }
 }
 
+// Inactivity deadline of a connection that has no timeout of its own, so
+// that it is not kept forever. 0 if there is no default timeout.
+static inline ink_hrtime
+net_default_inactivity_deadline()
+{
+  return net_default_inactivity_timeout > 0 ? ink_get_hrtime() + HRTIME_SECONDS(net_default_inactivity_timeout) : 0;
+}
+
 //
 // Disable a UnixNetVConnection
 //
 static inline void
 read_disable(NetHandler * nh, UnixNetVConnection * vc)
 {
-#ifdef INACTIVITY_TIMEOUT
-  if (vc->inactivity_timeout) {
-    if (!vc->write.enabled) {
-      vc->inactivity_timeout->cancel_action();
-      vc->inactivity_timeout = NULL;
-    }
-  }
-#else
   if (!vc->write.enabled)
-    vc->next_inactivity_timeout_at = 0;
-#endif
+    vc->arm_timer(&vc->inactivity_timer, net_default_inactivity_deadline());
   vc->read.enabled = 0;
   nh->read_ready_list.remove(vc);
   vc->ep.modify(-EVENTIO_READ);
@@ -408,17 +415,8 @@ read_disable(NetHandler * nh, UnixNetVConnection * vc)
 static inline void
 write_disable(NetHandler * nh, UnixNetVConnection * vc)
 {
-#ifdef INACTIVITY_TIMEOUT
-  if (vc->inactivity_timeout) {
-    if (!vc->read.enabled) {
-      vc->inactivity_timeout->cancel_action();
-      vc->inactivity_timeout = NULL;
-    }
-  }
-#else
   if (!vc->read.enabled)
-    vc->next_inactivity_timeout_at = 0;
-#endif
+    vc->arm_timer(&vc->inactivity_timer, net_default_inactivity_deadline());
   vc->write.enabled = 0;
   nh->write_ready_list.remove(vc);
   vc->ep.modify(-EVENTIO_WRITE);
@@ -36,11 +36,21 @@
 #include "I_NetVConnection.h"
 #include "P_UnixNetState.h"
 #include "P_Connection.h"
+#include "P_NetTimerWheel.h"
 
 class UnixNetVConnection;
 class NetHandler;
 struct PollDescriptor;
 
+// Data moving from the socket of one connection to another through a
+// pipe with splice(2).
+struct NetSplice
+{
+  int pipe_fd[2];
+  int64_t pending;              // bytes waiting in the pipe
+  UnixNetVConnection *to;
+};
+
 TS_INLINE void
 NetVCOptions::reset()
 {
@@ -142,6 +152,14 @@ public:
   virtual void reenable_re(VIO *vio);
 
   virtual SOCKET get_socket();
+  virtual bool splice_to(NetVConnection *peer);
+  virtual NetVConnection *migrate_to_thread(Continuation *cont, EThread *t);
+  virtual bool can_migrate() const;
+
+  /// Set the deadline of @a timer, 0 to disarm it, and file it in the timer wheel of the owning thread.
+  void arm_timer(NetTimer *timer, ink_hrtime at);
+  /// Restart the inactivity timeout, or the default one if there is none.
+  void reset_inactivity_timer();
 
   virtual ~ UnixNetVConnection();
 
@@ -199,7 +217,6 @@ public:
   NetState read;
   NetState write;
 
-  LINK(UnixNetVConnection, cop_link);
   LINKM(UnixNetVConnection, read, ready_link)
   SLINKM(UnixNetVConnection, read, enable_link)
   LINKM(UnixNetVConnection, write, ready_link)
@@ -207,12 +224,12 @@ public:
 
   ink_hrtime inactivity_timeout_in;
   ink_hrtime active_timeout_in;
-#ifdef INACTIVITY_TIMEOUT
-  Event *inactivity_timeout;
-#else
-  ink_hrtime next_inactivity_timeout_at;
-#endif
-  Event *active_timeout;
+  NetTimer inactivity_timer;
+  NetTimer active_timer;
+  SLINK(UnixNetVConnection, timer_link);
+  volatile int in_timer_rearm_list;
+  SLINK(UnixNetVConnection, close_link);
+  volatile int in_close_list;
   EventIO ep;
   NetHandler *nh;
   unsigned int id;
@@ -236,6 +253,8 @@ public:
   ink_hrtime submit_time;
   OOB_callback *oob_ptr;
   bool from_accept_thread;
+  NetSplice *splice;                   // set while reads are spliced to another connection
+  UnixNetVConnection *splice_source;   // set while writes come from a splice
 
   int startEvent(int event, Event *e);
   int acceptEvent(int event, Event *e);
@@ -287,29 +306,7 @@ UnixNetVConnection::set_inactivity_timeout(ink_hrtime timeout)
 {
   Debug("socket", "Set inactive timeout=%" PRId64 ", for NetVC=%p", timeout, this);
   inactivity_timeout_in = timeout;
-#ifndef INACTIVITY_TIMEOUT
-  next_inactivity_timeout_at = ink_get_hrtime() + timeout;
-#else
-  if (inactivity_timeout)
-    inactivity_timeout->cancel_action(this);
-  if (inactivity_timeout_in) {
-    if (read.enabled) {
-      ink_assert(read.vio.mutex->thread_holding == this_ethread() && thread);
-      if (read.vio.mutex->thread_holding == thread)
-        inactivity_timeout = thread->schedule_in_local(this, inactivity_timeout_in);
-      else
-        inactivity_timeout = thread->schedule_in(this, inactivity_timeout_in);
-    } else if (write.enabled) {
-      ink_assert(write.vio.mutex->thread_holding == this_ethread() && thread);
-      if (write.vio.mutex->thread_holding == thread)
-        inactivity_timeout = thread->schedule_in_local(this, inactivity_timeout_in);
-      else
-        inactivity_timeout = thread->schedule_in(this, inactivity_timeout_in);
-    } else
-      inactivity_timeout = 0;
-  } else
-    inactivity_timeout = 0;
-#endif
+  arm_timer(&inactivity_timer, timeout ? ink_get_hrtime() + timeout : 0);
 }
 
 TS_INLINE void
@@ -317,52 +314,23 @@ UnixNetVConnection::set_active_timeout(ink_hrtime timeout)
 {
   Debug("socket", "Set active timeout=%" PRId64 ", NetVC=%p", timeout, this);
   active_timeout_in = timeout;
-  if (active_timeout)
-    active_timeout->cancel_action(this);
-  if (active_timeout_in) {
-    if (read.enabled) {
-      ink_assert(read.vio.mutex->thread_holding == this_ethread() && thread);
-      if (read.vio.mutex->thread_holding == thread)
-        active_timeout = thread->schedule_in_local(this, active_timeout_in);
-      else
-        active_timeout = thread->schedule_in(this, active_timeout_in);
-    } else if (write.enabled) {
-      ink_assert(write.vio.mutex->thread_holding == this_ethread() && thread);
-      if (write.vio.mutex->thread_holding == thread)
-        active_timeout = thread->schedule_in_local(this, active_timeout_in);
-      else
-        active_timeout = thread->schedule_in(this, active_timeout_in);
-    } else
-      active_timeout = 0;
-  } else
-    active_timeout = 0;
+  arm_timer(&active_timer, timeout ? ink_get_hrtime() + timeout : 0);
 }
 
 TS_INLINE void
 UnixNetVConnection::cancel_inactivity_timeout()
 {
-  inactivity_timeout_in = 0;
-#ifdef INACTIVITY_TIMEOUT
-  if (inactivity_timeout) {
-    Debug("socket", "Cancel inactive timeout for NetVC=%p", this);
-    inactivity_timeout->cancel_action(this);
-    inactivity_timeout = NULL;
-  }
-#else
   Debug("socket", "Cancel inactive timeout for NetVC=%p", this);
-  next_inactivity_timeout_at = 0;
-#endif
+  inactivity_timeout_in = 0;
+  reset_inactivity_timer();
 }
 
 TS_INLINE void
 UnixNetVConnection::cancel_active_timeout()
 {
-  if (active_timeout) {
-    Debug("socket", "Cancel active timeout for NetVC=%p", this);
-    active_timeout->cancel_action(this);
-    active_timeout = NULL;
-    active_timeout_in = 0;
-  }
+  Debug("socket", "Cancel active timeout for NetVC=%p", this);
+  active_timeout_in = 0;
+  arm_timer(&active_timer, 0);
 }
 
 TS_INLINE int
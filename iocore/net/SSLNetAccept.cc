@@ -54,14 +54,17 @@ SSLNetAccept::init_accept_per_thread()
   period = ACCEPT_PERIOD;
   n = eventProcessor.n_threads_for_type[SSLNetProcessor::ET_SSL];
   for (i = 0; i < n; i++) {
-    if (i < n - 1)
+    if (i < n - 1) {
       a = clone();
-    else
+      a->do_listen_reuseport();
+    } else
       a = this;
+    if (SSLNetProcessor::ET_SSL == ET_NET)
+      a->thread_index = i;
     EThread *t = eventProcessor.eventthread[SSLNetProcessor::ET_SSL][i];
 
     PollDescriptor *pd = get_PollDescriptor(t);
-    if (ep.start(pd, this, EVENTIO_READ) < 0)
+    if (a->ep.start(pd, a, EVENTIO_READ) < 0)
       Debug("iocore_net", "error starting EventIO");
     a->mutex = get_NetHandler(t)->mutex;
     t->schedule_every(a, period, etype);
@@ -28,63 +28,40 @@ ink_hrtime last_shedding_warning;
 ink_hrtime emergency_throttle_time;
 int net_connections_throttle;
 int fds_throttle;
+int net_splice_enabled = 0;
+ink_hrtime net_splice_copy_cost = 0; // to copy 1MB through user space, once
+int net_default_inactivity_timeout = 0;
 int fds_limit = 8000;
 ink_hrtime last_transient_accept_error;
 
 extern "C" void fd_reify(struct ev_loop *);
 
-
-#ifndef INACTIVITY_TIMEOUT
-// INKqa10496
-// One Inactivity cop runs on each thread once every second and
-// loops through the list of NetVCs and calls the timeouts
-class InactivityCop : public Continuation {
-public:
-  InactivityCop(ProxyMutex *m):Continuation(m), default_inactivity_timeout(0) {
-    SET_HANDLER(&InactivityCop::check_inactivity);
-    REC_ReadConfigInteger(default_inactivity_timeout, "proxy.config.net.default_inactivity_timeout");
-    Debug("inactivity_cop", "default inactivity timeout is set to: %d", default_inactivity_timeout);
+// Time a copy of 1MB, which is what a spliced byte saves twice over: once
+// out of the kernel on the read and once back in on the write.
+void
+net_splice_calibrate()
+{
+  const size_t size = 1024 * 1024;
+  char *from = (char *) ats_malloc(size);
+  char *to = (char *) ats_malloc(size);
+  ink_hrtime best = 0;
+
+  memset(from, 0x5a, size);
+  memset(to, 0, size);
+  for (int i = 0; i < 4; i++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+    memcpy(to, from, size);
+    ink_hrtime t = ink_get_hrtime_internal() - start;
+    if (!best || t < best)
+      best = t;
+    from[i] = to[size - 1 - i];  // keep the copies from being folded away
   }
-  int check_inactivity(int event, Event *e) {
-    (void) event;
-    ink_hrtime now = ink_get_hrtime();
-    NetHandler *nh = get_NetHandler(this_ethread());
-    // Copy the list and use pop() to catch any closes caused by callbacks.
-    forl_LL(UnixNetVConnection, vc, nh->open_list) {
-      if (vc->thread == this_ethread())
-        nh->cop_list.push(vc);
-    }
-    while (UnixNetVConnection *vc = nh->cop_list.pop()) {
-      // If we cannot get the lock don't stop just keep cleaning
-      MUTEX_TRY_LOCK(lock, vc->mutex, this_ethread());
-      if (!lock.lock_acquired) {
-       NET_INCREMENT_DYN_STAT(inactivity_cop_lock_acquire_failure_stat);
-       continue;
-      }
-
-      if (vc->closed) {
-        close_UnixNetVConnection(vc, e->ethread);
-        continue;
-      }
-
-      // set a default inactivity timeout if one is not set
-      if (vc->next_inactivity_timeout_at == 0 && default_inactivity_timeout > 0) {
-        Debug("inactivity_cop", "vc: %p inactivity timeout not set, setting a default of %d", vc, default_inactivity_timeout);
-        vc->set_inactivity_timeout(HRTIME_SECONDS(default_inactivity_timeout));
-      } else {
-        Debug("inactivity_cop_verbose", "vc: %p timeout at: %" PRId64 " timeout in: %" PRId64, vc, ink_hrtime_to_sec(vc->next_inactivity_timeout_at),
-            ink_hrtime_to_sec(vc->inactivity_timeout_in));
-      }
+  net_splice_copy_cost = best;
+  Debug("iocore_net", "copying 1MB takes %" PRId64 " ns", (int64_t) best);
+  ats_free(from);
+  ats_free(to);
+}
 
-      if (vc->next_inactivity_timeout_at && vc->next_inactivity_timeout_at < now)
-        vc->handleEvent(EVENT_IMMEDIATE, e);
-    }
-    return 0;
-  }
-private:
-  int default_inactivity_timeout;  // only used when one is not set for some bad reason
-};
-#endif
 
 PollCont::PollCont(ProxyMutex *m, int pt):Continuation(m), net_handler(NULL), nextPollDescriptor(NULL), poll_timeout(pt) {
   pollDescriptor = new PollDescriptor;
@@ -218,11 +195,6 @@ initialize_thread_for_net(EThread *thread)
 
   thread->schedule_imm(get_NetHandler(thread));
 
-#ifndef INACTIVITY_TIMEOUT
-  InactivityCop *inactivityCop = new InactivityCop(get_NetHandler(thread)->mutex);
-  thread->schedule_every(inactivityCop, HRTIME_SECONDS(1));
-#endif
-
   thread->signal_hook = net_signal_hook_function;
   thread->ep = (EventIO*)ats_malloc(sizeof(EventIO));
   thread->ep->type = EVENTIO_ASYNC_SIGNAL;
@@ -251,6 +223,7 @@ NetHandler::startNetEvent(int event, Event *e)
   SET_HANDLER((NetContHandler) & NetHandler::mainNetEvent);
   e->schedule_every(NET_PERIOD);
   trigger_event = e;
+  timer_wheel.init(ink_get_hrtime());
   return EVENT_CONT;
 }
 
@@ -299,7 +272,8 @@ NetHandler::mainNetEvent(int event, Event *e)
   NET_INCREMENT_DYN_STAT(net_handler_run_stat);
 
   process_enabled_list(this);
-  if (likely(!read_ready_list.empty() || !write_ready_list.empty() || !read_enable_list.empty() || !write_enable_list.empty()))
+  if (likely(!read_ready_list.empty() || !write_ready_list.empty() || !read_enable_list.empty() || !write_enable_list.empty() ||
+             !close_list.empty()))
     poll_timeout = 0; // poll immediately returns -- we have triggered stuff to process right now
   else
     poll_timeout = net_config_poll_timeout;
@@ -443,6 +417,53 @@ NetHandler::mainNetEvent(int event, Event *e)
   }
 #endif /* !USE_EDGE_TRIGGER */
 
+  process_close_list();
+  process_timers(e);
   return EVENT_CONT;
 }
 
+//
+// Close the connections that were closed from other threads.
+//
+void
+NetHandler::process_close_list()
+{
+  UnixNetVConnection *vc = NULL;
+
+  SList(UnixNetVConnection, close_link) cq(close_list.popall());
+  while ((vc = cq.pop())) {
+    if (!vc->closed) {
+      // do_io_close() has queued it but not marked it yet
+      close_list.push(vc);
+      continue;
+    }
+    vc->in_close_list = 0;
+    close_UnixNetVConnection(vc, trigger_event->ethread);
+  }
+}
+
+//
+// Signal the connections whose inactivity or active timeout has passed.
+// The timer wheel only looks at the slots that are due, so this costs
+// nothing for connections that are idle but not expiring.
+//
+void
+NetHandler::process_timers(Event *e)
+{
+  UnixNetVConnection *vc = NULL;
+
+  // Pick up timeouts that were changed from other threads.
+  SList(UnixNetVConnection, timer_link) tq(timer_rearm_list.popall());
+  while ((vc = tq.pop())) {
+    vc->in_timer_rearm_list = 0;
+    timer_wheel.schedule(&vc->inactivity_timer);
+    timer_wheel.schedule(&vc->active_timer);
+  }
+
+  timer_wheel.advance(ink_get_hrtime());
+  while (NetTimer *timer = timer_wheel.pop_expired()) {
+    vc = timer->vc;
+    vc->handleEvent(timer == &vc->active_timer ? EVENT_INTERVAL : EVENT_IMMEDIATE, e);
+  }
+}
+
@@ -22,6 +22,7 @@
  */
 
 #include "P_Net.h"
+#include "ink_cap.h"
 
 #ifdef ROUNDUP
 #undef ROUNDUP
@@ -193,10 +194,12 @@ NetAccept::init_accept_per_thread()
   NetAccept *a;
   n = eventProcessor.n_threads_for_type[ET_NET];
   for (i = 0; i < n; i++) {
-    if (i < n - 1)
+    if (i < n - 1) {
       a = clone();
-    else
+      a->do_listen_reuseport();
+    } else
       a = this;
+    a->thread_index = i;
     EThread *t = eventProcessor.eventthread[ET_NET][i];
     PollDescriptor *pd = get_PollDescriptor(t);
     if (a->ep.start(pd, a, EVENTIO_READ) < 0)
@@ -232,6 +235,70 @@ NetAccept::do_listen(bool non_blocking, bool transparent)
   return res;
 }
 
+//
+// Replace the listen socket of a per-thread clone with one of its own
+// when SO_REUSEPORT is enabled, so the kernel spreads incoming connections
+// across the threads. On failure the clone keeps sharing the socket of the
+// template NetAccept.
+//
+// The kernel only lets sockets owned by the same user join a SO_REUSEPORT
+// group. Without POSIX capabilities traffic_manager binds privileged ports
+// as root, so the clones of those are opened as root too. This works while
+// the ports are started before change_uid_gid() gives up root for good.
+//
+void
+NetAccept::do_listen_reuseport()
+{
+  if (!server.f_reuseport)
+    return;
+
+  int shared_fd = server.fd;
+  server.fd = NO_FD;
+  int res;
+  {
+#if !TS_USE_POSIX_CAP
+    ElevateAccess access(ntohs(server.accept_addr.port()) < 1024);
+#endif
+    res = server.listen(NON_BLOCKING, recv_bufsize, send_bufsize, server.f_inbound_transparent);
+  }
+  if (res) {
+    Warning("unable to open a SO_REUSEPORT socket for port %d, sharing the listen socket: %d, %s",
+            ntohs(server.accept_addr.port()), errno, strerror(errno));
+    server.fd = shared_fd;
+    server.f_reuseport = false;
+    return;
+  }
+  setup_listen_sockopts();
+  Debug("iocore_net_accept", "opened SO_REUSEPORT socket %d for port %d", server.fd, ntohs(server.accept_addr.port()));
+}
+
+//
+// Socket options which are applied to the listen socket after it is open.
+//
+void
+NetAccept::setup_listen_sockopts()
+{
+#ifdef TCP_DEFER_ACCEPT
+  // set tcp defer accept timeout if it is configured, this will not trigger an accept until there is
+  // data on the socket ready to be read
+  int should_filter_int = 0;
+  REC_ReadConfigInteger(should_filter_int, "proxy.config.net.defer_accept");
+  if (should_filter_int > 0) {
+    setsockopt(server.fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &should_filter_int, sizeof(int));
+  }
+#endif
+#ifdef TCP_INIT_CWND
+  int tcp_init_cwnd = 0;
+  REC_ReadConfigInteger(tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
+  if (tcp_init_cwnd > 0) {
+    Debug("net", "Setting initial congestion window to %d", tcp_init_cwnd);
+    if (setsockopt(server.fd, IPPROTO_TCP, TCP_INIT_CWND, &tcp_init_cwnd, sizeof(int)) != 0) {
+      Error("Cannot set initial congestion window to %d", tcp_init_cwnd);
+    }
+  }
+#endif
+}
+
 int
 NetAccept::do_blocking_accept(EThread * t)
 {
@@ -372,6 +439,10 @@ NetAccept::acceptFastEvent(int event, void *ep)
   UnixNetVConnection *vc = NULL;
   int loop = accept_till_done;
 
+  // A per-thread SO_REUSEPORT socket is not closed by NetAccept::cancel().
+  if (server.f_reuseport && action_->cancelled)
+    goto Lerror;
+
   do {
     if (!backdoor && check_net_throttle(ACCEPT, ink_get_hrtime())) {
       ifd = -1;
@@ -457,6 +528,8 @@ NetAccept::acceptFastEvent(int event, void *ep)
 
     NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
     vc->id = net_next_connection_number();
+    if (thread_index >= 0 && net_accept_thread_rsb)
+      RecIncrRawStatSum(net_accept_thread_rsb, e->ethread, thread_index, 1);
 
     vc->submit_time = ink_get_hrtime();
     ats_ip_copy(&vc->server_addr, &vc->con.addr);
@@ -475,6 +548,7 @@ NetAccept::acceptFastEvent(int event, void *ep)
     }
 
     vc->nh->open_list.enqueue(vc);
+    vc->reset_inactivity_timer();
 
 #ifdef USE_EDGE_TRIGGER
     // Set the vc as triggered and place it in the read ready queue in case there is already data on the socket.
@@ -537,7 +611,8 @@ NetAccept::NetAccept()
     sockopt_flags(0),
     packet_mark(0),
     packet_tos(0),
-    etype(0)
+    etype(0),
+    thread_index(-1)
 { }
 
 
@@ -129,6 +129,17 @@ UnixNetProcessor::accept_internal(Continuation *cont, int fd, AcceptOptions cons
   if (should_filter_int > 0 && opt.etype == ET_NET)
     na->server.http_accept_filter = true;
 
+  // One SO_REUSEPORT socket per thread only makes sense for per-thread accepts.
+  int reuseport = 0;
+  REC_ReadConfigInteger(reuseport, "proxy.config.net.accept_reuseport");
+  if (reuseport > 0 && opt.frequent_accept && accept_threads <= 0) {
+#ifdef SO_REUSEPORT
+    na->server.f_reuseport = true;
+#else
+    Warning("proxy.config.net.accept_reuseport is set but SO_REUSEPORT is not supported");
+#endif
+  }
+
   na->action_ = new NetAcceptAction();
   *na->action_ = cont;
   na->action_->server = &na->server;
@@ -166,23 +177,7 @@ UnixNetProcessor::accept_internal(Continuation *cont, int fd, AcceptOptions cons
     na->init_accept();
   }
 
-#ifdef TCP_DEFER_ACCEPT
-  // set tcp defer accept timeout if it is configured, this will not trigger an accept until there is
-  // data on the socket ready to be read
-  if (should_filter_int > 0) {
-    setsockopt(na->server.fd, IPPROTO_TCP, TCP_DEFER_ACCEPT, &should_filter_int, sizeof(int));
-  }
-#endif
-#ifdef TCP_INIT_CWND
- int tcp_init_cwnd = 0;
- REC_ReadConfigInteger(tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
- if(tcp_init_cwnd > 0) {
-    Debug("net", "Setting initial congestion window to %d", tcp_init_cwnd);
-    if(setsockopt(na->server.fd, IPPROTO_TCP, TCP_INIT_CWND, &tcp_init_cwnd, sizeof(int)) != 0) {
-      Error("Cannot set initial congestion window to %d", tcp_init_cwnd);
-    }
- }
-#endif
+  na->setup_listen_sockopts();
   return na->action_;
 }
 
@@ -410,6 +405,18 @@ UnixNetProcessor::start(int, size_t)
     initialize_thread_for_http_sessions(netthreads[i], i);
   }
 
+  // Per-thread accept counts, to check how connections are spread over the threads.
+  if (etype == ET_NET && !net_accept_thread_rsb) {
+    char stat_name[64];
+    net_accept_thread_rsb = RecAllocateRawStatBlock(n_netthreads);
+    for (int i = 0; net_accept_thread_rsb && i < n_netthreads; ++i) {
+      snprintf(stat_name, sizeof(stat_name), "proxy.process.net.accepts.thread_%d", i);
+      RecRegisterRawStat(net_accept_thread_rsb, RECT_PROCESS, stat_name, RECD_INT, RECP_NON_PERSISTENT, i, RecRawStatSyncSum);
+      RecSetRawStatSum(net_accept_thread_rsb, i, 0);
+      RecSetRawStatCount(net_accept_thread_rsb, i, 0);
+    }
+  }
+
   RecData d;
   d.rec_int = 0;
   change_net_connections_throttle(NULL, RECD_INT, d, NULL);
@@ -68,24 +68,25 @@ void
 net_activity(UnixNetVConnection *vc, EThread *thread)
 {
   (void) thread;
-#ifdef INACTIVITY_TIMEOUT
-  if (vc->inactivity_timeout && vc->inactivity_timeout_in && vc->inactivity_timeout->ethread == thread)
-    vc->inactivity_timeout->schedule_in(vc->inactivity_timeout_in);
-  else {
-    if (vc->inactivity_timeout)
-      vc->inactivity_timeout->cancel_action();
-    if (vc->inactivity_timeout_in) {
-      vc->inactivity_timeout = vc->thread->schedule_in_local(vc, vc->inactivity_timeout_in);
-    } else
-      vc->inactivity_timeout = 0;
-  }
-#else
-  if (vc->inactivity_timeout_in)
-    vc->next_inactivity_timeout_at = ink_get_hrtime() + vc->inactivity_timeout_in;
-  else
-    vc->next_inactivity_timeout_at = 0;
-#endif
+  // Usually a later deadline, which leaves the timer where it is in the wheel.
+  vc->reset_inactivity_timer();
+}
 
+// Stop splicing the reads of @a vc to another connection.
+static void
+splice_stop(UnixNetVConnection *vc)
+{
+  NetSplice *sp = vc->splice;
+
+  if (!sp)
+    return;
+  Debug("iocore_net", "stop splicing %d, %" PRId64 " bytes left in pipe", vc->con.fd, sp->pending);
+  if (sp->to)
+    sp->to->splice_source = NULL;
+  socketManager.close(sp->pipe_fd[0]);
+  socketManager.close(sp->pipe_fd[1]);
+  delete sp;
+  vc->splice = NULL;
 }
 
 //
@@ -96,24 +97,24 @@ close_UnixNetVConnection(UnixNetVConnection *vc, EThread *t)
 {
   NetHandler *nh = vc->nh;
   vc->cancel_OOB();
+  splice_stop(vc);
+  if (vc->splice_source)
+    splice_stop(vc->splice_source);
   vc->ep.stop();
   vc->con.close();
-#ifdef INACTIVITY_TIMEOUT
-  if (vc->inactivity_timeout) {
-    vc->inactivity_timeout->cancel_action(vc);
-    vc->inactivity_timeout = NULL;
+  nh->timer_wheel.cancel(&vc->inactivity_timer);
+  nh->timer_wheel.cancel(&vc->active_timer);
+  if (vc->in_timer_rearm_list) {
+    nh->timer_rearm_list.remove(vc);
+    vc->in_timer_rearm_list = 0;
   }
-#else
-  vc->next_inactivity_timeout_at = 0;
-#endif
-  vc->inactivity_timeout_in = 0;
-  if (vc->active_timeout) {
-    vc->active_timeout->cancel_action(vc);
-    vc->active_timeout = NULL;
+  if (vc->in_close_list) {
+    nh->close_list.remove(vc);
+    vc->in_close_list = 0;
   }
+  vc->inactivity_timeout_in = 0;
   vc->active_timeout_in = 0;
   nh->open_list.remove(vc);
-  nh->cop_list.remove(vc);
   nh->read_ready_list.remove(vc);
   nh->write_ready_list.remove(vc);
   if (vc->read.in_enabled_list) {
@@ -198,6 +199,186 @@ write_signal_error(NetHandler *nh, UnixNetVConnection *vc, int lerrno)
   return write_signal_done(VC_EVENT_ERROR, nh, vc);
 }
 
+//
+// Splicing: data read from one connection is moved through a pipe to the
+// socket of another connection, without passing through an MIOBuffer.
+//
+#define NET_SPLICE_CHUNK   (64 * 1024)
+#define NET_SPLICE_MAX     (1024 * 1024)  // per call, to be fair to other connections
+
+#if HAVE_SPLICE
+static inline int64_t
+net_splice(int fd_in, int fd_out, int64_t len)
+{
+  int64_t r;
+  do {
+    if (unlikely((r = ::splice(fd_in, NULL, fd_out, NULL, len, SPLICE_F_MOVE | SPLICE_F_NONBLOCK)) < 0))
+      r = -errno;
+  } while (r == -EINTR);
+  return r;
+}
+
+// Write the bytes waiting in the pipe of @a vc to the connection it is
+// spliced to. Returns 0 once the pipe is empty, 1 if the other side can't
+// take more yet, -1 if the other side failed and the splice is gone.
+static int
+splice_drain(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
+{
+  NetSplice *sp = vc->splice;
+  UnixNetVConnection *to = sp->to;
+  ProxyMutex *mutex = thread->mutex;
+
+  while (sp->pending > 0) {
+    int64_t r = net_splice(sp->pipe_fd[0], to->con.fd, sp->pending);
+    if (r == -EAGAIN) {
+      NET_DEBUG_COUNT_DYN_STAT(net_calls_to_write_nodata_stat, 1);
+      to->write.triggered = 0;
+      to->write.enabled = 1;
+      write_reschedule(nh, to);
+      return 1;
+    }
+    if (r <= 0) {
+      splice_stop(vc);
+      to->write.triggered = 0;
+      write_signal_error(nh, to, r ? (int) -r : EPIPE);
+      return -1;
+    }
+    sp->pending -= r;
+    to->write.vio.ndone += r;
+    NET_SUM_DYN_STAT(net_write_bytes_stat, r);
+    NET_SUM_DYN_STAT(net_splice_bytes_stat, r);
+    net_activity(to, thread);
+  }
+  return 0;
+}
+
+// Credit the copies through user space a splice of @a bytes saved, less
+// the time the splice calls since @a start took.
+static void
+splice_account(EThread *thread, int64_t bytes, ink_hrtime start)
+{
+  ProxyMutex *mutex = thread->mutex;
+  int64_t saved = bytes * 2 * net_splice_copy_cost / (1024 * 1024) - (ink_get_hrtime_internal() - start);
+
+  if (saved > 0)
+    NET_SUM_DYN_STAT(net_splice_cpu_saved_stat, saved / HRTIME_USECOND);
+}
+
+// Read from the socket of @a vc into its splice pipe and on to the other
+// connection. Returns false if the data has to go through the read buffer.
+static bool
+read_splice(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
+{
+  NetState *s = &vc->read;
+  NetSplice *sp = vc->splice;
+  UnixNetVConnection *to = sp->to;
+  ProxyMutex *mutex = thread->mutex;
+  ProxyMutex *vio_mutex = s->vio.mutex.m_ptr;
+
+  // Data already in the buffers has to go out first, and the other side is
+  // only written while its VIO is alive and under the lock we hold.
+  if (to->closed || (to->f.shutdown & NET_VC_SHUTDOWN_WRITE) || to->write.vio.op != VIO::WRITE ||
+      to->write.vio.mutex.m_ptr != vio_mutex || s->vio.buffer.writer()->max_read_avail() > 0 ||
+      (to->write.vio.buffer.reader() && to->write.vio.buffer.reader()->read_avail() > 0))
+    return false;
+
+  // Wait until the other side has drained the pipe.
+  if (sp->pending) {
+    nh->read_ready_list.remove(vc);
+    return true;
+  }
+
+  ink_hrtime start = ink_get_hrtime_internal();
+  int64_t written = to->write.vio.ndone;
+  int64_t moved = 0;
+  int64_t r = 1;
+  while (moved < NET_SPLICE_MAX) {
+    int64_t len = MIN(s->vio.ntodo(), to->write.vio.ntodo());
+    if (len > NET_SPLICE_CHUNK)
+      len = NET_SPLICE_CHUNK;
+    if (len <= 0)
+      break;
+
+    r = net_splice(vc->con.fd, sp->pipe_fd[1], len);
+    NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_stat, 1);
+    if (r <= 0)
+      break;
+    NET_SUM_DYN_STAT(net_read_bytes_stat, r);
+    s->vio.ndone += r;
+    sp->pending = r;
+    moved += r;
+    net_activity(vc, thread);
+
+    if (splice_drain(nh, vc, thread) < 0) {
+      splice_account(thread, moved, start);
+      return true;
+    }
+    // the other side is full, wait for it to be writable
+    if (sp->pending)
+      break;
+  }
+  splice_account(thread, moved, start);
+  written = to->write.vio.ndone - written;
+
+  if (r <= 0) {
+    vc->read.triggered = 0;
+    nh->read_ready_list.remove(vc);
+    if (r == -EAGAIN || r == -ENOTCONN) {
+      NET_DEBUG_COUNT_DYN_STAT(net_calls_to_read_nodata_stat, 1);
+    } else {
+      splice_stop(vc);
+      if (!r || r == -ECONNRESET)
+        read_signal_done(VC_EVENT_EOS, nh, vc);
+      else
+        read_signal_error(nh, vc, (int) -r);
+      return true;
+    }
+  }
+
+  if (sp->pending) {
+    nh->read_ready_list.remove(vc);
+  } else if (s->vio.ntodo() <= 0) {
+    splice_stop(vc);
+    read_signal_done(VC_EVENT_READ_COMPLETE, nh, vc);
+    return true;
+  } else if (to->write.vio.ntodo() <= 0) {
+    splice_stop(vc);
+    write_signal_done(VC_EVENT_WRITE_COMPLETE, nh, to);
+    return true;
+  }
+
+  // Tell both sides about the bytes that moved, as a copy through the
+  // buffers would. The writer is signalled with the reader held open, since
+  // its handler is free to close either connection.
+  if (written > 0) {
+    vc->recursion++;
+    int ret = write_signal_and_update(VC_EVENT_WRITE_READY, to);
+    if (!--vc->recursion && vc->closed) {
+      close_UnixNetVConnection(vc, thread);
+      return true;
+    }
+    if (ret != EVENT_CONT)
+      return true;
+    if (s->vio.mutex.m_ptr != vio_mutex) {
+      read_reschedule(nh, vc);
+      return true;
+    }
+  }
+  if (moved > 0) {
+    if (read_signal_and_update(VC_EVENT_READ_READY, vc) != EVENT_CONT)
+      return true;
+    // change of lock... don't look at shared variables!
+    if (s->vio.mutex.m_ptr != vio_mutex) {
+      read_reschedule(nh, vc);
+      return true;
+    }
+  }
+  if (!vc->splice || !vc->splice->pending)
+    read_reschedule(nh, vc);
+  return true;
+}
+#endif
+
 // Read the data for a UnixNetVConnection.
 // Rescheduling the UnixNetVConnection by moving the VC
 // onto or off of the ready_list.
@@ -230,6 +411,10 @@ read_from_net(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
     read_disable(nh, vc);
     return;
   }
+#if HAVE_SPLICE
+  if (vc->splice && read_splice(nh, vc, thread))
+    return;
+#endif
   int64_t toread = buf.writer()->write_avail();
   if (toread > ntodo)
     toread = ntodo;
@@ -394,6 +579,24 @@ write_to_net_io(NetHandler *nh, UnixNetVConnection *vc, EThread *thread)
       write_reschedule(nh, vc);
     return;
   }
+#if HAVE_SPLICE
+  // Finish moving the data a spliced connection left in its pipe.
+  if (vc->splice_source && vc->splice_source->splice->pending) {
+    UnixNetVConnection *from = vc->splice_source;
+    if (from->read.vio.mutex.m_ptr != s->vio.mutex.m_ptr) {
+      write_reschedule(nh, vc);
+      return;
+    }
+    if (splice_drain(nh, from, thread))
+      return;
+    if (from->read.vio.ntodo() <= 0) {
+      splice_stop(from);
+      read_signal_done(VC_EVENT_READ_COMPLETE, nh, from);
+      return;
+    }
+    read_reschedule(nh, from);
+  }
+#endif
   // If it is not enabled,add to WaitList.
   if (!s->enabled || s->vio.op != VIO::WRITE) {
     write_disable(nh, vc);
@@ -539,6 +742,7 @@ VIO *
 UnixNetVConnection::do_io_read(Continuation *c, int64_t nbytes, MIOBuffer *buf)
 {
   ink_assert(!closed);
+  splice_stop(this);
   read.vio.op = VIO::READ;
   read.vio.mutex = c->mutex;
   read.vio._cont = c;
@@ -560,6 +764,8 @@ VIO *
 UnixNetVConnection::do_io_write(Continuation *c, int64_t nbytes, IOBufferReader *reader, bool owner)
 {
   ink_assert(!closed);
+  if (splice_source)
+    splice_stop(splice_source);
   write.vio.op = VIO::WRITE;
   write.vio.mutex = c->mutex;
   write.vio._cont = c;
@@ -592,6 +798,13 @@ UnixNetVConnection::do_io_close(int alerrno /* = -1 */ )
   EThread *t = this_ethread();
   bool close_inline = !recursion && nh->mutex->thread_holding == t;
 
+  // Unless it can be closed right here, hand the connection to its
+  // NetHandler to be closed on its own thread, whichever thread this is.
+  // It is queued before it is marked closed, so the owner can't free it
+  // while it is being queued.
+  if (!close_inline && ink_atomic_cas(&in_close_list, 0, 1))
+    nh->close_list.push(this);
+
   INK_WRITE_MEMORY_BARRIER;
   if (alerrno && alerrno != -1)
     this->lerrno = alerrno;
@@ -609,6 +822,7 @@ UnixNetVConnection::do_io_shutdown(ShutdownHowTo_t howto)
 {
   switch (howto) {
   case IO_SHUTDOWN_READ:
+    splice_stop(this);
     socketManager.shutdown(((UnixNetVConnection *) this)->con.fd, 0);
     disable_read(this);
     read.vio.buffer.clear();
@@ -616,6 +830,8 @@ UnixNetVConnection::do_io_shutdown(ShutdownHowTo_t howto)
     f.shutdown = NET_VC_SHUTDOWN_READ;
     break;
   case IO_SHUTDOWN_WRITE:
+    if (splice_source)
+      splice_stop(splice_source);
     socketManager.shutdown(((UnixNetVConnection *) this)->con.fd, 1);
     disable_write(this);
     write.vio.buffer.clear();
@@ -623,6 +839,9 @@ UnixNetVConnection::do_io_shutdown(ShutdownHowTo_t howto)
     f.shutdown = NET_VC_SHUTDOWN_WRITE;
     break;
   case IO_SHUTDOWN_READWRITE:
+    splice_stop(this);
+    if (splice_source)
+      splice_stop(splice_source);
     socketManager.shutdown(((UnixNetVConnection *) this)->con.fd, 2);
     disable_read(this);
     disable_write(this);
@@ -791,15 +1010,9 @@ UnixNetVConnection::reenable_re(VIO *vio)
 
 
 UnixNetVConnection::UnixNetVConnection()
-  : closed(0), inactivity_timeout_in(0), active_timeout_in(0),
-#ifdef INACTIVITY_TIMEOUT
-    inactivity_timeout(NULL),
-#else
-    next_inactivity_timeout_at(0),
-#endif
-    active_timeout(NULL), nh(NULL),
+  : closed(0), inactivity_timeout_in(0), active_timeout_in(0), in_timer_rearm_list(0), in_close_list(0), nh(NULL),
     id(0), flags(0), recursion(0), submit_time(0), oob_ptr(0),
-    from_accept_thread(false)
+    from_accept_thread(false), splice(NULL), splice_source(NULL)
 {
   memset(&local_addr, 0, sizeof local_addr);
   memset(&server_addr, 0, sizeof server_addr);
@@ -814,17 +1027,13 @@ UnixNetVConnection::set_enabled(VIO *vio)
   ink_assert(vio->mutex->thread_holding == this_ethread() && thread);
   ink_assert(!closed);
   STATE_FROM_VIO(vio)->enabled = 1;
-#ifdef INACTIVITY_TIMEOUT
-  if (!inactivity_timeout && inactivity_timeout_in) {
-    if (vio->mutex->thread_holding == thread)
-      inactivity_timeout = thread->schedule_in_local(this, inactivity_timeout_in);
-    else
-      inactivity_timeout = thread->schedule_in(this, inactivity_timeout_in);
+  // Start the inactivity timeout unless it is already running, a later
+  // deadline is the default one armed while the connection was disabled.
+  if (inactivity_timeout_in) {
+    ink_hrtime at = ink_get_hrtime() + inactivity_timeout_in;
+    if (!inactivity_timer.at || inactivity_timer.at > at)
+      arm_timer(&inactivity_timer, at);
   }
-#else
-  if (!next_inactivity_timeout_at && inactivity_timeout_in)
-    next_inactivity_timeout_at = ink_get_hrtime() + inactivity_timeout_in;
-#endif
 }
 
 void
@@ -982,9 +1191,7 @@ UnixNetVConnection::acceptEvent(int event, Event *e)
 
   nh->open_list.enqueue(this);
 
-  if (inactivity_timeout_in) {
-    UnixNetVConnection::set_inactivity_timeout(inactivity_timeout_in);
-  }
+  reset_inactivity_timer();
 
   if (active_timeout_in) {
     UnixNetVConnection::set_active_timeout(active_timeout_in);
@@ -996,8 +1203,8 @@ UnixNetVConnection::acceptEvent(int event, Event *e)
 
 //
 // The main event for UnixNetVConnections.
-// This is called by the Event subsystem to initialize the UnixNetVConnection
-// and for active and inactivity timeouts.
+// This is called by the NetHandler when the inactivity timeout
+// (EVENT_IMMEDIATE) or the active timeout (EVENT_INTERVAL) has passed.
 //
 int
 UnixNetVConnection::mainEvent(int event, Event *e)
@@ -1005,6 +1212,8 @@ UnixNetVConnection::mainEvent(int event, Event *e)
   ink_assert(event == EVENT_IMMEDIATE || event == EVENT_INTERVAL);
   ink_assert(thread == this_ethread());
 
+  NetTimer *timer = event == EVENT_INTERVAL ? &active_timer : &inactivity_timer;
+
   MUTEX_TRY_LOCK(hlock, get_NetHandler(thread)->mutex, e->ethread);
   MUTEX_TRY_LOCK(rlock, read.vio.mutex ? (ProxyMutex *) read.vio.mutex : (ProxyMutex *) e->ethread->mutex, e->ethread);
   MUTEX_TRY_LOCK(wlock, write.vio.mutex ? (ProxyMutex *) write.vio.mutex :
@@ -1012,47 +1221,21 @@ UnixNetVConnection::mainEvent(int event, Event *e)
   if (!hlock || !rlock || !wlock ||
       (read.vio.mutex.m_ptr && rlock.m.m_ptr != read.vio.mutex.m_ptr) ||
       (write.vio.mutex.m_ptr && wlock.m.m_ptr != write.vio.mutex.m_ptr)) {
-#ifndef INACTIVITY_TIMEOUT
-    if (e == active_timeout)
-#endif
-      e->schedule_in(NET_RETRY_DELAY);
+    arm_timer(timer, ink_get_hrtime() + NET_RETRY_DELAY);
     return EVENT_CONT;
   }
-  if (e->cancelled)
-    return EVENT_DONE;
 
-  int signal_event;
-  Event **signal_timeout;
+  // The deadline may have moved or been cleared since the timer expired.
+  if (!timer->at || timer->at > ink_get_hrtime()) {
+    arm_timer(timer, timer->at);
+    return EVENT_CONT;
+  }
+
+  int signal_event = event == EVENT_INTERVAL ? VC_EVENT_ACTIVE_TIMEOUT : VC_EVENT_INACTIVITY_TIMEOUT;
   Continuation *reader_cont = NULL;
   Continuation *writer_cont = NULL;
-  ink_hrtime next_activity_timeout_at = 0;
-  ink_hrtime *signal_timeout_at = &next_activity_timeout_at;
-  Event *t = NULL;
-  signal_timeout = &t;
-
-#ifdef INACTIVITY_TIMEOUT
-  if (e == inactivity_timeout) {
-    signal_event = VC_EVENT_INACTIVITY_TIMEOUT;
-    signal_timeout = &inactivity_timeout;
-  }
-#else
-  if (event == EVENT_IMMEDIATE) {
-    /* BZ 49408 */
-    //ink_assert(inactivity_timeout_in);
-    //ink_assert(next_inactivity_timeout_at < ink_get_hrtime());
-    if (!inactivity_timeout_in || next_inactivity_timeout_at > ink_get_hrtime())
-      return EVENT_CONT;
-    signal_event = VC_EVENT_INACTIVITY_TIMEOUT;
-    signal_timeout_at = &next_inactivity_timeout_at;
-  }
-#endif
-  else {
-    ink_assert(e == active_timeout);
-    signal_event = VC_EVENT_ACTIVE_TIMEOUT;
-    signal_timeout = &active_timeout;
-  }
-  *signal_timeout = 0;
-  *signal_timeout_at = 0;
+
+  nh->timer_wheel.cancel(timer);
   writer_cont = write.vio._cont;
 
   if (closed) {
@@ -1066,12 +1249,14 @@ UnixNetVConnection::mainEvent(int event, Event *e)
       return EVENT_DONE;
   }
 
-  if (!*signal_timeout &&
-      !*signal_timeout_at &&
+  if (!timer->at &&
       !closed && write.vio.op == VIO::WRITE &&
       !(f.shutdown & NET_VC_SHUTDOWN_WRITE) && reader_cont != write.vio._cont && writer_cont == write.vio._cont)
     if (write_signal_and_update(signal_event, this) == EVENT_DONE)
       return EVENT_DONE;
+
+  if (!closed && !inactivity_timer.at)
+    arm_timer(&inactivity_timer, net_default_inactivity_deadline());
   return EVENT_DONE;
 }
 
@@ -1152,6 +1337,7 @@ UnixNetVConnection::connectUp(EThread *t, int fd)
 
   nh = get_NetHandler(t);
   nh->open_list.enqueue(this);
+  reset_inactivity_timer();
 
   ink_assert(!inactivity_timeout_in);
   ink_assert(!active_timeout_in);
@@ -1184,12 +1370,13 @@ UnixNetVConnection::free(EThread *t)
   write.triggered = 0;
   options.reset();
   closed = 0;
+  ink_assert(!splice && !splice_source);
   ink_assert(!read.ready_link.prev && !read.ready_link.next);
   ink_assert(!read.enable_link.next);
   ink_assert(!write.ready_link.prev && !write.ready_link.next);
   ink_assert(!write.enable_link.next);
   ink_assert(!link.next && !link.prev);
-  ink_assert(!active_timeout);
+  ink_assert(!inactivity_timer.list && !active_timer.list && !in_timer_rearm_list && !in_close_list);
   ink_assert(con.fd == NO_FD);
   ink_assert(t == this_ethread());
 
@@ -1200,8 +1387,217 @@ UnixNetVConnection::free(EThread *t)
   }
 }
 
+bool
+UnixNetVConnection::splice_to(NetVConnection *peer)
+{
+#if HAVE_SPLICE
+  UnixNetVConnection *to = dynamic_cast<UnixNetVConnection *>(peer);
+
+  if (!net_splice_enabled || !to || dynamic_cast<SSLNetVConnection *>(to) || to->thread != thread || splice ||
+      to->splice_source || closed || to->closed)
+    return false;
+
+  NetSplice *sp = new NetSplice;
+  if (pipe2(sp->pipe_fd, O_NONBLOCK | O_CLOEXEC) < 0) {
+    Debug("iocore_net", "unable to create a splice pipe: %s", strerror(errno));
+    delete sp;
+    return false;
+  }
+  sp->pending = 0;
+  sp->to = to;
+  splice = sp;
+  to->splice_source = this;
+  NET_SUM_GLOBAL_DYN_STAT(net_splice_tunnels_stat, 1);
+  Debug("iocore_net", "splicing %d to %d", con.fd, to->con.fd);
+  return true;
+#else
+  (void) peer;
+  return false;
+#endif
+}
+
+NetVConnection *
+UnixNetVConnection::migrate_to_thread(Continuation *cont, EThread *t)
+{
+  NetHandler *to_nh = get_NetHandler(t);
+
+  if (nh == to_nh)
+    return this;
+
+  MUTEX_TRY_LOCK(lock, mutex, t);
+  if (!lock.lock_acquired || !can_migrate())
+    return NULL;
+
+  UnixNetVConnection *netvc = (UnixNetVConnection *) unix_netProcessor.allocate_vc(t);
+
+  NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
+  netvc->con = con;
+  netvc->options = options;
+  netvc->id = id;
+  netvc->submit_time = submit_time;
+  netvc->server_addr = server_addr;
+  netvc->local_addr = local_addr;
+  netvc->remote_addr = remote_addr;
+  netvc->got_local_addr = got_local_addr;
+  netvc->got_remote_addr = got_remote_addr;
+  netvc->is_internal_request = is_internal_request;
+  netvc->is_transparent = is_transparent;
+  netvc->thread = t;
+  netvc->nh = to_nh;
+  netvc->mutex = cont->mutex;
+  netvc->action_ = cont;
+  SET_CONTINUATION_HANDLER(netvc, (NetVConnHandler) & UnixNetVConnection::mainEvent);
+
+  // Register with the new thread before leaving the old one so the socket is never unwatched.
+  if (netvc->ep.start(get_PollDescriptor(t), netvc, EVENTIO_READ|EVENTIO_WRITE) < 0) {
+    Debug("iocore_net", "migrate_to_thread : failed EventIO::start\n");
+    netvc->con.fd = NO_FD;
+    netvc->free(t);
+    return NULL;
+  }
+  to_nh->open_list.enqueue(netvc);
+  netvc->inactivity_timeout_in = inactivity_timeout_in;
+  netvc->reset_inactivity_timer();
+  if (active_timeout_in)
+    netvc->set_active_timeout(active_timeout_in);
+
+  // Closed off its thread, so do_io_close() queues it on the close_list of
+  // the owning NetHandler, which takes it off its lists and frees it.
+  ep.stop();
+  con.fd = NO_FD;
+  do_io_close();
+  Debug("iocore_net", "migrated fd %d from %p to %p", netvc->con.fd, this, netvc);
+  return netvc;
+}
+
+bool
+UnixNetVConnection::can_migrate() const
+{
+  return !closed && !splice && !splice_source && !read.in_enabled_list && !write.in_enabled_list;
+}
+
+void
+UnixNetVConnection::arm_timer(NetTimer *timer, ink_hrtime at)
+{
+  timer->at = at;
+  timer->vc = this;
+  // Not on a thread yet, the timeouts are armed when it gets one.
+  if (!nh)
+    return;
+  if (this_ethread() == thread) {
+    nh->timer_wheel.schedule(timer);
+  } else if (ink_atomic_cas(&in_timer_rearm_list, 0, 1)) {
+    // The wheel belongs to the owning thread, let it file the timer.
+    nh->timer_rearm_list.push(this);
+  }
+}
+
+void
+UnixNetVConnection::reset_inactivity_timer()
+{
+  arm_timer(&inactivity_timer, inactivity_timeout_in ? ink_get_hrtime() + inactivity_timeout_in : net_default_inactivity_deadline());
+}
+
 void
 UnixNetVConnection::apply_options()
 {
   con.apply_options(options);
 }
+
+#if TS_HAS_TESTS
+
+// Close a connection from a thread other than its own, on which nothing
+// else would ever look at it again, and wait for the owning NetHandler to
+// free it. The socket being closed shows on the other end of the pair.
+struct NetCloseOffThreadTest : public Continuation
+{
+  RegressionTest *t;
+  int *pstatus;
+  int fds[2];
+  UnixNetVConnection *vc;
+  ink_hrtime deadline;
+
+  int
+  acceptEvent(int event, void *data)
+  {
+    ink_release_assert(event == NET_EVENT_ACCEPT);
+    vc = (UnixNetVConnection *) data;
+    SET_HANDLER(&NetCloseOffThreadTest::closeEvent);
+    eventProcessor.schedule_imm(this, ET_TASK);
+    return EVENT_DONE;
+  }
+
+  int
+  closeEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    if (e->ethread == vc->thread) {
+      vc->do_io_close();
+      done("no other thread to close the connection from", REGRESSION_TEST_FAILED);
+      return EVENT_DONE;
+    }
+    vc->do_io_close();
+    vc = NULL;
+    deadline = ink_get_hrtime() + HRTIME_SECONDS(5);
+    SET_HANDLER(&NetCloseOffThreadTest::waitEvent);
+    e->schedule_in(HRTIME_MSECONDS(10));
+    return EVENT_CONT;
+  }
+
+  int
+  waitEvent(int /* event ATS_UNUSED */, Event *e)
+  {
+    char c;
+    if (read(fds[1], &c, 1) == 0) {
+      done("closed connection freed", REGRESSION_TEST_PASSED);
+      return EVENT_DONE;
+    }
+    if (ink_get_hrtime() > deadline) {
+      done("connection closed from another thread was not freed", REGRESSION_TEST_FAILED);
+      return EVENT_DONE;
+    }
+    e->schedule_in(HRTIME_MSECONDS(10));
+    return EVENT_CONT;
+  }
+
+  void
+  done(const char *what, int status)
+  {
+    rprintf(t, "%s\n", what);
+    close(fds[1]);
+    *pstatus = status;
+    delete this;
+  }
+
+  NetCloseOffThreadTest(RegressionTest *at, int *apstatus)
+    : Continuation(new_ProxyMutex()), t(at), pstatus(apstatus), vc(NULL), deadline(0)
+  {
+    fds[0] = fds[1] = NO_FD;
+    SET_HANDLER(&NetCloseOffThreadTest::acceptEvent);
+  }
+};
+
+REGRESSION_TEST(UnixNetVConnection_close_off_thread)(RegressionTest * t, int /* level ATS_UNUSED */, int *pstatus)
+{
+  NetCloseOffThreadTest *test = new NetCloseOffThreadTest(t, pstatus);
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, test->fds) < 0 || safe_nonblocking(test->fds[1]) < 0) {
+    rprintf(t, "unable to create a socket pair: %s\n", strerror(errno));
+    *pstatus = REGRESSION_TEST_FAILED;
+    delete test;
+    return;
+  }
+  *pstatus = REGRESSION_TEST_INPROGRESS;
+
+  // Set up the way NetAccept hands a new connection to a network thread.
+  UnixNetVConnection *vc = (UnixNetVConnection *) netProcessor.allocate_vc(NULL);
+  NET_SUM_GLOBAL_DYN_STAT(net_connections_currently_open_stat, 1);
+  vc->con.fd = test->fds[0];
+  vc->submit_time = ink_get_hrtime();
+  vc->mutex = new_ProxyMutex();
+  vc->action_ = test;
+  vc->closed = 0;
+  SET_CONTINUATION_HANDLER(vc, (NetVConnHandler) & UnixNetVConnection::acceptEvent);
+  eventProcessor.schedule_imm(vc, ET_NET);
+}
+
+#endif
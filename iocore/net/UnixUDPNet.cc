@@ -113,6 +113,38 @@ UDPNetProcessorInternal::udp_read_from_net(UDPNetHandler * nh, UDPConnection * x
   // don't call back connection at this time.
   int r;
   int iters = 0;
+#if HAVE_RECVMMSG
+  // Read up to UDP_READ_BATCH datagrams per system call into the handler's
+  // receive ring, then copy each one into a right sized packet.
+  struct mmsghdr msgs[UDP_READ_BATCH];
+  struct iovec iov[UDP_READ_BATCH];
+  sockaddr_in6 fromaddr[UDP_READ_BATCH];
+
+  if (!nh->read_ring)
+    nh->read_ring = (char *)ats_malloc(UDP_READ_BATCH * UDP_MAX_DATAGRAM);
+  do {
+    for (int i = 0; i < UDP_READ_BATCH; i++) {
+      iov[i].iov_base = nh->read_ring + i * UDP_MAX_DATAGRAM;
+      iov[i].iov_len = UDP_MAX_DATAGRAM;
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = &fromaddr[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(fromaddr[i]);
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    r = socketManager.recvmmsg(uc->getFd(), msgs, UDP_READ_BATCH, 0);
+    for (int i = 0; i < r; i++) {
+      if (msgs[i].msg_len == 0)
+        continue;
+      // create packet
+      UDPPacket *p = new_incoming_UDPPacket(ats_ip_sa_cast(&fromaddr[i]), (char *) iov[i].iov_base, msgs[i].msg_len);
+      p->setConnection(uc);
+      // queue onto the UDPConnection
+      ink_atomiclist_push(&uc->inQueue, p);
+      iters++;
+    }
+  } while (r == UDP_READ_BATCH);
+#else
   do {
     sockaddr_in6 fromaddr;
     socklen_t fromlen = sizeof(fromaddr);
@@ -133,6 +165,7 @@ UDPNetProcessorInternal::udp_read_from_net(UDPNetHandler * nh, UDPConnection * x
     ink_atomiclist_push(&uc->inQueue, p);
     iters++;
   } while (r > 0);
+#endif
   if (iters >= 1) {
     Debug("udp-read", "read %d at a time", iters);
   }
@@ -696,6 +729,8 @@ UDPQueue::SendPackets()
   int32_t bytesThisSlot = INT_MAX, bytesUsed = 0;
   int32_t bytesThisPipe, sentOne;
   int64_t pktLen;
+  UDPPacketInternal *batch[UDP_SEND_BATCH];
+  uint16_t nbatch = 0;
 
   bytesThisSlot = INT_MAX;
 
@@ -712,9 +747,20 @@ sendPackets:
     if (p->conn->GetSendGenerationNumber() != p->reqGenerationNum)
       goto next_pkt;
 
-    SendUDPPacket(p, pktLen);
+    // Collect the packets due in this slot and hand them to the kernel a
+    // batch at a time. A batch is flushed when the socket changes.
+    if (nbatch && (nbatch == UDP_SEND_BATCH || batch[0]->conn->getFd() != p->conn->getFd())) {
+      SendMultipleUDPPackets(batch, nbatch);
+      nbatch = 0;
+    }
+    batch[nbatch++] = p;
     bytesUsed += pktLen;
     bytesThisPipe -= pktLen;
+    sentOne = true;
+    if (bytesThisPipe < 0)
+      break;
+    continue;
+
   next_pkt:
     sentOne = true;
     p->free();
@@ -722,6 +768,10 @@ sendPackets:
     if (bytesThisPipe < 0)
       break;
   }
+  if (nbatch) {
+    SendMultipleUDPPackets(batch, nbatch);
+    nbatch = 0;
+  }
 
   bytesThisSlot -= bytesUsed;
 
@@ -789,6 +839,81 @@ UDPQueue::SendUDPPacket(UDPPacketInternal *p, int32_t /* pktLen ATS_UNUSED */)
 }
 
 
+// Send @a n packets, which all go out on the same socket, and free them.
+void
+UDPQueue::SendMultipleUDPPackets(UDPPacketInternal ** p, uint16_t n)
+{
+#if HAVE_SENDMMSG
+  struct mmsghdr msgvec[UDP_SEND_BATCH];
+  struct iovec iov_buf[UDP_SEND_BATCH * 4];
+  struct iovec *iov = iov_buf;
+  int iov_used = 0;
+  int vlen = 0;
+  int fd = p[0]->conn->getFd();
+  int i, nblocks = 0;
+  IOBufferBlock *b;
+
+  ink_assert(n <= UDP_SEND_BATCH);
+  // Packets go out in order, so a packet with a long chain stays in the
+  // batch and the iovec is sized to fit it.
+  for (i = 0; i < n; i++)
+    for (b = p[i]->chain; b != NULL; b = b->next)
+      nblocks++;
+  if (nblocks > (int) countof(iov_buf))
+    iov = (struct iovec *)ats_malloc(nblocks * sizeof(struct iovec));
+
+  for (i = 0; i < n; i++) {
+    p[i]->conn->lastSentPktStartTime = p[i]->delivery_time;
+    Debug("udp-send", "Sending %p", p[i]);
+
+    struct msghdr *msg = &msgvec[vlen].msg_hdr;
+    memset(&msgvec[vlen], 0, sizeof(msgvec[vlen]));
+    msg->msg_name = (caddr_t) & p[i]->to;
+    msg->msg_namelen = sizeof(p[i]->to);
+    msg->msg_iov = &iov[iov_used];
+    for (b = p[i]->chain; b != NULL; b = b->next) {
+      iov[iov_used].iov_base = (caddr_t) b->start();
+      iov[iov_used].iov_len = b->size();
+      iov_used++;
+    }
+    msg->msg_iovlen = &iov[iov_used] - msg->msg_iov;
+    vlen++;
+  }
+
+  int sent = 0;
+  int count = 0;
+  while (sent < vlen) {
+    int res = socketManager.sendmmsg(fd, msgvec + sent, vlen - sent, 0);
+    if (res > 0) {
+      sent += res;
+      continue;
+    }
+    if (res == -EAGAIN) {
+      // stupid Linux problem: sendmsg can return EAGAIN
+      ++count;
+      if ((g_udp_numSendRetries > 0) && (count >= g_udp_numSendRetries)) {
+        // tried too many times; give up
+        Debug("udpnet", "Send failed: too many retries");
+        break;
+      }
+      continue;
+    }
+    // some random error happened, drop the packet it happened on.
+    Debug("udpnet", "Send failed: %d", res);
+    sent++;
+  }
+  Debug("udp-send", "sent %d of %d packets in a batch", sent, vlen);
+  if (iov != iov_buf)
+    ats_free(iov);
+#else
+  for (int i = 0; i < n; i++)
+    SendUDPPacket(p[i], 0);
+#endif
+
+  for (int j = 0; j < n; j++)
+    p[j]->free();
+}
+
 void
 UDPQueue::send(UDPPacket * p)
 {
@@ -805,6 +930,7 @@ UDPNetHandler::UDPNetHandler()
   ink_atomiclist_init(&udpNewConnections, "UDP Connection queue", offsetof(UnixUDPConnection, newconn_alink.next));
   nextCheck = ink_get_hrtime_internal() + HRTIME_MSECONDS(1000);
   lastCheck = 0;
+  read_ring = NULL;
   SET_HANDLER((UDPNetContHandler) & UDPNetHandler::startNetEvent);
 }
 
@@ -888,3 +1014,122 @@ UDPNetHandler::mainNetEvent(int event, Event * e)
 
   return EVENT_CONT;
 }
+
+#if TS_HAS_TESTS
+
+#include "ts/TestBox.h"
+
+// Send @a npkts small datagrams from @a sfd to @a to and read them back on
+// @a rfd, @a batch at a time, one system call per datagram or one per batch.
+// Returns the number of datagrams received.
+static int
+udp_loopback_run(int sfd, int rfd, sockaddr const* to, int npkts, int batch, bool batched)
+{
+  char payload[64];
+  char rbuf[UDP_READ_BATCH][2048];
+  int received = 0;
+
+  memset(payload, 'x', sizeof(payload));
+  for (int sent = 0; sent < npkts; sent += batch) {
+    int n = 0;
+#if HAVE_SENDMMSG && HAVE_RECVMMSG
+    if (batched) {
+      struct mmsghdr msgs[UDP_READ_BATCH];
+      struct iovec iov[UDP_READ_BATCH];
+
+      for (int i = 0; i < batch; i++) {
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        iov[i].iov_base = payload;
+        iov[i].iov_len = sizeof(payload);
+        msgs[i].msg_hdr.msg_name = (void *) to;
+        msgs[i].msg_hdr.msg_namelen = ats_ip_size(to);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      socketManager.sendmmsg(sfd, msgs, batch, 0);
+      for (int i = 0; i < batch; i++) {
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        iov[i].iov_base = rbuf[i];
+        iov[i].iov_len = sizeof(rbuf[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      while (n < batch) {
+        int r = socketManager.recvmmsg(rfd, msgs, batch - n, 0);
+        if (r <= 0)
+          break;
+        n += r;
+      }
+    } else
+#else
+    (void) batched;
+#endif
+    {
+      for (int i = 0; i < batch; i++)
+        socketManager.sendto(sfd, payload, sizeof(payload), 0, to, ats_ip_size(to));
+      while (n < batch && socketManager.recvfrom(rfd, rbuf[0], sizeof(rbuf[0]), 0, NULL, NULL) > 0)
+        n++;
+    }
+    received += n;
+  }
+  return received;
+}
+
+REGRESSION_TEST(UDPNet_batch)(RegressionTest * t, int level, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  // Only run at the highest levels.
+  if (REGRESSION_TEST_EXTENDED > level) {
+    box = REGRESSION_TEST_PASSED;
+    return;
+  }
+  box = REGRESSION_TEST_PASSED;
+
+  IpEndpoint addr;
+  socklen_t addrlen = sizeof(addr);
+  int sfd = socketManager.socket(AF_INET, SOCK_DGRAM, 0);
+  int rfd = socketManager.socket(AF_INET, SOCK_DGRAM, 0);
+
+  ats_ip4_set(&addr, htonl(INADDR_LOOPBACK), 0);
+  if (!box.check(sfd >= 0 && rfd >= 0, "unable to create UDP sockets") ||
+      !box.check(socketManager.ink_bind(rfd, &addr.sa, ats_ip_size(&addr.sa)) == 0, "unable to bind the loopback socket") ||
+      !box.check(safe_getsockname(rfd, &addr.sa, &addrlen) == 0, "unable to read the loopback address")) {
+    goto Ldone;
+  }
+  socketManager.set_rcvbuf_size(rfd, 1 << 20);
+  {
+    // a lost datagram must not leave the receive loops blocked
+    struct timeval tv = { 0, 100 * 1000 };
+    safe_setsockopt(rfd, SOL_SOCKET, SO_RCVTIMEO, (char *) &tv, sizeof(tv));
+  }
+
+  {
+    const int npkts = 1 << 18;
+    const char *name[] = { "sendto/recvfrom", "sendmmsg/recvmmsg" };
+
+    for (int mode = 0; mode < 2; mode++) {
+#if !(HAVE_SENDMMSG && HAVE_RECVMMSG)
+      if (mode) {
+        rprintf(t, "%s not available\n", name[mode]);
+        break;
+      }
+#endif
+      ink_hrtime start = ink_get_hrtime_internal();
+      int received = udp_loopback_run(sfd, rfd, &addr.sa, npkts, UDP_READ_BATCH, mode == 1);
+      ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+      rprintf(t, "%s: %d of %d packets, %.0f packets/sec\n", name[mode], received, npkts,
+              (double) received * HRTIME_SECOND / (elapsed ? elapsed : 1));
+      box.check(received > npkts / 2, "%s lost %d of %d packets", name[mode], npkts - received, npkts);
+    }
+  }
+
+Ldone:
+  if (sfd >= 0)
+    socketManager.close(sfd);
+  if (rfd >= 0)
+    socketManager.close(rfd);
+}
+
+#endif
@@ -135,6 +135,10 @@ int RecRegisterRawStatUpdateFunc(const char *name, RecRawStatBlock * rsb, int id
 // functions from a configuration update callback (RecConfigUpdateCb),
 // be sure to set 'lock' to 'false' as the hash-table rwlock has
 // already been taken out for the callback.
+//
+// Looking up a record by name does not take any lock, and neither does
+// reading a record that is not a string: 'lock' only matters to the
+// calls that may add a record.
 
 // RecSetRecordConvert -> WebMgmtUtils.cc::varSetFromStr()
 int RecSetRecordConvert(const char *name, const RecString rec_string, bool lock = true, bool inc_version = true);
@@ -174,6 +178,40 @@ void RecGetRecordList(char *, char ***, int *);
 int RecGetRecordPrefix_Xmalloc(char *prefix, char **result, int *result_len);
 
 
+//------------------------------------------------------------------------
+// Record Snapshots
+//------------------------------------------------------------------------
+
+struct RecSnapshotEntry
+{
+  RecT rec_type;
+  const char *name;             // records are never freed, nor is their name
+  bool registered;
+  RecDataT data_type;
+  RecData data;                 // a string is a copy, owned by the snapshot
+};
+
+struct RecSnapshot;
+
+// Copy the value of every record of type 'rec_type' (RECT_NULL for all
+// of them) to 'snap', in one pass and without locking anything but the
+// records that are strings. The entries of 'snap', and the copies of the
+// strings that did not change, are reused from one snapshot to the next.
+// Returns the number of entries.
+int RecSnapshotRecords(RecT rec_type, RecSnapshot *snap);
+void RecSnapshotFree(RecSnapshot *snap);
+
+struct RecSnapshot
+{
+  RecSnapshotEntry *entries;
+  int count;
+  int size;                     // entries allocated
+
+  RecSnapshot() : entries(NULL), count(0), size(0) { }
+  ~RecSnapshot() { RecSnapshotFree(this); }
+};
+
+
 //------------------------------------------------------------------------
 // Signal and Alarms
 //------------------------------------------------------------------------
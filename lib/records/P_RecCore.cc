@@ -375,6 +375,41 @@ RecRegisterConfigCounter(RecT rec_type, const char *name,
 }
 
 
+//-------------------------------------------------------------------------
+// rec_add_record
+//-------------------------------------------------------------------------
+static int
+rec_add_record(RecT rec_type, const char *name, RecDataT data_type, RecData *data, RecRawStat *data_raw)
+{
+  RecRecord *r1;
+  int err = REC_ERR_OKAY;
+
+  // Add the record but do not set the 'registered' flag, as this
+  // record really hasn't been registered yet.  Also, in order to
+  // add the record, we need to have a rec_type, so if the user
+  // calls RecSetRecord on a record we haven't registered yet, we
+  // should fail out here.
+  if ((rec_type == RECT_NULL) || (data_type == RECD_NULL)) {
+    return REC_ERR_FAIL;
+  }
+  if ((r1 = RecAlloc(rec_type, name, data_type)) == NULL) {
+    return REC_ERR_FAIL;
+  }
+  RecDataSet(data_type, &(r1->data), data);
+  if (REC_TYPE_IS_STAT(r1->rec_type) && (data_raw != NULL)) {
+    r1->stat_meta.data_raw = *data_raw;
+  }
+  if (i_am_the_record_owner(r1->rec_type)) {
+    r1->sync_required = r1->sync_required | REC_PEER_SYNC_REQUIRED;
+  } else {
+    err = send_set_message(r1);
+  }
+  RecIndexInsert(r1);
+
+  return err;
+}
+
+
 //-------------------------------------------------------------------------
 // RecSetRecordXXX
 //-------------------------------------------------------------------------
@@ -384,100 +419,81 @@ RecSetRecord(RecT rec_type, const char *name, RecDataT data_type, RecData *data,
   int err = REC_ERR_OKAY;
   RecRecord *r1;
 
-  // FIXME: Most of the time we set, we don't actually need to wrlock
-  // since we are not modifying the g_records_ht.
-  if (lock) {
-    ink_rwlock_wrlock(&g_records_rwlock);
+  // Only adding a record to the index needs the wrlock
+  if ((r1 = RecIndexLookup(name)) == NULL) {
+    if (lock) {
+      ink_rwlock_wrlock(&g_records_rwlock);
+    }
+    if ((r1 = RecIndexLookup(name)) == NULL) {
+      err = rec_add_record(rec_type, name, data_type, data, data_raw);
+    }
+    if (lock) {
+      ink_rwlock_unlock(&g_records_rwlock);
+    }
+    if (r1 == NULL) {
+      return err;
+    }
   }
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r1)) {
-    if (i_am_the_record_owner(r1->rec_type)) {
-      rec_mutex_acquire(&(r1->lock));
-      if ((data_type != RECD_NULL) && (r1->data_type != data_type)) {
-        err = REC_ERR_FAIL;
-      } else {
-        if (data_type == RECD_NULL) {
-          ink_assert(data->rec_string);
-          switch (r1->data_type) {
-          case RECD_INT:
-            r1->data.rec_int = ink_atoi64(data->rec_string);
-            data_type = RECD_INT;
-            break;
-          case RECD_FLOAT:
-            r1->data.rec_float = atof(data->rec_string);
-            data_type = RECD_FLOAT;
-            break;
-          case RECD_STRING:
-            data_type = RECD_STRING;
-            r1->data.rec_string = data->rec_string;
-            break;
-          case RECD_COUNTER:
-            r1->data.rec_int = ink_atoi64(data->rec_string);
-            data_type = RECD_COUNTER;
-            break;
-          default:
-            err = REC_ERR_FAIL;
-            break;
-          }
+  if (i_am_the_record_owner(r1->rec_type)) {
+    rec_mutex_acquire(&(r1->lock));
+    if ((data_type != RECD_NULL) && (r1->data_type != data_type)) {
+      err = REC_ERR_FAIL;
+    } else {
+      if (data_type == RECD_NULL) {
+        ink_assert(data->rec_string);
+        switch (r1->data_type) {
+        case RECD_INT:
+          r1->data.rec_int = ink_atoi64(data->rec_string);
+          data_type = RECD_INT;
+          break;
+        case RECD_FLOAT:
+          r1->data.rec_float = atof(data->rec_string);
+          data_type = RECD_FLOAT;
+          break;
+        case RECD_STRING:
+          data_type = RECD_STRING;
+          r1->data.rec_string = data->rec_string;
+          break;
+        case RECD_COUNTER:
+          r1->data.rec_int = ink_atoi64(data->rec_string);
+          data_type = RECD_COUNTER;
+          break;
+        default:
+          err = REC_ERR_FAIL;
+          break;
         }
+      }
 
-        if (RecDataSet(data_type, &(r1->data), data)) {
-          r1->sync_required = REC_SYNC_REQUIRED;
-          if (inc_version) {
-            r1->sync_required |= REC_INC_CONFIG_VERSION;
-          }
-          if (REC_TYPE_IS_CONFIG(r1->rec_type)) {
-            r1->config_meta.update_required = REC_UPDATE_REQUIRED;
-          }
+      if (RecDataSet(data_type, &(r1->data), data)) {
+        r1->sync_required = REC_SYNC_REQUIRED;
+        if (inc_version) {
+          r1->sync_required |= REC_INC_CONFIG_VERSION;
         }
-        if (REC_TYPE_IS_STAT(r1->rec_type) && (data_raw != NULL)) {
-          r1->stat_meta.data_raw = *data_raw;
+        if (REC_TYPE_IS_CONFIG(r1->rec_type)) {
+          r1->config_meta.update_required = REC_UPDATE_REQUIRED;
         }
       }
-      rec_mutex_release(&(r1->lock));
-    } else {
-      // We don't need to ats_strdup() here as we will make copies of any
-      // strings when we marshal them into our RecMessage buffer.
-      RecRecord r2;
-
-      RecRecordInit(&r2);
-      r2.rec_type = rec_type;
-      r2.name = name;
-      r2.data_type = (data_type != RECD_NULL) ? data_type : r1->data_type;
-      r2.data = *data;
-      if (REC_TYPE_IS_STAT(r2.rec_type) && (data_raw != NULL)) {
-        r2.stat_meta.data_raw = *data_raw;
+      if (REC_TYPE_IS_STAT(r1->rec_type) && (data_raw != NULL)) {
+        r1->stat_meta.data_raw = *data_raw;
       }
-      err = send_set_message(&r2);
-      RecRecordFree(&r2);
     }
+    rec_mutex_release(&(r1->lock));
   } else {
-    // Add the record but do not set the 'registered' flag, as this
-    // record really hasn't been registered yet.  Also, in order to
-    // add the record, we need to have a rec_type, so if the user
-    // calls RecSetRecord on a record we haven't registered yet, we
-    // should fail out here.
-    if ((rec_type == RECT_NULL) || (data_type == RECD_NULL)) {
-      err = REC_ERR_FAIL;
-      goto Ldone;
+    // We don't need to ats_strdup() here as we will make copies of any
+    // strings when we marshal them into our RecMessage buffer.
+    RecRecord r2;
+
+    RecRecordInit(&r2);
+    r2.rec_type = rec_type;
+    r2.name = name;
+    r2.data_type = (data_type != RECD_NULL) ? data_type : r1->data_type;
+    r2.data = *data;
+    if (REC_TYPE_IS_STAT(r2.rec_type) && (data_raw != NULL)) {
+      r2.stat_meta.data_raw = *data_raw;
     }
-    r1 = RecAlloc(rec_type, name, data_type);
-    RecDataSet(data_type, &(r1->data), data);
-    if (REC_TYPE_IS_STAT(r1->rec_type) && (data_raw != NULL)) {
-      r1->stat_meta.data_raw = *data_raw;
-    }
-    if (i_am_the_record_owner(r1->rec_type)) {
-      r1->sync_required = r1->sync_required | REC_PEER_SYNC_REQUIRED;
-    } else {
-      err = send_set_message(r1);
-    }
-    ink_hash_table_insert(g_records_ht, name, (void *) r1);
-
-  }
-
-Ldone:
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
+    err = send_set_message(&r2);
+    RecRecordFree(&r2);
   }
 
   return err;
@@ -725,7 +741,7 @@ RecSyncConfigToTB(textBuffer * tb, bool *inc_version)
           tb->copyFrom(cfe->entry, strlen(cfe->entry));
           tb->copyFrom("\n", 1);
         } else {
-          if (ink_hash_table_lookup(g_records_ht, cfe->entry, (void **) &r)) {
+          if ((r = RecIndexLookup(cfe->entry)) != NULL) {
             rec_mutex_acquire(&(r->lock));
             // rec_type
             switch (r->rec_type) {
@@ -843,7 +859,7 @@ RecResetStatRecord(const char *name)
   RecRecord *r1 = NULL;
   int err = REC_ERR_OKAY;
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r1)) {
+  if ((r1 = RecIndexLookup(name)) != NULL) {
     if (i_am_the_record_owner(r1->rec_type)) {
       rec_mutex_acquire(&(r1->lock));
       ++(r1->version);
@@ -914,18 +930,12 @@ RecResetStatRecord(RecT type, bool all)
 
 
 int
-RecSetSyncRequired(char *name, bool lock)
+RecSetSyncRequired(char *name, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r1;
 
-  // FIXME: Most of the time we set, we don't actually need to wrlock
-  // since we are not modifying the g_records_ht.
-  if (lock) {
-    ink_rwlock_wrlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r1)) {
+  if ((r1 = RecIndexLookup(name)) != NULL) {
     if (i_am_the_record_owner(r1->rec_type)) {
       rec_mutex_acquire(&(r1->lock));
       r1->sync_required = REC_SYNC_REQUIRED;
@@ -955,10 +965,6 @@ RecSetSyncRequired(char *name, bool lock)
     }
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
@@ -34,9 +34,8 @@
 #include "P_RecDefs.h"
 #include "P_RecTree.h"
 
-// records, record hash-table, and hash-table rwlock
+// records, and the rwlock held to add records to the index
 extern RecRecord *g_records;
-extern InkHashTable *g_records_ht;
 extern ink_rwlock g_records_rwlock;
 extern int g_num_records;
 extern RecModeT g_mode_type;
@@ -67,6 +66,11 @@ RecRecord *RecRegisterConfig(RecT rec_type, const char *name, RecDataT data_type
 
 RecRecord *RecForceInsert(RecRecord * record);
 
+// The record named 'name', or NULL. Does not take any lock.
+RecRecord *RecIndexLookup(const char *name);
+// Add 'r' to the index. Must hold g_records_rwlock as a writer.
+void RecIndexInsert(RecRecord *r);
+
 //-------------------------------------------------------------------------
 // Setting/Getting
 //-------------------------------------------------------------------------
@@ -101,7 +105,8 @@ int RecExecRawStatUpdateFuncs();
 
 void RecDumpRecordsHt(RecT rec_type = RECT_NULL);
 
+// 'snap' is reused from one dump to the next, by default a snapshot of the calling thread
 void
-RecDumpRecords(RecT rec_type, RecDumpEntryCb callback, void *edata);
+RecDumpRecords(RecT rec_type, RecDumpEntryCb callback, void *edata, RecSnapshot *snap = NULL);
 
 #endif
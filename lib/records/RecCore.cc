@@ -32,21 +32,112 @@
 static bool g_initialized = false;
 
 RecRecord *g_records = NULL;
-InkHashTable *g_records_ht = NULL;
 ink_rwlock g_records_rwlock;
 int g_num_records = 0;
 
 RecTree *g_records_tree = NULL;
 
+//-------------------------------------------------------------------------
+// Record index
+//
+// Names are looked up in an open addressing table of at least twice
+// REC_MAX_RECORDS slots. Records are never removed and the table never
+// grows, so a slot never changes once it is set: readers probe without
+// taking any lock, while writers, which hold g_records_rwlock, fill
+// free slots.
+//-------------------------------------------------------------------------
+struct RecIndexSlot
+{
+  uint64_t hash;
+  RecRecord *volatile record;   // NULL if the slot is free
+};
+
+static RecIndexSlot *g_records_index = NULL;
+static uint64_t g_records_index_mask = 0;
+// Records of g_records which are in the index, and can be read by RecSnapshotRecords()
+static volatile int g_num_records_indexed = 0;
+
+// The value of a record which is not a string, read without its lock.
+// Writers store it in one word, so a reader sees either value.
+static inline RecData
+rec_data_read(RecRecord *r)
+{
+  RecData data;
+
+  data.rec_int = *(volatile RecInt *) &(r->data.rec_int);
+  return data;
+}
+
+static inline uint64_t
+rec_index_hash(const char *name)
+{
+  ATSHash64FNV1a h;
+
+  h.update(name, strlen(name));
+  h.final();
+  return h.get();
+}
+
+static void
+rec_index_init()
+{
+  uint64_t nslots = 1;
+
+  while (nslots < 2 * REC_MAX_RECORDS) {
+    nslots <<= 1;
+  }
+  g_records_index = (RecIndexSlot *)ats_calloc(nslots, sizeof(RecIndexSlot));
+  g_records_index_mask = nslots - 1;
+}
+
+RecRecord *
+RecIndexLookup(const char *name)
+{
+  uint64_t hash = rec_index_hash(name);
+
+  for (uint64_t i = hash;; ++i) {
+    RecIndexSlot *s = &g_records_index[i & g_records_index_mask];
+    RecRecord *r = s->record;
+
+    if (r == NULL) {
+      return NULL;
+    }
+    if (s->hash == hash && strcmp(r->name, name) == 0) {
+      return r;
+    }
+  }
+}
+
+void
+RecIndexInsert(RecRecord *r)
+{
+  uint64_t hash = rec_index_hash(r->name);
+
+  for (uint64_t i = hash;; ++i) {
+    RecIndexSlot *s = &g_records_index[i & g_records_index_mask];
+
+    if (s->record == NULL) {
+      s->hash = hash;
+      // Full barrier: the record and the hash are visible before the slot is
+      ink_atomic_cas(&s->record, (RecRecord *) NULL, r);
+      break;
+    }
+  }
+
+  if (r->order >= g_num_records_indexed) {
+    ink_atomic_swap(&g_num_records_indexed, r->order + 1);
+  }
+}
+
 //-------------------------------------------------------------------------
 // register_record
 //-------------------------------------------------------------------------
 static RecRecord *
 register_record(RecT rec_type, const char *name, RecDataT data_type, RecData data_default, RecPersistT persist_type)
 {
-  RecRecord *r = NULL;
+  RecRecord *r;
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     ink_release_assert(r->rec_type == rec_type);
     ink_release_assert(r->data_type == data_type);
     // Note: do not set r->data as we want to keep the previous value
@@ -58,7 +149,7 @@ register_record(RecT rec_type, const char *name, RecDataT data_type, RecData dat
     // Set the r->data to its default value as this is a new record
     RecDataSet(r->data_type, &(r->data), &(data_default));
     RecDataSet(r->data_type, &(r->data_default), &(data_default));
-    ink_hash_table_insert(g_records_ht, name, (void *) r);
+    RecIndexInsert(r);
 
     if (REC_TYPE_IS_STAT(r->rec_type)) {
       r->stat_meta.persist_type = persist_type;
@@ -169,12 +260,10 @@ RecCoreInit(RecModeT mode_type, Diags *_diags)
   // initialize record array for our internal stats (this can be reallocated later)
   g_records = (RecRecord *)ats_malloc(REC_MAX_RECORDS * sizeof(RecRecord));
 
-  // initialize record hash index
-  g_records_ht = ink_hash_table_create(InkHashTableKeyType_String);
+  // initialize record index
+  rec_index_init();
   ink_rwlock_init(&g_records_rwlock);
-  if (!g_records_ht) {
-    return REC_ERR_FAIL;
-  }
+
   // read stats
   if ((mode_type == RECM_SERVER) || (mode_type == RECM_STAND_ALONE)) {
     RecReadStatsFile();
@@ -286,9 +375,7 @@ RecRegisterConfigUpdateCb(const char *name, RecConfigUpdateCb update_cb, void *c
   int err = REC_ERR_FAIL;
   RecRecord *r;
 
-  ink_rwlock_rdlock(&g_records_rwlock);
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       /* -- upgrade to support a list of callback functions
@@ -325,8 +412,6 @@ RecRegisterConfigUpdateCb(const char *name, RecConfigUpdateCb update_cb, void *c
     rec_mutex_release(&(r->lock));
   }
 
-  ink_rwlock_unlock(&g_records_rwlock);
-
   return err;
 }
 
@@ -355,14 +440,11 @@ RecGetRecordFloat(const char *name, RecFloat * rec_float, bool lock)
 }
 
 int
-RecGetRecordString(const char *name, char *buf, int buf_len, bool lock)
+RecGetRecordString(const char *name, char *buf, int buf_len, bool /* lock */)
 {
   int err = REC_ERR_OKAY;
   RecRecord *r;
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (!r->registered || (r->data_type != RECD_STRING)) {
       err = REC_ERR_FAIL;
@@ -377,9 +459,6 @@ RecGetRecordString(const char *name, char *buf, int buf_len, bool lock)
   } else {
     err = REC_ERR_FAIL;
   }
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
   return err;
 }
 
@@ -427,41 +506,29 @@ RecGetRecordBool(const char *name, RecBool *rec_bool, bool lock)
 // RecGetRec Attributes
 //-------------------------------------------------------------------------
 int
-RecGetRecordType(const char *name, RecT * rec_type, bool lock)
+RecGetRecordType(const char *name, RecT * rec_type, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     *rec_type = r->rec_type;
     err = REC_ERR_OKAY;
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 
 int
-RecGetRecordDataType(const char *name, RecDataT * data_type, bool lock)
+RecGetRecordDataType(const char *name, RecDataT * data_type, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (!r->registered) {
       err = REC_ERR_FAIL;
@@ -472,26 +539,18 @@ RecGetRecordDataType(const char *name, RecDataT * data_type, bool lock)
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 int
-RecGetRecordPersistenceType(const char *name, RecPersistT * persist_type, bool lock)
+RecGetRecordPersistenceType(const char *name, RecPersistT * persist_type, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
   *persist_type = RECP_NULL;
 
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_STAT(r->rec_type)) {
       *persist_type = r->stat_meta.persist_type;
@@ -500,24 +559,16 @@ RecGetRecordPersistenceType(const char *name, RecPersistT * persist_type, bool l
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 int
-RecGetRecordOrderAndId(const char *name, int* order, int* id, bool lock)
+RecGetRecordOrderAndId(const char *name, int* order, int* id, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     if (r->registered) {
       rec_mutex_acquire(&(r->lock));
       if (order)
@@ -529,24 +580,16 @@ RecGetRecordOrderAndId(const char *name, int* order, int* id, bool lock)
     }
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 int
-RecGetRecordUpdateType(const char *name, RecUpdateT *update_type, bool lock)
+RecGetRecordUpdateType(const char *name, RecUpdateT *update_type, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       *update_type = r->config_meta.update_type;
@@ -557,25 +600,17 @@ RecGetRecordUpdateType(const char *name, RecUpdateT *update_type, bool lock)
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 
 int
-RecGetRecordCheckType(const char *name, RecCheckT *check_type, bool lock)
+RecGetRecordCheckType(const char *name, RecCheckT *check_type, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       *check_type = r->config_meta.check_type;
@@ -586,25 +621,17 @@ RecGetRecordCheckType(const char *name, RecCheckT *check_type, bool lock)
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 
 int
-RecGetRecordCheckExpr(const char *name, char **check_expr, bool lock)
+RecGetRecordCheckExpr(const char *name, char **check_expr, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_CONFIG(r->rec_type)) {
       *check_expr = r->config_meta.check_expr;
@@ -615,24 +642,16 @@ RecGetRecordCheckExpr(const char *name, char **check_expr, bool lock)
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 int
-RecGetRecordDefaultDataString_Xmalloc(char *name, char **buf, bool lock)
+RecGetRecordDefaultDataString_Xmalloc(char *name, char **buf, bool /* lock */)
 {
   int err;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     *buf = (char *)ats_malloc(sizeof(char) * 1024);
     memset(*buf, 0, 1024);
     err = REC_ERR_OKAY;
@@ -665,60 +684,40 @@ RecGetRecordDefaultDataString_Xmalloc(char *name, char **buf, bool lock)
     err = REC_ERR_FAIL;
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 
 int
-RecGetRecordAccessType(const char *name, RecAccessT *access, bool lock)
+RecGetRecordAccessType(const char *name, RecAccessT *access, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     *access = r->config_meta.access_type;
     err = REC_ERR_OKAY;
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
 
 int
-RecSetRecordAccessType(const char *name, RecAccessT access, bool lock)
+RecSetRecordAccessType(const char *name, RecAccessT access, bool /* lock */)
 {
   int err = REC_ERR_FAIL;
   RecRecord *r = NULL;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     r->config_meta.access_type = access;
     err = REC_ERR_OKAY;
     rec_mutex_release(&(r->lock));
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
@@ -785,34 +784,35 @@ RecRegisterConfig(RecT rec_type, const char *name, RecDataT data_type,
 // RecGetRecord_Xmalloc
 //-------------------------------------------------------------------------
 int
-RecGetRecord_Xmalloc(const char *name, RecDataT data_type, RecData *data, bool lock)
+RecGetRecord_Xmalloc(const char *name, RecDataT data_type, RecData *data, bool /* lock */)
 {
   int err = REC_ERR_OKAY;
   RecRecord *r;
 
-  if (lock) {
-    ink_rwlock_rdlock(&g_records_rwlock);
-  }
-
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
-    rec_mutex_acquire(&(r->lock));
-    if (!r->registered || (r->data_type != data_type)) {
-      err = REC_ERR_FAIL;
+  if ((r = RecIndexLookup(name)) != NULL) {
+    if (data_type != RECD_STRING) {
+      // A number is read in one go, it does not need the record lock
+      if (!r->registered || (r->data_type != data_type)) {
+        err = REC_ERR_FAIL;
+      } else {
+        *data = rec_data_read(r);
+      }
     } else {
-      // Clear the caller's record just in case it has trash in it.
-      // Passing trashy records to RecDataSet will cause confusion.
-      memset(data, 0, sizeof(RecData));
-      RecDataSet(data_type, data, &(r->data));
+      rec_mutex_acquire(&(r->lock));
+      if (!r->registered || (r->data_type != data_type)) {
+        err = REC_ERR_FAIL;
+      } else {
+        // Clear the caller's record just in case it has trash in it.
+        // Passing trashy records to RecDataSet will cause confusion.
+        memset(data, 0, sizeof(RecData));
+        RecDataSet(data_type, data, &(r->data));
+      }
+      rec_mutex_release(&(r->lock));
     }
-    rec_mutex_release(&(r->lock));
   } else {
     err = REC_ERR_FAIL;
   }
 
-  if (lock) {
-    ink_rwlock_unlock(&g_records_rwlock);
-  }
-
   return err;
 }
 
@@ -828,11 +828,15 @@ RecForceInsert(RecRecord * record)
 
   ink_rwlock_wrlock(&g_records_rwlock);
 
-  if (ink_hash_table_lookup(g_records_ht, record->name, (void **) &r)) {
+  if ((r = RecIndexLookup(record->name)) != NULL) {
+    // The types of an indexed record never change, readers rely on them without the lock
+    if (r->rec_type != record->rec_type || r->data_type != record->data_type) {
+      ink_rwlock_unlock(&g_records_rwlock);
+      RecDebug(DL_Warning, "ignoring '%s', its type does not match the existing record", record->name);
+      return NULL;
+    }
     r_is_a_new_record = false;
     rec_mutex_acquire(&(r->lock));
-    r->rec_type = record->rec_type;
-    r->data_type = record->data_type;
   } else {
     r_is_a_new_record = true;
     if ((r = RecAlloc(record->rec_type, record->name, record->data_type)) == NULL) {
@@ -861,7 +865,7 @@ RecForceInsert(RecRecord * record)
   }
 
   if (r_is_a_new_record) {
-    ink_hash_table_insert(g_records_ht, r->name, (void *) r);
+    RecIndexInsert(r);
   } else {
     rec_mutex_release(&(r->lock));
   }
@@ -899,19 +903,115 @@ debug_record_callback(RecT /* rec_type */, void * /* edata */, int registered, c
   }
 }
 void
-RecDumpRecords(RecT rec_type, RecDumpEntryCb callback, void *edata)
+RecDumpRecords(RecT rec_type, RecDumpEntryCb callback, void *edata, RecSnapshot *snap)
+{
+  // Unless the caller keeps its own, each thread reuses one snapshot from dump to dump
+  static __thread RecSnapshot *thread_snap = NULL;
+  static __thread bool thread_snap_busy = false;
+  RecSnapshot local_snap;
+  bool use_thread_snap = !snap && !thread_snap_busy;
+  int i, num_entries;
+
+  if (use_thread_snap) {
+    if (!thread_snap) {
+      thread_snap = new RecSnapshot;
+    }
+    snap = thread_snap;
+    thread_snap_busy = true;
+  } else if (!snap) {
+    // a callback is dumping records itself
+    snap = &local_snap;
+  }
+
+  // The callbacks run on a copy, without holding any record lock
+  num_entries = RecSnapshotRecords(rec_type, snap);
+  for (i = 0; i < num_entries; i++) {
+    RecSnapshotEntry *e = &(snap->entries[i]);
+    callback(rec_type, edata, e->registered, e->name, e->data_type, &e->data);
+  }
+
+  if (use_thread_snap) {
+    thread_snap_busy = false;
+  }
+}
+
+//-------------------------------------------------------------------------
+// RecSnapshotRecords
+//-------------------------------------------------------------------------
+static void
+snapshot_clear_strings(RecSnapshot *snap, int from)
+{
+  for (int i = from; i < snap->count; i++) {
+    if (snap->entries[i].data_type == RECD_STRING) {
+      ats_free(snap->entries[i].data.rec_string);
+    }
+  }
+  snap->count = from;
+}
+
+int
+RecSnapshotRecords(RecT rec_type, RecSnapshot *snap)
 {
-  int i, num_records;
+  int i, n = 0, num_records;
+
+  num_records = g_num_records_indexed;
+  if (snap->size < num_records) {
+    snap->entries = (RecSnapshotEntry *)ats_realloc(snap->entries, num_records * sizeof(RecSnapshotEntry));
+    snap->size = num_records;
+  }
 
-  num_records = g_num_records;
   for (i = 0; i < num_records; i++) {
     RecRecord *r = &(g_records[i]);
     if ((rec_type == RECT_NULL) || (rec_type & r->rec_type)) {
-      rec_mutex_acquire(&(r->lock));
-      callback(rec_type, edata, r->registered, r->name, r->data_type, &r->data);
-      rec_mutex_release(&(r->lock));
+      RecSnapshotEntry *e = &(snap->entries[n]);
+      // The copy of the string of the last snapshot, if this entry held the same record
+      char *copy = NULL;
+
+      if (n < snap->count && e->data_type == RECD_STRING) {
+        if (e->name == r->name) {
+          copy = e->data.rec_string;
+        } else {
+          ats_free(e->data.rec_string);
+        }
+      }
+      n++;
+
+      // The types of an indexed record never change, only strings need the lock
+      e->rec_type = r->rec_type;
+      e->name = r->name;
+      e->data_type = r->data_type;
+      if (e->data_type == RECD_STRING) {
+        rec_mutex_acquire(&(r->lock));
+        e->registered = r->registered;
+        if (copy && r->data.rec_string && strcmp(copy, r->data.rec_string) == 0) {
+          e->data.rec_string = copy;
+          copy = NULL;
+        } else {
+          e->data.rec_string = ats_strdup(r->data.rec_string);
+        }
+        rec_mutex_release(&(r->lock));
+        ats_free(copy);
+      } else {
+        e->registered = r->registered;
+        e->data = rec_data_read(r);
+      }
     }
   }
+
+  if (n < snap->count) {
+    snapshot_clear_strings(snap, n);
+  }
+  snap->count = n;
+  return snap->count;
+}
+
+void
+RecSnapshotFree(RecSnapshot *snap)
+{
+  snapshot_clear_strings(snap, 0);
+  ats_free(snap->entries);
+  snap->entries = NULL;
+  snap->size = 0;
 }
 
 void
@@ -1205,3 +1305,165 @@ RecSignalWarning(int sig, const char * fmt, ...)
   RecSignalManager(sig, msg);
   va_end(args);
 }
+
+#if TS_HAS_TESTS
+
+#include "ts/TestBox.h"
+
+// Records that RecIndex_concurrent registers while other threads read them:
+// even ones are integers of value i, odd ones the string "value-i".
+#define REC_INDEX_TEST_PREFIX "proxy.process.regression.rec_index."
+
+struct RecIndexTest
+{
+  int nrecords;
+  volatile int nregistered;     // records that can be looked up
+  volatile int done;
+  volatile int lookup_failures;
+  volatile int snapshot_failures;
+  volatile int snapshots;
+};
+
+static void
+rec_index_test_name(char *buf, int size, int i)
+{
+  snprintf(buf, size, REC_INDEX_TEST_PREFIX "%d", i);
+}
+
+static void *
+rec_index_test_lookup(void *arg)
+{
+  RecIndexTest *test = (RecIndexTest *) arg;
+  char name[64], value[64], expected[64];
+
+  for (int i = 0; !test->done || i < test->nregistered; i++) {
+    int n = test->nregistered;
+
+    if (n == 0) {
+      continue;
+    }
+    rec_index_test_name(name, sizeof(name), i % n);
+
+    RecRecord *r = RecIndexLookup(name);
+    bool ok = r != NULL && strcmp(r->name, name) == 0;
+
+    if (ok && (i % n) % 2 == 0) {
+      RecInt v;
+      ok = RecGetRecordInt(name, &v) == REC_ERR_OKAY && v == i % n;
+    } else if (ok) {
+      snprintf(expected, sizeof(expected), "value-%d", i % n);
+      ok = RecGetRecordString(name, value, sizeof(value)) == REC_ERR_OKAY && strcmp(value, expected) == 0;
+    }
+    if (!ok) {
+      ink_atomic_increment(&test->lookup_failures, 1);
+    }
+  }
+  return NULL;
+}
+
+static void *
+rec_index_test_snapshot(void *arg)
+{
+  RecIndexTest *test = (RecIndexTest *) arg;
+  RecSnapshot snap;
+  char expected[64];
+
+  while (!test->done) {
+    int n = RecSnapshotRecords(RECT_PROCESS, &snap);
+
+    for (int j = 0; j < n; j++) {
+      RecSnapshotEntry *e = &(snap.entries[j]);
+      int i;
+
+      if (strncmp(e->name, REC_INDEX_TEST_PREFIX, sizeof(REC_INDEX_TEST_PREFIX) - 1) != 0) {
+        continue;
+      }
+      // The type is set before the record is indexed, the value when it is registered
+      i = atoi(e->name + sizeof(REC_INDEX_TEST_PREFIX) - 1);
+      if (i % 2 == 0) {
+        if (e->data_type != RECD_INT || (e->registered && e->data.rec_int != i)) {
+          ink_atomic_increment(&test->snapshot_failures, 1);
+        }
+      } else {
+        snprintf(expected, sizeof(expected), "value-%d", i);
+        if (e->data_type != RECD_STRING ||
+            (e->registered && (e->data.rec_string == NULL || strcmp(e->data.rec_string, expected) != 0))) {
+          ink_atomic_increment(&test->snapshot_failures, 1);
+        }
+      }
+    }
+    ink_atomic_increment(&test->snapshots, 1);
+  }
+  return NULL;
+}
+
+// Register records while other threads look them up by name and take
+// snapshots: every record that was registered must be found, with its
+// value, and no snapshot may see a record with the wrong type or value.
+REGRESSION_TEST(RecIndex_concurrent)(RegressionTest * t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+  RecIndexTest test;
+  ink_thread threads[5];
+  char name[64], value[64];
+  int nthreads = countof(threads);
+
+  box = REGRESSION_TEST_PASSED;
+
+  memset(&test, 0, sizeof(test));
+  // The records stay registered, leave the room that plugins may need
+  test.nrecords = 64;
+  if (REC_MAX_RECORDS - g_num_records < 4 * test.nrecords) {
+    rprintf(t, "only %d records left, skipping\n", REC_MAX_RECORDS - g_num_records);
+    return;
+  }
+
+  for (int i = 0; i < nthreads - 1; i++) {
+    threads[i] = ink_thread_create(rec_index_test_lookup, &test);
+  }
+  threads[nthreads - 1] = ink_thread_create(rec_index_test_snapshot, &test);
+
+  for (int i = 0; i < test.nrecords; i++) {
+    rec_index_test_name(name, sizeof(name), i);
+    if (i % 2 == 0) {
+      RecRegisterStatInt(RECT_PROCESS, name, i, RECP_NON_PERSISTENT);
+    } else {
+      snprintf(value, sizeof(value), "value-%d", i);
+      RecRegisterStatString(RECT_PROCESS, name, value, RECP_NON_PERSISTENT);
+    }
+    ink_atomic_swap(&test.nregistered, i + 1);
+    // let a snapshot run now and then while records are being added
+    if (i % 8 == 7) {
+      int snapshots = test.snapshots;
+      for (int wait = 0; test.snapshots == snapshots && wait < 1000; wait++) {
+        usleep(100);
+      }
+    }
+  }
+
+  ink_atomic_swap(&test.done, 1);
+  for (int i = 0; i < nthreads; i++) {
+    ink_thread_join(threads[i]);
+  }
+
+  box.check(test.lookup_failures == 0, "%d lookups of registered records failed", test.lookup_failures);
+  box.check(test.snapshot_failures == 0, "%d snapshot entries had the wrong type or value", test.snapshot_failures);
+
+  // And a snapshot taken now has all of them, in order
+  RecSnapshot snap;
+  int n = RecSnapshotRecords(RECT_PROCESS, &snap);
+  int next = 0;
+
+  for (int j = 0; j < n; j++) {
+    if (strncmp(snap.entries[j].name, REC_INDEX_TEST_PREFIX, sizeof(REC_INDEX_TEST_PREFIX) - 1) == 0) {
+      rec_index_test_name(name, sizeof(name), next);
+      if (strcmp(snap.entries[j].name, name) == 0 && snap.entries[j].registered) {
+        next++;
+      }
+    }
+  }
+  box.check(next == test.nrecords, "the snapshot has %d of the %d records", next, test.nrecords);
+  rprintf(t, "%d records, %d snapshots taken while registering\n", test.nrecords, test.snapshots);
+}
+
+#endif
@@ -846,8 +846,7 @@ RecRegisterRawStatSyncCb(const char *name, RecRawStatSyncCb sync_cb, RecRawStatB
   int err = REC_ERR_FAIL;
   RecRecord *r;
 
-  ink_rwlock_rdlock(&g_records_rwlock);
-  if (ink_hash_table_lookup(g_records_ht, name, (void **) &r)) {
+  if ((r = RecIndexLookup(name)) != NULL) {
     rec_mutex_acquire(&(r->lock));
     if (REC_TYPE_IS_STAT(r->rec_type)) {
       if (!(r->stat_meta.sync_cb)) {
@@ -862,7 +861,6 @@ RecRegisterRawStatSyncCb(const char *name, RecRawStatSyncCb sync_cb, RecRawStatB
     }
     rec_mutex_release(&(r->lock));
   }
-  ink_rwlock_unlock(&g_records_rwlock);
 
   return err;
 }
@@ -0,0 +1,282 @@
+/** @file
+
+    Compact radix trie for 8-bit string keys.
+
+    Unlike Trie, a node does not have a slot for every byte value. Each node
+    holds the run of key bytes that leads to it from its parent (path
+    compression), and its children are told apart by the first byte of their
+    run, so a node costs a few dozen bytes instead of two kilobytes. Nodes,
+    runs and child arrays are carved out of large chunks: building a trie of
+    a million keys takes a few thousand allocations and Clear() frees them
+    all at once.
+
+    The trie does not own the values it points to.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef _RADIX_TRIE_H
+#define _RADIX_TRIE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ink_assert.h"
+#include "ink_memory.h"
+
+template<typename T>
+class RadixTrie
+{
+public:
+  RadixTrie()
+    : m_chunks(NULL), m_free(NULL), m_avail(0), m_allocated(0), m_count(0)
+  {
+    _ClearNode(&m_root);
+  }
+
+  ~RadixTrie() { Clear(); }
+
+  // will return false for duplicates
+  bool Insert(const char *key, int key_len, T *value, int rank);
+
+  // Of the values whose key is a prefix of (or equal to) key, returns the
+  // one with the lowest rank, or NULL if there is none.
+  T *Search(const char *key, int key_len) const;
+
+  void Clear();
+
+  int Count() const { return m_count; }
+  bool Empty() const { return m_count == 0; }
+  size_t MemoryUsed() const { return m_allocated; }
+
+private:
+  static const size_t CHUNK_SIZE = 64 * 1024;
+
+  struct Node
+  {
+    const char *label;          // key bytes from the parent to this node
+    T *value;
+    int rank;
+    unsigned int label_len;
+    unsigned short nchildren;
+    unsigned short capacity;
+    unsigned char *first;       // first label byte of each child
+    Node **children;
+
+    int FindChild(unsigned char c) const {
+      const unsigned char *p = nchildren ? static_cast<const unsigned char *>(memchr(first, c, nchildren)) : NULL;
+      return p ? p - first : -1;
+    }
+    Node *GetChild(unsigned char c) const {
+      int i = FindChild(c);
+      return i < 0 ? NULL : children[i];
+    }
+  };
+
+  struct Chunk
+  {
+    Chunk *next;
+  };
+
+  Node m_root;
+  Chunk *m_chunks;
+  char *m_free;
+  size_t m_avail;
+  size_t m_allocated;
+  int m_count;
+
+  void *_Alloc(size_t size, size_t alignment);
+  Node *_NewNode(const char *label, unsigned int label_len);
+  void _AddChild(Node *parent, Node *child);
+
+  static void _ClearNode(Node *node) {
+    memset(node, 0, sizeof(*node));
+  }
+
+  // make copy-constructor and assignment operator private
+  // till we properly implement them
+  RadixTrie(const RadixTrie<T> &);
+  RadixTrie &operator =(const RadixTrie<T> &);
+};
+
+template<typename T>
+void *
+RadixTrie<T>::_Alloc(size_t size, size_t alignment)
+{
+  size_t pad = (alignment - (reinterpret_cast<uintptr_t>(m_free) & (alignment - 1))) & (alignment - 1);
+
+  if (m_free == NULL || pad + size > m_avail) {
+    size_t chunk_size = CHUNK_SIZE;
+
+    if (size + sizeof(double) > CHUNK_SIZE - sizeof(Chunk)) {
+      chunk_size = size + sizeof(double) + sizeof(Chunk);
+    }
+    Chunk *chunk = static_cast<Chunk *>(ats_malloc(chunk_size));
+    chunk->next = m_chunks;
+    m_chunks = chunk;
+    m_allocated += chunk_size;
+    // Chunk is pointer sized, so this is aligned for a pointer
+    m_free = reinterpret_cast<char *>(chunk + 1);
+    m_avail = chunk_size - sizeof(Chunk);
+    pad = (alignment - (reinterpret_cast<uintptr_t>(m_free) & (alignment - 1))) & (alignment - 1);
+  }
+
+  void *mem = m_free + pad;
+  m_free += pad + size;
+  m_avail -= pad + size;
+  return mem;
+}
+
+template<typename T>
+typename RadixTrie<T>::Node *
+RadixTrie<T>::_NewNode(const char *label, unsigned int label_len)
+{
+  Node *node = static_cast<Node *>(_Alloc(sizeof(Node), sizeof(void *)));
+
+  _ClearNode(node);
+  node->label = label;
+  node->label_len = label_len;
+  return node;
+}
+
+template<typename T>
+void
+RadixTrie<T>::_AddChild(Node *parent, Node *child)
+{
+  // A child per byte value at most, so 256 entries are always enough. The
+  // arrays that are outgrown stay in their chunk until Clear().
+  if (parent->nchildren == parent->capacity) {
+    unsigned short capacity = parent->capacity ? parent->capacity * 2 : 2;
+    // one block, so that the bytes and the pointers share cache lines
+    Node **children = static_cast<Node **>(_Alloc(capacity * (sizeof(Node *) + 1), sizeof(void *)));
+    unsigned char *first = reinterpret_cast<unsigned char *>(children + capacity);
+
+    if (parent->nchildren) {
+      memcpy(first, parent->first, parent->nchildren);
+      memcpy(children, parent->children, parent->nchildren * sizeof(Node *));
+    }
+    parent->first = first;
+    parent->children = children;
+    parent->capacity = capacity;
+  }
+  ink_assert(parent->nchildren < 256);
+  parent->first[parent->nchildren] = static_cast<unsigned char>(child->label[0]);
+  parent->children[parent->nchildren] = child;
+  parent->nchildren++;
+}
+
+template<typename T>
+bool
+RadixTrie<T>::Insert(const char *key, int key_len, T *value, int rank)
+{
+  Node *node = &m_root;
+  int i = 0;
+
+  ink_assert(key_len >= 0 && value != NULL);
+
+  while (i < key_len) {
+    Node *child = node->GetChild(key[i]);
+
+    if (!child) {
+      // the run goes right after the node, where the search reads it next
+      child = _NewNode(NULL, key_len - i);
+      child->label = static_cast<char *>(_Alloc(key_len - i, 1));
+      memcpy(const_cast<char *>(child->label), key + i, key_len - i);
+      _AddChild(node, child);
+      node = child;
+      break;
+    }
+
+    unsigned int n = key_len - i;
+    unsigned int k = 1;
+
+    if (n > child->label_len) {
+      n = child->label_len;
+    }
+    while (k < n && child->label[k] == key[i + k]) {
+      ++k;
+    }
+
+    if (k < child->label_len) {
+      // The key leaves (or ends inside) the child's run: split the run at k.
+      Node *mid = _NewNode(child->label, k);
+
+      node->children[node->FindChild(key[i])] = mid;
+      child->label += k;
+      child->label_len -= k;
+      _AddChild(mid, child);
+      child = mid;
+    }
+    node = child;
+    i += k;
+  }
+
+  if (node->value) {
+    return false;
+  }
+  node->value = value;
+  node->rank = rank;
+  ++m_count;
+  return true;
+}
+
+template<typename T>
+T *
+RadixTrie<T>::Search(const char *key, int key_len) const
+{
+  const Node *found = NULL;
+  const Node *node = &m_root;
+  int i = 0;
+
+  for (;;) {
+    if (node->value && (!found || node->rank <= found->rank)) {
+      found = node;
+    }
+    if (i == key_len) {
+      break;
+    }
+    node = node->GetChild(key[i]);
+    if (!node || node->label_len > static_cast<unsigned int>(key_len - i) ||
+        memcmp(node->label, key + i, node->label_len) != 0) {
+      break;
+    }
+    i += node->label_len;
+  }
+
+  return found ? found->value : NULL;
+}
+
+template<typename T>
+void
+RadixTrie<T>::Clear()
+{
+  while (m_chunks) {
+    Chunk *next = m_chunks->next;
+
+    ats_free(m_chunks);
+    m_chunks = next;
+  }
+  _ClearNode(&m_root);
+  m_free = NULL;
+  m_avail = 0;
+  m_allocated = 0;
+  m_count = 0;
+}
+
+#endif // _RADIX_TRIE_H
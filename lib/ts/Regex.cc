@@ -31,7 +31,7 @@ DFA::~DFA()
 
   while(p) {
     if (p->_pe)
-      pcre_free(p->_pe);
+      regex_free_study(p->_pe);
     if (p->_re)
       pcre_free(p->_re);
     if(p->_p)
@@ -62,7 +62,7 @@ DFA::build(const char *pattern, REFlags flags)
     return NULL;
   }
 
-  ret->_pe = pcre_study(ret->_re, 0, &error);
+  ret->_pe = pcre_study(ret->_re, RE_STUDY_OPTIONS, &error);
 
   if (error) {
     ats_free(ret);
@@ -144,3 +144,381 @@ DFA::match(const char *str, int length) const
 
   return -1;
 }
+
+RegexPrefilter::Matches::~Matches()
+{
+  if (_bits != _inline)
+    ats_free(_bits);
+}
+
+void
+RegexPrefilter::Matches::reset(int npatterns)
+{
+  int nwords = (npatterns + 63) / 64;
+
+  if (nwords > (int) countof(_inline) && nwords > _nwords) {
+    if (_bits != _inline)
+      ats_free(_bits);
+    _bits = (uint64_t *) ats_malloc(nwords * sizeof(uint64_t));
+  }
+  _nwords = nwords;
+}
+
+RegexPrefilter::RegexPrefilter()
+  : _npatterns(0), _patterns_size(0), _literals(NULL), _compiled(0), _nstates(0), _nclasses(0),
+    _delta(NULL), _report(NULL), _dict(NULL), _out_first(NULL), _out_next(NULL), _out_id(NULL), _always(NULL)
+{
+  memset(_classes, 0, sizeof(_classes));
+}
+
+RegexPrefilter::~RegexPrefilter()
+{
+  for (int i = 0; i < _npatterns; i++)
+    ats_free(_literals[i]);
+  ats_free(_literals);
+  clear_automaton();
+}
+
+void
+RegexPrefilter::clear_automaton()
+{
+  ats_free(_delta);
+  ats_free(_report);
+  ats_free(_dict);
+  ats_free(_out_first);
+  ats_free(_out_next);
+  ats_free(_out_id);
+  ats_free(_always);
+  _delta = _report = _dict = _out_first = _out_next = _out_id = NULL;
+  _always = NULL;
+  _compiled = _nstates = _nclasses = 0;
+}
+
+// Skip the group or character class starting at @a p, returns the character after it.
+static const char *
+regex_skip(const char *p)
+{
+  int depth = 0;
+  bool in_class = false;
+
+  for (; *p; p++) {
+    if (*p == '\\') {
+      if (!*++p)
+        break;
+    } else if (in_class) {
+      if (*p == ']')
+        in_class = false;
+    } else if (*p == '[') {
+      in_class = true;
+      // a ] right after [ or [^ belongs to the class
+      if (p[1] == '^')
+        p++;
+      if (p[1] == ']')
+        p++;
+    } else if (*p == '(') {
+      depth++;
+    } else if (*p == ')') {
+      if (--depth == 0)
+        return p + 1;
+    }
+    if (!in_class && depth == 0)
+      return p + 1;
+  }
+  return p;
+}
+
+// Skip the @a close terminated argument of an escape, NULL if it is not terminated.
+static const char *
+regex_skip_arg(const char *p, char close)
+{
+  p = strchr(p + 1, close);
+  return p ? p + 1 : NULL;
+}
+
+// Skip the alphanumeric escape starting at @a p, returns the character after it or NULL
+// if its argument can't be parsed. None of these match a known literal.
+static const char *
+regex_skip_escape(const char *p)
+{
+  char e = p[1];
+
+  p += 2;
+  if (strchr("dDwWsShHvVRbBAzZGXCKEtnrfea", e))
+    return p;
+  if (ParseRules::is_digit(e)) {
+    // octal character or back reference
+    while (ParseRules::is_digit(*p))
+      p++;
+    return p;
+  }
+
+  switch (e) {
+  case 'x':
+    if (*p == '{')
+      return regex_skip_arg(p, '}');
+    for (int i = 0; i < 2 && ParseRules::is_hex(*p); i++)
+      p++;
+    return p;
+  case 'o':
+    return *p == '{' ? regex_skip_arg(p, '}') : NULL;
+  case 'c':
+    return *p ? p + 1 : NULL;
+  case 'p':
+  case 'P':
+    if (*p == '{')
+      return regex_skip_arg(p, '}');
+    return ParseRules::is_alpha(*p) ? p + 1 : NULL;
+  case 'N':
+    return *p == '{' ? regex_skip_arg(p, '}') : p;
+  case 'g':
+    if (*p == '+' || *p == '-')
+      p++;
+    if (ParseRules::is_digit(*p)) {
+      while (ParseRules::is_digit(*p))
+        p++;
+      return p;
+    }
+    // fall through, \g{..}, \g<..> and \g'..' take the same arguments as \k
+  case 'k':
+    if (*p == '{')
+      return regex_skip_arg(p, '}');
+    if (*p == '<')
+      return regex_skip_arg(p, '>');
+    if (*p == '\'')
+      return regex_skip_arg(p, '\'');
+    return NULL;
+  default:
+    return NULL;
+  }
+}
+
+int
+RegexPrefilter::extract_literal(const char *pattern, char *buf, int size)
+{
+  char *run = (char *) alloca(size);
+  int run_len = 0, best_len = 0;
+  bool last_literal = false;    // the last character of run was just added
+  const char *p;
+
+  // Extended syntax and quoting would need a real parser, take no chances.
+  if (strstr(pattern, "\\Q"))
+    return 0;
+  for (p = strstr(pattern, "(?"); p; p = strstr(p + 2, "(?")) {
+    for (const char *o = p + 2; *o && *o != ')' && *o != ':'; o++) {
+      if (*o == 'x')
+        return 0;
+    }
+  }
+
+  p = pattern;
+  while (*p) {
+    int c = -1;
+
+    switch (*p) {
+    case '|':
+      return 0;                 // alternatives at the top level, nothing is required
+    case '?':
+    case '*':
+    case '{':
+      // the previous character may not be there at all
+      if (last_literal)
+        run_len--;
+      if (*p == '{' && strchr(p, '}'))
+        p = strchr(p, '}');
+      p++;
+      break;
+    case '(':
+    case '[':
+      p = regex_skip(p);
+      break;
+    case '\\':
+      if (!p[1]) {
+        p++;
+      } else if (!ParseRules::is_alnum(p[1])) {
+        c = p[1];
+        p += 2;
+      } else if (!(p = regex_skip_escape(p))) {
+        return 0;
+      }
+      break;
+    case '+':
+    case '.':
+    case '^':
+    case '$':
+    case ')':
+      p++;
+      break;
+    default:
+      c = *p++;
+      break;
+    }
+
+    if (c >= 0 && run_len < size) {
+      run[run_len++] = ParseRules::ink_tolower(c);
+      last_literal = true;
+      continue;
+    }
+
+    if (run_len > best_len) {
+      best_len = run_len;
+      memcpy(buf, run, run_len);
+    }
+    run_len = 0;
+    last_literal = false;
+  }
+
+  if (run_len > best_len) {
+    best_len = run_len;
+    memcpy(buf, run, run_len);
+  }
+  return best_len;
+}
+
+int
+RegexPrefilter::add(const char *pattern)
+{
+  char buf[1024];
+  int len = extract_literal(pattern, buf, sizeof(buf));
+
+  if (_npatterns == _patterns_size) {
+    _patterns_size = _patterns_size ? _patterns_size * 2 : 16;
+    _literals = (char **) ats_realloc(_literals, _patterns_size * sizeof(char *));
+  }
+  _literals[_npatterns] = len ? ats_strndup(buf, len) : NULL;
+  return _npatterns++;
+}
+
+void
+RegexPrefilter::compile()
+{
+  int nwords = (_npatterns + 63) / 64;
+  int max_states = 1;
+  int nout = 0;
+  int i;
+
+  clear_automaton();
+  memset(_classes, 0, sizeof(_classes));
+
+  // Input classes: one per character in the literals, 0 for all others.
+  _nclasses = 1;
+  for (i = 0; i < _npatterns; i++) {
+    if (!_literals[i])
+      continue;
+    for (const char *l = _literals[i]; *l; l++) {
+      uint8_t c = (uint8_t) *l;
+
+      if (!_classes[c]) {
+        _classes[c] = _nclasses;
+        _classes[(uint8_t) ParseRules::ink_toupper(c)] = _nclasses;
+        _nclasses++;
+      }
+    }
+    max_states += strlen(_literals[i]);
+    nout++;
+  }
+
+  _delta = (int32_t *) ats_malloc(max_states * _nclasses * sizeof(int32_t));
+  _report = (int32_t *) ats_malloc(max_states * sizeof(int32_t));
+  _dict = (int32_t *) ats_malloc(max_states * sizeof(int32_t));
+  _out_first = (int32_t *) ats_malloc(max_states * sizeof(int32_t));
+  _out_next = (int32_t *) ats_malloc((nout + 1) * sizeof(int32_t));
+  _out_id = (int32_t *) ats_malloc((nout + 1) * sizeof(int32_t));
+  _always = (uint64_t *) ats_malloc((nwords + 1) * sizeof(uint64_t));
+  memset(_always, 0, (nwords + 1) * sizeof(uint64_t));
+
+  // The trie of the literals, -1 for no transition yet.
+  _nstates = 1;
+  memset(_delta, -1, _nclasses * sizeof(int32_t));
+  _out_first[0] = -1;
+  nout = 0;
+  for (i = 0; i < _npatterns; i++) {
+    int32_t s = 0;
+
+    if (!_literals[i]) {
+      _always[i / 64] |= (uint64_t) 1 << (i % 64);
+      continue;
+    }
+    for (const char *l = _literals[i]; *l; l++) {
+      int32_t *next = &_delta[s * _nclasses + _classes[(uint8_t) *l]];
+
+      if (*next < 0) {
+        *next = _nstates;
+        memset(&_delta[_nstates * _nclasses], -1, _nclasses * sizeof(int32_t));
+        _out_first[_nstates] = -1;
+        _nstates++;
+      }
+      s = *next;
+    }
+    _out_id[nout] = i;
+    _out_next[nout] = _out_first[s];
+    _out_first[s] = nout++;
+  }
+
+  // Breadth first, complete the transitions through the suffix links. The
+  // states are numbered in insertion order, not by depth, so use a queue.
+  int32_t *queue = (int32_t *) ats_malloc(_nstates * sizeof(int32_t));
+  int32_t *fail = (int32_t *) ats_malloc(_nstates * sizeof(int32_t));
+  int head = 0, tail = 0;
+
+  _report[0] = _dict[0] = 0;
+  for (int c = 0; c < _nclasses; c++) {
+    int32_t t = _delta[c];
+
+    if (t < 0) {
+      _delta[c] = 0;
+    } else {
+      fail[t] = 0;
+      _dict[t] = 0;
+      _report[t] = _out_first[t] >= 0 ? t : 0;
+      queue[tail++] = t;
+    }
+  }
+  while (head < tail) {
+    int32_t s = queue[head++];
+
+    for (int c = 0; c < _nclasses; c++) {
+      int32_t t = _delta[s * _nclasses + c];
+
+      if (t < 0) {
+        _delta[s * _nclasses + c] = _delta[fail[s] * _nclasses + c];
+      } else {
+        fail[t] = _delta[fail[s] * _nclasses + c];
+        _dict[t] = _report[fail[t]];
+        _report[t] = _out_first[t] >= 0 ? t : _dict[t];
+        queue[tail++] = t;
+      }
+    }
+  }
+  ats_free(queue);
+  ats_free(fail);
+
+  _compiled = _npatterns;
+}
+
+void
+RegexPrefilter::scan(const char *str, int length, Matches &m) const
+{
+  m.reset(_npatterns);
+
+  if (_compiled == 0) {
+    memset(m._bits, 0xff, m._nwords * sizeof(uint64_t));
+    return;
+  }
+
+  memcpy(m._bits, _always, m._nwords * sizeof(uint64_t));
+  // patterns added after compile() are always candidates
+  for (int i = _compiled; i < _npatterns; i++)
+    m.set(i);
+
+  const uint8_t *s = (const uint8_t *) str;
+  const uint8_t *e = s + length;
+  int32_t state = 0;
+
+  for (; s < e; s++) {
+    state = _delta[state * _nclasses + _classes[*s]];
+    for (int32_t t = _report[state]; t; t = _dict[t]) {
+      for (int32_t o = _out_first[t]; o >= 0; o = _out_next[o])
+        m.set(_out_id[o]);
+    }
+  }
+}
@@ -24,6 +24,8 @@
 #ifndef __TS_REGEX_H__
 #define __TS_REGEX_H__
 
+#include <stdint.h>
+
 #ifdef HAVE_PCRE_PCRE_H
 #include <pcre/pcre.h>
 #else
@@ -36,6 +38,24 @@ enum REFlags
   RE_CASE_INSENSITIVE = 1
 };
 
+// Study patterns with the PCRE JIT where it is available. Study data has to be
+// released with regex_free_study() then.
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define RE_STUDY_OPTIONS PCRE_STUDY_JIT_COMPILE
+#else
+#define RE_STUDY_OPTIONS 0
+#endif
+
+inline void
+regex_free_study(pcre_extra *extra)
+{
+#ifdef PCRE_STUDY_JIT_COMPILE
+  pcre_free_study(extra);
+#else
+  pcre_free(extra);
+#endif
+}
+
 typedef struct __pat {
   int _idx;
   pcre *_re;
@@ -63,5 +83,75 @@ private:
   dfa_pattern * _my_patterns;
 };
 
+/**
+  Prefilter for an ordered list of regular expressions.
+
+  For each pattern the longest literal string that every match of it has to
+  contain is extracted, and all of these are compiled in one Aho-Corasick
+  automaton. A single pass over a subject then tells which of the patterns can
+  match it at all, so the caller only runs PCRE on those, still in order, which
+  keeps the first match wins rule and the captures of the matching pattern.
+
+  Patterns without such a literal (e.g. top level alternation) are candidates
+  for every subject. The automaton ignores case, so caseless patterns work too.
+*/
+class RegexPrefilter
+{
+public:
+  /// The candidates for one subject, a bit per pattern id.
+  class Matches
+  {
+  public:
+    Matches():_bits(_inline), _nwords(0) { }
+    ~Matches();
+
+    bool test(int id) const { return id < 0 || (_bits[id / 64] >> (id % 64)) & 1; }
+
+  private:
+    friend class RegexPrefilter;
+
+    void reset(int npatterns);
+    void set(int id) { _bits[id / 64] |= (uint64_t) 1 << (id % 64); }
+
+    uint64_t _inline[16];
+    uint64_t *_bits;
+    int _nwords;
+  };
+
+  RegexPrefilter();
+  ~RegexPrefilter();
+
+  /// Add the next pattern, returns its id (patterns are numbered from 0 in the order they are added).
+  int add(const char *pattern);
+  /// Build the automaton. Patterns added later are candidates for every subject.
+  void compile();
+
+  /// Find the candidate patterns for @a str.
+  void scan(const char *str, int length, Matches &m) const;
+
+  int count() const { return _npatterns; }
+
+  /// Copy the literal that every match of @a pattern contains to @a buf, returns its length (0 if none).
+  static int extract_literal(const char *pattern, char *buf, int size);
+
+private:
+  int _npatterns;
+  int _patterns_size;
+  char **_literals;             // per pattern, NULL if it has none
+
+  int _compiled;                // patterns covered by the automaton
+  int _nstates;
+  int _nclasses;
+  uint8_t _classes[256];        // byte -> input class, case folded
+  int32_t *_delta;              // [state * _nclasses + class] -> state
+  int32_t *_report;             // state -> first state with output along the suffix links, 0 if none
+  int32_t *_dict;               // state -> next state with output along the suffix links
+  int32_t *_out_first;          // state -> first entry in _out_id, -1 if none
+  int32_t *_out_next;
+  int32_t *_out_id;
+  uint64_t *_always;            // patterns without a literal
+
+  void clear_automaton();
+};
 
 #endif /* __TS_REGEX_H__ */
@@ -169,6 +169,18 @@ ink_atomic_decrement(pvuint64 mem, Amount value) {
 #define INK_WRITE_MEMORY_BARRIER
 #define INK_MEMORY_BARRIER
 
+/* Hint to the CPU that this is a spin-wait loop. */
+static inline void
+ink_pause()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+  __asm__ __volatile__("yield");
+#else
+  __asm__ __volatile__("" ::: "memory");
+#endif
+}
 
 #else /* not gcc > v4.1.2 */
 #error Need a compiler / libc that supports atomic operations, e.g. gcc v4.1.2 or later
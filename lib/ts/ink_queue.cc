@@ -43,6 +43,9 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/mman.h>
+#if defined(linux)
+#include <sys/syscall.h>
+#endif
 #include "ink_atomic.h"
 #include "ink_queue.h"
 #include "ink_memory.h"
@@ -50,6 +53,7 @@
 #include "ink_assert.h"
 #include "ink_queue_ext.h"
 #include "ink_align.h"
+#include "ink_thread.h"
 
 inkcoreapi volatile int64_t fastalloc_mem_in_use = 0;
 inkcoreapi volatile int64_t fastalloc_mem_total = 0;
@@ -77,9 +81,302 @@ ink_freelist_list *freelists = NULL;
 
 inkcoreapi volatile int64_t freelist_allocated_mem = 0;
 
+inkcoreapi int ink_freelist_magazines = 1;
+
 #define fl_memadd(_x_) \
    ink_atomic_increment(&freelist_allocated_mem, (int64_t) (_x_));
 
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+/*
+ * Per-thread magazines
+ *
+ * Every thread keeps two magazines of free objects per freelist, as in
+ * Bonwick's magazine allocator, and allocates from and frees to them
+ * without any atomic operation. When both are empty or both are full,
+ * a whole magazine is traded with a depot of full magazines, so the
+ * shared list is touched once per magazine_size objects instead of
+ * once per object. There is a depot per NUMA node, threads trade with
+ * the depot of the node they are running on. The magazines of a type
+ * grow when its depots are contended.
+ */
+
+#define MAGAZINE_MAX_ROUNDS      64
+#define MAGAZINE_INITIAL_ROUNDS  8
+#define MAGAZINE_MAX_BYTES       (64 * 1024)   // don't cache more than this per magazine
+#define MAGAZINE_MAX_CACHES      1024          // freelists that can use magazines
+#define MAGAZINE_RESIZE_INTERVAL 1024          // exchanges between resize decisions
+#define MAGAZINE_NODE_REFRESH    256           // depot visits before a thread looks up its node again
+
+struct InkMagazine
+{
+  void *next;                   // link in a depot, must be first
+  uint32_t rounds;
+  void *round[MAGAZINE_MAX_ROUNDS];
+};
+
+struct InkMagazineCache
+{
+  InkFreeList *f;
+  InkMagazine *loaded;
+  InkMagazine *previous;
+};
+
+static uint32_t nr_magazine_caches;
+static InkAtomicList magazine_pool;     // empty magazines, shared by all types
+static ink_thread_key magazine_key;
+static pthread_once_t magazine_once = PTHREAD_ONCE_INIT;
+static __thread InkMagazineCache *magazine_caches;
+// Set once the caches of this thread are gone, what it frees after that goes to the list.
+static __thread bool magazine_thread_exited;
+// NUMA node this thread last ran on, and depot visits since it was looked up.
+static __thread int magazine_node = -1;
+static __thread uint32_t magazine_node_age;
+
+static void *freelist_new(InkFreeList * f);
+static void freelist_free(InkFreeList * f, void *item);
+
+// Push @a m on @a l, returning the number of times the CAS lost a race.
+static uint32_t
+magazine_push(InkAtomicList * l, InkMagazine * m)
+{
+  head_p head;
+  head_p item_pair;
+  uint32_t retries = 0;
+
+  for (;;) {
+    INK_QUEUE_LD(head, l->head);
+    m->next = FREELIST_POINTER(head);
+    SET_FREELIST_POINTER_VERSION(item_pair, FROM_PTR(m), FREELIST_VERSION(head));
+    INK_MEMORY_BARRIER;
+#if TS_HAS_128BIT_CAS
+    if (ink_atomic_cas((__int128_t*) & l->head.data, head.data, item_pair.data))
+#else
+    if (ink_atomic_cas((int64_t *) & l->head.data, head.data, item_pair.data))
+#endif
+      return retries;
+    ++retries;
+  }
+}
+
+// Pop a magazine from @a l, adding the lost CAS races to @a retries.
+static InkMagazine *
+magazine_pop(InkAtomicList * l, uint32_t * retries)
+{
+  head_p item;
+  head_p next;
+
+  for (;;) {
+    INK_QUEUE_LD(item, l->head);
+    InkMagazine *m = (InkMagazine *) TO_PTR(FREELIST_POINTER(item));
+    if (m == NULL)
+      return NULL;
+    SET_FREELIST_POINTER_VERSION(next, m->next, FREELIST_VERSION(item) + 1);
+#if TS_HAS_128BIT_CAS
+    if (ink_atomic_cas((__int128_t*) & l->head.data, item.data, next.data))
+#else
+    if (ink_atomic_cas((int64_t *) & l->head.data, item.data, next.data))
+#endif
+      return m;
+    ++*retries;
+  }
+}
+
+static InkMagazine *
+magazine_get()
+{
+  uint32_t retries = 0;
+  InkMagazine *m = magazine_pop(&magazine_pool, &retries);
+
+  if (m == NULL)
+    m = (InkMagazine *) ats_malloc(sizeof(InkMagazine));
+  m->rounds = 0;
+  return m;
+}
+
+static void
+magazine_put(InkMagazine * m)
+{
+  magazine_push(&magazine_pool, m);
+}
+
+// Depot of the NUMA node the calling thread is running on. The node is
+// cached per thread and looked up again only now and then, threads
+// rarely move between nodes.
+static inline int
+magazine_depot()
+{
+  if (unlikely(magazine_node < 0 || ++magazine_node_age >= MAGAZINE_NODE_REFRESH)) {
+    magazine_node = 0;
+    magazine_node_age = 0;
+#if defined(linux) && defined(SYS_getcpu)
+    unsigned cpu, node;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+      magazine_node = node % INK_FREELIST_DEPOTS;
+#endif
+  }
+  return magazine_node;
+}
+
+// Give the magazines of an exiting thread back.
+static void
+magazine_caches_free(void *data)
+{
+  InkMagazineCache *caches = (InkMagazineCache *) data;
+
+  // Other thread specific destructors may still allocate or free.
+  magazine_caches = NULL;
+  magazine_thread_exited = true;
+  for (uint32_t i = 0; i < MAGAZINE_MAX_CACHES; i++) {
+    InkMagazineCache *c = &caches[i];
+    InkMagazine *mags[2] = { c->loaded, c->previous };
+
+    for (int j = 0; j < 2; j++) {
+      if (mags[j] == NULL)
+        continue;
+      while (mags[j]->rounds)
+        freelist_free(c->f, mags[j]->round[--mags[j]->rounds]);
+      magazine_put(mags[j]);
+    }
+  }
+  ats_free(caches);
+}
+
+static void
+magazine_once_init()
+{
+  ink_atomiclist_init(&magazine_pool, "magazines", 0);
+  ink_thread_key_create(&magazine_key, magazine_caches_free);
+}
+
+static void
+magazine_init(InkFreeList * f)
+{
+  uint32_t max_rounds = MAGAZINE_MAX_BYTES / f->type_size;
+
+  // Allocators can be created by any thread, at any time.
+  pthread_once(&magazine_once, magazine_once_init);
+
+  f->magazine_idx = ink_atomic_increment(&nr_magazine_caches, 1);
+  f->magazine_max = max_rounds < MAGAZINE_MAX_ROUNDS ? max_rounds : MAGAZINE_MAX_ROUNDS;
+  // Objects too large to cache more than one at a time go straight to the list.
+  if (f->magazine_idx >= MAGAZINE_MAX_CACHES || f->magazine_max < 2)
+    f->magazine_size = 0;
+  else
+    f->magazine_size = f->magazine_max < MAGAZINE_INITIAL_ROUNDS ? f->magazine_max : MAGAZINE_INITIAL_ROUNDS;
+  f->depot_exchanges = 0;
+  f->depot_misses = 0;
+  f->depot_contention = 0;
+  f->contention_mark = 0;
+  for (int i = 0; i < INK_FREELIST_DEPOTS; i++)
+    ink_atomiclist_init(&f->depot[i], f->name, 0);
+}
+
+static inline InkMagazineCache *
+magazine_cache(InkFreeList * f)
+{
+  InkMagazineCache *caches = magazine_caches;
+  InkMagazineCache *c;
+
+  if (!f->magazine_size || !ink_freelist_magazines || unlikely(magazine_thread_exited))
+    return NULL;
+  if (unlikely(caches == NULL)) {
+    caches = (InkMagazineCache *) ats_calloc(MAGAZINE_MAX_CACHES, sizeof(InkMagazineCache));
+    magazine_caches = caches;
+    ink_thread_setspecific(magazine_key, caches);
+  }
+  c = &caches[f->magazine_idx];
+  if (unlikely(c->loaded == NULL)) {
+    c->f = f;
+    c->loaded = magazine_get();
+    c->previous = magazine_get();
+  }
+  return c;
+}
+
+// Account for a magazine traded with a depot. Every MAGAZINE_RESIZE_INTERVAL
+// exchanges, double the magazines of the type if more than 1 in 16 of the
+// exchanges lost a CAS race, so that it goes to its depots less often.
+static void
+magazine_exchanged(InkFreeList * f, uint32_t retries)
+{
+  uint64_t n = ink_atomic_increment(&f->depot_exchanges, 1) + 1;
+
+  if (retries)
+    ink_atomic_increment(&f->depot_contention, retries);
+  if (n % MAGAZINE_RESIZE_INTERVAL == 0) {
+    uint64_t contention = f->depot_contention;
+    uint64_t mark = ink_atomic_swap(&f->contention_mark, contention);
+    uint32_t size = f->magazine_size;
+
+    // Threads fill and empty their magazines with the size they read, so a
+    // lost race here only leaves it to the next interval.
+    if (contention - mark > MAGAZINE_RESIZE_INTERVAL / 16 && size < f->magazine_max)
+      ink_atomic_cas(&f->magazine_size, size, size * 2 < f->magazine_max ? size * 2 : f->magazine_max);
+  }
+}
+
+// Both magazines are empty (or the loaded one is and the previous one is full).
+static void *
+magazine_alloc(InkFreeList * f, InkMagazineCache * c)
+{
+  InkMagazine *m = c->previous;
+
+  if (m->rounds) {
+    c->previous = c->loaded;
+    c->loaded = m;
+    return m->round[--m->rounds];
+  }
+
+  uint32_t retries = 0;
+  int depot = magazine_depot();
+
+  // Prefer the depot of this node, but take from the others before growing the list.
+  m = NULL;
+  for (int i = 0; i < INK_FREELIST_DEPOTS && m == NULL; i++)
+    m = magazine_pop(&f->depot[(depot + i) % INK_FREELIST_DEPOTS], &retries);
+
+  if (m) {
+    ink_atomic_increment((int *) &f->used, m->rounds);
+    ink_atomic_increment(&fastalloc_mem_in_use, (int64_t) m->rounds * f->type_size);
+    magazine_put(c->previous);
+    c->previous = c->loaded;
+    c->loaded = m;
+    magazine_exchanged(f, retries);
+  } else {
+    uint32_t size = f->magazine_size;
+
+    m = c->loaded;
+    ink_atomic_increment(&f->depot_misses, 1);
+    while (m->rounds < size)
+      m->round[m->rounds++] = freelist_new(f);
+  }
+  return m->round[--m->rounds];
+}
+
+// The loaded magazine is full.
+static void
+magazine_free(InkFreeList * f, InkMagazineCache * c, void *item)
+{
+  InkMagazine *m = c->previous;
+
+  if (m->rounds == 0) {
+    c->previous = c->loaded;
+    c->loaded = m;
+  } else {
+    uint32_t rounds = m->rounds;
+    uint32_t retries = magazine_push(&f->depot[magazine_depot()], m);
+
+    ink_atomic_increment((int *) &f->used, -(int) rounds);
+    ink_atomic_increment(&fastalloc_mem_in_use, -(int64_t) rounds * f->type_size);
+    c->previous = c->loaded;
+    c->loaded = magazine_get();
+    magazine_exchanged(f, retries);
+  }
+  c->loaded->round[c->loaded->rounds++] = item;
+}
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
 void
 ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
                   uint32_t chunk_size, uint32_t alignment)
@@ -111,6 +408,9 @@ ink_freelist_init(InkFreeList **fl, const char *name, uint32_t type_size,
   f->allocated = 0;
   f->allocated_base = 0;
   f->used_base = 0;
+#if TS_USE_FREELIST
+  magazine_init(f);
+#endif
   *fl = f;
 #endif
 }
@@ -139,6 +439,29 @@ ink_freelist_new(InkFreeList * f)
 #if TS_USE_RECLAIMABLE_FREELIST
   return reclaimable_freelist_new(f);
 #else
+  InkMagazineCache *c = magazine_cache(f);
+
+  if (c) {
+    InkMagazine *m = c->loaded;
+    return m->rounds ? m->round[--m->rounds] : magazine_alloc(f, c);
+  }
+  return freelist_new(f);
+#endif /* TS_USE_RECLAIMABLE_FREELIST */
+#else // ! TS_USE_FREELIST
+  void *newp = NULL;
+
+  if (f->alignment)
+    newp = ats_memalign(f->alignment, f->type_size);
+  else
+    newp = ats_malloc(f->type_size);
+  return newp;
+#endif
+}
+
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+static void *
+freelist_new(InkFreeList * f)
+{
   head_p item;
   head_p next;
   int result = 0;
@@ -185,7 +508,7 @@ ink_freelist_new(InkFreeList * f)
         for (int j = 0; j < (int)type_size; j++)
           a[j] = str[j % 4];
 #endif
-        ink_freelist_free(f, a);
+        freelist_free(f, a);
 #ifdef MEMPROTECT
         if (f->type_size >= MEMPROTECT_SIZE) {
           a += type_size - page_size;
@@ -227,17 +550,9 @@ ink_freelist_new(InkFreeList * f)
   ink_atomic_increment(&fastalloc_mem_in_use, (int64_t) f->type_size);
 
   return TO_PTR(FREELIST_POINTER(item));
-#endif /* TS_USE_RECLAIMABLE_FREELIST */
-#else // ! TS_USE_FREELIST
-  void *newp = NULL;
-
-  if (f->alignment)
-    newp = ats_memalign(f->alignment, f->type_size);
-  else
-    newp = ats_malloc(f->type_size);
-  return newp;
-#endif
 }
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
+
 typedef volatile void *volatile_void_p;
 
 void
@@ -247,6 +562,37 @@ ink_freelist_free(InkFreeList * f, void *item)
 #if TS_USE_RECLAIMABLE_FREELIST
   return reclaimable_freelist_free(f, item);
 #else
+  InkMagazineCache *c = magazine_cache(f);
+
+  if (c) {
+    InkMagazine *m = c->loaded;
+
+#ifdef DEADBEEF
+    static const char str[4] = { (char) 0xde, (char) 0xad, (char) 0xbe, (char) 0xef };
+
+    for (int j = 0; j < (int)f->type_size; j++)
+      ((char*)item)[j] = str[j % 4];
+#endif /* DEADBEEF */
+    if (m->rounds < f->magazine_size)
+      m->round[m->rounds++] = item;
+    else
+      magazine_free(f, c, item);
+    return;
+  }
+  freelist_free(f, item);
+#endif /* TS_USE_RECLAIMABLE_FREELIST */
+#else
+  if (f->alignment)
+    ats_memalign_free(item);
+  else
+    ats_free(item);
+#endif
+}
+
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+static void
+freelist_free(InkFreeList * f, void *item)
+{
   volatile_void_p *adr_of_next = (volatile_void_p *) ADDRESS_OF_NEXT(item, 0);
   head_p h;
   head_p item_pair;
@@ -286,14 +632,8 @@ ink_freelist_free(InkFreeList * f, void *item)
 
   ink_atomic_increment((int *) &f->used, -1);
   ink_atomic_increment(&fastalloc_mem_in_use, -(int64_t) f->type_size);
-#endif /* TS_USE_RECLAIMABLE_FREELIST */
-#else
-  if (f->alignment)
-    ats_memalign_free(item);
-  else
-    ats_free(item);
-#endif
 }
+#endif /* TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST */
 
 void
 ink_freelists_snap_baseline()
@@ -362,6 +702,30 @@ ink_freelists_dump(FILE * f)
 #endif
 }
 
+void
+ink_freelists_dump_magazines(FILE * f)
+{
+#if TS_USE_FREELIST && !TS_USE_RECLAIMABLE_FREELIST
+  ink_freelist_list *fll;
+  if (f == NULL)
+    f = stderr;
+
+  fprintf(f, " magazine size | depot exchanges | depot misses | depot contention |   free list name\n");
+  fprintf(f, "---------------|-----------------|--------------|------------------|----------------------------------\n");
+
+  fll = freelists;
+  while (fll) {
+    if (fll->fl->magazine_size) {
+      fprintf(f, " %13u | %15" PRIu64 " | %12" PRIu64 " | %16" PRIu64 " | memory/%s\n",
+              fll->fl->magazine_size, (uint64_t)fll->fl->depot_exchanges, (uint64_t)fll->fl->depot_misses,
+              (uint64_t)fll->fl->depot_contention, fll->fl->name ? fll->fl->name : "<unknown>");
+    }
+    fll = fll->next;
+  }
+#else
+  (void)f;
+#endif
+}
 
 void
 ink_atomiclist_init(InkAtomicList * l, const char *name, uint32_t offset_to_next)
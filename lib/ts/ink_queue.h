@@ -146,18 +146,38 @@ extern "C"
 
   typedef void *void_p;
 
+  typedef struct
+  {
+    volatile head_p head;
+    const char *name;
+    uint32_t offset;
+  } InkAtomicList;
+
 #if TS_USE_RECLAIMABLE_FREELIST
   extern float cfg_reclaim_factor;
   extern int64_t cfg_max_overage;
   extern int64_t cfg_enable_reclaim;
   extern int64_t cfg_debug_filter;
 #else
+#define INK_FREELIST_DEPOTS 8
+
   struct _InkFreeList
   {
     volatile head_p head;
     const char *name;
     uint32_t type_size, chunk_size, used, allocated, alignment;
     uint32_t allocated_base, used_base;
+
+    /* Per-thread magazines in front of the list. Objects in them count
+       as in use. magazine_size is 0 if the type does not use them, it
+       only grows, by CAS, and is read once per use. */
+    uint32_t magazine_idx, magazine_max;
+    volatile uint32_t magazine_size;
+    volatile uint64_t depot_exchanges;  /* magazines traded with the depots */
+    volatile uint64_t depot_misses;     /* refills from the list, the depots being empty */
+    volatile uint64_t depot_contention; /* lost CAS races on the depots */
+    volatile uint64_t contention_mark;
+    InkAtomicList depot[INK_FREELIST_DEPOTS]; /* full magazines, one depot per NUMA node */
   };
 
   inkcoreapi extern volatile int64_t fastalloc_mem_in_use;
@@ -165,6 +185,9 @@ extern "C"
   inkcoreapi extern volatile int64_t freelist_allocated_mem;
 #endif
 
+  /* Set to 0 to bypass the per-thread magazines. */
+  inkcoreapi extern int ink_freelist_magazines;
+
   typedef struct _InkFreeList InkFreeList, *PInkFreeList;
   typedef struct _ink_freelist_list
   {
@@ -185,16 +208,10 @@ extern "C"
   inkcoreapi void *ink_freelist_new(InkFreeList * f);
   inkcoreapi void ink_freelist_free(InkFreeList * f, void *item);
   void ink_freelists_dump(FILE * f);
+  void ink_freelists_dump_magazines(FILE * f);
   void ink_freelists_dump_baselinerel(FILE * f);
   void ink_freelists_snap_baseline();
 
-  typedef struct
-  {
-    volatile head_p head;
-    const char *name;
-    uint32_t offset;
-  } InkAtomicList;
-
 #if !defined(INK_QUEUE_NT)
 #define INK_ATOMICLIST_EMPTY(_x) (!(TO_PTR(FREELIST_POINTER((_x.head)))))
 #else
@@ -0,0 +1,234 @@
+/** @file
+
+  Tests and benchmark of the compact radix trie.
+
+  Without arguments this checks the trie against a linear scan of the keys.
+  With arguments
+
+    test_RadixTrie bench [rules ...]
+
+  it builds tries of remap style keys (host, scheme, port and path prefix,
+  four path prefixes per host) with 10k, 100k and 1M rules, or the given
+  numbers of rules, and prints the build time, the memory used and the time
+  per lookup.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libts.h"
+#include "RadixTrie.h"
+#include "TestBox.h"
+
+struct Value
+{
+  int id;
+};
+
+REGRESSION_TEST(RadixTrie_Basic)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  RadixTrie<Value> trie;
+  Value v[8];
+
+  for (int i = 0; i < 8; i++)
+    v[i].id = i;
+
+  box.check(trie.Empty() && trie.Search("abc", 3) == NULL, "empty trie finds something");
+
+  box.check(trie.Insert("abcdef", 6, &v[0], 5), "insert abcdef");
+  box.check(trie.Insert("abc", 3, &v[1], 7), "insert abc, splitting abcdef");
+  box.check(trie.Insert("abxy", 4, &v[2], 3), "insert abxy, splitting abc");
+  box.check(trie.Insert("", 0, &v[3], 9), "insert the empty key");
+  box.check(!trie.Insert("abc", 3, &v[4], 1), "duplicate abc was inserted");
+  box.check(trie.Count() == 4, "count is %d", trie.Count());
+
+  // the lowest rank among the prefixes wins, not the longest prefix
+  box.check(trie.Search("abcdefgh", 8) == &v[0], "abcdefgh");
+  box.check(trie.Search("abcde", 5) == &v[1], "abcde");
+  box.check(trie.Search("abc", 3) == &v[1], "abc");
+  box.check(trie.Search("ab", 2) == &v[3], "ab");
+  box.check(trie.Search("abxyz", 5) == &v[2], "abxyz");
+  box.check(trie.Search("zzz", 3) == &v[3], "zzz");
+  box.check(trie.Search("", 0) == &v[3], "empty key");
+
+  // keys may hold any byte, including NUL
+  box.check(trie.Insert("h\0\x01", 3, &v[5], 0), "insert a key with NUL");
+  box.check(trie.Search("h\0\x01/x", 5) == &v[5], "key with NUL");
+  box.check(trie.Search("h\0\x02/x", 5) == &v[3], "key with NUL, other byte");
+
+  trie.Clear();
+  box.check(trie.Empty() && trie.MemoryUsed() == 0 && trie.Search("abc", 3) == NULL, "Clear() left something");
+  box.check(trie.Insert("abc", 3, &v[1], 7) && trie.Search("abcd", 4) == &v[1], "reuse after Clear()");
+}
+
+REGRESSION_TEST(RadixTrie_Random)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  static const int NKEYS = 2000;
+  static const int NSEARCHES = 20000;
+  static const char alphabet[] = "ab/\xff";
+  InkRand rand(17);
+  char keys[NKEYS][12];
+  int lens[NKEYS];
+  int ranks[NKEYS];
+  Value values[NKEYS];
+  bool inserted[NKEYS];
+  RadixTrie<Value> trie;
+
+  for (int i = 0; i < NKEYS; i++) {
+    lens[i] = rand.random() % sizeof(keys[i]);
+    for (int j = 0; j < lens[i]; j++)
+      keys[i][j] = alphabet[rand.random() % (sizeof(alphabet) - 1)];
+    ranks[i] = rand.random() % (NKEYS * 4);
+    values[i].id = i;
+
+    bool dup = false;
+    for (int j = 0; j < i && !dup; j++)
+      dup = inserted[j] && lens[j] == lens[i] && memcmp(keys[j], keys[i], lens[i]) == 0;
+    inserted[i] = trie.Insert(keys[i], lens[i], &values[i], ranks[i]);
+    box.check(inserted[i] == !dup, "key %d: duplicate %d, inserted %d", i, dup, inserted[i]);
+  }
+
+  for (int n = 0; n < NSEARCHES; n++) {
+    char key[16];
+    int len = rand.random() % sizeof(key);
+    int best = -1;
+
+    for (int j = 0; j < len; j++)
+      key[j] = alphabet[rand.random() % (sizeof(alphabet) - 1)];
+    for (int i = 0; i < NKEYS; i++) {
+      if (inserted[i] && lens[i] <= len && memcmp(keys[i], key, lens[i]) == 0 &&
+          (best < 0 || ranks[i] <= ranks[best]))
+        best = i;
+    }
+
+    Value *found = trie.Search(key, len);
+    if (!box.check(best < 0 ? found == NULL : (found && ranks[found->id] == ranks[best]),
+                   "search %d: expected %d, found %d", n, best, found ? found->id : -1))
+      break;
+  }
+}
+
+// host, a NUL, the scheme and the port in two bytes each, then the path
+static int
+remap_key(char *buf, const char *host, int scheme, int port, const char *path)
+{
+  int len = strlen(host);
+
+  memcpy(buf, host, len);
+  buf[len++] = '\0';
+  buf[len++] = scheme >> 8;
+  buf[len++] = scheme;
+  buf[len++] = port >> 8;
+  buf[len++] = port;
+  strcpy(buf + len, path);
+  return len + strlen(path);
+}
+
+static int
+bench(int nrules)
+{
+  static const int NLOOKUPS = 1000000;
+  static const char *rule_paths[] = { "", "/api/", "/static/img/", "/u/%d/" };
+  static const char *request_paths[] = { "/", "/api/v1/users?id=42", "/static/img/logo.png", "/u/%d/profile" };
+  int nhosts = nrules / countof(rule_paths);
+  Value *values = (Value *) ats_malloc(nrules * sizeof(Value));
+  char **lookups = (char **) ats_malloc(NLOOKUPS * sizeof(char *));
+  int *lookup_lens = (int *) ats_malloc(NLOOKUPS * sizeof(int));
+  char host[64], path[64], key[256];
+  InkRand rand(nrules);
+  RadixTrie<Value> trie;
+  int n = 0, failures = 0;
+
+  ink_hrtime start = ink_get_hrtime_internal();
+  for (int h = 0; h < nhosts; h++) {
+    snprintf(host, sizeof(host), "host%d.example.com", h);
+    for (unsigned p = 0; p < countof(rule_paths); p++, n++) {
+      snprintf(path, sizeof(path), rule_paths[p], h);
+      values[n].id = n;
+      if (!trie.Insert(key, remap_key(key, host, 1, 80, path), &values[n], n))
+        printf("FAILED: can't insert rule %d\n", n), failures++;
+    }
+  }
+  ink_hrtime built = ink_get_hrtime_internal() - start;
+
+  // one lookup in ten is for a host without rules
+  for (int i = 0; i < NLOOKUPS; i++) {
+    int h = rand.random() % nhosts;
+
+    snprintf(host, sizeof(host), (i % 10) ? "host%d.example.com" : "other%d.example.com", h);
+    snprintf(path, sizeof(path), request_paths[rand.random() % countof(request_paths)], h);
+    lookup_lens[i] = remap_key(key, host, 1, 80, path);
+    lookups[i] = (char *) ats_malloc(lookup_lens[i]);
+    memcpy(lookups[i], key, lookup_lens[i]);
+  }
+
+  int hits = 0;
+  start = ink_get_hrtime_internal();
+  for (int i = 0; i < NLOOKUPS; i++) {
+    if (trie.Search(lookups[i], lookup_lens[i]))
+      hits++;
+  }
+  ink_hrtime searched = ink_get_hrtime_internal() - start;
+
+  size_t memory = trie.MemoryUsed();
+  start = ink_get_hrtime_internal();
+  trie.Clear();
+  ink_hrtime cleared = ink_get_hrtime_internal() - start;
+
+  printf("%8d rules: build %8.2f ms, %6.1f bytes per rule, lookup %6.1f ns (%d%% hits), clear %6.2f ms\n",
+         n, (double) built / HRTIME_MSECOND, (double) memory / n, (double) searched / NLOOKUPS,
+         hits / (NLOOKUPS / 100), (double) cleared / HRTIME_MSECOND);
+
+  for (int i = 0; i < NLOOKUPS; i++)
+    ats_free(lookups[i]);
+  ats_free(lookups);
+  ats_free(lookup_lens);
+  ats_free(values);
+  return failures;
+}
+
+int
+main(int argc, char **argv)
+{
+  if (argc >= 2 && strcmp(argv[1], "bench") == 0) {
+    int failures = 0;
+
+    if (argc == 2) {
+      failures += bench(10000);
+      failures += bench(100000);
+      failures += bench(1000000);
+    }
+    for (int i = 2; i < argc; i++)
+      failures += bench(atoi(argv[i]));
+    return failures ? 1 : 0;
+  }
+
+  RegressionTest::run((char *) "RadixTrie_.*");
+  return RegressionTest::final_status == REGRESSION_TEST_PASSED ? 0 : 1;
+}
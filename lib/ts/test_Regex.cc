@@ -0,0 +1,364 @@
+/** @file
+
+  Tests and benchmark of the regular expression prefilter.
+
+  Without arguments this checks the literal extraction and that the prefilter
+  never rules out a pattern that matches. With a pattern file and a URL file
+
+    test_Regex remap.config urls.txt [rounds]
+    test_Regex regex_remap.conf urls.txt [rounds]
+
+  it replays the URLs against the patterns, once trying every pattern in turn
+  and once with the prefilter, and prints the time per URL of both. Lines
+  starting with regex_ are taken as remap.config rules, matched against the URL
+  host; any other line is a regex_remap rule, matched against the path and query.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libts.h"
+#include "Regex.h"
+#include "TestBox.h"
+
+struct Compiled
+{
+  pcre *re;
+  pcre_extra *extra;
+};
+
+static bool
+compile(const char *pattern, Compiled &c)
+{
+  const char *error;
+  int erroffset;
+
+  c.re = pcre_compile(pattern, 0, &error, &erroffset, NULL);
+  if (!c.re)
+    return false;
+  c.extra = pcre_study(c.re, RE_STUDY_OPTIONS, &error);
+  return true;
+}
+
+static bool
+match(const Compiled &c, const char *str, int len)
+{
+  int ovector[30];
+
+  return pcre_exec(c.re, c.extra, str, len, 0, 0, ovector, 30) > 0;
+}
+
+REGRESSION_TEST(Regex_Extract)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  static const struct {
+    const char *pattern;
+    const char *literal;
+  } cases[] = {
+    { "www\\.example\\.com", "www.example.com" },
+    { "^(.*)\\.example\\.com$", ".example.com" },
+    { "Foo[0-9]+Barbaz", "barbaz" },
+    { "abcd?efgh", "efgh" },
+    { "ab*cdef", "cdef" },
+    { "abc{2,3}de", "ab" },
+    { "x+yz", "yz" },
+    { "a|bcdef", "" },
+    { "(a|b)cdef", "cdef" },
+    { "[a-z]{3}\\d+", "" },
+    { "/images/(.*)\\.jpg", "/images/" },
+    { "\\Qa.b\\E", "" },
+    { "(?x) a b c", "" },
+    { "(?i)HostName", "hostname" },
+    { "\\w+\\.cdn[.]net", ".cdn" },
+    { "abc\\x41defg", "defg" },
+    { "ab\\x{41}cdef", "cdef" },
+    { "abc\\cXdefg", "defg" },
+    { "ab\\p{Lu}cdef", "cdef" },
+    { "abc\\PLdefg", "defg" },
+    { "abc\\012defg", "defg" },
+    { "(ab)cde\\g{1}fg", "cde" },
+    { "(?<n>ab)cde\\k<n>fg", "cde" },
+    { "abc\\x{41", "" },
+    { "abc\\k", "" },
+    { "", "" },
+  };
+  char buf[1024];
+
+  for (unsigned i = 0; i < countof(cases); i++) {
+    int len = RegexPrefilter::extract_literal(cases[i].pattern, buf, sizeof(buf));
+
+    box.check(len == (int) strlen(cases[i].literal) && memcmp(buf, cases[i].literal, len) == 0,
+              "literal of '%s' is '%.*s', expected '%s'", cases[i].pattern, len, buf, cases[i].literal);
+  }
+}
+
+REGRESSION_TEST(Regex_Prefilter)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  static const char *patterns[] = {
+    "^www\\.example\\.com$", "^(.*)\\.example\\.com$", "cdn[0-9]+\\.example\\.net", "^img(.*)\\.com$",
+    "a|b", "^static\\.(.*)$", "foo.*bar", "^MEDIA\\.", "^[a-z]+$", "example",
+  };
+  static const char *subjects[] = {
+    "www.example.com", "img.example.com", "cdn12.example.net", "imgfoo.com", "static.foo.org", "foobazbar",
+    "media.example.org", "MEDIA.EXAMPLE.ORG", "localhost", "nothing-matches-here.123", "", "b",
+  };
+  Compiled compiled[countof(patterns)];
+  RegexPrefilter prefilter;
+
+  for (unsigned i = 0; i < countof(patterns); i++) {
+    box.check(compile(patterns[i], compiled[i]), "can't compile '%s'", patterns[i]);
+    box.check(prefilter.add(patterns[i]) == (int) i, "ids are not in order");
+  }
+  prefilter.compile();
+
+  for (unsigned j = 0; j < countof(subjects); j++) {
+    RegexPrefilter::Matches m;
+    int len = strlen(subjects[j]);
+
+    prefilter.scan(subjects[j], len, m);
+    for (unsigned i = 0; i < countof(patterns); i++) {
+      if (match(compiled[i], subjects[j], len))
+        box.check(m.test(i), "'%s' matches '%s' but is not a candidate", patterns[i], subjects[j]);
+    }
+  }
+
+  // Literals are found at every position, and overlapping each other.
+  RegexPrefilter overlap;
+  RegexPrefilter::Matches m;
+
+  overlap.add("she");
+  overlap.add("he");
+  overlap.add("hers");
+  overlap.add("his");
+  overlap.compile();
+  overlap.scan("USHERS", 6, m);
+  box.check(m.test(0) && m.test(1) && m.test(2) && !m.test(3), "wrong candidates for USHERS");
+
+  // Patterns added after compile() are always candidates, and a lot of them work.
+  RegexPrefilter many;
+  char pattern[32];
+
+  for (int i = 0; i < 5000; i++) {
+    snprintf(pattern, sizeof(pattern), "^host%d\\.example", i);
+    many.add(pattern);
+  }
+  many.compile();
+  many.add("^late");
+  many.scan("host4321.example", 16, m);
+  box.check(m.test(4321) && !m.test(432) && !m.test(4322) && m.test(5000), "wrong candidates for host4321");
+
+  for (unsigned i = 0; i < countof(patterns); i++) {
+    pcre_free(compiled[i].re);
+    if (compiled[i].extra)
+      regex_free_study(compiled[i].extra);
+  }
+}
+
+REGRESSION_TEST(Regex_Escapes)(RegressionTest *t, int /* atype ATS_UNUSED */, int *pstatus)
+{
+  TestBox box(t, pstatus);
+
+  box = REGRESSION_TEST_PASSED;
+
+  // Every escape that is not a literal character, with a subject it matches.
+  static const struct {
+    const char *pattern;
+    const char *subject;
+  } cases[] = {
+    { "abc\\x41defg", "abcAdefg" },
+    { "ab\\x{41}cdef", "abAcdef" },
+    { "abc\\cXdefg", "abc\030defg" },
+    { "ab\\p{Lu}cdef", "abQcdef" },
+    { "abc\\PLdefg", "abc1defg" },
+    { "abc\\012defg", "abc\ndefg" },
+    { "(ab)cde\\g{1}fg", "abcdeabfg" },
+    { "(ab)cde\\g1fg", "abcdeabfg" },
+    { "(ab)cde\\g{-1}fg", "abcdeabfg" },
+    { "(ab)cde\\1fg", "abcdeabfg" },
+    { "(?<n>ab)cde\\k<n>fg", "abcdeabfg" },
+    { "(?<n>ab)cde\\k{n}fg", "abcdeabfg" },
+    { "(?<n>ab)cde\\k'n'fg", "abcdeabfg" },
+    { "abc\\tdefg", "abc\tdefg" },
+    { "abc\\d+defg", "abc42defg" },
+  };
+
+  for (unsigned i = 0; i < countof(cases); i++) {
+    Compiled compiled;
+    RegexPrefilter prefilter;
+    RegexPrefilter::Matches m;
+    int len = strlen(cases[i].subject);
+
+    if (!compile(cases[i].pattern, compiled)) {
+      // \p needs a PCRE built with Unicode properties
+      printf("skipping '%s', it does not compile\n", cases[i].pattern);
+      continue;
+    }
+    box.check(match(compiled, cases[i].subject, len), "'%s' does not match '%s'", cases[i].pattern, cases[i].subject);
+    prefilter.add(cases[i].pattern);
+    prefilter.compile();
+    prefilter.scan(cases[i].subject, len, m);
+    box.check(m.test(0), "'%s' matches '%s' but is not a candidate", cases[i].pattern, cases[i].subject);
+
+    pcre_free(compiled.re);
+    if (compiled.extra)
+      regex_free_study(compiled.extra);
+  }
+}
+
+static char *
+subject_of(char *url, bool host)
+{
+  char *p = strstr(url, "://");
+
+  p = p ? p + 3 : url;
+  if (host) {
+    p[strcspn(p, "/:")] = '\0';
+    return p;
+  }
+  p = strchr(p, '/');
+  return p ? p : (char *) "/";
+}
+
+static int
+bench(const char *pattern_file, const char *url_file, int rounds)
+{
+  FILE *fp;
+  char line[8192];
+  Compiled *compiled = NULL;
+  char **subjects = NULL;
+  int npatterns = 0, nsubjects = 0;
+  bool host = false;
+  RegexPrefilter prefilter;
+
+  if (!(fp = fopen(pattern_file, "r"))) {
+    perror(pattern_file);
+    return 1;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    char *p = line + strspn(line, " \t");
+    char *pattern;
+
+    if (*p == '#' || *p == '\n' || !*p)
+      continue;
+    if (strncmp(p, "regex_", 6) == 0) {
+      // regex_map http://(.*)\.example\.com/ http://... : the host of the from URL
+      p += strcspn(p, " \t");
+      p += strspn(p, " \t");
+      p[strcspn(p, " \t\n")] = '\0';
+      pattern = subject_of(p, true);
+      host = true;
+    } else {
+      p[strcspn(p, " \t\n")] = '\0';
+      pattern = p;
+    }
+
+    compiled = (Compiled *) ats_realloc(compiled, (npatterns + 1) * sizeof(Compiled));
+    if (!compile(pattern, compiled[npatterns])) {
+      fprintf(stderr, "skipping '%s', it does not compile\n", pattern);
+      continue;
+    }
+    prefilter.add(pattern);
+    npatterns++;
+  }
+  fclose(fp);
+  prefilter.compile();
+
+  if (!(fp = fopen(url_file, "r"))) {
+    perror(url_file);
+    return 1;
+  }
+  while (fgets(line, sizeof(line), fp)) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (!*line)
+      continue;
+    subjects = (char **) ats_realloc(subjects, (nsubjects + 1) * sizeof(char *));
+    subjects[nsubjects++] = ats_strdup(subject_of(line, host));
+  }
+  fclose(fp);
+
+  if (!npatterns || !nsubjects) {
+    fprintf(stderr, "need at least one pattern and one URL\n");
+    return 1;
+  }
+
+  int64_t calls[2] = { 0, 0 };
+  int *expected = (int *) ats_malloc(nsubjects * sizeof(int));
+  int mismatches = 0;
+  ink_hrtime elapsed[2];
+
+  for (int with_prefilter = 0; with_prefilter < 2; with_prefilter++) {
+    ink_hrtime start = ink_get_hrtime_internal();
+
+    for (int r = 0; r < rounds; r++) {
+      for (int j = 0; j < nsubjects; j++) {
+        RegexPrefilter::Matches m;
+        int len = strlen(subjects[j]);
+        int first = -1;
+
+        if (with_prefilter)
+          prefilter.scan(subjects[j], len, m);
+        for (int i = 0; i < npatterns; i++) {
+          if (with_prefilter && !m.test(i))
+            continue;
+          calls[with_prefilter]++;
+          if (match(compiled[i], subjects[j], len)) {
+            first = i;
+            break;
+          }
+        }
+        // both loops have to agree on the rule that matched first
+        if (r == 0) {
+          if (!with_prefilter)
+            expected[j] = first;
+          else if (expected[j] != first)
+            mismatches++;
+        }
+      }
+    }
+    elapsed[with_prefilter] = ink_get_hrtime_internal() - start;
+  }
+
+  printf("%d patterns, %d subjects (%s), %d rounds\n", npatterns, nsubjects, host ? "hosts" : "paths", rounds);
+  printf("  every pattern: %8.1f ns per subject, %.1f pcre_exec per subject\n",
+         (double) elapsed[0] / ((double) nsubjects * rounds), (double) calls[0] / ((double) nsubjects * rounds));
+  printf("  prefiltered:   %8.1f ns per subject, %.1f pcre_exec per subject\n",
+         (double) elapsed[1] / ((double) nsubjects * rounds), (double) calls[1] / ((double) nsubjects * rounds));
+  printf("  %d subjects matched a different first pattern\n", mismatches);
+
+  return mismatches ? 1 : 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  if (argc >= 3)
+    return bench(argv[1], argv[2], argc > 3 ? atoi(argv[3]) : 10);
+
+  RegressionTest::run((char *) "Regex_.*");
+  return RegressionTest::final_status == REGRESSION_TEST_PASSED ? 0 : 1;
+}
@@ -23,13 +23,109 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "ink_thread.h"
 #include "ink_queue.h"
+#include "ink_atomic.h"
 
 
 #define NTHREADS 64
 InkFreeList *flist = NULL;
 
+// Multithreaded allocation benchmark, with and without the per-thread magazines.
+
+#define BENCH_BATCH 16
+InkFreeList *bench_flist = NULL;
+volatile int bench_stop = 0;
+volatile int64_t bench_ops = 0;
+
+void *
+bench(void * /* d ATS_UNUSED */)
+{
+  void *m[BENCH_BATCH];
+  int64_t ops = 0;
+
+  while (!bench_stop) {
+    for (int i = 0; i < BENCH_BATCH; i++)
+      m[i] = ink_freelist_new(bench_flist);
+    for (int i = 0; i < BENCH_BATCH; i++)
+      ink_freelist_free(bench_flist, m[i]);
+    ops += BENCH_BATCH;
+  }
+  ink_atomic_increment(&bench_ops, ops);
+  return NULL;
+}
+
+void
+run_bench(int nthreads, int magazines)
+{
+  ink_thread t[NTHREADS];
+
+  ink_freelist_magazines = magazines;
+  bench_stop = 0;
+  bench_ops = 0;
+  for (int i = 0; i < nthreads; i++)
+    t[i] = ink_thread_create(bench, NULL);
+  sleep(1);
+  bench_stop = 1;
+  for (int i = 0; i < nthreads; i++)
+    ink_thread_join(t[i]);
+  printf("%2d threads, magazines %s: %10" PRId64 " alloc/free pairs per second\n", nthreads,
+         magazines ? "on " : "off", (int64_t)bench_ops);
+}
+
+// Objects allocated on one thread and freed on another go through the depots.
+
+#define HANDOFF_SIZE 64
+InkAtomicList handoff;
+volatile int handoff_done = 0;
+
+void *
+handoff_producer(void * /* d ATS_UNUSED */)
+{
+  time_t start = time(NULL);
+
+  while (start + 2 > time(NULL)) {
+    char *m = (char *)ink_freelist_new(bench_flist);
+    memset(m, 0x5a, HANDOFF_SIZE);
+    ink_atomiclist_push(&handoff, m);
+  }
+  handoff_done = 1;
+  return NULL;
+}
+
+void
+run_handoff()
+{
+  ink_thread t;
+  int64_t n = 0;
+
+  ink_freelist_magazines = 1;
+  ink_atomiclist_init(&handoff, "handoff", 0);
+  t = ink_thread_create(handoff_producer, NULL);
+  for (;;) {
+    int done = handoff_done;
+    char *m = (char *)ink_atomiclist_pop(&handoff);
+
+    if (!m) {
+      if (done)
+        break;
+      continue;
+    }
+    // The first word is the list link.
+    for (int i = sizeof(void *); i < HANDOFF_SIZE; i++) {
+      if (m[i] != 0x5a) {
+        printf("handoff: object %p corrupted at byte %d\n", m, i);
+        exit(1);
+      }
+    }
+    ink_freelist_free(bench_flist, m);
+    ++n;
+  }
+  ink_thread_join(t);
+  printf("handed off %" PRId64 " objects between threads\n", n);
+}
+
 
 void *
 test(void *d)
@@ -75,6 +171,14 @@ main(int /* argc ATS_UNUSED */, char */*argv ATS_UNUSED */[])
   int i;
 
   flist = ink_freelist_create("woof", 64, 256, 8);
+  bench_flist = ink_freelist_create("bench", 64, 256, 8);
+
+  for (int n = 1; n <= NTHREADS; n *= 4) {
+    run_bench(n, 0);
+    run_bench(n, 1);
+  }
+  run_handoff();
+  ink_freelists_dump_magazines(stdout);
 
   for (i = 0; i < NTHREADS; i++) {
     fprintf(stderr, "Create thread %d\n", i);
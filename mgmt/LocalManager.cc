@@ -1119,6 +1119,17 @@ LocalManager::bindProxyPort(HttpProxyPort& port)
     _exit(1);
   }
 
+#ifdef SO_REUSEPORT
+  // The network threads open further sockets on this port, which must be
+  // allowed before the first socket is bound.
+  bool reuseport_found;
+  if (REC_readInteger("proxy.config.net.accept_reuseport", &reuseport_found) > 0 && reuseport_found) {
+    if (setsockopt(port.m_fd, SOL_SOCKET, SO_REUSEPORT, (char *) &one, sizeof(int)) < 0) {
+      mgmt_elog(stderr, 0, "[bindProxyPort] Unable to set SO_REUSEPORT: %d : %s\n", port.m_port, strerror(errno));
+    }
+  }
+#endif
+
   if (port.m_inbound_transparent_p) {
 #if TS_USE_TPROXY
     Debug("http_tproxy", "Listen port %d inbound transparency enabled.\n", port.m_port);
@@ -25,8 +25,12 @@
 
 #define TS_LUA_MAX_STATE_COUNT                  512
 
-static uint64_t ts_lua_http_next_id = 0;
-static uint64_t ts_lua_g_http_next_id = 0;
+/* each thread takes the next free state on its first request */
+static int ts_lua_next_state = 0;
+static int ts_lua_g_next_state = 0;
+
+static pthread_key_t ts_lua_state_key;
+static pthread_key_t ts_lua_g_state_key;
 
 static ts_lua_main_ctx *ts_lua_main_ctx_array;
 static ts_lua_main_ctx *ts_lua_g_main_ctx_array;
@@ -53,9 +57,12 @@ TSRemapInit(TSRemapInterface * api_info, char *errbuf, int errbuf_size)
   if (ret) {
     ts_lua_destroy_vm(ts_lua_main_ctx_array, TS_LUA_MAX_STATE_COUNT);
     TSfree(ts_lua_main_ctx_array);
+    ts_lua_main_ctx_array = NULL;
     return TS_ERROR;
   }
 
+  pthread_key_create(&ts_lua_state_key, NULL);
+
   return TS_SUCCESS;
 }
 
@@ -64,6 +71,7 @@ TSRemapNewInstance(int argc, char *argv[], void **ih, char *errbuf, int errbuf_s
 {
   int fn;
   int ret;
+  ts_lua_main_ctx check_ctx;
 
   if (argc < 3) {
     strncpy(errbuf, "[TSRemapNewInstance] - lua script file or string is required !!", errbuf_size - 1);
@@ -95,10 +103,20 @@ TSRemapNewInstance(int argc, char *argv[], void **ih, char *errbuf, int errbuf_s
 
   ts_lua_init_instance(conf);
 
-  ret = ts_lua_add_module(conf, ts_lua_main_ctx_array, TS_LUA_MAX_STATE_COUNT, argc - 2, &argv[2]);
+  /* The states load the instance on their first request for it, here it is
+     only checked in a state of its own. */
+  ts_lua_create_vm(&check_ctx, 1);
+  ret = ts_lua_create_state(&check_ctx);
+
+  if (ret == 0)
+    ret = ts_lua_add_module(conf, &check_ctx, argc - 2, &argv[2]);
+
+  ts_lua_destroy_vm(&check_ctx, 1);
 
   if (ret != 0) {
     strncpy(errbuf, "[TSRemapNewInstance] ts_lua_add_module failed", errbuf_size - 1);
+    ts_lua_del_instance(conf);
+    TSfree(conf);
     return TS_ERROR;
   }
 
@@ -120,7 +138,6 @@ TSRemapStatus
 TSRemapDoRemap(void *ih, TSHttpTxn rh, TSRemapRequestInfo * rri)
 {
   int ret;
-  uint64_t req_id;
 
   TSCont contp;
   lua_State *l;
@@ -131,14 +148,21 @@ TSRemapDoRemap(void *ih, TSHttpTxn rh, TSRemapRequestInfo * rri)
   ts_lua_instance_conf *instance_conf;
 
   instance_conf = (ts_lua_instance_conf *) ih;
-  req_id = __sync_fetch_and_add(&ts_lua_http_next_id, 1);
 
+  /* The state belongs to this thread, entering it is a CAS nobody else
+     races with unless a hook of its transactions runs elsewhere. */
+  main_ctx = ts_lua_get_thread_main_ctx(ts_lua_main_ctx_array, TS_LUA_MAX_STATE_COUNT, ts_lua_state_key,
+                                        &ts_lua_next_state, "remap");
+  if (main_ctx == NULL)
+    return TSREMAP_NO_REMAP;
 
-  main_ctx = &ts_lua_main_ctx_array[req_id % TS_LUA_MAX_STATE_COUNT];
-
-  TSMutexLock(main_ctx->mutexp);
+  ts_lua_state_lock(main_ctx);
 
   http_ctx = ts_lua_create_http_ctx(main_ctx, instance_conf);
+  if (http_ctx == NULL) {
+    ts_lua_state_unlock(main_ctx);
+    return TSREMAP_NO_REMAP;
+  }
 
   http_ctx->txnp = rh;
   http_ctx->client_request_bufp = rri->requestBufp;
@@ -155,11 +179,14 @@ TSRemapDoRemap(void *ih, TSHttpTxn rh, TSRemapRequestInfo * rri)
 
   lua_getglobal(l, TS_LUA_FUNCTION_REMAP);
   if (lua_type(l, -1) != LUA_TFUNCTION) {
-    TSMutexUnlock(main_ctx->mutexp);
+    lua_pop(l, 1);
+    ts_lua_destroy_http_ctx(http_ctx);
+    TSContDestroy(contp);
+    ts_lua_state_unlock(main_ctx);
     return TSREMAP_NO_REMAP;
   }
 
-  if (lua_pcall(l, 0, 1, 0) != 0) {
+  if (ts_lua_pcall(main_ctx, l, 0, 1) != 0) {
     TSError("lua_pcall failed: %s", lua_tostring(l, -1));
   }
 
@@ -175,7 +202,7 @@ TSRemapDoRemap(void *ih, TSHttpTxn rh, TSRemapRequestInfo * rri)
     TSContDestroy(contp);
   }
 
-  TSMutexUnlock(main_ctx->mutexp);
+  ts_lua_state_unlock(main_ctx);
 
   return ret;
 }
@@ -190,7 +217,6 @@ globalHookHandler(TSCont contp, TSEvent event ATS_UNUSED, void *edata)
   TSMLoc url_loc;
 
   int ret;
-  uint64_t req_id;
   TSCont txn_contp;
 
   lua_State *l;
@@ -200,14 +226,21 @@ globalHookHandler(TSCont contp, TSEvent event ATS_UNUSED, void *edata)
 
   ts_lua_instance_conf *conf = (ts_lua_instance_conf *) TSContDataGet(contp);
 
-  req_id = __sync_fetch_and_add(&ts_lua_g_http_next_id, 1);
-
-  main_ctx = &ts_lua_g_main_ctx_array[req_id % TS_LUA_MAX_STATE_COUNT];
+  main_ctx = ts_lua_get_thread_main_ctx(ts_lua_g_main_ctx_array, TS_LUA_MAX_STATE_COUNT, ts_lua_g_state_key,
+                                        &ts_lua_g_next_state, "global");
+  if (main_ctx == NULL) {
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    return 0;
+  }
 
-  TSDebug(TS_LUA_DEBUG_TAG, "[%s] req_id: %" PRId64, __FUNCTION__, req_id);
-  TSMutexLock(main_ctx->mutexp);
+  ts_lua_state_lock(main_ctx);
 
   http_ctx = ts_lua_create_http_ctx(main_ctx, conf);
+  if (http_ctx == NULL) {
+    ts_lua_state_unlock(main_ctx);
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
+    return 0;
+  }
   http_ctx->txnp = txnp;
   http_ctx->remap = 0;
   http_ctx->has_hook = 0;
@@ -224,6 +257,9 @@ globalHookHandler(TSCont contp, TSEvent event ATS_UNUSED, void *edata)
   }
 
   if (!http_ctx->client_request_hdrp) {
+    ts_lua_destroy_http_ctx(http_ctx);
+    ts_lua_state_unlock(main_ctx);
+
     TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
     return 0;
   }
@@ -284,18 +320,21 @@ globalHookHandler(TSCont contp, TSEvent event ATS_UNUSED, void *edata)
     break;
 
   default:
-    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
-    return 0;
+    lua_pushnil(l);
     break;
   }
 
   if (lua_type(l, -1) != LUA_TFUNCTION) {
-    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
     lua_pop(l, 1);
+    ts_lua_destroy_http_ctx(http_ctx);
+    TSContDestroy(txn_contp);
+    ts_lua_state_unlock(main_ctx);
+
+    TSHttpTxnReenable(txnp, TS_EVENT_HTTP_CONTINUE);
     return 0;
   }
 
-  if (lua_pcall(l, 0, 1, 0) != 0) {
+  if (ts_lua_pcall(main_ctx, l, 0, 1) != 0) {
     TSError("lua_pcall failed: %s", lua_tostring(l, -1));
   }
 
@@ -312,7 +351,7 @@ globalHookHandler(TSCont contp, TSEvent event ATS_UNUSED, void *edata)
     TSContDestroy(txn_contp);
   }
 
-  TSMutexUnlock(main_ctx->mutexp);
+  ts_lua_state_unlock(main_ctx);
 
   if(ret) {
     TSHttpTxnReenable(txnp, TS_EVENT_HTTP_ERROR);
@@ -338,6 +377,8 @@ TSPluginInit(int argc, const char *argv[])
     return;
   }
 
+  pthread_key_create(&ts_lua_g_state_key, NULL);
+
   if (argc < 2) {
     TSError("[%s] lua script file required !!", __FUNCTION__);
     return;
@@ -359,10 +400,19 @@ TSPluginInit(int argc, const char *argv[])
 
   ts_lua_init_instance(conf);
 
-  ret = ts_lua_add_module(conf, ts_lua_g_main_ctx_array, TS_LUA_MAX_STATE_COUNT, argc - 1, (char **) &argv[1]);
+  /* The script is checked, and its hooks looked up, in a state of its own.
+     The states of the threads load it on their first request. */
+  ts_lua_main_ctx check_ctx;
+
+  ts_lua_create_vm(&check_ctx, 1);
+  ret = ts_lua_create_state(&check_ctx);
+
+  if (ret == 0)
+    ret = ts_lua_add_module(conf, &check_ctx, argc - 1, (char **) &argv[1]);
 
   if (ret != 0) {
     TSError("[%s] ts_lua_add_module failed", __FUNCTION__);
+    ts_lua_destroy_vm(&check_ctx, 1);
     return;
   }
 
@@ -374,8 +424,7 @@ TSPluginInit(int argc, const char *argv[])
   TSContDataSet(global_contp, conf);
 
   //adding hook based on whether the lua global function exists.
-  ts_lua_main_ctx *main_ctx = &ts_lua_g_main_ctx_array[0];
-  ts_lua_http_ctx *http_ctx = ts_lua_create_http_ctx(main_ctx, conf);
+  ts_lua_http_ctx *http_ctx = ts_lua_create_http_ctx(&check_ctx, conf);
   lua_State *l = http_ctx->lua;
 
   lua_getglobal(l, TS_LUA_FUNCTION_G_SEND_REQUEST);
@@ -463,5 +512,6 @@ TSPluginInit(int argc, const char *argv[])
   lua_pop(l, 1);
 
   ts_lua_destroy_http_ctx(http_ctx);
+  ts_lua_destroy_vm(&check_ctx, 1);
 
 }
@@ -90,17 +90,31 @@ typedef struct
   char script[TS_LUA_MAX_SCRIPT_FNAME_LENGTH];
   void *conf_vars[TS_LUA_MAX_CONFIG_VARS_COUNT];
 
-  int _first:1;                 // create current instance for 1st ts_lua_main_ctx
-  int _last:1;                  // create current instance for the last ts_lua_main_ctx
+  /* kept for the states that load the instance on their first request */
+  char *chunk;                  // the script file, read once
+  size_t chunk_len;
+  int argc;                     // arguments for __init__
+  char **argv;
 } ts_lua_instance_conf;
 
 
-/* global lua state struct */
+/* per-thread stats of a lua state */
+typedef enum
+{
+  TS_LUA_STAT_CALLS,            // lua function calls
+  TS_LUA_STAT_SCRIPT_TIME,      // nanoseconds spent in those calls
+  TS_LUA_STAT_GC_TIME,          // nanoseconds spent in garbage collection steps
+  TS_LUA_STAT_COUNT
+} TSLuaStat;
+
+/* global lua state struct, each event thread owns one */
 typedef struct
 {
-  lua_State *lua;
-  TSMutex mutexp;
+  lua_State *lua;               // created by the first thread to take the state
+  void *volatile holder;        // thread running in the state, see ts_lua_state_lock()
+  int depth;
   int gref;
+  int stats[TS_LUA_STAT_COUNT]; // created when a thread takes the state, -1 if none
 } ts_lua_main_ctx;
 
 /* lua state for http request */
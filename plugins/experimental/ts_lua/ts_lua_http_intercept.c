@@ -138,11 +138,11 @@ ts_lua_http_intercept_process(ts_lua_http_ctx * http_ctx, TSVConn conn)
 {
   TSCont contp;
   lua_State *l;
-  TSMutex mtxp;
+  ts_lua_main_ctx *main_ctx;
   ts_lua_http_intercept_ctx *ictx;
 
-  mtxp = http_ctx->mctx->mutexp;
-  TSMutexLock(mtxp);
+  main_ctx = http_ctx->mctx;
+  ts_lua_state_lock(main_ctx);
 
   ictx = ts_lua_create_http_intercept_ctx(http_ctx);
 
@@ -169,7 +169,7 @@ ts_lua_http_intercept_process(ts_lua_http_ctx * http_ctx, TSVConn conn)
 
   ts_lua_http_intercept_run_coroutine(ictx, 0);
 
-  TSMutexUnlock(mtxp);
+  ts_lua_state_unlock(main_ctx);
 
 }
 
@@ -193,11 +193,11 @@ static int
 ts_lua_http_intercept_handler(TSCont contp, TSEvent event, void *edata)
 {
   int ret, n;
-  TSMutex mtxp;
+  ts_lua_main_ctx *main_ctx;
   ts_lua_http_intercept_ctx *ictx;
 
   ictx = (ts_lua_http_intercept_ctx *) TSContDataGet(contp);
-  mtxp = NULL;
+  main_ctx = NULL;
 
   if (edata == ictx->input.vio) {
     ret = ts_lua_http_intercept_process_read(event, ictx);
@@ -206,9 +206,9 @@ ts_lua_http_intercept_handler(TSCont contp, TSEvent event, void *edata)
     ret = ts_lua_http_intercept_process_write(event, ictx);
 
   } else {
-    mtxp = ictx->mctx->mutexp;
+    main_ctx = ictx->mctx;
     n = (int64_t) edata & 0xFFFF;
-    TSMutexLock(mtxp);
+    ts_lua_state_lock(main_ctx);
     ret = ts_lua_http_intercept_run_coroutine(ictx, n);
   }
 
@@ -216,16 +216,16 @@ ts_lua_http_intercept_handler(TSCont contp, TSEvent event, void *edata)
 
     TSContDestroy(contp);
 
-    if (!mtxp) {
-      mtxp = ictx->mctx->mutexp;
-      TSMutexLock(mtxp);
+    if (!main_ctx) {
+      main_ctx = ictx->mctx;
+      ts_lua_state_lock(main_ctx);
     }
 
     ts_lua_destroy_http_intercept_ctx(ictx);
   }
 
-  if (mtxp)
-    TSMutexUnlock(mtxp);
+  if (main_ctx)
+    ts_lua_state_unlock(main_ctx);
 
   return 0;
 }
@@ -30,17 +30,11 @@ typedef struct
 } ts_lua_package_path;
 
 
-static int g_path_cnt = 0;
-static ts_lua_package_path g_path[TS_LUA_MAX_PACKAGE_NUM];
-
-static int g_cpath_cnt = 0;
-static ts_lua_package_path g_cpath[TS_LUA_MAX_PACKAGE_NUM];
-
-
 static int ts_lua_add_package_path(lua_State * L);
 static int ts_lua_add_package_cpath(lua_State * L);
 static int ts_lua_add_package_path_items(lua_State * L, ts_lua_package_path * pp, int n);
 static int ts_lua_add_package_cpath_items(lua_State * L, ts_lua_package_path * pp, int n);
+static int ts_lua_package_has(lua_State * L, const char *field, const char *item, size_t item_len);
 
 
 void
@@ -62,9 +56,8 @@ ts_lua_add_package_path(lua_State * L)
   const char *data;
   const char *ptr, *end, *hit;
   size_t dlen;
-  size_t i, n, item_len;
+  size_t n, item_len;
   ts_lua_package_path pp[TS_LUA_MAX_PACKAGE_NUM];
-  ts_lua_package_path *elt;
 
   conf = ts_lua_get_instance_conf(L);
   if (conf == NULL) {
@@ -89,16 +82,9 @@ ts_lua_add_package_path(lua_State * L)
 
     if (item_len > 0) {
 
-      for (i = 0; i < g_path_cnt; i++) {
-        if (g_path[i].len == item_len && memcmp(g_path[i].name, ptr, item_len) == 0)    // exist
-        {
-          break;
-        }
-      }
-
-      if (i >= g_path_cnt) {
+      if (!ts_lua_package_has(L, "path", ptr, item_len)) {
 
-        if (n + i >= TS_LUA_MAX_PACKAGE_NUM)
+        if (n >= TS_LUA_MAX_PACKAGE_NUM)
           return luaL_error(L, "extended package path number exceeds %d.", TS_LUA_MAX_PACKAGE_NUM);
 
         pp[n].name = (char *) ptr;
@@ -112,19 +98,6 @@ ts_lua_add_package_path(lua_State * L)
 
   if (n > 0) {
     ts_lua_add_package_path_items(L, pp, n);
-
-    if (conf->_last) {
-      elt = &g_path[g_path_cnt];
-
-      for (i = 0; i < n; i++) {
-        elt->len = pp[i].len;
-        elt->name = (char *) TSmalloc(pp[i].len);
-        memcpy(elt->name, pp[i].name, pp[i].len);
-        elt++;
-      }
-
-      g_path_cnt += n;
-    }
   }
 
   return 0;
@@ -183,9 +156,8 @@ ts_lua_add_package_cpath(lua_State * L)
   const char *data;
   const char *ptr, *end, *hit;
   size_t dlen;
-  size_t i, n, item_len;
+  size_t n, item_len;
   ts_lua_package_path pp[TS_LUA_MAX_PACKAGE_NUM];
-  ts_lua_package_path *elt;
 
   conf = ts_lua_get_instance_conf(L);
   if (conf == NULL) {
@@ -210,16 +182,9 @@ ts_lua_add_package_cpath(lua_State * L)
 
     if (item_len > 0) {
 
-      for (i = 0; i < g_cpath_cnt; i++) {
-        if (g_cpath[i].len == item_len && memcmp(g_cpath[i].name, ptr, item_len) == 0)  // exist
-        {
-          break;
-        }
-      }
-
-      if (i >= g_cpath_cnt) {
+      if (!ts_lua_package_has(L, "cpath", ptr, item_len)) {
 
-        if (n + i >= TS_LUA_MAX_PACKAGE_NUM)
+        if (n >= TS_LUA_MAX_PACKAGE_NUM)
           return luaL_error(L, "extended package cpath number exceeds %d.", TS_LUA_MAX_PACKAGE_NUM);
 
         pp[n].name = (char *) ptr;
@@ -233,19 +198,6 @@ ts_lua_add_package_cpath(lua_State * L)
 
   if (n > 0) {
     ts_lua_add_package_cpath_items(L, pp, n);
-
-    if (conf->_last) {
-      elt = &g_cpath[g_cpath_cnt];
-
-      for (i = 0; i < n; i++) {
-        elt->len = pp[i].len;
-        elt->name = (char *) TSmalloc(pp[i].len);
-        memcpy(elt->name, pp[i].name, pp[i].len);
-        elt++;
-      }
-
-      g_cpath_cnt += n;
-    }
   }
 
   return 0;
@@ -295,3 +247,43 @@ ts_lua_add_package_cpath_items(lua_State * L, ts_lua_package_path * pp, int n)
 
   return 0;
 }
+
+/* Whether package.@field of this state has @item already. Each state loads
+   the instances on its own, so it is the state's own path that counts. */
+static int
+ts_lua_package_has(lua_State * L, const char *field, const char *item, size_t item_len)
+{
+  const char *path, *ptr, *end, *hit;
+  size_t path_len, len;
+  int found;
+
+  found = 0;
+
+  lua_getglobal(L, "package");
+
+  if (lua_istable(L, -1)) {
+    lua_getfield(L, -1, field);
+    path = lua_tolstring(L, -1, &path_len);
+
+    if (path) {
+      ptr = path;
+      end = path + path_len;
+
+      while (ptr < end && !found) {
+        hit = memchr(ptr, ';', end - ptr);
+        len = hit ? (size_t) (hit - ptr) : (size_t) (end - ptr);
+
+        if (len == item_len && memcmp(ptr, item, item_len) == 0)
+          found = 1;
+
+        ptr += len + 1;
+      }
+    }
+
+    lua_pop(L, 1);
+  }
+
+  lua_pop(L, 1);
+
+  return found;
+}
@@ -70,10 +70,10 @@ ts_lua_transform_handler(TSCont contp, ts_lua_transform_ctx * transform_ctx)
   int ret, eos;
 
   lua_State *L;
-  TSMutex mtxp;
+  ts_lua_main_ctx *main_ctx;
 
   L = transform_ctx->hctx->lua;
-  mtxp = transform_ctx->hctx->mctx->mutexp;
+  main_ctx = transform_ctx->hctx->mctx;
 
   output_conn = TSTransformOutputVConnGet(contp);
   input_vio = TSVConnWriteVIOGet(contp);
@@ -106,7 +106,7 @@ ts_lua_transform_handler(TSCont contp, ts_lua_transform_ctx * transform_ctx)
   if (towrite > avail)
     towrite = avail;
 
-  TSMutexLock(mtxp);
+  ts_lua_state_lock(main_ctx);
 
   blk = TSIOBufferReaderStart(input_reader);
 
@@ -130,7 +130,7 @@ ts_lua_transform_handler(TSCont contp, ts_lua_transform_ctx * transform_ctx)
       lua_pushinteger(L, 0);    /* second param, not finish */
     }
 
-    if (lua_pcall(L, 2, 2, 0)) {
+    if (ts_lua_pcall(transform_ctx->hctx->mctx, L, 2, 2)) {
       TSError("lua_pcall failed: %s", lua_tostring(L, -1));
     }
 
@@ -153,7 +153,7 @@ ts_lua_transform_handler(TSCont contp, ts_lua_transform_ctx * transform_ctx)
 
   } while (blk && towrite > 0);
 
-  TSMutexUnlock(mtxp);
+  ts_lua_state_unlock(main_ctx);
 
   TSIOBufferReaderConsume(input_reader, avail);
   TSVIONDoneSet(input_vio, upstream_done + avail);
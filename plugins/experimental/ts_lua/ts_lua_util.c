@@ -17,6 +17,9 @@
 */
 
 
+#include <errno.h>
+#include <sched.h>
+
 #include "ts_lua_util.h"
 #include "ts_lua_remap.h"
 #include "ts_lua_client_request.h"
@@ -39,24 +42,23 @@ static void ts_lua_init_globals(lua_State * L);
 static void ts_lua_inject_ts_api(lua_State * L);
 
 
+/* identifies the calling thread to ts_lua_state_lock() */
+static __thread char ts_lua_thread_tag;
+
 int
 ts_lua_create_vm(ts_lua_main_ctx * arr, int n)
 {
-  int i;
-  lua_State *L;
+  int i, t;
 
+  /* The states themselves are created by the threads that take them, so
+     there are only as many as there are threads running scripts. */
   for (i = 0; i < n; i++) {
+    arr[i].lua = NULL;
+    arr[i].holder = NULL;
+    arr[i].depth = 0;
 
-    L = ts_lua_new_state();
-
-    if (L == NULL)
-      return -1;
-
-    lua_pushvalue(L, LUA_GLOBALSINDEX);
-
-    arr[i].gref = luaL_ref(L, LUA_REGISTRYINDEX);       /* L[REG][gref] = L[GLOBAL] */
-    arr[i].lua = L;
-    arr[i].mutexp = TSMutexCreate();
+    for (t = 0; t < TS_LUA_STAT_COUNT; t++)
+      arr[i].stats[t] = -1;
   }
 
   return 0;
@@ -73,11 +75,141 @@ ts_lua_destroy_vm(ts_lua_main_ctx * arr, int n)
     L = arr[i].lua;
     if (L)
       lua_close(L);
+
+    arr[i].lua = NULL;
   }
 
   return;
 }
 
+int
+ts_lua_create_state(ts_lua_main_ctx * main_ctx)
+{
+  lua_State *L;
+
+  L = ts_lua_new_state();
+
+  if (L == NULL)
+    return -1;
+
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+
+  main_ctx->gref = luaL_ref(L, LUA_REGISTRYINDEX);      /* L[REG][gref] = L[GLOBAL] */
+  main_ctx->lua = L;
+
+  return 0;
+}
+
+/* A state is entered with a CAS on its holder. The thread the state belongs
+   to is nearly always the only one entering it, and that is all it pays.
+   Hooks, transforms and intercepts of its transactions which run on another
+   thread, and the thread loading a remap configuration, wait for their turn.
+   A thread may enter a state it is already in. */
+void
+ts_lua_state_lock(ts_lua_main_ctx * main_ctx)
+{
+  void *self = &ts_lua_thread_tag;
+
+  if (main_ctx->holder == self) {
+    main_ctx->depth++;
+    return;
+  }
+
+  while (!__sync_bool_compare_and_swap(&main_ctx->holder, NULL, self))
+    sched_yield();
+
+  main_ctx->depth = 1;
+}
+
+void
+ts_lua_state_unlock(ts_lua_main_ctx * main_ctx)
+{
+  if (--main_ctx->depth == 0)
+    __sync_lock_release(&main_ctx->holder);
+}
+
+static void
+ts_lua_create_stats(ts_lua_main_ctx * main_ctx, const char *name, int id)
+{
+  static const char *stat_names[TS_LUA_STAT_COUNT] = { "calls", "script_time", "gc_time" };
+  char buf[128];
+  int i;
+
+  for (i = 0; i < TS_LUA_STAT_COUNT; i++) {
+    snprintf(buf, sizeof(buf), "plugin.ts_lua.%s.thread_%d.%s", name, id, stat_names[i]);
+    main_ctx->stats[i] = TSStatCreate(buf, TS_RECORDDATATYPE_INT, TS_STAT_NON_PERSISTENT, TS_STAT_SYNC_SUM);
+  }
+}
+
+ts_lua_main_ctx *
+ts_lua_get_thread_main_ctx(ts_lua_main_ctx * arr, int n, pthread_key_t key, int *next, const char *name)
+{
+  ts_lua_main_ctx *main_ctx;
+  int id;
+
+  main_ctx = pthread_getspecific(key);
+
+  if (main_ctx == NULL) {
+    /* first call from this thread, take the next state. Only with more threads
+       than states do threads share one, and then they take turns in it. */
+    id = __sync_fetch_and_add(next, 1);
+    main_ctx = &arr[id % n];
+
+    ts_lua_state_lock(main_ctx);
+
+    if (main_ctx->lua == NULL && ts_lua_create_state(main_ctx)) {
+      ts_lua_state_unlock(main_ctx);
+      TSError("[%s] could not create a lua state", __FUNCTION__);
+      return NULL;
+    }
+
+    if (id < n)
+      ts_lua_create_stats(main_ctx, name, id);
+
+    ts_lua_state_unlock(main_ctx);
+
+    pthread_setspecific(key, main_ctx);
+    TSDebug(TS_LUA_DEBUG_TAG, "[%s] %s lua state %d taken by thread %p", __FUNCTION__, name, id % n, TSThreadSelf());
+  }
+
+  return main_ctx;
+}
+
+static inline void
+ts_lua_stat_incr(ts_lua_main_ctx * main_ctx, TSLuaStat stat, TSMgmtInt amount)
+{
+  if (main_ctx->stats[stat] >= 0)
+    TSStatIntIncrement(main_ctx->stats[stat], amount);
+}
+
+int
+ts_lua_pcall(ts_lua_main_ctx * main_ctx, lua_State * l, int nargs, int nresults)
+{
+  TSHRTime start;
+  int ret;
+
+  start = TShrtime();
+  ret = lua_pcall(l, nargs, nresults, 0);
+
+  ts_lua_stat_incr(main_ctx, TS_LUA_STAT_CALLS, 1);
+  ts_lua_stat_incr(main_ctx, TS_LUA_STAT_SCRIPT_TIME, TShrtime() - start);
+
+  return ret;
+}
+
+/* Do one incremental collection step between transactions, so that less of
+   the collector's work lands inside the scripts, and account for it. */
+static void
+ts_lua_gc_step(ts_lua_main_ctx * main_ctx)
+{
+  TSHRTime start;
+
+  start = TShrtime();
+  lua_gc(main_ctx->lua, LUA_GCSTEP, 0);
+
+  ts_lua_stat_incr(main_ctx, TS_LUA_STAT_GC_TIME, TShrtime() - start);
+}
+
 lua_State *
 ts_lua_new_state()
 {
@@ -98,101 +230,185 @@ ts_lua_new_state()
   return L;
 }
 
-int
-ts_lua_add_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * arr, int n, int argc, char *argv[])
+/* Load the module of @conf into the state @main_ctx, which is locked. */
+static int
+ts_lua_add_module_state(ts_lua_instance_conf * conf, ts_lua_main_ctx * main_ctx)
 {
-  int i, ret;
+  int ret;
   int t;
+  const char *chunk;
+  size_t chunk_len;
+  char chunk_name[TS_LUA_MAX_SCRIPT_FNAME_LENGTH + 1];
   lua_State *L;
 
-  for (i = 0; i < n; i++) {
-    conf->_first = (i == 0) ? 1 : 0;
-    conf->_last = (i == n - 1) ? 1 : 0;
+  L = main_ctx->lua;
 
-    TSMutexLock(arr[i].mutexp);
+  lua_newtable(L);              /* new TB1 */
+  lua_pushvalue(L, -1);         /* new TB2 */
+  lua_setfield(L, -2, "_G");    /* TB1[_G] = TB2 empty table, we can change _G to xx */
+  lua_newtable(L);              /* new TB3 */
+  lua_rawgeti(L, LUA_REGISTRYINDEX, main_ctx->gref);    /* push L[GLOBAL] */
+  lua_setfield(L, -2, "__index");       /* TB3[__index] = L[GLOBAL] which has ts.xxx api */
+  lua_setmetatable(L, -2);      /* TB1[META]  = TB3 */
+  lua_replace(L, LUA_GLOBALSINDEX);     /* L[GLOBAL] = TB1 */
 
-    L = arr[i].lua;
+  ts_lua_set_instance_conf(L, conf);
 
-    lua_newtable(L);            /* new TB1 */
-    lua_pushvalue(L, -1);       /* new TB2 */
-    lua_setfield(L, -2, "_G");  /* TB1[_G] = TB2 empty table, we can change _G to xx */
-    lua_newtable(L);            /* new TB3 */
-    lua_rawgeti(L, LUA_REGISTRYINDEX, arr[i].gref);     /* push L[GLOBAL] */
-    lua_setfield(L, -2, "__index");     /* TB3[__index] = L[GLOBAL] which has ts.xxx api */
-    lua_setmetatable(L, -2);    /* TB1[META]  = TB3 */
-    lua_replace(L, LUA_GLOBALSINDEX);   /* L[GLOBAL] = TB1 */
-
-    ts_lua_set_instance_conf(L, conf);
-
-    if (conf->content) {
-      if (luaL_loadstring(L, conf->content)) {
-        TSError("[%s] luaL_loadstring %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
-        lua_pop(L, 1);
-        TSMutexUnlock(arr[i].mutexp);
-        return -1;
-      }
+  if (conf->content) {
+    if (luaL_loadstring(L, conf->content)) {
+      TSError("[%s] luaL_loadstring %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
+      lua_pop(L, 1);
+      goto fail;
+    }
 
-    } else if (conf->script) { 
-      if (luaL_loadfile(L, conf->script)) {
-        TSError("[%s] luaL_loadfile %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
-        lua_pop(L, 1);
-        TSMutexUnlock(arr[i].mutexp);
-        return -1;
+  } else if (conf->chunk) {
+    /* skip a "#!" line the way luaL_loadfile does, keeping the line numbers */
+    chunk = conf->chunk;
+    chunk_len = conf->chunk_len;
+    if (chunk_len && chunk[0] == '#') {
+      while (chunk_len && chunk[0] != '\n') {
+        chunk++;
+        chunk_len--;
       }
     }
 
-    if (lua_pcall(L, 0, 0, 0)) {
-      TSError("[%s] lua_pcall %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
+    snprintf(chunk_name, sizeof(chunk_name), "@%s", conf->script);
+    if (luaL_loadbuffer(L, chunk, chunk_len, chunk_name)) {
+      TSError("[%s] luaL_loadbuffer %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
       lua_pop(L, 1);
-      TSMutexUnlock(arr[i].mutexp);
-      return -1;
+      goto fail;
     }
+  }
 
-    /* call "__init__", to parse parameters */
-    lua_getglobal(L, "__init__");
+  if (lua_pcall(L, 0, 0, 0)) {
+    TSError("[%s] lua_pcall %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
+    lua_pop(L, 1);
+    goto fail;
+  }
 
-    if (lua_type(L, -1) == LUA_TFUNCTION) {
+  /* call "__init__", to parse parameters */
+  lua_getglobal(L, "__init__");
 
-      lua_newtable(L);
+  if (lua_type(L, -1) == LUA_TFUNCTION) {
 
-      for (t = 0; t < argc; t++) {
-        lua_pushnumber(L, t);
-        lua_pushstring(L, argv[t]);
-        lua_rawset(L, -3);
-      }
+    lua_newtable(L);
 
-      if (lua_pcall(L, 1, 1, 0)) {
-        TSError("[%s] lua_pcall %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
-        lua_pop(L, 1);
-        TSMutexUnlock(arr[i].mutexp);
-        return -1;
-      }
+    for (t = 0; t < conf->argc; t++) {
+      lua_pushnumber(L, t);
+      lua_pushstring(L, conf->argv[t]);
+      lua_rawset(L, -3);
+    }
 
-      ret = lua_tonumber(L, -1);
+    if (lua_pcall(L, 1, 1, 0)) {
+      TSError("[%s] lua_pcall %s failed: %s", __FUNCTION__, conf->script, lua_tostring(L, -1));
       lua_pop(L, 1);
+      goto fail;
+    }
 
-      if (ret) {
-        TSMutexUnlock(arr[i].mutexp);
-        return -1;              /* script parse error */
-      }
+    ret = lua_tonumber(L, -1);
+    lua_pop(L, 1);
 
-    } else {
-      lua_pop(L, 1);            /* pop nil */
-    }
+    if (ret)
+      goto fail;                /* script parse error */
 
-    lua_pushlightuserdata(L, conf);
-    lua_pushvalue(L, LUA_GLOBALSINDEX);
-    lua_rawset(L, LUA_REGISTRYINDEX);   /* L[REG][conf] = L[GLOBAL] */
+  } else {
+    lua_pop(L, 1);              /* pop nil */
+  }
 
-    lua_newtable(L);
-    lua_replace(L, LUA_GLOBALSINDEX);   /* L[GLOBAL] = EMPTY */
+  lua_pushlightuserdata(L, conf);
+  lua_pushvalue(L, LUA_GLOBALSINDEX);
+  lua_rawset(L, LUA_REGISTRYINDEX);     /* L[REG][conf] = L[GLOBAL] */
+
+  lua_newtable(L);
+  lua_replace(L, LUA_GLOBALSINDEX);     /* L[GLOBAL] = EMPTY */
+
+  return 0;
+
+fail:
+  lua_newtable(L);
+  lua_replace(L, LUA_GLOBALSINDEX);     /* L[GLOBAL] = EMPTY */
+
+  return -1;
+}
+
+/* Load @conf into @main_ctx on the first request for it there. The state is locked. */
+static int
+ts_lua_load_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * main_ctx)
+{
+  lua_State *L;
+  int loaded;
+
+  L = main_ctx->lua;
+
+  lua_pushlightuserdata(L, conf);
+  lua_rawget(L, LUA_REGISTRYINDEX);
+  loaded = !lua_isnil(L, -1);
+  lua_pop(L, 1);
+
+  if (loaded)
+    return 0;
+
+  TSDebug(TS_LUA_DEBUG_TAG, "[%s] loading %s into lua state %p", __FUNCTION__, conf->script, main_ctx);
+  return ts_lua_add_module_state(conf, main_ctx);
+}
 
-    TSMutexUnlock(arr[i].mutexp);
+/* Read the script file of @conf, so that every state loads the same code. */
+static int
+ts_lua_read_script(ts_lua_instance_conf * conf)
+{
+  FILE *fp;
+  long len;
+
+  fp = fopen(conf->script, "r");
+  if (fp == NULL) {
+    TSError("[%s] could not open %s: %s", __FUNCTION__, conf->script, strerror(errno));
+    return -1;
   }
 
+  if (fseek(fp, 0, SEEK_END) || (len = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET)) {
+    TSError("[%s] could not read %s: %s", __FUNCTION__, conf->script, strerror(errno));
+    fclose(fp);
+    return -1;
+  }
+
+  conf->chunk = TSmalloc(len + 1);
+  conf->chunk_len = fread(conf->chunk, 1, len, fp);
+  conf->chunk[conf->chunk_len] = '\0';
+
+  if (ferror(fp)) {
+    TSError("[%s] could not read %s", __FUNCTION__, conf->script);
+    fclose(fp);
+    return -1;
+  }
+
+  fclose(fp);
   return 0;
 }
 
+/* Keep what the states need to load @conf on their first request for it, and
+   check that it loads by loading it into @main_ctx, a state of the caller. */
+int
+ts_lua_add_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * main_ctx, int argc, char *argv[])
+{
+  int i;
+
+  conf->argc = argc;
+  conf->argv = TSmalloc(sizeof(char *) * (argc + 1));
+
+  for (i = 0; i < argc; i++)
+    conf->argv[i] = TSstrdup(argv[i]);
+
+  conf->argv[argc] = NULL;
+
+  /* an inline script is the first argument, which the caller may free */
+  if (conf->content)
+    conf->content = conf->argv[0];
+  else if (ts_lua_read_script(conf))
+    return -1;
+
+  return ts_lua_add_module_state(conf, main_ctx);
+}
+
 int
 ts_lua_del_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * arr, int n)
 {
@@ -201,13 +417,25 @@ ts_lua_del_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * arr, int n)
 
   for (i = 0; i < n; i++) {
 
-    TSMutexLock(arr[i].mutexp);
+    ts_lua_state_lock(&arr[i]);
 
     L = arr[i].lua;
 
-    /* call "__clean__", to clean resources */
+    if (L == NULL) {
+      ts_lua_state_unlock(&arr[i]);
+      continue;
+    }
+
+    /* only the states which had a request for it have loaded it */
     lua_pushlightuserdata(L, conf);
     lua_rawget(L, LUA_REGISTRYINDEX);
+
+    if (lua_isnil(L, -1)) {
+      lua_pop(L, 1);
+      ts_lua_state_unlock(&arr[i]);
+      continue;
+    }
+
     lua_replace(L, LUA_GLOBALSINDEX);   /* L[GLOBAL] = L[REG][conf] */
 
     lua_getglobal(L, "__clean__");      /* get __clean__ function */
@@ -229,7 +457,7 @@ ts_lua_del_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * arr, int n)
     lua_newtable(L);
     lua_replace(L, LUA_GLOBALSINDEX);   /* L[GLOBAL] = EMPTY  */
 
-    TSMutexUnlock(arr[i].mutexp);
+    ts_lua_state_unlock(&arr[i]);
   }
 
   return 0;
@@ -242,8 +470,19 @@ ts_lua_init_instance(ts_lua_instance_conf * conf ATS_UNUSED)
 }
 
 int
-ts_lua_del_instance(ts_lua_instance_conf * conf ATS_UNUSED)
+ts_lua_del_instance(ts_lua_instance_conf * conf)
 {
+  int i;
+
+  if (conf->argv) {
+    for (i = 0; i < conf->argc; i++)
+      TSfree(conf->argv[i]);
+
+    TSfree(conf->argv);
+  }
+
+  TSfree(conf->chunk);
+
   return 0;
 }
 
@@ -345,6 +584,9 @@ ts_lua_create_http_ctx(ts_lua_main_ctx * main_ctx, ts_lua_instance_conf * conf)
 
   L = main_ctx->lua;
 
+  if (ts_lua_load_module(conf, main_ctx))
+    return NULL;
+
   size = TS_LUA_MEM_ALIGN(sizeof(ts_lua_http_ctx));
   http_ctx = TSmalloc(size);
 
@@ -418,6 +660,8 @@ ts_lua_destroy_http_ctx(ts_lua_http_ctx * http_ctx)
 
   luaL_unref(main_ctx->lua, LUA_REGISTRYINDEX, http_ctx->ref);
   TSfree(http_ctx);
+
+  ts_lua_gc_step(main_ctx);
 }
 
 void
@@ -532,7 +776,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
   ret = 0;
   l = http_ctx->lua;
 
-  TSMutexLock(main_ctx->mutexp);
+  ts_lua_state_lock(main_ctx);
 
   switch (event) {
 
@@ -541,7 +785,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
     lua_getglobal(l, TS_LUA_FUNCTION_POST_REMAP);
 
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -555,7 +799,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
     lua_getglobal(l, TS_LUA_FUNCTION_CACHE_LOOKUP_COMPLETE);
 
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -569,7 +813,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
     lua_getglobal(l, TS_LUA_FUNCTION_SEND_REQUEST);
 
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -583,7 +827,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
     lua_getglobal(l, TS_LUA_FUNCTION_READ_RESPONSE);
 
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -597,7 +841,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
     lua_getglobal(l, TS_LUA_FUNCTION_SEND_RESPONSE);
 
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -610,7 +854,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
 
     lua_getglobal(l, TS_LUA_FUNCTION_READ_REQUEST);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -623,7 +867,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
 
     lua_getglobal(l, TS_LUA_FUNCTION_TXN_START);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -636,7 +880,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
 
     lua_getglobal(l, TS_LUA_FUNCTION_PRE_REMAP);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
     
@@ -649,7 +893,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
 
     lua_getglobal(l, TS_LUA_FUNCTION_OS_DNS);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -662,7 +906,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
 
     lua_getglobal(l, TS_LUA_FUNCTION_SELECT_ALT);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -675,7 +919,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
 
     lua_getglobal(l, TS_LUA_FUNCTION_READ_CACHE);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -687,7 +931,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
   case TS_EVENT_HTTP_TXN_CLOSE:
     lua_getglobal(l, TS_LUA_FUNCTION_TXN_CLOSE);
     if (lua_type(l, -1) == LUA_TFUNCTION) {
-      if (lua_pcall(l, 0, 1, 0)) {
+      if (ts_lua_pcall(main_ctx, l, 0, 1)) {
         TSError("lua_pcall failed: %s", lua_tostring(l, -1));
       }
 
@@ -702,7 +946,7 @@ ts_lua_http_cont_handler(TSCont contp, TSEvent event, void *edata)
     break;
   }
 
-  TSMutexUnlock(main_ctx->mutexp);
+  ts_lua_state_unlock(main_ctx);
 
   if (ret) {
     TSHttpTxnReenable(txnp, TS_EVENT_HTTP_ERROR);
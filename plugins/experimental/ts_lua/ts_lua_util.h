@@ -20,12 +20,22 @@
 #ifndef _TS_LUA_UTIL_H
 #define _TS_LUA_UTIL_H
 
+#include <pthread.h>
+
 #include "ts_lua_common.h"
 
 int ts_lua_create_vm(ts_lua_main_ctx * arr, int n);
 void ts_lua_destroy_vm(ts_lua_main_ctx * arr, int n);
+int ts_lua_create_state(ts_lua_main_ctx * main_ctx);
+ts_lua_main_ctx *ts_lua_get_thread_main_ctx(ts_lua_main_ctx * arr, int n, pthread_key_t key, int *next,
+                                            const char *name);
+
+void ts_lua_state_lock(ts_lua_main_ctx * main_ctx);
+void ts_lua_state_unlock(ts_lua_main_ctx * main_ctx);
+
+int ts_lua_pcall(ts_lua_main_ctx * main_ctx, lua_State * l, int nargs, int nresults);
 
-int ts_lua_add_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * arr, int n, int argc, char *argv[]);
+int ts_lua_add_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * main_ctx, int argc, char *argv[]);
 
 int ts_lua_del_module(ts_lua_instance_conf * conf, ts_lua_main_ctx * arr, int n);
 
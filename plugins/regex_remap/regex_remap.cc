@@ -47,6 +47,7 @@
 #include "ink_platform.h"
 #include "ink_atomic.h"
 #include "ink_time.h"
+#include "Regex.h"
 
 static const char* PLUGIN_NAME = "regex_remap";
 
@@ -117,7 +118,7 @@ class RemapRegex
 {
  public:
   RemapRegex() :
-    _num_subs(-1), _rex(NULL), _extra(NULL), _options(0), _order(-1),
+    _num_subs(-1), _rex(NULL), _extra(NULL), _options(0), _order(-1), _prefilter_id(-1),
     _lowercase_substitutions(false),
     _active_timeout(-1), _no_activity_timeout(-1), _connect_timeout(-1), _dns_timeout(-1),
     _first_override(NULL)
@@ -135,7 +136,7 @@ class RemapRegex
       pcre_free(_rex);
     }
     if (_extra) {
-      pcre_free(_extra);
+      regex_free_study(_extra);
     }
   }
 
@@ -177,6 +178,10 @@ class RemapRegex
   inline void set_order(int order) { _order = order; }
   inline int order() { return _order; }
 
+  // id of the regex in the prefilter of the instance
+  inline void set_prefilter_id(int id) { _prefilter_id = id; }
+  inline int prefilter_id() const { return _prefilter_id; }
+
   // Various getters
   inline const char* regex() const { return _rex_string;  }
   inline const char* substitution() const { return _subst;  }
@@ -214,6 +219,7 @@ class RemapRegex
   int _sub_ix[MAX_SUBS];
   RemapRegex* _next;
   int _order;
+  int _prefilter_id;
   TSHttpStatus _status;
   bool _lowercase_substitutions;
   int _active_timeout;
@@ -351,7 +357,7 @@ RemapRegex::compile(const char** error, int* erroffset)
     return -1;
   }
 
-  _extra = pcre_study(_rex, 0, error);
+  _extra = pcre_study(_rex, RE_STUDY_OPTIONS, error);
   if ((_extra == NULL) && (*error != 0)) {
     return -1;
   }
@@ -590,6 +596,7 @@ struct RemapInstance
 
   RemapRegex* first;
   RemapRegex* last;
+  RegexPrefilter prefilter; // which of the regexes can match a URL
   bool profile;
   bool method;
   bool query_string;
@@ -780,6 +787,7 @@ TSRemapNewInstance(int argc, char* argv[], void** ih, char* /* errbuf ATS_UNUSED
       TSDebug(PLUGIN_NAME, "Added regex=%s with subs=%s and options `%s'",
                regex.c_str(), subst.c_str(), options.c_str());
       cur->set_order(++count);
+      cur->set_prefilter_id(ri->prefilter.add(regex.c_str()));
       if (ri->first == NULL) {
         ri->first = cur;
       } else {
@@ -796,6 +804,8 @@ TSRemapNewInstance(int argc, char* argv[], void** ih, char* /* errbuf ATS_UNUSED
     return TS_ERROR;
   }
 
+  ri->prefilter.compile();
+
   return TS_SUCCESS;
 }
 
@@ -920,10 +930,13 @@ TSRemapDoRemap(void* ih, TSHttpTxn txnp, TSRemapRequestInfo *rri)
   match_buf[match_len] = '\0'; // NULL terminate the match string
   TSDebug(PLUGIN_NAME, "Target match string is `%s'", match_buf);
 
-  // Apply the regular expressions, in order. First one wins.
+  // Only the regexes that pass the prefilter can match, but apply them in order. First one wins.
+  RegexPrefilter::Matches candidates;
+  ri->prefilter.scan(match_buf, match_len, candidates);
+
   while (re) {
     // Since we check substitutions on parse time, we don't need to reset ovector
-    if (re->match(match_buf, match_len, ovector) != -1) {
+    if (candidates.test(re->prefilter_id()) && re->match(match_buf, match_len, ovector) != -1) {
       int new_len = re->get_lengths(ovector, lengths, rri, &req_url);
 
       // Set timeouts
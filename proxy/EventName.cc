@@ -33,7 +33,7 @@
 //#include "P_Cluster.h"
 #include "I_HostDB.h"
 #include "BaseManager.h"
-#include "P_MultiCache.h"
+#include "P_HostDBTable.h"
 
 /*-------------------------------------------------------------------------
   event_int_to_string
@@ -77,7 +77,7 @@ event_int_to_string(int event, int blen, char *buffer)
     case DNS_EVENT_EVENTS_START: return "DNS_EVENT_EVENTS_START";
 
 
-    case MULTI_CACHE_EVENT_SYNC: return "MULTI_CACHE_EVENT_SYNC";
+    case HOST_DB_TABLE_EVENT_SYNC: return "HOST_DB_TABLE_EVENT_SYNC";
 
     case CACHE_EVENT_LOOKUP: return "CACHE_EVENT_LOOKUP";
     case CACHE_EVENT_LOOKUP_FAILED: return "CACHE_EVENT_LOOKUP_FAILED";
@@ -44,12 +44,14 @@
 #include "UrlRewrite.h"
 #include "UrlMapping.h"
 
-/** Time till we free the old stuff after a reconfiguration. */
-#define URL_REWRITE_TIMEOUT            (HRTIME_SECOND*60)
+/** How often a replaced table checks whether its last reference is gone. */
+#define URL_REWRITE_RELEASE_PERIOD     HRTIME_SECOND
 
 // Global Ptrs
 static Ptr<ProxyMutex> reconfig_mutex;
 UrlRewrite *rewrite_table = NULL;
+// Held by the threads that are not regular event threads while they take a reference, and by the swap
+static ink_mutex rewrite_table_mutex;
 remap_plugin_info *remap_pi_list; // We never reload the remap plugins, just append to 'em.
 
 // Tokens for the Callback function
@@ -69,11 +71,90 @@ int url_remap_mode;
 // Begin API Functions
 //
 
+static void
+url_rewrite_stats_init()
+{
+  url_rewrite_rsb = RecAllocateRawStatBlock((int) url_rewrite_stat_count);
+
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.reloads",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) url_rewrite_reloads_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.reload_failures",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) url_rewrite_reload_failures_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.last_reload_msec",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) url_rewrite_last_reload_msec_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.last_reload_peak_rss",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) url_rewrite_last_reload_peak_rss_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.last_reload_rss_growth",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) url_rewrite_last_reload_rss_growth_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.tables",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) url_rewrite_tables_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(url_rewrite_rsb, RECT_PROCESS, "proxy.process.url_remap.plugin_instances_reused",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) url_rewrite_plugin_instances_reused_stat,
+                     RecRawStatSyncCount);
+}
+
+/** Starts a new peak resident size for url_rewrite_peak_rss(), if the kernel lets us. */
+static void
+url_rewrite_reset_peak_rss()
+{
+#if defined(linux)
+  int fd = open("/proc/self/clear_refs", O_WRONLY);
+
+  if (fd >= 0) {
+    ATS_UNUSED_RETURN(write(fd, "5", 1));
+    close(fd);
+  }
+#endif
+}
+
+/** Peak resident size of the process in bytes (VmHWM), or 0 if we can't tell. */
+static int64_t
+url_rewrite_peak_rss()
+{
+  int64_t rss = 0;
+#if defined(linux)
+  FILE *fp = fopen("/proc/self/status", "r");
+  char line[256];
+  long long kb;
+
+  if (fp) {
+    while (fgets(line, sizeof(line), fp)) {
+      if (sscanf(line, "VmHWM: %lld kB", &kb) == 1) {
+        rss = (int64_t) kb * 1024;
+        break;
+      }
+    }
+    fclose(fp);
+  }
+#endif
+  return rss;
+}
+
+/** Resident size of the process in bytes, or 0 if we can't tell. */
+static int64_t
+url_rewrite_rss()
+{
+  int64_t rss = 0;
+#if defined(linux)
+  FILE *fp = fopen("/proc/self/statm", "r");
+  long long size, resident;
+
+  if (fp) {
+    if (fscanf(fp, "%lld %lld", &size, &resident) == 2)
+      rss = (int64_t) resident * getpagesize();
+    fclose(fp);
+  }
+#endif
+  return rss;
+}
+
 int
 init_reverse_proxy()
 {
   ink_assert(rewrite_table == NULL);
   reconfig_mutex = new_ProxyMutex();
+  ink_mutex_init(&rewrite_table_mutex, "rewrite_table");
+  url_rewrite_stats_init();
   rewrite_table = new UrlRewrite();
 
   if (!rewrite_table->is_valid()) {
@@ -113,13 +194,63 @@ request_url_remap(HttpTransact::State * /* s ATS_UNUSED */, HTTPHdr * /* request
 mapping_type
 request_url_remap_redirect(HTTPHdr *request_header, URL *redirect_url)
 {
-  return rewrite_table ? rewrite_table->Remap_redirect(request_header, redirect_url) : NONE;
+  UrlRewrite *table = acquire_url_rewrite();
+  mapping_type type = NONE;
+
+  if (table) {
+    type = table->Remap_redirect(request_header, redirect_url);
+    release_url_rewrite(table);
+  }
+  return type;
 }
 
 bool
 response_url_remap(HTTPHdr *response_header)
 {
-  return rewrite_table ? rewrite_table->ReverseMap(response_header) : false;
+  UrlRewrite *table = acquire_url_rewrite();
+  bool remapped = false;
+
+  if (table) {
+    remapped = table->ReverseMap(response_header);
+    release_url_rewrite(table);
+  }
+  return remapped;
+}
+
+UrlRewrite *
+acquire_url_rewrite()
+{
+  EThread *t = this_ethread();
+  UrlRewrite *table;
+
+  // A regular event thread counts in its own slot. A replaced table is
+  // only freed once each of these threads has run an event since the swap,
+  // so one that loaded the old table has counted its reference by then.
+  if (t && t->tt == REGULAR) {
+    table = rewrite_table;
+    if (table && table->thread_refs_slot(t) == t->id) {
+      ink_atomic_increment(&table->thread_refs[t->id].count, 1);
+      return table;
+    }
+  }
+
+  // The other threads don't run events, they count under the swap's lock.
+  ink_mutex_acquire(&rewrite_table_mutex);
+  table = rewrite_table;
+  if (table) {
+    ink_atomic_increment(&table->thread_refs[table->n_thread_refs - 1].count, 1);
+  }
+  ink_mutex_release(&rewrite_table_mutex);
+  return table;
+}
+
+void
+release_url_rewrite(UrlRewrite *table)
+{
+  // The table is freed on ET_TASK by UR_ReleaseContinuation, never here.
+  if (table) {
+    ink_atomic_increment(&table->thread_refs[table->thread_refs_slot(this_ethread())].count, -1);
+  }
 }
  
 
@@ -146,25 +277,96 @@ struct UR_UpdateContinuation: public Continuation
   }
 };
 
+/** Runs once on a regular event thread to tell UR_ReleaseContinuation it went past the swap. */
+struct UR_QuiesceContinuation: public Continuation
+{
+  volatile int *pending;
+
+  int quiesce_handler(int /* etype ATS_UNUSED */, void * /* data ATS_UNUSED */)
+  {
+    ink_atomic_increment(pending, -1);
+    delete this;
+    return EVENT_DONE;
+  }
+  UR_QuiesceContinuation(volatile int *p)
+    : Continuation(new_ProxyMutex()), pending(p)
+  {
+    SET_HANDLER(&UR_QuiesceContinuation::quiesce_handler);
+  }
+};
+
+/**
+  Frees a table rewrite_table no longer points to. Once every regular
+  event thread has run an event since the swap, no one can take a new
+  reference to it; from then on its references only go down, and the
+  table is freed when their sum is 0.
+*/
+struct UR_ReleaseContinuation: public Continuation
+{
+  UrlRewrite *table;
+  volatile int pending;         // regular event threads that may still load the table
+
+  int release_handler(int /* etype ATS_UNUSED */, Event *e)
+  {
+    if (pending > 0 || table->thread_refs_sum() > 0) {
+      return EVENT_CONT;
+    }
+    Debug("url_rewrite", "freeing the remap table %p", table);
+    delete table;
+    e->cancel();
+    delete this;
+    return EVENT_DONE;
+  }
+  UR_ReleaseContinuation(UrlRewrite *t)
+    : Continuation(new_ProxyMutex()), table(t), pending(t->n_thread_refs - 1)
+  {
+    SET_HANDLER(&UR_ReleaseContinuation::release_handler);
+    for (int i = 0; i < t->n_thread_refs - 1; i++) {
+      eventProcessor.all_ethreads[i]->schedule_imm(new UR_QuiesceContinuation(&pending));
+    }
+    eventProcessor.schedule_every(this, URL_REWRITE_RELEASE_PERIOD, ET_TASK);
+  }
+};
+
 /**
   Called when the remap.config file changes. Since it called infrequently,
   we do the load of new file as blocking I/O and lock aquire is also
   blocking.
 
+  Transactions keep using the table they started with while the new one
+  is built: it is published with a single pointer swap, and the old table
+  goes away when the last transaction that uses it is done, see
+  UR_ReleaseContinuation.
+
 */
 void
 reloadUrlRewrite()
 {
-  UrlRewrite *newTable;
+  UrlRewrite *newTable, *oldTable;
+  ink_hrtime start = ink_get_hrtime();
+  int64_t rss_before = url_rewrite_rss();
 
   Debug("url_rewrite", "remap.config updated, reloading...");
+  url_rewrite_reset_peak_rss();
   newTable = new UrlRewrite();
   if (newTable->is_valid()) {
-    new_Deleter(rewrite_table, URL_REWRITE_TIMEOUT);
-    Debug("url_rewrite", "remap.config done reloading!");
-    ink_atomic_swap(&rewrite_table, newTable);
+    int64_t rss = url_rewrite_rss();
+    int64_t msec = ink_hrtime_to_msec(ink_get_hrtime() - start);
+
+    RecIncrGlobalRawStatCount(url_rewrite_rsb, url_rewrite_reloads_stat, 1);
+    RecSetGlobalRawStatSum(url_rewrite_rsb, url_rewrite_last_reload_msec_stat, msec);
+    RecSetGlobalRawStatSum(url_rewrite_rsb, url_rewrite_last_reload_peak_rss_stat, url_rewrite_peak_rss());
+    RecSetGlobalRawStatSum(url_rewrite_rsb, url_rewrite_last_reload_rss_growth_stat,
+                           rss > rss_before ? rss - rss_before : 0);
+
+    ink_mutex_acquire(&rewrite_table_mutex);
+    oldTable = ink_atomic_swap(&rewrite_table, newTable);
+    ink_mutex_release(&rewrite_table_mutex);
+    new UR_ReleaseContinuation(oldTable);
+    Debug("url_rewrite", "remap.config done reloading in %" PRId64 " ms!", msec);
   } else {
     static const char* msg = "failed to reload remap.config, not replacing!";
+    RecIncrGlobalRawStatCount(url_rewrite_rsb, url_rewrite_reload_failures_stat, 1);
     delete newTable;
     Debug("url_rewrite", "%s", msg);
     Warning("%s", msg);
@@ -178,7 +380,12 @@ url_rewrite_CB(const char * /* name ATS_UNUSED */, RecDataT /* data_type ATS_UNU
 
   switch (my_token) {
   case REVERSE_CHANGED:
-    rewrite_table->SetReverseFlag(data.rec_int);
+    {
+      UrlRewrite *table = acquire_url_rewrite();
+
+      table->SetReverseFlag(data.rec_int);
+      release_url_rewrite(table);
+    }
     break;
 
   case TSNAME_CHANGED:
@@ -53,6 +53,12 @@ extern int url_remap_mode;
 extern UrlRewrite *rewrite_table;
 extern remap_plugin_info *remap_pi_list;
 
+// The current remap table, with a reference the caller gives back with
+// release_url_rewrite(). A reload never waits for these references: the
+// old table is freed on ET_TASK once the last one is released.
+UrlRewrite *acquire_url_rewrite();
+void release_url_rewrite(UrlRewrite *table);
+
 // API Functions
 int init_reverse_proxy();
 
@@ -0,0 +1,131 @@
+/** @file
+
+  Generate the perfect hash of the well-known strings.
+
+  Writes HdrTokenHash.h to the standard output. The strings are split in
+  buckets by the low bits of their hash, and the buckets, largest first,
+  are given the first displacement that sends all their strings to free
+  slots (hash and displace). There are as many slots as strings.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HdrTokenStrs.h"
+
+#define NUM_STRS              (sizeof(_hdrtoken_strs) / sizeof(_hdrtoken_strs[0]))
+#define MAX_DISPLACEMENT      (1U << 24)
+
+static uint64_t hashes[NUM_STRS];
+static int bucket_strs[HDRTOKEN_HASH_BUCKETS][NUM_STRS];
+static int bucket_sizes[HDRTOKEN_HASH_BUCKETS];
+static int bucket_order[HDRTOKEN_HASH_BUCKETS];
+static uint32_t displacements[HDRTOKEN_HASH_BUCKETS];
+static int slots[NUM_STRS];
+
+static int
+cmp_bucket_size(const void *a, const void *b)
+{
+  int x = *(const int *) a;
+  int y = *(const int *) b;
+
+  if (bucket_sizes[x] != bucket_sizes[y])
+    return bucket_sizes[y] - bucket_sizes[x];
+  return x - y;
+}
+
+// Try to place all strings of @a bucket with displacement @a d.
+static bool
+place(int bucket, uint32_t d)
+{
+  uint32_t s[NUM_STRS];
+
+  for (int i = 0; i < bucket_sizes[bucket]; i++) {
+    s[i] = hdrtoken_hash_slot(hashes[bucket_strs[bucket][i]], d, NUM_STRS);
+    if (slots[s[i]] >= 0)
+      return false;
+    for (int j = 0; j < i; j++) {
+      if (s[j] == s[i])
+        return false;
+    }
+  }
+  for (int i = 0; i < bucket_sizes[bucket]; i++)
+    slots[s[i]] = bucket_strs[bucket][i];
+  return true;
+}
+
+int
+main()
+{
+  unsigned int i;
+
+  for (i = 0; i < NUM_STRS; i++) {
+    unsigned int len = strlen(_hdrtoken_strs[i]);
+
+    if (len >= HDRTOKEN_MAX_LENGTH) {
+      fprintf(stderr, "CompileHdrTokenHash: '%s' is longer than HDRTOKEN_MAX_LENGTH\n", _hdrtoken_strs[i]);
+      return 1;
+    }
+    hashes[i] = hdrtoken_hash((const unsigned char *) _hdrtoken_strs[i], len);
+    for (unsigned int j = 0; j < i; j++) {
+      if (hashes[j] == hashes[i]) {
+        fprintf(stderr, "CompileHdrTokenHash: '%s' and '%s' have the same hash\n", _hdrtoken_strs[j], _hdrtoken_strs[i]);
+        return 1;
+      }
+    }
+    int bucket = hashes[i] & (HDRTOKEN_HASH_BUCKETS - 1);
+    bucket_strs[bucket][bucket_sizes[bucket]++] = i;
+  }
+
+  for (i = 0; i < NUM_STRS; i++)
+    slots[i] = -1;
+  for (i = 0; i < HDRTOKEN_HASH_BUCKETS; i++)
+    bucket_order[i] = i;
+  qsort(bucket_order, HDRTOKEN_HASH_BUCKETS, sizeof(bucket_order[0]), cmp_bucket_size);
+
+  for (i = 0; i < HDRTOKEN_HASH_BUCKETS && bucket_sizes[bucket_order[i]]; i++) {
+    int bucket = bucket_order[i];
+    uint32_t d;
+
+    for (d = 0; d < MAX_DISPLACEMENT; d++) {
+      if (place(bucket, d))
+        break;
+    }
+    if (d == MAX_DISPLACEMENT) {
+      fprintf(stderr, "CompileHdrTokenHash: no displacement found for bucket %d\n", bucket);
+      return 1;
+    }
+    displacements[bucket] = d;
+  }
+
+  printf("/* Generated by CompileHdrTokenHash from HdrTokenStrs.h, do not edit. */\n\n");
+  printf("static const uint32_t hdrtoken_hash_displacements[HDRTOKEN_HASH_BUCKETS] = {\n");
+  for (i = 0; i < HDRTOKEN_HASH_BUCKETS; i++)
+    printf("  %u%s\n", displacements[i], i + 1 < HDRTOKEN_HASH_BUCKETS ? "," : "");
+  printf("};\n\n");
+  printf("static const int16_t hdrtoken_hash_slots[%u] = {\n", (unsigned int) NUM_STRS);
+  for (i = 0; i < NUM_STRS; i++)
+    printf("  %d%s\t/* %s */\n", slots[i], i + 1 < NUM_STRS ? "," : " ", _hdrtoken_strs[slots[i]]);
+  printf("};\n");
+
+  return 0;
+}
@@ -28,6 +28,7 @@
 #include <string.h>
 #include "HTTP.h"
 #include "HdrToken.h"
+#include "HdrScan.h"
 #include "Diags.h"
 
 
@@ -979,13 +980,10 @@ http_parser_parse_req(HTTPParser *parser, HdrHeap *heap, HTTPHdrImpl *hh, const
     }
     method_start = cur;
     GETNEXT(done);
-  parse_method2:
-    if (ParseRules::is_ws(*cur)) {
-      method_end = cur;
-      goto parse_version1;
-    }
-    GETNEXT(done);
-    goto parse_method2;
+    cur = hdr_scan_ws(cur, end);
+    if (!cur)
+      goto done;
+    method_end = cur;
 
   parse_version1:
     cur = end - 1;
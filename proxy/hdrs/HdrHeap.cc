@@ -45,6 +45,30 @@ static HdrHeap proto_heap;
 Allocator strHeapAllocator("hdrStrHeap", HDR_STR_HEAP_DEFAULT_SIZE);
 static HdrStrHeap str_proto_heap;
 
+Allocator hdrHeapArenaAllocator("hdrHeapArena", HDR_HEAP_ARENA_SIZE);
+
+RecRawStatBlock *hdr_heap_rsb = NULL;
+
+static inline void
+hdr_heap_incr_stat(int id, int64_t incr)
+{
+  if (hdr_heap_rsb)
+    RecIncrRawStat(hdr_heap_rsb, this_ethread(), id, incr);
+}
+
+void
+hdr_heap_stats_init()
+{
+  hdr_heap_rsb = RecAllocateRawStatBlock((int) HdrHeap_Stat_Count);
+
+  RecRegisterRawStat(hdr_heap_rsb, RECT_PROCESS, "proxy.process.http.header_heap.bytes_allocated",
+                     RECD_INT, RECP_PERSISTENT, (int) hdr_heap_bytes_allocated_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(hdr_heap_rsb, RECT_PROCESS, "proxy.process.http.header_heap.coalesces",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) hdr_heap_coalesce_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(hdr_heap_rsb, RECT_PROCESS, "proxy.process.http.header_heap.arenas",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) hdr_heap_arena_stat, RecRawStatSyncCount);
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -92,6 +116,7 @@ HdrHeap::init()
   m_data_start = m_free_start = ((char *) this) + HDR_HEAP_HDR_SIZE;
   m_magic = HDR_BUF_MAGIC_ALIVE;
   m_writeable = true;
+  m_arena = false;
 
   m_next = NULL;
   m_free_size = m_size - HDR_HEAP_HDR_SIZE;
@@ -113,14 +138,23 @@ HdrHeap::init()
 }
 
 HdrHeap *
-new_HdrHeap(int size)
+new_HdrHeap(int size, HdrHeapArena *arena)
 {
   HdrHeap *h;
-  if (size <= HDR_HEAP_DEFAULT_SIZE) {
+  if (size <= HDR_HEAP_DEFAULT_SIZE)
     size = HDR_HEAP_DEFAULT_SIZE;
+
+  if (arena) {
+    // Leave room in front of the heap for the arena pointer
+    h = (HdrHeap *)(arena->allocate(HDR_PTR_SIZE + size) + HDR_PTR_SIZE);
+    ((HdrHeapArena **) h)[-1] = arena;
+    arena->refcount_inc();
+  } else if (size == HDR_HEAP_DEFAULT_SIZE) {
     h = (HdrHeap *)(THREAD_ALLOC(hdrHeapAllocator, this_ethread()));
+    hdr_heap_incr_stat(hdr_heap_bytes_allocated_stat, size);
   } else {
     h = (HdrHeap *)ats_malloc(size);
+    hdr_heap_incr_stat(hdr_heap_bytes_allocated_stat, size);
   }
 
 //    Debug("hdrs", "Allocated header heap in size %d", size);
@@ -130,13 +164,13 @@ new_HdrHeap(int size)
 
   h->m_size = size;
   h->init();
-
+  h->m_arena = (arena != NULL);
 
   return h;
 }
 
-HdrStrHeap *
-new_HdrStrHeap(int requested_size)
+static HdrStrHeap *
+new_HdrStrHeap(int requested_size, HdrHeapArena *arena = NULL)
 {
   // The callee is asking for a string heap to be created
   //  that can allocate at least size bytes.  As such we,
@@ -146,12 +180,17 @@ new_HdrStrHeap(int requested_size)
   int alloc_size = requested_size + sizeof(HdrStrHeap);
 
   HdrStrHeap *sh;
-  if (alloc_size <= HDR_STR_HEAP_DEFAULT_SIZE) {
+  if (arena) {
+    alloc_size = ROUND(alloc_size, HDR_PTR_SIZE);
+    sh = (HdrStrHeap *)arena->allocate(alloc_size);
+  } else if (alloc_size <= HDR_STR_HEAP_DEFAULT_SIZE) {
     alloc_size = HDR_STR_HEAP_DEFAULT_SIZE;
     sh = (HdrStrHeap *)(THREAD_ALLOC(strHeapAllocator, this_ethread()));
+    hdr_heap_incr_stat(hdr_heap_bytes_allocated_stat, alloc_size);
   } else {
     alloc_size = ROUND(alloc_size, HDR_STR_HEAP_DEFAULT_SIZE*2);
     sh = (HdrStrHeap *)ats_malloc(alloc_size);
+    hdr_heap_incr_stat(hdr_heap_bytes_allocated_stat, alloc_size);
   }
 
 //    Debug("hdrs", "Allocated string heap in size %d", alloc_size);
@@ -163,6 +202,7 @@ new_HdrStrHeap(int requested_size)
   sh->m_free_size = alloc_size - STR_HEAP_HDR_SIZE;
   sh->m_free_start = ((char *) sh) + STR_HEAP_HDR_SIZE;
   sh->m_refcount = 0;
+  sh->m_arena = (arena != NULL);
 
   ink_assert(sh->m_free_size > 0);
 
@@ -180,7 +220,11 @@ HdrHeap::destroy()
   for (int i = 0; i < HDR_BUF_RONLY_HEAPS; i++)
     m_ronly_heap[i].m_ref_count_ptr = NULL;
 
-  if (m_size == HDR_HEAP_DEFAULT_SIZE) {
+  if (m_arena) {
+    HdrHeapArena *a = arena();
+    if (!a->refcount_dec())
+      a->free();
+  } else if (m_size == HDR_HEAP_DEFAULT_SIZE) {
     THREAD_FREE(this, hdrHeapAllocator, this_thread());
   } else {
     ats_free(this);
@@ -224,7 +268,7 @@ HdrHeap::allocate_obj(int nbytes, int type)
       //   twice as large as this one so
       //   number of pointer heaps is O(log n)
       //   with regard to number of bytes allocated
-      h->m_next = new_HdrHeap(h->m_size * 2);
+      h->m_next = new_HdrHeap(h->m_size * 2, arena());
     }
 
     h = h->m_next;
@@ -254,7 +298,8 @@ HdrHeap::allocate_str(int nbytes)
   //   but I already no that this code path is
   //   safe for forcing a str coalesce so I'm doing
   //   it here for sanity's sake
-  if (m_lost_string_space > (int)MAX_LOST_STR_SPACE) {
+  //  Dead strings in an arena go away with it.
+  if (m_lost_string_space > (int)MAX_LOST_STR_SPACE && !m_arena) {
     goto FAILED;
   }
 
@@ -263,9 +308,13 @@ RETRY:
   // First check to see if we have a read/write
   //   string heap
   if (!m_read_write_heap) {
-    int next_size = (last_size * 2) - STR_HEAP_HDR_SIZE;
-    next_size = next_size > nbytes ? next_size : nbytes;
-    m_read_write_heap = new_HdrStrHeap(next_size);
+    if (m_arena) {
+      m_read_write_heap = arena()->str_heap(nbytes);
+    } else {
+      int next_size = (last_size * 2) - STR_HEAP_HDR_SIZE;
+      next_size = next_size > nbytes ? next_size : nbytes;
+      m_read_write_heap = new_HdrStrHeap(next_size);
+    }
   }
   // Try to allocate of our read/write string heap
   new_space = m_read_write_heap->allocate(nbytes);
@@ -338,9 +387,11 @@ HdrHeap::demote_rw_str_heap()
   for (int i = 0; i < HDR_BUF_RONLY_HEAPS; i++) {
     if (m_ronly_heap[i].m_heap_start == NULL) {
       // We've found a slot
+      // Same range as inherit_string_heaps() attaches, so the two are
+      //  recognized as the same heap when an arena heap shares it
       m_ronly_heap[i].m_ref_count_ptr = m_read_write_heap;
-      m_ronly_heap[i].m_heap_start = (char *) m_read_write_heap.m_ptr;
-      m_ronly_heap[i].m_heap_len = m_read_write_heap->m_heap_size - m_read_write_heap->m_free_size;
+      m_ronly_heap[i].m_heap_start = ((char *) m_read_write_heap.m_ptr) + STR_HEAP_HDR_SIZE;
+      m_ronly_heap[i].m_heap_len = m_read_write_heap->m_heap_size - STR_HEAP_HDR_SIZE - m_read_write_heap->m_free_size;
 
 //          Debug("hdrs", "Demoted rw heap of %d size", m_read_write_heap->m_heap_size);
       m_read_write_heap = NULL;
@@ -371,9 +422,11 @@ HdrHeap::coalesce_str_heaps(int incoming_size)
 
   new_heap_size += required_space_for_evacuation();
 
-  HdrStrHeap *new_heap = new_HdrStrHeap(new_heap_size);
+  // In an arena the new heap is not shared, it holds only our strings
+  HdrStrHeap *new_heap = new_HdrStrHeap(new_heap_size, arena());
   evacuate_from_str_heaps(new_heap);
   m_lost_string_space = 0;
+  hdr_heap_incr_stat(hdr_heap_coalesce_stat, 1);
 
   // At this point none of the currently used string
   //  heaps are needed since everything is in the
@@ -677,6 +730,7 @@ HdrHeap::marshal(char *buf, int len)
   marshal_hdr->m_data_start = (char *) HDR_HEAP_HDR_SIZE;       // offset
   marshal_hdr->m_magic = HDR_BUF_MAGIC_MARSHALED;
   marshal_hdr->m_writeable = false;
+  marshal_hdr->m_arena = false;
   marshal_hdr->m_size = ptr_heap_size + HDR_HEAP_HDR_SIZE;
   marshal_hdr->m_next = NULL;
   marshal_hdr->m_free_size = 0;
@@ -911,6 +965,9 @@ HdrHeap::unmarshal(int buf_length, int obj_type, HdrHeapObjImpl ** found_obj, Re
 
   ink_assert(m_free_start == NULL);
 
+  // Older marshalled heaps have garbage in the padding m_arena lives in
+  m_arena = false;
+
   // Convert Heap offsets to pointers
   m_data_start = ((char *) this) + (intptr_t) m_data_start;
   m_free_start = ((char *) this) + m_size;
@@ -1025,6 +1082,12 @@ HdrHeap::inherit_string_heaps(const HdrHeap * inherit_from)
   int inherit_str_size = 0;
   ink_assert(m_writeable);
 
+  // Strings in an arena stay in it, anyone else takes a copy
+  if (inherit_from->m_arena && inherit_from->arena() != arena()) {
+    coalesce_str_heaps();
+    return;
+  }
+
   // Find the number of free heap slots & the first open index
   for (index = 0; index < HDR_BUF_RONLY_HEAPS; index++) {
     if (m_ronly_heap[index].m_heap_start == NULL) {
@@ -1035,13 +1098,18 @@ HdrHeap::inherit_string_heaps(const HdrHeap * inherit_from)
     }
   }
 
-  // Find out if we have enough slots
-  if (inherit_from->m_read_write_heap) {
+  // Find out if we have enough slots.  A heap of the same arena may
+  //  share our read/write heap, which needs no slot.
+  if (m_arena && !m_read_write_heap && inherit_from->arena() == arena())
+    m_read_write_heap = inherit_from->m_read_write_heap;
+  if (inherit_from->m_read_write_heap && inherit_from->m_read_write_heap != m_read_write_heap) {
     free_slots--;
     inherit_str_size = inherit_from->m_read_write_heap->m_heap_size;
   }
   for (index = 0; index < HDR_BUF_RONLY_HEAPS; index++) {
     if (inherit_from->m_ronly_heap[index].m_heap_start != NULL) {
+      if (m_read_write_heap && m_read_write_heap->contains(inherit_from->m_ronly_heap[index].m_heap_start))
+        continue;
       free_slots--;
       inherit_str_size += inherit_from->m_ronly_heap[index].m_heap_len;
     } else {
@@ -1054,7 +1122,7 @@ HdrHeap::inherit_string_heaps(const HdrHeap * inherit_from)
   // Find out if we are building up too much lost space
   int new_lost_space = m_lost_string_space + inherit_from->m_lost_string_space;
 
-  if (free_slots < 0 || new_lost_space > (int)MAX_LOST_STR_SPACE) {
+  if (free_slots < 0 || (new_lost_space > (int)MAX_LOST_STR_SPACE && !m_arena)) {
     // Not enough free slots.  We need to force a coalesce of
     //  string heaps for both old heaps and the inherited from heaps.
     // Coalesce can't know the inherited str size so we pass it
@@ -1066,7 +1134,7 @@ HdrHeap::inherit_string_heaps(const HdrHeap * inherit_from)
     coalesce_str_heaps(inherit_str_size);
   } else {
     // Copy over read/write string heap if it exists
-    if (inherit_from->m_read_write_heap) {
+    if (inherit_from->m_read_write_heap && inherit_from->m_read_write_heap != m_read_write_heap) {
       int str_size = inherit_from->m_read_write_heap->m_heap_size -
         STR_HEAP_HDR_SIZE - inherit_from->m_read_write_heap->m_free_size;
       result = attach_str_heap(((char *) inherit_from->m_read_write_heap.m_ptr) + STR_HEAP_HDR_SIZE,
@@ -1075,7 +1143,8 @@ HdrHeap::inherit_string_heaps(const HdrHeap * inherit_from)
     }
     // Copy over read only string heaps
     for (int i = 0; i < HDR_BUF_RONLY_HEAPS; i++) {
-      if (inherit_from->m_ronly_heap[i].m_heap_start) {
+      if (inherit_from->m_ronly_heap[i].m_heap_start &&
+          !(m_read_write_heap && m_read_write_heap->contains(inherit_from->m_ronly_heap[i].m_heap_start))) {
         result = attach_str_heap(inherit_from->m_ronly_heap[i].m_heap_start,
                                  inherit_from->m_ronly_heap[i].m_heap_len,
                                  inherit_from->m_ronly_heap[i].m_ref_count_ptr.m_ptr, &first_free);
@@ -1134,6 +1203,10 @@ HdrHeap::dump_heap(int len)
 void
 HdrStrHeap::free()
 {
+  // Arena memory is released with the arena
+  if (m_arena)
+    return;
+
   if (m_heap_size == HDR_STR_HEAP_DEFAULT_SIZE) {
     THREAD_FREE(this, strHeapAllocator, this_thread());
   } else {
@@ -1185,6 +1258,84 @@ HdrStrHeap::expand(char *ptr, int old_size, int new_size)
 
 
 
+HdrHeapArena *
+new_HdrHeapArena()
+{
+  HdrHeapArena *a = (HdrHeapArena *) THREAD_ALLOC(hdrHeapArenaAllocator, this_ethread());
+  int hdr_size = ROUND(sizeof(HdrHeapArena), HDR_PTR_SIZE);
+
+  // The arena lives at the start of its first slab
+  new (a) HdrHeapArena;
+  a->m_str_heap = NULL;
+  a->m_free_start = ((char *) a) + hdr_size;
+  a->m_free_size = HDR_HEAP_ARENA_SIZE - hdr_size;
+  a->m_next_slab_size = HDR_HEAP_ARENA_SIZE * 2;
+  a->m_slabs = NULL;
+
+  hdr_heap_incr_stat(hdr_heap_bytes_allocated_stat, HDR_HEAP_ARENA_SIZE);
+  hdr_heap_incr_stat(hdr_heap_arena_stat, 1);
+  return a;
+}
+
+void
+HdrHeapArena::free()
+{
+  while (m_slabs) {
+    void *next = *(void **) m_slabs;
+    ats_free(m_slabs);
+    m_slabs = next;
+  }
+  THREAD_FREE(this, hdrHeapArenaAllocator, this_thread());
+}
+
+// char* HdrHeapArena::allocate(int nbytes)
+//
+//   Bump allocates nbytes, aligned for heap objects.  A slab
+//    that runs out is left as it is and a larger one started.
+//
+char *
+HdrHeapArena::allocate(int nbytes)
+{
+  char *new_space;
+
+  nbytes = ROUND(nbytes, HDR_PTR_SIZE);
+  if ((unsigned) nbytes > m_free_size) {
+    uint32_t slab_size = m_next_slab_size;
+
+    while (slab_size < nbytes + HDR_PTR_SIZE)
+      slab_size *= 2;
+    void *slab = ats_malloc(slab_size);
+    *(void **) slab = m_slabs;
+    m_slabs = slab;
+    m_free_start = ((char *) slab) + HDR_PTR_SIZE;
+    m_free_size = slab_size - HDR_PTR_SIZE;
+    m_next_slab_size = slab_size * 2;
+    hdr_heap_incr_stat(hdr_heap_bytes_allocated_stat, slab_size);
+  }
+
+  new_space = m_free_start;
+  m_free_start += nbytes;
+  m_free_size -= nbytes;
+  return new_space;
+}
+
+// HdrStrHeap* HdrHeapArena::str_heap(int nbytes)
+//
+//   Returns the read/write string heap the heaps of the arena
+//    share, replaced by a larger one if it can't take nbytes
+//
+HdrStrHeap *
+HdrHeapArena::str_heap(int nbytes)
+{
+  if (!m_str_heap || m_str_heap->space_avail() < nbytes) {
+    int size = m_str_heap ? m_str_heap->m_heap_size * 2 : HDR_STR_HEAP_DEFAULT_SIZE * 2;
+
+    size -= STR_HEAP_HDR_SIZE;
+    m_str_heap = new_HdrStrHeap(size > nbytes ? size : nbytes, this);
+  }
+  return m_str_heap;
+}
+
 StrHeapDesc::StrHeapDesc()
 {
   m_heap_start = NULL;
@@ -1290,4 +1441,50 @@ REGRESSION_TEST(HdrHeap_Coalesce)(RegressionTest* t, int /* atype ATS_UNUSED */,
   // Clean up
   heap->destroy();
 }
+
+REGRESSION_TEST(HdrHeap_Arena)(RegressionTest* t, int /* atype ATS_UNUSED */, int*  pstatus) {
+  TestBox tb(t, pstatus);
+  Ptr<HdrHeapArena> arena(new_HdrHeapArena());
+  HTTPHdr req, copy, out;
+  char value[100];
+  int len;
+
+  *pstatus = REGRESSION_TEST_PASSED;
+  memset(value, 'v', sizeof(value));
+
+  req.m_heap = new_HdrHeap(HDR_HEAP_DEFAULT_SIZE, arena);
+  req.create(HTTP_TYPE_REQUEST);
+  req.value_set("X-Arena", 7, value, sizeof(value));
+  tb.check(req.m_heap->arena() == arena.m_ptr, "Checking that the heap knows its arena");
+  tb.check(req.m_heap->m_read_write_heap.m_ptr == arena->m_str_heap, "Checking that the heap uses the shared string heap");
+
+  // A copy in the same arena shares the strings without a read only slot
+  copy.m_heap = new_HdrHeap(HDR_HEAP_DEFAULT_SIZE, arena);
+  copy.copy(&req);
+  tb.check(copy.m_heap->m_read_write_heap == req.m_heap->m_read_write_heap, "Checking that the copy shares the string heap");
+  tb.check(copy.m_heap->m_ronly_heap[0].m_heap_start == NULL, "Checking that the copy took no read only slot");
+
+  // Rewriting leaves dead strings behind, which are not coalesced away
+  for (int i = 0; i < 40; ++i) {
+    value[0] = 'a' + (i % 26);
+    req.value_set("X-Arena", 7, value, sizeof(value));
+  }
+  tb.check(req.m_heap->m_lost_string_space > MAX_LOST_STR_SPACE, "Checking that dead strings were kept");
+  tb.check(req.m_heap->m_read_write_heap.m_ptr == arena->m_str_heap, "Checking that the string heaps were not coalesced");
+  tb.check(memcmp(req.value_get("X-Arena", 7, &len), value, sizeof(value)) == 0 && len == sizeof(value),
+           "Checking the rewritten value");
+
+  // A copy outside of the arena gets its own strings
+  out.copy(&req);
+  tb.check(!out.m_heap->m_arena && !out.m_heap->m_read_write_heap->m_arena, "Checking that the outside copy has its own string heap");
+  tb.check(out.m_heap->m_ronly_heap[0].m_heap_start == NULL, "Checking that the outside copy holds no arena strings");
+  tb.check(memcmp(out.value_get("X-Arena", 7, &len), value, sizeof(value)) == 0 && len == sizeof(value),
+           "Checking the value of the outside copy");
+
+  req.destroy();
+  copy.destroy();
+  tb.check(arena->refcount() == 1, "Checking that only the owner holds the arena, refcount %d", arena->refcount());
+  arena = NULL;
+  out.destroy();
+}
 #endif
@@ -154,6 +154,7 @@ struct StrHeapDesc
 
 
 class IOBufferBlock;
+class HdrHeapArena;
 
 class HdrStrHeap:public RefCountObj
 {
@@ -163,11 +164,15 @@ public:
 
   char *allocate(int nbytes);
   char *expand(char *ptr, int old_size, int new_size);
-  int space_avail();
+  int space_avail() const
+  {
+    return m_free_size;
+  }
 
   uint32_t m_heap_size;
   char *m_free_start;
   uint32_t m_free_size;
+  bool m_arena;                 // carved from a HdrHeapArena, released with it
 
   bool contains(const char *str) const
   {
@@ -249,6 +254,9 @@ public:
   uint32_t m_size;
 
   bool m_writeable;
+  // Carved from a HdrHeapArena. It fits in the padding before m_next
+  //  so the marshalled layout is unchanged.
+  bool m_arena;
 
   // Overflow block ptr
   //   Overflow blocks are necessary because we can
@@ -262,6 +270,12 @@ public:
   // HdrBuf heap pointers
   uint32_t m_free_size;
 
+  // The arena of a heap is kept in the slot in front of it
+  HdrHeapArena *arena() const
+  {
+    return m_arena ? ((HdrHeapArena * const *) this)[-1] : NULL;
+  }
+
   int demote_rw_str_heap();
   void coalesce_str_heaps(int incoming_size = 0);
   void evacuate_from_str_heaps(HdrStrHeap * new_heap);
@@ -497,7 +511,52 @@ HdrHeapSDKHandle::set(const HdrHeapSDKHandle * from)
   m_heap = from->m_heap;
 }
 
-inkcoreapi HdrHeap *new_HdrHeap(int size = HDR_HEAP_DEFAULT_SIZE);
+// class HdrHeapArena
+//
+//   A slab that the header heaps of one transaction, and their
+//    string heaps, are bump allocated from.  The heaps share one
+//    read/write string heap, so copying strings between them takes
+//    no read only slots and dead strings are not coalesced away.
+//    The slab is released in one go once the owner and all the heaps
+//    have let go of it.
+//
+//   Strings in the arena are never shared with a heap outside of it,
+//    such a heap gets its own copy when it inherits them (see
+//    HdrHeap::inherit_string_heaps()), so the strings a cache alternate
+//    marshals are compacted and the arena can't outlive the transaction.
+//
+class HdrHeapArena:public RefCountObj
+{
+public:
+  virtual void free();
+
+  char *allocate(int nbytes);
+  HdrStrHeap *str_heap(int nbytes);
+
+  HdrStrHeap *m_str_heap;       // shared read/write string heap, not a reference
+  char *m_free_start;
+  uint32_t m_free_size;
+  uint32_t m_next_slab_size;
+  void *m_slabs;                // slabs after the first one
+};
+
+#define HDR_HEAP_ARENA_SIZE  16384
+
+inkcoreapi HdrHeap *new_HdrHeap(int size = HDR_HEAP_DEFAULT_SIZE, HdrHeapArena *arena = NULL);
+inkcoreapi HdrHeapArena *new_HdrHeapArena();
+
+// Header heap stats, registered by hdr_heap_stats_init()
+enum HdrHeap_Stats
+{
+  hdr_heap_bytes_allocated_stat,
+  hdr_heap_coalesce_stat,
+  hdr_heap_arena_stat,
+  HdrHeap_Stat_Count
+};
+
+struct RecRawStatBlock;
+extern RecRawStatBlock *hdr_heap_rsb;
+void hdr_heap_stats_init();
 
 void hdr_heap_test();
 #endif
@@ -0,0 +1,93 @@
+/** @file
+
+  Vectorized scanning of header text.
+
+  Look for any of a few delimiters 32 bytes at a time with AVX2, 16
+  with SSE2, falling back to a byte loop elsewhere and for the tail of
+  the input. They never read outside [@a s, @a e).
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HdrScan_h_
+#define _HdrScan_h_
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HDR_SCAN_AVX2 1
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HDR_SCAN_SSE2 1
+#endif
+
+/** Find the first @a a, @a b or @a c in [@a s, @a e).
+
+    A single character is better found with memchr(), which is already
+    vectorized.
+
+    @return A pointer to it, or @c NULL if there is none.
+*/
+static inline const char *
+hdr_scan_any(const char *s, const char *e, char a, char b, char c)
+{
+#if HDR_SCAN_AVX2
+  __m256i av = _mm256_set1_epi8(a);
+  __m256i bv = _mm256_set1_epi8(b);
+  __m256i cv = _mm256_set1_epi8(c);
+
+  for (; e - s >= 32; s += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) s);
+    __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, av), _mm256_cmpeq_epi8(v, bv)),
+                                  _mm256_cmpeq_epi8(v, cv));
+    unsigned mask = (unsigned) _mm256_movemask_epi8(hit);
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+#endif
+#if HDR_SCAN_AVX2 || HDR_SCAN_SSE2
+  __m128i ax = _mm_set1_epi8(a);
+  __m128i bx = _mm_set1_epi8(b);
+  __m128i cx = _mm_set1_epi8(c);
+
+  for (; e - s >= 16; s += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) s);
+    __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, ax), _mm_cmpeq_epi8(v, bx)), _mm_cmpeq_epi8(v, cx));
+    unsigned mask = (unsigned) _mm_movemask_epi8(hit);
+    if (mask)
+      return s + __builtin_ctz(mask);
+  }
+#endif
+  for (; s < e; ++s) {
+    if (*s == a || *s == b || *s == c)
+      return s;
+  }
+  return NULL;
+}
+
+/** Find the first space or tab in [@a s, @a e).
+
+    @return A pointer to it, or @c NULL if there is none.
+*/
+static inline const char *
+hdr_scan_ws(const char *s, const char *e)
+{
+  return hdr_scan_any(s, e, ' ', '\t', '\t');
+}
+
+#endif
@@ -40,6 +40,7 @@
 #include "Regex.h"
 #include "URL.h"
 #include "HttpCompat.h"
+#include "HdrScan.h"
 
 #include "HdrTest.h"
 
@@ -48,7 +49,7 @@
 //////////////////////
 
 int
-HdrTest::go(RegressionTest * t, int /* atype ATS_UNUSED */)
+HdrTest::go(RegressionTest * t, int atype)
 {
   HdrTest::rtest = t;
   int status = 1;
@@ -77,6 +78,13 @@ HdrTest::go(RegressionTest * t, int /* atype ATS_UNUSED */)
   status = status & test_http_mutation();
   status = status & test_mime();
   status = status & test_http();
+  status = status & test_hdr_scan();
+  status = status & test_hdrtoken();
+  // Only benchmark at the highest levels.
+  if (REGRESSION_TEST_EXTENDED <= atype) {
+    status = status & bench_http_parse();
+    status = status & bench_hdrtoken();
+  }
 
   return (status ? REGRESSION_TEST_PASSED : REGRESSION_TEST_FAILED);
 }
@@ -2246,6 +2254,339 @@ HdrTest::test_parse_comma_list()
   return (failures_to_status("test_parse_comma_list", failures));
 }
 
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+static const char *
+scalar_scan_any(const char *s, const char *e, char a, char b, char c)
+{
+  for (; s < e; ++s) {
+    if (*s == a || *s == b || *s == c)
+      return s;
+  }
+  return NULL;
+}
+
+int
+HdrTest::test_hdr_scan()
+{
+  char buf[128];
+  int failures = 0;
+
+  bri_box("test_hdr_scan");
+
+  // Every alignment, length and delimiter position, across the 16 and 32 byte blocks.
+  for (int off = 0; off < 32; off++) {
+    for (int len = 0; len <= 80; len++) {
+      for (int pos = -1; pos < len; pos++) {
+        const char *s = buf + off;
+        const char *e = s + len;
+
+        memset(buf, 'x', sizeof(buf));
+        if (pos >= 0)
+          buf[off + pos] = (pos & 1) ? '?' : '#';
+        // A delimiter just past the end must not be found.
+        buf[off + len] = ';';
+        if (hdr_scan_any(s, e, ';', '?', '#') != scalar_scan_any(s, e, ';', '?', '#')) {
+          printf("FAILED: hdr_scan_any offset %d length %d position %d\n", off, len, pos);
+          ++failures;
+        }
+        if (pos >= 0)
+          buf[off + pos] = (pos & 1) ? ' ' : '\t';
+        if (hdr_scan_ws(s, e) != scalar_scan_any(s, e, ' ', '\t', '\t')) {
+          printf("FAILED: hdr_scan_ws offset %d length %d position %d\n", off, len, pos);
+          ++failures;
+        }
+      }
+    }
+  }
+
+  // URL components split at the vectorized scans, on both sides of a block boundary.
+  static const char *paths[] = {
+    "p", "path/to/a/fairly/long/object", "path/to/an/object/that/is/longer/than/32/bytes.html"
+  };
+  for (unsigned i = 0; i < countof(paths); i++) {
+    char str[512];
+    const char *path = paths[i];
+    const char *params = "a=b";
+    const char *query = "q=some/long/query/string/more/than/thirty/two/bytes";
+    const char *fragment = "frag";
+    URL url;
+    int len, nfail = failures;
+    const char *v;
+
+    snprintf(str, sizeof(str), "http://some.place/%s;%s?%s#%s", path, params, query, fragment);
+    url.create(NULL);
+    url.parse(str, strlen(str));
+    v = url.path_get(&len);
+    if (len != (int) strlen(path) || memcmp(v, path, len))
+      ++failures;
+    v = url.params_get(&len);
+    if (len != (int) strlen(params) || memcmp(v, params, len))
+      ++failures;
+    v = url.query_get(&len);
+    if (len != (int) strlen(query) || memcmp(v, query, len))
+      ++failures;
+    v = url.fragment_get(&len);
+    if (len != (int) strlen(fragment) || memcmp(v, fragment, len))
+      ++failures;
+    if (failures != nfail)
+      printf("FAILED: components of %s\n", str);
+    url.destroy();
+  }
+
+  return (failures_to_status("test_hdr_scan", failures));
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// The well-known string @a string is equal to, ignoring case, or -1.
+static int
+linear_tokenize(const char *string, int length)
+{
+  for (int i = 0; i < hdrtoken_num_wks; i++) {
+    if (hdrtoken_str_lengths[i] == length && !strncasecmp(hdrtoken_strs[i], string, length))
+      return i;
+  }
+  return -1;
+}
+
+int
+HdrTest::test_hdrtoken()
+{
+  char buf[64];
+  int failures = 0;
+
+  bri_box("test_hdrtoken");
+
+  for (int i = 0; i < hdrtoken_num_wks; i++) {
+    const char *wks = hdrtoken_strs[i];
+    int len = hdrtoken_str_lengths[i];
+    const char *wks_out = NULL;
+    int idx;
+
+    // Copies, so they are not short cut as well-known strings.
+    for (int j = 0; j < len; j++)
+      buf[j] = (j & 1) ? ParseRules::ink_toupper(wks[j]) : ParseRules::ink_tolower(wks[j]);
+    idx = hdrtoken_tokenize(buf, len, &wks_out);
+    if (idx != i || wks_out != wks) {
+      printf("FAILED: hdrtoken_tokenize('%.*s') returned %d, expected %d\n", len, buf, idx, i);
+      ++failures;
+    }
+
+    // Near misses, which must not be taken for the string unless they are another one.
+    memcpy(buf, wks, len);
+    buf[len - 1] = '~';
+    if (hdrtoken_tokenize(buf, len) != linear_tokenize(buf, len))
+      ++failures;
+    if (hdrtoken_tokenize(buf, len - 1) != linear_tokenize(buf, len - 1))
+      ++failures;
+    memcpy(buf, wks, len);
+    buf[len] = 'z';
+    if (hdrtoken_tokenize(buf, len + 1) != linear_tokenize(buf, len + 1))
+      ++failures;
+    // The hash folds '-' and CR together, the compare must not.
+    memcpy(buf, wks, len);
+    for (int j = 0; j < len; j++) {
+      if (buf[j] == '-')
+        buf[j] = '\r';
+    }
+    if (memchr(wks, '-', len) && hdrtoken_tokenize(buf, len) != -1)
+      ++failures;
+  }
+
+  memset(buf, 'a', sizeof(buf));
+  if (hdrtoken_tokenize(buf, sizeof(buf)) != -1 || hdrtoken_tokenize(buf, 0) != -1)
+    ++failures;
+
+  return (failures_to_status("test_hdrtoken", failures));
+}
+
+// The hash table hdrtoken_tokenize() used before the perfect hash: a
+// 32 bit FNV hash, one entry per slot, a match on hash and length.
+struct LegacyHdrTokenBucket
+{
+  int wks_idx;
+  uint32_t hash;
+};
+
+static uint32_t
+legacy_hdrtoken_hash(const unsigned char *string, unsigned int length)
+{
+  uint32_t hash = 2166136261U;
+
+  for (unsigned int i = 0; i < length; i++) {
+    hash = hash ^ (toupper(string[i]));
+    hash = hash * 16777619;
+  }
+  return hash;
+}
+
+static inline uint32_t
+legacy_hdrtoken_slot(uint32_t hash)
+{
+  return ((hash >> 15) ^ hash) & ((1 << 15) - 1);
+}
+
+static int
+legacy_hdrtoken_tokenize(const LegacyHdrTokenBucket *table, const char *string, int length)
+{
+  uint32_t hash = legacy_hdrtoken_hash((const unsigned char *) string, (unsigned int) length);
+  const LegacyHdrTokenBucket *bucket = &table[legacy_hdrtoken_slot(hash)];
+
+  if (bucket->wks_idx >= 0 && bucket->hash == hash && hdrtoken_str_lengths[bucket->wks_idx] == length)
+    return bucket->wks_idx;
+  return -1;
+}
+
+// Look up a mix of well-known and other field names with both tables.
+int
+HdrTest::bench_hdrtoken()
+{
+  static const char *others[] = {
+    "X-Request-Id", "X-Powered-By", "Upgrade-Insecure-Requests", "DNT", "X-Cache", "Sec-Fetch-Mode",
+    "P3P", "X-Frame-Options"
+  };
+  const int rounds = 20000;
+  const int nnames = hdrtoken_num_wks + countof(others);
+  LegacyHdrTokenBucket *table = new LegacyHdrTokenBucket[1 << 15];
+  char (*names)[64] = new char[nnames][64];
+  int *lengths = new int[nnames];
+  int failures = 0;
+  int64_t found = 0;
+
+  bri_box("bench_hdrtoken");
+
+  for (int i = 0; i < (1 << 15); i++)
+    table[i].wks_idx = -1;
+  for (int i = 0; i < hdrtoken_num_wks; i++) {
+    uint32_t hash = legacy_hdrtoken_hash((const unsigned char *) hdrtoken_strs[i], hdrtoken_str_lengths[i]);
+    table[legacy_hdrtoken_slot(hash)].wks_idx = i;
+    table[legacy_hdrtoken_slot(hash)].hash = hash;
+  }
+  for (int i = 0; i < nnames; i++) {
+    const char *name = i < hdrtoken_num_wks ? hdrtoken_strs[i] : others[i - hdrtoken_num_wks];
+    lengths[i] = strlen(name);
+    memcpy(names[i], name, lengths[i]);
+  }
+
+  ink_hrtime begin = ink_get_hrtime_internal();
+  for (int k = 0; k < rounds; k++) {
+    for (int i = 0; i < nnames; i++)
+      found += legacy_hdrtoken_tokenize(table, names[i], lengths[i]) >= 0;
+  }
+  ink_hrtime legacy = ink_get_hrtime_internal() - begin;
+
+  begin = ink_get_hrtime_internal();
+  for (int k = 0; k < rounds; k++) {
+    for (int i = 0; i < nnames; i++)
+      found -= hdrtoken_tokenize(names[i], lengths[i]) >= 0;
+  }
+  ink_hrtime perfect = ink_get_hrtime_internal() - begin;
+
+  if (found != 0) {
+    printf("FAILED: the tables found a different number of names\n");
+    ++failures;
+  }
+  rprintf(rtest, "  legacy hash table: %.1fM lookups/sec\n", (double) rounds * nnames * 1000.0 / legacy);
+  rprintf(rtest, "  perfect hash:      %.1fM lookups/sec\n", (double) rounds * nnames * 1000.0 / perfect);
+
+  delete[] table;
+  delete[] names;
+  delete[] lengths;
+  return (failures_to_status("bench_hdrtoken", failures));
+}
+
+/*-------------------------------------------------------------------------
+  -------------------------------------------------------------------------*/
+
+// A small corpus of request and response headers as seen by a forward
+// and reverse proxy, used by bench_http_parse().
+static const char *parse_corpus[] = {
+  "GET /images/logo.png HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 6.1; WOW64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/35.0.1916.153 Safari/537.36\r\n"
+    "Accept: image/webp,*/*;q=0.8\r\n"
+    "Referer: http://www.example.com/index.html\r\n"
+    "Accept-Encoding: gzip,deflate,sdch\r\n"
+    "Accept-Language: en-US,en;q=0.8\r\n"
+    "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; prefs=compact; tracking=opt-out\r\n"
+    "\r\n",
+  "GET /api/v2/search;jsessionid=0A1B2C3D?q=traffic+server&lang=en&page=2&per_page=50 HTTP/1.1\r\n"
+    "Host: api.example.com\r\n"
+    "Accept: application/json\r\n"
+    "Connection: keep-alive\r\n"
+    "X-Forwarded-For: 192.0.2.17\r\n"
+    "If-None-Match: \"5e8c3b7a-1f2\"\r\n"
+    "\r\n",
+  "POST http://upload.example.com/files/new HTTP/1.1\r\n"
+    "Host: upload.example.com\r\n"
+    "Content-Type: multipart/form-data; boundary=----WebKitFormBoundary7MA4YWxkTrZu0gW\r\n"
+    "Content-Length: 48213\r\n"
+    "Proxy-Connection: keep-alive\r\n"
+    "Expect: 100-continue\r\n"
+    "\r\n",
+  "HTTP/1.1 200 OK\r\n"
+    "Date: Tue, 24 Jun 2014 17:42:08 GMT\r\n"
+    "Server: ATS/5.0.0\r\n"
+    "Content-Type: image/png\r\n"
+    "Content-Length: 10432\r\n"
+    "Last-Modified: Mon, 02 Jun 2014 09:12:55 GMT\r\n"
+    "ETag: \"28c0-4fad5a3e6c7c0\"\r\n"
+    "Cache-Control: public, max-age=86400\r\n"
+    "Age: 1312\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n",
+  "HTTP/1.1 304 Not Modified\r\n"
+    "Date: Tue, 24 Jun 2014 17:42:09 GMT\r\n"
+    "ETag: \"5e8c3b7a-1f2\"\r\n"
+    "Vary: Accept-Encoding\r\n"
+    "\r\n",
+};
+
+// Parse the corpus over and over and report the time per header.
+int
+HdrTest::bench_http_parse()
+{
+  const int iterations = 100000;
+  HTTPParser parser;
+  int failures = 0;
+
+  bri_box("bench_http_parse");
+  http_parser_init(&parser);
+
+  for (unsigned i = 0; i < countof(parse_corpus); i++) {
+    bool request = strncmp(parse_corpus[i], "HTTP/", 5) != 0;
+    size_t length = strlen(parse_corpus[i]);
+    ink_hrtime begin = ink_get_hrtime_internal();
+
+    for (int k = 0; k < iterations; k++) {
+      HTTPHdr hdr;
+      const char *start = parse_corpus[i];
+      const char *end = start + length;
+      MIMEParseResult ret;
+
+      http_parser_clear(&parser);
+      if (request) {
+        hdr.create(HTTP_TYPE_REQUEST);
+        ret = hdr.parse_req(&parser, &start, end, true);
+      } else {
+        hdr.create(HTTP_TYPE_RESPONSE);
+        ret = hdr.parse_resp(&parser, &start, end, true);
+      }
+      if (ret != PARSE_DONE)
+        ++failures;
+      hdr.destroy();
+    }
+
+    ink_hrtime elapsed = ink_get_hrtime_internal() - begin;
+    rprintf(rtest, "  corpus entry %u (%d bytes): %" PRId64 " ns per parse\n", i, (int) length, elapsed / iterations);
+  }
+
+  return (failures_to_status("bench_http_parse", failures));
+}
+
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
@@ -30,167 +30,9 @@
 #include "MIME.h"
 #include "Regex.h"
 #include "URL.h"
+#include "HdrScan.h"
+#include "HdrTokenStrs.h"
 
-/* 
- You SHOULD add to _hdrtoken_commonly_tokenized_strs, with the same ordering
- ** important, ordering matters **
- 
- You want a regexp like 'Accept' after "greedier" choices so it doesn't match 'Accept-Ranges' earlier than
- it should. The regexp are anchored (^Accept), but I dont see a way with the current system to 
- match the word ONLY without making _hdrtoken_strs a real PCRE, but then that breaks the hashing
- hdrtoken_hash("^Accept$") != hdrtoken_hash("Accept")
- 
- So, the current hack is to have "Accept" follow "Accept-.*", lame, I know
- 
-  /ericb
-*/
-
-static const char *_hdrtoken_strs[] = {
-  // MIME Field names
-  "Accept-Charset",
-  "Accept-Encoding",
-  "Accept-Language",
-  "Accept-Ranges",
-  "Accept",
-  "Age",
-  "Allow",
-  "Approved",                   // NNTP
-  "Authorization",
-  "Bytes",                      // NNTP
-  "Cache-Control",
-  "Client-ip",
-  "Connection",
-  "Content-Base",
-  "Content-Encoding",
-  "Content-Language",
-  "Content-Length",
-  "Content-Location",
-  "Content-MD5",
-  "Content-Range",
-  "Content-Type",
-  "Control",                    // NNTP
-  "Cookie",
-  "Date",
-  "Distribution",               // NNTP
-  "Etag",
-  "Expect",
-  "Expires",
-  "Followup-To",                // NNTP
-  "From",
-  "Host",
-  "If-Match",
-  "If-Modified-Since",
-  "If-None-Match",
-  "If-Range",
-  "If-Unmodified-Since",
-  "Keep-Alive",
-  "Keywords",                   // NNTP
-  "Last-Modified",
-  "Lines",                      // NNTP
-  "Location",
-  "Max-Forwards",
-  "Message-ID",                 // NNTP
-  "MIME-Version",
-  "Newsgroups",                 // NNTP
-  "Organization",               // NNTP
-  "Path",                       // NNTP
-  "Pragma",
-  "Proxy-Authenticate",
-  "Proxy-Authorization",
-  "Proxy-Connection",
-  "Public",
-  "Range",
-  "References",                 // NNTP
-  "Referer",
-  "Reply-To",                   // NNTP
-  "Retry-After",
-  "Sender",                     // NNTP
-  "Server",
-  "Set-Cookie",
-  "Subject",                    // NNTP
-  "Summary",                    // NNTP
-  "Transfer-Encoding",
-  "Upgrade",
-  "User-Agent",
-  "Vary",
-  "Via",
-  "Warning",
-  "Www-Authenticate",
-  "Xref",                       // NNTP
-  "@DataInfo",                  // Internal Hack
-  
-  // Accept-Encoding
-  "compress",
-  "deflate",
-  "gzip",
-  "identity",
-  
-  // Cache-Control flags
-  "max-age",
-  "max-stale",
-  "min-fresh",
-  "must-revalidate",
-  "no-cache",
-  "no-store",
-  "no-transform",
-  "only-if-cached",
-  "private",
-  "proxy-revalidate",
-  "s-maxage",
-  "need-revalidate-once",
-  
-  // HTTP miscellaneous
-  "none",
-  "chunked",
-  "close",
-  
-  // WS
-  "websocket",
-  "Sec-WebSocket-Key",
-  "Sec-WebSocket-Version",
-
-  // URL schemes
-  "file",
-  "ftp",
-  "gopher",
-  "https",
-  "http",
-  "mailto",
-  "news",
-  "nntp",
-  "prospero",
-  "telnet",
-  "tunnel",
-  "wais",
-  "pnm",
-  "rtspu",
-  "rtsp",
-  "mmsu",
-  "mmst",
-  "mms",
-  "wss",
-  "ws",
-  
-  // HTTP methods
-  "CONNECT",
-  "DELETE",
-  "GET",
-  "POST",
-  "HEAD",
-  "ICP_QUERY",
-  "OPTIONS",
-  "PURGE",
-  "PUT",
-  "TRACE",
-  "PUSH",
-  
-  // Header extensions
-  "X-ID",
-  "X-Forwarded-For",
-  "TE",
-  "Strict-Transport-Security",
-  "100-continue"
-};
 
 static HdrTokenTypeBinding _hdrtoken_strs_type_initializers[] = {
   {"file", HDRTOKEN_TYPE_SCHEME},
@@ -344,227 +186,80 @@ DFA *hdrtoken_strs_dfa = NULL;
  *                                                                     *
  ***********************************************************************/
 
-#define	HDRTOKEN_HASH_TABLE_SIZE	65536
-#define	HDRTOKEN_HASH_TABLE_MASK	HDRTOKEN_HASH_TABLE_SIZE-1
+// The perfect hash over _hdrtoken_strs is generated at build time by
+// CompileHdrTokenHash: hdrtoken_hash_displacements[] has a value per
+// bucket, chosen so that every well-known string gets its own slot, and
+// hdrtoken_hash_slots[] maps the slots to wks indexes.
+#include "HdrTokenHash.h"
 
-struct HdrTokenHashBucket
-{
-  const char *wks;
-  uint32_t hash;
-};
-
-HdrTokenHashBucket hdrtoken_hash_table[HDRTOKEN_HASH_TABLE_SIZE];
+// The well-known strings in lower case, padded for the SIMD compare.
+static char hdrtoken_folded_strs[SIZEOF(_hdrtoken_strs)][HDRTOKEN_MAX_LENGTH] __attribute__ ((aligned(16)));
 
 /**
-  basic FNV hash
+  Compare @a string to the folded well-known string @a folded, ignoring
+  case, 16 bytes at a time where SSE2 is available.
 **/
-#define TINY_MASK(x) (((u_int32_t)1<<(x))-1)
-
-inline uint32_t
-hash_to_slot(uint32_t hash)
+static inline bool
+hdrtoken_match(const char *string, int length, const char *folded)
 {
-  return ((hash>>15) ^ hash) & TINY_MASK(15);
-}
-
-inline uint32_t
-hdrtoken_hash(const unsigned char *string, unsigned int length)
-{
-  static const uint32_t InitialFNV = 2166136261U;
-  static const int32_t FNVMultiple = 16777619;
-
-  uint32_t hash = InitialFNV;
-
-  for (size_t i = 0; i < length; i++)  {
-      hash = hash ^ (toupper(string[i])); 
-      hash = hash * FNVMultiple;          
+#if HDR_SCAN_AVX2 || HDR_SCAN_SSE2
+  const __m128i before_a = _mm_set1_epi8('A' - 1);
+  const __m128i after_z = _mm_set1_epi8('Z' + 1);
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+
+  for (int i = 0; i < length; i += 16) {
+    int n = length - i;
+    __m128i v;
+
+    // Copy a partial block rather than read past the end of the string.
+    if (n >= 16) {
+      v = _mm_loadu_si128((const __m128i *) (string + i));
+    } else {
+      char buf[16];
+      memcpy(buf, string + i, n);
+      v = _mm_loadu_si128((const __m128i *) buf);
+    }
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_a), _mm_cmplt_epi8(v, after_z));
+    v = _mm_or_si128(v, _mm_and_si128(upper, case_bit));
+    unsigned eq = (unsigned) _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_load_si128((const __m128i *) (folded + i))));
+    unsigned want = n < 16 ? (1U << n) - 1 : 0xFFFF;
+    if ((eq & want) != want)
+      return false;
   }
-
-  return hash;
+  return true;
+#else
+  for (int i = 0; i < length; i++) {
+    if (ParseRules::ink_tolower(string[i]) != folded[i])
+      return false;
+  }
+  return true;
+#endif
 }
 
-/*-------------------------------------------------------------------------
-  -------------------------------------------------------------------------*/
-
-static const char *_hdrtoken_commonly_tokenized_strs[] = {
-  // MIME Field names
-  "Accept-Charset",
-  "Accept-Encoding",
-  "Accept-Language",
-  "Accept-Ranges",
-  "Accept",
-  "Age",
-  "Allow",
-  "Approved",                   // NNTP
-  "Authorization",
-  "Bytes",                      // NNTP
-  "Cache-Control",
-  "Client-ip",
-  "Connection",
-  "Content-Base",
-  "Content-Encoding",
-  "Content-Language",
-  "Content-Length",
-  "Content-Location",
-  "Content-MD5",
-  "Content-Range",
-  "Content-Type",
-  "Control",                    // NNTP
-  "Cookie",
-  "Date",
-  "Distribution",               // NNTP
-  "Etag",
-  "Expect",
-  "Expires",
-  "Followup-To",                // NNTP
-  "From",
-  "Host",
-  "If-Match",
-  "If-Modified-Since",
-  "If-None-Match",
-  "If-Range",
-  "If-Unmodified-Since",
-  "Keep-Alive",
-  "Keywords",                   // NNTP
-  "Last-Modified",
-  "Lines",                      // NNTP
-  "Location",
-  "Max-Forwards",
-  "Message-ID",                 // NNTP
-  "MIME-Version",
-  "Newsgroups",                 // NNTP
-  "Organization",               // NNTP
-  "Path",                       // NNTP
-  "Pragma",
-  "Proxy-Authenticate",
-  "Proxy-Authorization",
-  "Proxy-Connection",
-  "Public",
-  "Range",
-  "References",                 // NNTP
-  "Referer",
-  "Reply-To",                   // NNTP
-  "Retry-After",
-  "Sender",                     // NNTP
-  "Server",
-  "Set-Cookie",
-  "Subject",                    // NNTP
-  "Summary",                    // NNTP
-  "Transfer-Encoding",
-  "Upgrade",
-  "User-Agent",
-  "Vary",
-  "Via",
-  "Warning",
-  "Www-Authenticate",
-  "Xref",                       // NNTP
-  "@DataInfo",                  // Internal Hack
-  
-  // Accept-Encoding
-  "compress",
-  "deflate",
-  "gzip",
-  "identity",
-  
-  // Cache-Control flags
-  "max-age",
-  "max-stale",
-  "min-fresh",
-  "must-revalidate",
-  "no-cache",
-  "no-store",
-  "no-transform",
-  "only-if-cached",
-  "private",
-  "proxy-revalidate",
-  "s-maxage",
-  "need-revalidate-once",
-  
-  // HTTP miscellaneous
-  "none",
-  "chunked",
-  "close",
-  
-  // WS
-  "websocket",
-  "Sec-WebSocket-Key",
-  "Sec-WebSocket-Version",
-
-  // URL schemes
-  "file",
-  "ftp",
-  "gopher",
-  "https",
-  "http",
-  "mailto",
-  "news",
-  "nntp",
-  "prospero",
-  "telnet",
-  "tunnel",
-  "wais",
-  "pnm",
-  "rtspu",
-  "rtsp",
-  "mmsu",
-  "mmst",
-  "mms",
-  "wss",
-  "ws",
-  
-  // HTTP methods
-  "CONNECT",
-  "DELETE",
-  "GET",
-  "POST",
-  "HEAD",
-  "ICP_QUERY",
-  "OPTIONS",
-  "PURGE",
-  "PUT",
-  "TRACE",
-  "PUSH",
-  
-  // Header extensions
-  "X-ID",
-  "X-Forwarded-For",
-  "TE",
-  "Strict-Transport-Security",
-  "100-continue"
-};
-
 /*-------------------------------------------------------------------------
   -------------------------------------------------------------------------*/
 
 void
 hdrtoken_hash_init()
 {
-  uint32_t i;
-  int num_collisions;
-
-  memset(hdrtoken_hash_table, 0, sizeof(hdrtoken_hash_table));
-  num_collisions = 0;
-
-  for (i = 0; i < (int) SIZEOF(_hdrtoken_commonly_tokenized_strs); i++) {
-    // convert the common string to the well-known token
-    unsigned const char *wks;
-    int wks_idx = hdrtoken_tokenize_dfa(_hdrtoken_commonly_tokenized_strs[i],
-                                        (int) strlen(_hdrtoken_commonly_tokenized_strs[i]),
-                                        (const char **) &wks);
-    ink_release_assert(wks_idx >= 0);
-
-    uint32_t hash = hdrtoken_hash(wks, hdrtoken_str_lengths[wks_idx]);
-    uint32_t slot = hash_to_slot(hash);
-
-    if (hdrtoken_hash_table[slot].wks) {
-      printf("ERROR: hdrtoken_hash_table[%u] collision: '%s' replacing '%s'\n",
-             slot, (const char*)wks, hdrtoken_hash_table[slot].wks);
-      ++num_collisions;
+  int num_misses = 0;
+
+  for (int i = 0; i < (int) SIZEOF(_hdrtoken_strs); i++) {
+    ink_release_assert(hdrtoken_str_lengths[i] < HDRTOKEN_MAX_LENGTH);
+    memset(hdrtoken_folded_strs[i], 0, HDRTOKEN_MAX_LENGTH);
+    for (int j = 0; j < hdrtoken_str_lengths[i]; j++)
+      hdrtoken_folded_strs[i][j] = ParseRules::ink_tolower(_hdrtoken_strs[i][j]);
+  }
+
+  // A stale generated table would send some strings to the wrong slot.
+  for (int i = 0; i < (int) SIZEOF(_hdrtoken_strs); i++) {
+    if (hdrtoken_tokenize(_hdrtoken_strs[i], hdrtoken_str_lengths[i]) != i) {
+      printf("ERROR: hdrtoken perfect hash does not find '%s'\n", _hdrtoken_strs[i]);
+      ++num_misses;
     }
-    hdrtoken_hash_table[slot].wks = (const char *)wks;
-    hdrtoken_hash_table[slot].hash = hash;
   }
 
-  if (num_collisions > 0)
+  if (num_misses > 0)
     abort();
 }
 
@@ -716,7 +411,6 @@ int
 hdrtoken_tokenize(const char *string, int string_len, const char **wks_string_out)
 {
   int wks_idx;
-  HdrTokenHashBucket *bucket;
 
   ink_assert(string != NULL);
 
@@ -727,17 +421,16 @@ hdrtoken_tokenize(const char *string, int string_len, const char **wks_string_ou
     return wks_idx;
   }
 
-  uint32_t hash = hdrtoken_hash((const unsigned char *) string, (unsigned int) string_len);
-  uint32_t slot = hash_to_slot(hash);
+  if (string_len > 0 && string_len < HDRTOKEN_MAX_LENGTH) {
+    uint64_t hash = hdrtoken_hash((const unsigned char *) string, (unsigned int) string_len);
+    uint32_t displacement = hdrtoken_hash_displacements[hash & (HDRTOKEN_HASH_BUCKETS - 1)];
 
-  bucket = &(hdrtoken_hash_table[slot]);
-  if ((bucket->wks != NULL) &&
-      (bucket->hash == hash) &&
-      (hdrtoken_wks_to_length(bucket->wks) == string_len)) {
-    wks_idx = hdrtoken_wks_to_index(bucket->wks);
-    if (wks_string_out)
-      *wks_string_out = bucket->wks;
-    return wks_idx;
+    wks_idx = hdrtoken_hash_slots[hdrtoken_hash_slot(hash, displacement, SIZEOF(_hdrtoken_strs))];
+    if ((hdrtoken_str_lengths[wks_idx] == string_len) && hdrtoken_match(string, string_len, hdrtoken_folded_strs[wks_idx])) {
+      if (wks_string_out)
+        *wks_string_out = hdrtoken_strs[wks_idx];
+      return wks_idx;
+    }
   }
 
   Debug("hdr_token", "Did not find a WKS for '%.*s'", string_len, string);
@@ -0,0 +1,232 @@
+/** @file
+
+  The well-known strings.
+
+  They are shared by HdrToken.cc and CompileHdrTokenHash, which generates
+  the perfect hash that hdrtoken_tokenize() looks them up with, along
+  with the hash functions both sides use.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef _HdrTokenStrs_h_
+#define _HdrTokenStrs_h_
+
+#include <stdint.h>
+
+/*
+ The strings are also compiled into a DFA of anchored patterns, which is
+ used at start up to bind the field and type initializers to them.
+ ** important, ordering matters **
+
+ You want a regexp like 'Accept' after "greedier" choices so it doesn't match 'Accept-Ranges' earlier than
+ it should. The regexp are anchored (^Accept), but I dont see a way with the current system to
+ match the word ONLY without making _hdrtoken_strs a real PCRE.
+
+ So, the current hack is to have "Accept" follow "Accept-.*", lame, I know
+
+  /ericb
+*/
+
+static const char *_hdrtoken_strs[] = {
+  // MIME Field names
+  "Accept-Charset",
+  "Accept-Encoding",
+  "Accept-Language",
+  "Accept-Ranges",
+  "Accept",
+  "Age",
+  "Allow",
+  "Approved",                   // NNTP
+  "Authorization",
+  "Bytes",                      // NNTP
+  "Cache-Control",
+  "Client-ip",
+  "Connection",
+  "Content-Base",
+  "Content-Encoding",
+  "Content-Language",
+  "Content-Length",
+  "Content-Location",
+  "Content-MD5",
+  "Content-Range",
+  "Content-Type",
+  "Control",                    // NNTP
+  "Cookie",
+  "Date",
+  "Distribution",               // NNTP
+  "Etag",
+  "Expect",
+  "Expires",
+  "Followup-To",                // NNTP
+  "From",
+  "Host",
+  "If-Match",
+  "If-Modified-Since",
+  "If-None-Match",
+  "If-Range",
+  "If-Unmodified-Since",
+  "Keep-Alive",
+  "Keywords",                   // NNTP
+  "Last-Modified",
+  "Lines",                      // NNTP
+  "Location",
+  "Max-Forwards",
+  "Message-ID",                 // NNTP
+  "MIME-Version",
+  "Newsgroups",                 // NNTP
+  "Organization",               // NNTP
+  "Path",                       // NNTP
+  "Pragma",
+  "Proxy-Authenticate",
+  "Proxy-Authorization",
+  "Proxy-Connection",
+  "Public",
+  "Range",
+  "References",                 // NNTP
+  "Referer",
+  "Reply-To",                   // NNTP
+  "Retry-After",
+  "Sender",                     // NNTP
+  "Server",
+  "Set-Cookie",
+  "Subject",                    // NNTP
+  "Summary",                    // NNTP
+  "Transfer-Encoding",
+  "Upgrade",
+  "User-Agent",
+  "Vary",
+  "Via",
+  "Warning",
+  "Www-Authenticate",
+  "Xref",                       // NNTP
+  "@DataInfo",                  // Internal Hack
+  
+  // Accept-Encoding
+  "compress",
+  "deflate",
+  "gzip",
+  "identity",
+  
+  // Cache-Control flags
+  "max-age",
+  "max-stale",
+  "min-fresh",
+  "must-revalidate",
+  "no-cache",
+  "no-store",
+  "no-transform",
+  "only-if-cached",
+  "private",
+  "proxy-revalidate",
+  "s-maxage",
+  "need-revalidate-once",
+  
+  // HTTP miscellaneous
+  "none",
+  "chunked",
+  "close",
+  
+  // WS
+  "websocket",
+  "Sec-WebSocket-Key",
+  "Sec-WebSocket-Version",
+
+  // URL schemes
+  "file",
+  "ftp",
+  "gopher",
+  "https",
+  "http",
+  "mailto",
+  "news",
+  "nntp",
+  "prospero",
+  "telnet",
+  "tunnel",
+  "wais",
+  "pnm",
+  "rtspu",
+  "rtsp",
+  "mmsu",
+  "mmst",
+  "mms",
+  "wss",
+  "ws",
+  
+  // HTTP methods
+  "CONNECT",
+  "DELETE",
+  "GET",
+  "POST",
+  "HEAD",
+  "ICP_QUERY",
+  "OPTIONS",
+  "PURGE",
+  "PUT",
+  "TRACE",
+  "PUSH",
+  
+  // Header extensions
+  "X-ID",
+  "X-Forwarded-For",
+  "TE",
+  "Strict-Transport-Security",
+  "100-continue"
+};
+
+#define HDRTOKEN_MAX_LENGTH   32    // longest well-known string, rounded up for the SIMD compare
+#define HDRTOKEN_HASH_BUCKETS 64    // displacement buckets of the perfect hash
+
+/**
+  FNV-1a over the string with letters folded to lower case. The fold
+  also merges some punctuation, a match is always checked against the
+  string.
+**/
+static inline uint64_t
+hdrtoken_hash(const unsigned char *string, unsigned int length)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  for (unsigned int i = 0; i < length; i++) {
+    hash ^= string[i] | 0x20;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+/**
+  Slot of a hash in a table of @a n, given the displacement of its bucket.
+  The high half of the hash is mixed with the displacement and mapped
+  onto [0, n) with a multiply instead of a division.
+**/
+static inline uint32_t
+hdrtoken_hash_slot(uint64_t hash, uint32_t displacement, uint32_t n)
+{
+  uint32_t x = (uint32_t) (hash >> 32) ^ displacement;
+
+  x ^= x >> 16;
+  x *= 0x85ebca6bU;
+  x ^= x >> 13;
+  x *= 0xc2b2ae35U;
+  x ^= x >> 16;
+  return (uint32_t) (((uint64_t) x * n) >> 32);
+}
+
+#endif
@@ -27,6 +27,7 @@
 #include "URL.h"
 #include "MIME.h"
 #include "HTTP.h"
+#include "HdrScan.h"
 #include "Diags.h"
 
 const char *URL_SCHEME_FILE;
@@ -1314,7 +1315,6 @@ url_parse_http(HdrHeap * heap, URLImpl * url, const char **start, const char *en
   const char *query_end = NULL;
   const char *fragment_start = NULL;
   const char *fragment_end = NULL;
-  char mask;
 
   err = url_parse_internet(heap, url, start, end, copy_strings);
   if (err < 0)
@@ -1325,52 +1325,40 @@ url_parse_http(HdrHeap * heap, URLImpl * url, const char **start, const char *en
     goto done;
 
   path_start = cur;
-  mask = ';' & '?' & '#';
-parse_path2:
-  if ((*cur & mask) == mask) {
-    if (*cur == ';') {
-      path_end = cur;
-      goto parse_params1;
-    }
-    if (*cur == '?') {
-      path_end = cur;
-      goto parse_query1;
-    }
-    if (*cur == '#') {
-      path_end = cur;
-      goto parse_fragment1;
-    }
-  } else {
-    ink_assert((*cur != ';') && (*cur != '?') && (*cur != '#'));
+  cur = hdr_scan_any(cur, end, ';', '?', '#');
+  if (!cur) {
+    cur = end;
+    goto done;
   }
-  GETNEXT(done);
-  goto parse_path2;
+  path_end = cur;
+  if (*cur == ';')
+    goto parse_params1;
+  if (*cur == '?')
+    goto parse_query1;
+  goto parse_fragment1;
 
 parse_params1:
   params_start = cur + 1;
   GETNEXT(done);
-parse_params2:
-  if (*cur == '?') {
-    params_end = cur;
-    goto parse_query1;
-  }
-  if (*cur == '#') {
-    params_end = cur;
-    goto parse_fragment1;
+  cur = hdr_scan_any(cur, end, '?', '#', '#');
+  if (!cur) {
+    cur = end;
+    goto done;
   }
-  GETNEXT(done);
-  goto parse_params2;
+  params_end = cur;
+  if (*cur == '?')
+    goto parse_query1;
+  goto parse_fragment1;
 
 parse_query1:
   query_start = cur + 1;
   GETNEXT(done);
-parse_query2:
-  if (*cur == '#') {
-    query_end = cur;
-    goto parse_fragment1;
+  cur = static_cast<char const*>(memchr(cur, '#', end - cur));
+  if (!cur) {
+    cur = end;
+    goto done;
   }
-  GETNEXT(done);
-  goto parse_query2;
+  query_end = cur;
 
 parse_fragment1:
   fragment_start = cur + 1;
@@ -124,7 +124,8 @@ static
 ConfigEnumPair<TSServerSessionSharingPoolType> SessionSharingPoolStrings[] =
 {
   { TS_SERVER_SESSION_SHARING_POOL_GLOBAL, "global" },
-  { TS_SERVER_SESSION_SHARING_POOL_THREAD, "thread" }
+  { TS_SERVER_SESSION_SHARING_POOL_THREAD, "thread" },
+  { TS_SERVER_SESSION_SHARING_POOL_HYBRID, "hybrid" }
 };
 
 # define ARRAY_SIZE(x) (sizeof(x)/(sizeof((x)[0])))
@@ -343,6 +344,20 @@ register_stat_callbacks()
                      "proxy.process.http.current_cache_connections",
                      RECD_INT, RECP_NON_PERSISTENT, (int) http_current_cache_connections_stat, RecRawStatSyncSum);
   HTTP_CLEAR_DYN_STAT(http_current_cache_connections_stat);
+
+  // Server session pool stats
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.hits",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) http_server_session_pool_hits_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.misses",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) http_server_session_pool_misses_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.steals",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) http_server_session_pool_steals_stat, RecRawStatSyncCount);
+  RecRegisterRawStat(http_rsb, RECT_PROCESS,
+                     "proxy.process.http.server_session_pool.over_origin_limit",
+                     RECD_COUNTER, RECP_PERSISTENT, (int) http_server_session_pool_over_limit_stat, RecRawStatSyncCount);
   RecRegisterRawStat(http_rsb, RECT_PROCESS,
                      "proxy.process.http.avg_transactions_per_client_connection",
                      RECD_FLOAT, RECP_PERSISTENT, (int) http_transactions_per_client_con, RecRawStatSyncAvg);
@@ -1219,6 +1234,7 @@ HttpConfig::startup()
   http_rsb = RecAllocateRawStatBlock((int) http_stat_count);
   register_configs();
   register_stat_callbacks();
+  hdr_heap_stats_init();
 
   HttpConfigParams &c = m_master;
 
@@ -1246,6 +1262,7 @@ HttpConfig::startup()
   HttpEstablishStaticConfigLongLong(c.oride.server_tcp_init_cwnd, "proxy.config.http.server_tcp_init_cwnd");
   HttpEstablishStaticConfigLongLong(c.oride.origin_max_connections, "proxy.config.http.origin_max_connections");
   HttpEstablishStaticConfigLongLong(c.origin_min_keep_alive_connections, "proxy.config.http.origin_min_keep_alive_connections");
+  HttpEstablishStaticConfigLongLong(c.server_session_max_idle_per_origin, "proxy.config.http.server_session_sharing.max_idle_per_origin");
   HttpEstablishStaticConfigLongLong(c.attach_server_session_to_client, "proxy.config.http.attach_server_session_to_client");
 
   HttpEstablishStaticConfigByte(c.parent_proxy_routing_enable, "proxy.config.http.parent_proxy_routing_enable");
@@ -1354,6 +1371,7 @@ HttpConfig::startup()
 
   HttpEstablishStaticConfigByte(c.oride.insert_age_in_response, "proxy.config.http.insert_age_in_response");
   HttpEstablishStaticConfigByte(c.enable_http_stats, "proxy.config.http.enable_http_stats");
+  HttpEstablishStaticConfigByte(c.hdr_heap_arena, "proxy.config.http.header_heap_arena");
   HttpEstablishStaticConfigByte(c.oride.normalize_ae_gzip, "proxy.config.http.normalize_ae_gzip");
 
   HttpEstablishStaticConfigByte(c.icp_enabled, "proxy.config.icp.enabled");
@@ -1514,6 +1532,7 @@ HttpConfig::reconfigure()
   params->oride.server_tcp_init_cwnd = m_master.oride.server_tcp_init_cwnd;
   params->oride.origin_max_connections = m_master.oride.origin_max_connections;
   params->origin_min_keep_alive_connections = m_master.origin_min_keep_alive_connections;
+  params->server_session_max_idle_per_origin = m_master.server_session_max_idle_per_origin;
   params->attach_server_session_to_client = m_master.attach_server_session_to_client;
 
   if (params->oride.origin_max_connections &&
@@ -1611,6 +1630,7 @@ HttpConfig::reconfigure()
   params->oride.insert_squid_x_forwarded_for = INT_TO_BOOL(m_master.oride.insert_squid_x_forwarded_for);
   params->oride.insert_age_in_response = INT_TO_BOOL(m_master.oride.insert_age_in_response);
   params->enable_http_stats = INT_TO_BOOL(m_master.enable_http_stats);
+  params->hdr_heap_arena = INT_TO_BOOL(m_master.hdr_heap_arena);
   params->oride.normalize_ae_gzip = INT_TO_BOOL(m_master.oride.normalize_ae_gzip);
 
   params->icp_enabled = (m_master.icp_enabled == ICP_MODE_SEND_RECEIVE ? 1 : 0); // INT_TO_BOOL
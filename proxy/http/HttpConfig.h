@@ -91,6 +91,12 @@ enum
   http_current_server_connections_stat,
   http_current_cache_connections_stat,
 
+  // Server session pool stats
+  http_server_session_pool_hits_stat,
+  http_server_session_pool_misses_stat,
+  http_server_session_pool_steals_stat,
+  http_server_session_pool_over_limit_stat,
+
   // Http K-A Stats
   http_transactions_per_client_con,
   http_transactions_per_server_con,
@@ -652,6 +658,7 @@ public:
 
   MgmtInt server_max_connections;
   MgmtInt origin_min_keep_alive_connections; // TODO: This one really ought to be overridable, but difficult right now.
+  MgmtInt server_session_max_idle_per_origin;
   MgmtInt attach_server_session_to_client;
 
   MgmtByte parent_proxy_routing_enable;
@@ -697,6 +704,8 @@ public:
 
   MgmtByte enable_http_stats; // Can be "slow"
 
+  MgmtByte hdr_heap_arena;
+
   ///////////////////
   // ICP variables //
   ///////////////////
@@ -886,6 +895,7 @@ HttpConfigParams::HttpConfigParams()
     proxy_hostname_len(0),
     server_max_connections(0),
     origin_min_keep_alive_connections(0),
+    server_session_max_idle_per_origin(0),
     parent_proxy_routing_enable(0),
     disable_ssl_parenting(0),
     enable_url_expandomatic(0),
@@ -909,6 +919,7 @@ HttpConfigParams::HttpConfigParams()
     parent_connect_timeout(30),
     anonymize_other_header_list(NULL),
     enable_http_stats(1),
+    hdr_heap_arena(0),
     icp_enabled(0),
     stale_icp_enabled(0),
     cache_vary_default_text(NULL),
@@ -48,6 +48,7 @@
 #define DEFAULT_RESPONSE_BUFFER_SIZE_INDEX    6 // 8K
 #define DEFAULT_REQUEST_BUFFER_SIZE_INDEX    6  // 8K
 #define MIN_CONFIG_BUFFER_SIZE_INDEX          5 // 4K
+#define HTTP_SPLICE_MIN_BODY_SIZE             (1 << 20) // 1M
 
 #define hsm_release_assert(EX) \
 { \
@@ -344,6 +345,8 @@ HttpSM::HttpSM()
 void
 HttpSM::cleanup()
 {
+  release_url_rewrite(t_state.url_rewrite_table);
+  t_state.url_rewrite_table = NULL;
   t_state.destroy();
   api_hooks.clear();
   http_parser_clear(&http_parser);
@@ -556,6 +559,7 @@ HttpSM::attach_client_session(HttpClientSession * client_vc, IOBufferReader * bu
   ua_buffer_reader = buffer_reader;
   ua_entry->vc_handler = &HttpSM::state_read_client_request_header;
   t_state.hdr_info.client_request.destroy();
+  t_state.hdr_arena_prepare(&t_state.hdr_info.client_request);
   t_state.hdr_info.client_request.create(HTTP_TYPE_REQUEST);
   http_parser_init(&http_parser);
 
@@ -898,6 +902,7 @@ HttpSM::setup_push_read_response_header()
   // Note: we must use destroy() here since clear()
   //  does not free the memory from the header
   t_state.hdr_info.server_response.destroy();
+  t_state.hdr_arena_prepare(&t_state.hdr_info.server_response);
   t_state.hdr_info.server_response.create(HTTP_TYPE_RESPONSE);
   http_parser_clear(&http_parser);
 
@@ -1545,6 +1550,7 @@ HttpSM::handle_api_return()
        setup_server_transfer();
        perform_cache_write_action();
        tunnel.tunnel_run();
+       splice_server_transfer();
       }
       break;
     }
@@ -1605,7 +1611,7 @@ HttpSM::state_http_server_open(int event, void *data)
 
   switch (event) {
   case NET_EVENT_OPEN:
-    session = (TS_SERVER_SESSION_SHARING_POOL_THREAD == t_state.txn_conf->server_session_sharing_pool) ? 
+    session = (TS_SERVER_SESSION_SHARING_POOL_GLOBAL != t_state.txn_conf->server_session_sharing_pool) ? 
       THREAD_ALLOC_INIT(httpServerSessionAllocator, mutex->thread_holding) :
       httpServerSessionAllocator.alloc();
     session->sharing_pool = static_cast<TSServerSessionSharingPoolType>(t_state.txn_conf->server_session_sharing_pool);
@@ -2698,6 +2704,7 @@ HttpSM::tunnel_handler_100_continue(int event, void *data)
       // Since 100 isn't a final (loggable) response header
       //   kill the 100 continue header and create an empty one
       t_state.hdr_info.server_response.destroy();
+      t_state.hdr_arena_prepare(&t_state.hdr_info.server_response);
       t_state.hdr_info.server_response.create(HTTP_TYPE_RESPONSE);
       handle_server_setup_error(VC_EVENT_EOS, server_entry->read_vio);
     } else {
@@ -5664,6 +5671,7 @@ HttpSM::setup_server_read_response_header()
   // Note: we must use destroy() here since clear()
   //  does not free the memory from the header
   t_state.hdr_info.server_response.destroy();
+  t_state.hdr_arena_prepare(&t_state.hdr_info.server_response);
   t_state.hdr_info.server_response.create(HTTP_TYPE_RESPONSE);
   http_parser_clear(&http_parser);
   server_response_hdr_bytes = 0;
@@ -6292,6 +6300,21 @@ HttpSM::setup_server_transfer()
   tunnel.set_producer_chunking_size(p, t_state.txn_conf->http_chunking_size);
 }
 
+// A large response body which goes unchanged to the client only, with no
+// cache write, transform or plugin agent, is spliced from the server
+// connection straight to the client connection.
+void
+HttpSM::splice_server_transfer()
+{
+  HttpTunnelProducer *p = tunnel.get_producer(server_entry->vc);
+
+  if (p && p->alive && p->num_consumers == 1 && p->consumer_list.head->vc_type == HT_HTTP_CLIENT &&
+      p->chunking_action == TCA_PASSTHRU_DECHUNKED_CONTENT && ua_session &&
+      (p->nbytes < 0 || p->nbytes >= HTTP_SPLICE_MIN_BODY_SIZE)) {
+    server_session->get_netvc()->splice_to(ua_session->get_netvc());
+  }
+}
+
 void
 HttpSM::setup_push_transfer_to_cache()
 {
@@ -6389,6 +6412,13 @@ HttpSM::setup_blind_tunnel(bool send_response_hdr)
   server_entry->in_tunnel = true;
 
   tunnel.tunnel_run();
+
+  // Nothing looks at the data of a blind tunnel, so once the buffers
+  // above have drained the sockets can be spliced together.
+  if (ua_session && server_session) {
+    server_session->get_netvc()->splice_to(ua_session->get_netvc());
+    ua_session->get_netvc()->splice_to(server_session->get_netvc());
+  }
 }
 
 void
@@ -7074,6 +7104,7 @@ HttpSM::set_next_state()
       if (transform_info.vc) {
         ink_assert(t_state.hdr_info.client_response.valid() == 0);
         ink_assert((t_state.hdr_info.transform_response.valid()? true : false) == true);
+        t_state.hdr_arena_prepare(&t_state.hdr_info.cache_response);
         t_state.hdr_info.cache_response.create(HTTP_TYPE_RESPONSE);
         t_state.hdr_info.cache_response.copy(&t_state.hdr_info.transform_response);
 
@@ -7082,6 +7113,7 @@ HttpSM::set_next_state()
         tunnel.tunnel_run(p);
       } else {
         ink_assert((t_state.hdr_info.client_response.valid()? true : false) == true);
+        t_state.hdr_arena_prepare(&t_state.hdr_info.cache_response);
         t_state.hdr_info.cache_response.create(HTTP_TYPE_RESPONSE);
         t_state.hdr_info.cache_response.copy(&t_state.hdr_info.client_response);
 
@@ -41,12 +41,13 @@ void
 initialize_thread_for_http_sessions(EThread *thread, int /* thread_index ATS_UNUSED */)
 {
   thread->server_session_pool = new ServerSessionPool;
+  thread->server_session_pool->m_thread = thread;
 }
 
 HttpSessionManager httpSessionManager;
 
 ServerSessionPool::ServerSessionPool()
-  : Continuation(new_ProxyMutex()), m_ip_pool(1023), m_host_pool(1023)
+  : Continuation(new_ProxyMutex()), m_ip_pool(1023), m_host_pool(1023), m_thread(NULL), m_idle(0), m_handoff_pending(0)
 {
   SET_HANDLER(&ServerSessionPool::eventHandler);
   m_ip_pool.setExpansionPolicy(IPHashTable::MANUAL);
@@ -61,6 +62,7 @@ ServerSessionPool::purge()
   }
   m_ip_pool.clear();
   m_host_pool.clear();
+  m_idle = 0;
 }
 
 bool
@@ -75,7 +77,8 @@ ServerSessionPool::match(HttpServerSession* ss, sockaddr const* addr, INK_MD5 co
 }
 
 HttpServerSession*
-ServerSessionPool::acquireSession(sockaddr const* addr, INK_MD5 const& hostname_hash, TSServerSessionSharingMatchType match_style)
+ServerSessionPool::acquireSession(sockaddr const* addr, INK_MD5 const& hostname_hash, TSServerSessionSharingMatchType match_style,
+                                  bool migratable)
 {
   HttpServerSession* zret = NULL;
 
@@ -83,25 +86,28 @@ ServerSessionPool::acquireSession(sockaddr const* addr, INK_MD5 const& hostname_
     // This is broken out because only in this case do we check the host hash first.
     HostHashTable::Location loc = m_host_pool.find(hostname_hash);
     in_port_t port = ats_ip_port_cast(addr);
-    while (loc && port != ats_ip_port_cast(loc->server_ip)) ++loc; // scan for matching port.
+    // scan for matching port.
+    while (loc && (port != ats_ip_port_cast(loc->server_ip) || (migratable && !loc->get_netvc()->can_migrate())))
+      ++loc;
     if (loc) {
       zret = loc;
       m_host_pool.remove(loc);
       m_ip_pool.remove(m_ip_pool.find(zret));
+      --m_idle;
     }
   } else if (TS_SERVER_SESSION_SHARING_MATCH_NONE != match_style) { // matching is not disabled.
     IPHashTable::Location loc = m_ip_pool.find(addr);
     // If we're matching on the IP address we're done, this one is good enough.
     // Otherwise we need to scan further matches to match the host name as well.
     // Note we don't have to check the port because it's checked as part of the IP address key.
-    if (TS_SERVER_SESSION_SHARING_MATCH_IP != match_style) {
-      while (loc && loc->hostname_hash != hostname_hash)
-        ++loc;
-    }
+    while (loc && ((TS_SERVER_SESSION_SHARING_MATCH_IP != match_style && loc->hostname_hash != hostname_hash) ||
+                   (migratable && !loc->get_netvc()->can_migrate())))
+      ++loc;
     if (loc) {
       zret = loc;
       m_ip_pool.remove(loc);
       m_host_pool.remove(m_host_pool.find(zret));
+      --m_idle;
     }
   }
   return zret;
@@ -126,10 +132,87 @@ ServerSessionPool::releaseSession(HttpServerSession* ss)
   // put it in the pools.
   m_ip_pool.insert(ss);
   m_host_pool.insert(ss);
+  ++m_idle;
 
   Debug("http_ss", "[%" PRId64 "] [release session] " "session placed into shared pool", ss->con_id);
 }
 
+int
+ServerSessionPool::countSessions(sockaddr const* addr, INK_MD5 const& hostname_hash)
+{
+  int count = 0;
+
+  // The IP key includes the port.
+  for (IPHashTable::Location loc = m_ip_pool.find(addr); loc; ++loc) {
+    if (loc->hostname_hash == hostname_hash)
+      ++count;
+  }
+  return count;
+}
+
+void
+ServerSessionPool::serveHandoff(SessionHandoff* h)
+{
+  ServerSessionPool *to = h->to;
+  // Only take sessions that can be moved, SSL ones never can.
+  HttpServerSession *ss = acquireSession(&h->addr.sa, h->hostname_hash, h->match_style, true);
+
+  if (ss) {
+    NetVConnection *vc = ss->get_netvc();
+
+    // Until the other thread moves it, the connection stays here with its
+    // I/O and timeouts off. Its VIOs take the lock of the pool it goes to,
+    // so this thread leaves it alone while that pool moves it.
+    h->session = ss;
+    h->inactivity_timeout = vc->get_inactivity_timeout();
+    h->active_timeout = vc->get_active_timeout();
+    vc->cancel_inactivity_timeout();
+    vc->cancel_active_timeout();
+    vc->mutex = to->mutex;
+    ss->do_io_read(to, 0, NULL);
+    ss->do_io_write(to, 0, NULL);
+    Debug("http_ss", "[%" PRId64 "] [handoff] session handed to thread %p", ss->con_id, to->m_thread);
+    to->m_inbox.push(h);
+    to->m_thread->schedule_imm(to);
+  } else {
+    delete h;
+  }
+  to->m_handoff_pending = 0;
+}
+
+void
+ServerSessionPool::takeInbox()
+{
+  SessionHandoff *h = NULL;
+  HttpConfigParams *http_config_params = HttpConfig::acquire();
+  MgmtInt max_idle = http_config_params->server_session_max_idle_per_origin;
+  HttpConfig::release(http_config_params);
+
+  SList(SessionHandoff, link) q(m_inbox.popall());
+  while ((h = q.pop())) {
+    HttpServerSession *ss = h->session;
+    NetVConnection *vc = ss->get_netvc()->migrate_to_thread(this, m_thread);
+
+    if (!vc) {
+      Debug("http_ss", "[%" PRId64 "] [handoff] could not move session, closing it", ss->con_id);
+      ss->do_io_close();
+    } else {
+      ss->set_netvc(vc);
+      vc->set_inactivity_timeout(h->inactivity_timeout);
+      if (h->active_timeout)
+        vc->set_active_timeout(h->active_timeout);
+      RecIncrRawStat(http_rsb, m_thread, (int) http_server_session_pool_steals_stat, 1);
+      if (max_idle > 0 && countSessions(&ss->server_ip.sa, ss->hostname_hash) >= max_idle) {
+        RecIncrRawStat(http_rsb, m_thread, (int) http_server_session_pool_over_limit_stat, 1);
+        ss->do_io_close();
+      } else {
+        releaseSession(ss);
+      }
+    }
+    delete h;
+  }
+}
+
 //   Called from the NetProcessor to let us know that a
 //    connection has closed down
 //
@@ -140,6 +223,15 @@ ServerSessionPool::eventHandler(int event, void *data)
   HttpServerSession *s = NULL;
 
   switch (event) {
+  case EVENT_IMMEDIATE: {
+    // A request from another thread, or sessions waiting in the inbox.
+    SessionHandoff *h = static_cast<SessionHandoff *>(static_cast<Event *>(data)->cookie);
+    if (h)
+      serveHandoff(h);
+    else
+      takeInbox();
+    return 0;
+  }
   case VC_EVENT_READ_READY:
     // The server sent us data.  This is unexpected so
     //   close the connection
@@ -190,6 +282,7 @@ ServerSessionPool::eventHandler(int event, void *data)
       // Out of the pool! Now!
       m_ip_pool.remove(lh);
       m_host_pool.remove(m_host_pool.find(s));
+      --m_idle;
       // Drop connection on this end.
       s->do_io_close();
       found = true;
@@ -259,8 +352,10 @@ HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockad
   // Now check to see if we have a connection in our shared connection pool
   EThread *ethread = this_ethread();
 
-  if (TS_SERVER_SESSION_SHARING_POOL_THREAD == sm->t_state.txn_conf->server_session_sharing_pool) {
+  if (TS_SERVER_SESSION_SHARING_POOL_GLOBAL != sm->t_state.txn_conf->server_session_sharing_pool) {
     to_return = ethread->server_session_pool->acquireSession(ip, hostname_hash, match_style);
+    if (!to_return && TS_SERVER_SESSION_SHARING_POOL_HYBRID == sm->t_state.txn_conf->server_session_sharing_pool)
+      steal_session(ethread, ip, hostname_hash, match_style);
   } else {
     MUTEX_TRY_LOCK(lock, m_g_pool->mutex, ethread);
     if (lock) {
@@ -274,24 +369,73 @@ HttpSessionManager::acquire_session(Continuation * /* cont ATS_UNUSED */, sockad
 
   if (to_return) {
     Debug("http_ss", "[%" PRId64 "] [acquire session] " "return session from shared pool", to_return->con_id);
+    RecIncrRawStat(http_rsb, ethread, (int) http_server_session_pool_hits_stat, 1);
     to_return->state = HSS_ACTIVE;
     sm->attach_server_session(to_return);
     return HSM_DONE;
   }
+  RecIncrRawStat(http_rsb, ethread, (int) http_server_session_pool_misses_stat, 1);
   return HSM_NOT_FOUND;
 }
 
+void
+HttpSessionManager::steal_session(EThread *ethread, sockaddr const* ip, INK_MD5 const& hostname_hash,
+                                  TSServerSessionSharingMatchType match_style)
+{
+  ServerSessionPool *pool = ethread->server_session_pool;
+  int n_threads = eventProcessor.n_threads_for_type[ET_NET];
+  EThread **threads = eventProcessor.eventthread[ET_NET];
+  int self = 0;
+
+  if (pool->m_handoff_pending)
+    return;
+
+  // Start with the thread after this one so requests are spread over the pools.
+  while (self < n_threads && threads[self] != ethread)
+    ++self;
+
+  for (int i = 1; i < n_threads; ++i) {
+    EThread *victim = threads[(self + i) % n_threads];
+    if (victim == ethread || victim->server_session_pool->m_idle <= 0)
+      continue;
+
+    SessionHandoff *h = new SessionHandoff;
+    ats_ip_copy(&h->addr, ip);
+    h->hostname_hash = hostname_hash;
+    h->match_style = match_style;
+    h->to = pool;
+    h->session = NULL;
+    h->inactivity_timeout = 0;
+    h->active_timeout = 0;
+    pool->m_handoff_pending = 1;
+    victim->schedule_imm(victim->server_session_pool, EVENT_IMMEDIATE, h);
+    Debug("http_ss", "[steal session] asked thread %p for a session", victim);
+    return;
+  }
+}
+
 HSMresult_t
 HttpSessionManager::release_session(HttpServerSession *to_release)
 {
   EThread *ethread = this_ethread();
-  ServerSessionPool* pool = TS_SERVER_SESSION_SHARING_POOL_THREAD == to_release->sharing_pool ? ethread->server_session_pool : m_g_pool;
+  ServerSessionPool* pool = TS_SERVER_SESSION_SHARING_POOL_GLOBAL != to_release->sharing_pool ? ethread->server_session_pool : m_g_pool;
   bool released_p = true;
   
   // The per thread lock looks like it should not be needed but if it's not locked the close checking I/O op will crash.
   MUTEX_TRY_LOCK(lock, pool->mutex, ethread);
   if (lock) {
-    pool->releaseSession(to_release);
+    HttpConfigParams *http_config_params = HttpConfig::acquire();
+    MgmtInt max_idle = http_config_params->server_session_max_idle_per_origin;
+    HttpConfig::release(http_config_params);
+
+    if (max_idle > 0 && pool->countSessions(&to_release->server_ip.sa, to_release->hostname_hash) >= max_idle) {
+      // The pool has enough idle sessions to this origin already, the session is done.
+      Debug("http_ss", "[%" PRId64 "] [release session] origin has %" PRId64 " idle sessions, closing", to_release->con_id, max_idle);
+      RecIncrRawStat(http_rsb, ethread, (int) http_server_session_pool_over_limit_stat, 1);
+      to_release->do_io_close();
+    } else {
+      pool->releaseSession(to_release);
+    }
   } else {
     Debug("http_ss", "[%" PRId64 "] [release session] could not release session due to lock contention", to_release->con_id);
     released_p = false;
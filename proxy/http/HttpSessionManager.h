@@ -44,6 +44,27 @@ class HttpSM;
 void
 initialize_thread_for_http_sessions(EThread *thread, int thread_index);
 
+class ServerSessionPool;
+
+/** A session handed from the pool of one thread to another.
+
+    The thread that wants a session sends this to another thread as a request. If that thread has a
+    matching idle session, it detaches the session and pushes this onto the inbox of the pool that
+    asked. The pool that asked then moves the connection to its own thread.
+*/
+struct SessionHandoff
+{
+  IpEndpoint addr;
+  INK_MD5 hostname_hash;
+  TSServerSessionSharingMatchType match_style;
+  ServerSessionPool *to;          ///< Pool that asked for the session.
+  HttpServerSession *session;     ///< Session found, @c NULL while this is a request.
+  ink_hrtime inactivity_timeout;  ///< Timeouts of the session, which are off while it moves.
+  ink_hrtime active_timeout;
+
+  SLINK(SessionHandoff, link);
+};
+
 /** A pool of server sessions.
 
     This is a continuation so that it can get callbacks from the server sessions.
@@ -99,15 +120,30 @@ public:
   /** Get a session from the pool.
 
       The session is selected based on @a match_style equivalently to @a match. If found the session
-      is removed from the pool.
+      is removed from the pool. If @a migratable is set only sessions whose connection can be moved
+      to another thread are considered.
 
       @return A pointer to the session or @c NULL if not matching session was found.
   */
-  HttpServerSession* acquireSession(sockaddr const* addr, INK_MD5 const& host_hash, TSServerSessionSharingMatchType match_style);
+  HttpServerSession* acquireSession(sockaddr const* addr, INK_MD5 const& host_hash, TSServerSessionSharingMatchType match_style,
+                                    bool migratable = false);
   /** Release a session to to pool.
    */
   void releaseSession(HttpServerSession* ss);
 
+  /// Count the sessions in the pool to the origin server at @a addr for the host name @a host_hash.
+  int countSessions(sockaddr const* addr, INK_MD5 const& host_hash);
+
+  /** Answer a request from another thread for a session.
+
+      If a matching session is in the pool it is detached and pushed onto the inbox of the pool
+      that asked, otherwise @a h is dropped. Runs on the thread of this pool.
+  */
+  void serveHandoff(SessionHandoff* h);
+
+  /// Move the sessions in the inbox to this thread and into the pool.
+  void takeInbox();
+
   /// Close all sessions and then clear the table.
   void purge();
 
@@ -115,6 +151,11 @@ public:
   // Note that each server session is stored in both pools.
   IPHashTable m_ip_pool;
   HostHashTable m_host_pool;
+
+  EThread* m_thread; ///< Thread of a per thread pool, @c NULL for the global pool.
+  volatile int m_idle; ///< Sessions in the pool, read without the lock by other threads as a hint.
+  volatile int m_handoff_pending; ///< Set while this pool has a request out to another thread.
+  ASLL(SessionHandoff, link) m_inbox; ///< Sessions handed over by other threads.
 };
 
 enum HSMresult_t
@@ -141,6 +182,16 @@ public:
   int main_handler(int event, void *data);
 
 private:
+  /** Ask another net thread for a matching session.
+
+      The request goes to the next thread with idle sessions, no other pool is
+      locked. A session found arrives later in the inbox of the pool of
+      @a ethread, so it serves a later transaction rather than this one. Only
+      one request per thread is out at a time.
+  */
+  void steal_session(EThread *ethread, sockaddr const* addr, INK_MD5 const& host_hash,
+                     TSServerSessionSharingMatchType match_style);
+
   /// Global pool, used if not per thread pools.
   /// @internal We delay creating this because the session manager is created during global statics init.
   ServerSessionPool* m_g_pool;
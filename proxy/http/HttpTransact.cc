@@ -600,6 +600,7 @@ HttpTransact::HandleBlindTunnel(State* s)
 
   // We've received a request on a port which we blind forward
   //  For logging purposes we create a fake request
+  s->hdr_arena_prepare(&s->hdr_info.client_request);
   s->hdr_info.client_request.create(HTTP_TYPE_REQUEST);
   s->hdr_info.client_request.method_set(HTTP_METHOD_CONNECT, HTTP_LEN_CONNECT);
   URL u;
@@ -1722,7 +1723,9 @@ HttpTransact::OSDNSLookup(State* s)
     // HostDB addresses. We use those if they're different from the CTA.
     // In all cases we now commit to client or HostDB for our source.
     if (s->host_db_info.round_robin) {
-      HostDBInfo* cta = s->host_db_info.rr()->select_next(&s->current.server->addr.sa);
+      // the round robin data goes away when the record is replaced
+      HostDBRoundRobin *rr = s->host_db_info.rr();
+      HostDBInfo* cta = rr ? rr->select_next(&s->current.server->addr.sa) : NULL;
       if (cta) {
         // found another addr, lock in host DB.
         s->host_db_info = *cta;
@@ -2059,6 +2062,7 @@ HttpTransact::HandlePushResponseHdr(State* s)
     return;
   }
   // We need to create the request header storing in the cache
+  s->hdr_arena_prepare(&s->hdr_info.server_request);
   s->hdr_info.server_request.create(HTTP_TYPE_REQUEST);
   s->hdr_info.server_request.copy(&s->hdr_info.client_request);
   s->hdr_info.server_request.method_set(HTTP_METHOD_GET, HTTP_LEN_GET);
@@ -4020,6 +4024,7 @@ HttpTransact::handle_100_continue_response(State* s)
 void
 HttpTransact::build_response_copy(State* s, HTTPHdr* base_response,HTTPHdr* outgoing_response, HTTPVersion outgoing_version)
 {
+  s->hdr_arena_prepare(outgoing_response);
   HttpTransactHeaders::copy_header_fields(base_response, outgoing_response, s->txn_conf->fwd_proxy_auth_to_parent,
                                           s->current.now);
   HttpTransactHeaders::convert_response(outgoing_version, outgoing_response);   // http version conversion
@@ -4755,6 +4760,7 @@ HttpTransact::handle_transform_ready(State* s)
 void
 HttpTransact::set_header_for_transform(State* s, HTTPHdr* base_header)
 {
+  s->hdr_arena_prepare(&s->hdr_info.transform_response);
   s->hdr_info.transform_response.create(HTTP_TYPE_RESPONSE);
   s->hdr_info.transform_response.copy(base_header);
 
@@ -7662,6 +7668,7 @@ HttpTransact::build_request(State* s, HTTPHdr* base_request, HTTPHdr* outgoing_r
     }
   }
 
+  s->hdr_arena_prepare(outgoing_request);
   HttpTransactHeaders::copy_header_fields(base_request, outgoing_request, s->txn_conf->fwd_proxy_auth_to_parent);
   add_client_ip_to_outgoing_request(s, outgoing_request);
   HttpTransactHeaders::remove_privacy_headers_from_request(s->http_config_param, s->txn_conf, outgoing_request);
@@ -7793,6 +7800,7 @@ HttpTransact::build_response(State* s, HTTPHdr* base_response, HTTPHdr* outgoing
     reason_phrase = http_hdr_reason_lookup(status_code);
   }
 
+  s->hdr_arena_prepare(outgoing_response);
   if (base_response == NULL) {
     HttpTransactHeaders::build_base_response(outgoing_response, status_code, reason_phrase, strlen(reason_phrase), s->current.now);
   } else {
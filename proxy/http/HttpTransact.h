@@ -109,6 +109,7 @@ typedef time_t ink_time_t;
 struct HttpConfigParams;
 struct MimeTableEntry;
 class HttpSM;
+class UrlRewrite;
 
 #include "InkErrno.h"
 #define UNKNOWN_INTERNAL_ERROR           (INK_START_ERRNO - 1)
@@ -857,6 +858,7 @@ public:
     HttpSM *state_machine;
 
     Arena arena;
+    Ptr<HdrHeapArena> hdr_arena;        // header heaps of the transaction, see hdr_arena_prepare()
 
     HttpConfigParams *http_config_param;
     CacheLookupInfo cache_info;
@@ -988,6 +990,7 @@ public:
 
     // Remap plugin processor support
     UrlMappingContainer url_map;
+    UrlRewrite *url_rewrite_table;      // the remap table url_map points into, referenced
     host_hdr_info hh_info;
 
     // congestion control
@@ -1099,6 +1102,7 @@ public:
         saved_update_cache_action(CACHE_DO_UNDEFINED),
         stale_icp_lookup(false),
         url_map(),
+        url_rewrite_table(NULL),
         pCongestionEntry(NULL),
         congest_saved_next_action(SM_ACTION_UNDEFINED),
         congestion_control_crat(0),
@@ -1184,6 +1188,7 @@ public:
       cache_info.transform_store.destroy();
       redirect_info.original_url.destroy();
       redirect_info.redirect_url.destroy();
+      hdr_arena = NULL;
 
       if (pCongestionEntry) {
         if (congestion_connection_opened == 1) {
@@ -1203,6 +1208,18 @@ public:
       return;
     }
 
+    // Have the next create() or copy() of @a hdr build it in the
+    //  header arena of the transaction, if header arenas are enabled
+    void
+    hdr_arena_prepare(HTTPHdr *hdr)
+    {
+      if (!http_config_param->hdr_heap_arena || hdr->m_heap)
+        return;
+      if (!hdr_arena)
+        hdr_arena = new_HdrHeapArena();
+      hdr->m_heap = new_HdrHeap(HDR_HEAP_DEFAULT_SIZE, hdr_arena);
+    }
+
     // Little helper function to setup the per-transaction configuration copy
     void
     setup_per_txn_configs()
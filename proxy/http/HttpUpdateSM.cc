@@ -70,6 +70,7 @@ HttpUpdateSM::start_scheduled_update(Continuation * cont, HTTPHdr * request)
   start_sub_sm();
 
   // Make a copy of the request we being asked to do
+  t_state.hdr_arena_prepare(&t_state.hdr_info.client_request);
   t_state.hdr_info.client_request.create(HTTP_TYPE_REQUEST);
   t_state.hdr_info.client_request.copy(request);
 
@@ -73,7 +73,7 @@ clear_xstr_array(char *v[], size_t vsize)
 }
 
 BUILD_TABLE_INFO::BUILD_TABLE_INFO()
-  : remap_optflg(0), paramc(0), argc(0), rules_list(NULL), rewrite(NULL)
+  : remap_optflg(0), paramc(0), argc(0), rules_list(NULL), rewrite(NULL), pending_regexes(NULL)
 {
   memset(this->paramv, 0, sizeof(this->paramv));
   memset(this->argv, 0, sizeof(this->argv));
@@ -262,6 +262,7 @@ parse_include_directive(const char * directive, BUILD_TABLE_INFO * bti, char * e
 
     nbti.rules_list = bti->rules_list;
     nbti.rewrite = bti->rewrite;
+    nbti.pending_regexes = bti->pending_regexes;
 
     // XXX at this point, we need to register the included file(s) with the management subsystem
     // so that we can correctly reload them when they change. Otherwise, the operator will have to
@@ -272,6 +273,7 @@ parse_include_directive(const char * directive, BUILD_TABLE_INFO * bti, char * e
 
     // The sub-parse might have updated the rules list, so push it up to the parent parse.
     bti->rules_list = nbti.rules_list;
+    bti->pending_regexes = nbti.pending_regexes;
 
     if (!success) {
       snprintf(errbuf, errbufsize, "failed to parse included file %s", bti->paramv[i]);
@@ -732,13 +734,19 @@ remap_load_plugin(const char ** argv, int argc, url_mapping *mp, char *errbuf, i
   }
 
   void* ih;
+  bool reused;
+  uint32_t reuse = 0;
 
+  REC_ReadConfigInteger(reuse, "proxy.config.url_remap.reuse_plugin_instances");
   Debug("remap_plugin", "creating new plugin instance");
 
   TSReturnCode res = TS_ERROR;
-  res = pi->fp_tsremap_new_instance(parc, parv, &ih, tmpbuf, sizeof(tmpbuf) - 1);
+  res = pi->new_instance(parc, parv, &ih, tmpbuf, sizeof(tmpbuf) - 1, reuse != 0, &reused);
 
   Debug("remap_plugin", "done creating new plugin instance");
+  if (reused && url_rewrite_rsb) {
+    RecIncrGlobalRawStatCount(url_rewrite_rsb, url_rewrite_plugin_instances_reused_stat, 1);
+  }
 
   ats_free(parv[0]);               // fromURL
   ats_free(parv[1]);               // toURL
@@ -754,27 +762,55 @@ remap_load_plugin(const char ** argv, int argc, url_mapping *mp, char *errbuf, i
 
   return 0;
 }
-/** will process the regex mapping configuration and create objects in
-    output argument reg_map. It assumes existing data in reg_map is
-    inconsequential and will be perfunctorily null-ed;
+
+/** A regex rule that is in the table but not compiled yet. Compiling the
+    regexes is most of the work of loading a configuration with many regex
+    rules, and unlike the parse it does not depend on the lines before, so
+    it is left until the end and done on several threads.
 */
-static bool
-process_regex_mapping_config(const char *from_host_lower, url_mapping *new_mapping, UrlRewrite::RegexMapping *reg_map)
+struct remap_pending_regex
 {
-  const char *str;
-  int str_index;
-  const char *to_host;
-  int to_host_len;
-  int substitution_id;
-  int substitution_count = 0;
+  UrlRewrite::RegexMapping *reg_map;
+  char *from_host;              // lower case and NUL-terminated
+  char *path;
+  int line;
+  bool compiled;
+  remap_pending_regex *next;
+};
+
+// Rules per worker thread, at least.
+static const int REGEX_COMPILE_MIN_RULES = 256;
 
+/** will null the objects that process_regex_mapping_config() creates in
+    output argument reg_map; the existing data in reg_map is
+    inconsequential.
+*/
+static void
+init_regex_mapping(url_mapping *new_mapping, UrlRewrite::RegexMapping *reg_map)
+{
   reg_map->re = NULL;
   reg_map->re_extra = NULL;
+  reg_map->prefilter_id = -1;
   reg_map->to_url_host_template = NULL;
   reg_map->to_url_host_template_len = 0;
   reg_map->n_substitutions = 0;
 
   reg_map->url_map = new_mapping;
+}
+
+/** will process the regex mapping configuration and create objects in
+    output argument reg_map, which init_regex_mapping() has set up.
+*/
+static bool
+process_regex_mapping_config(const char *from_host_lower, UrlRewrite::RegexMapping *reg_map)
+{
+  const char *str;
+  int str_index;
+  const char *to_host;
+  int to_host_len;
+  int substitution_id;
+  int substitution_count = 0;
+  url_mapping *new_mapping = reg_map->url_map;
 
   // using from_host_lower (and not new_mapping->fromURL.host_get())
   // as this one will be NULL-terminated (required by pcre_compile)
@@ -784,7 +820,7 @@ process_regex_mapping_config(const char *from_host_lower, url_mapping *new_mappi
     goto lFail;
   }
 
-  reg_map->re_extra = pcre_study(reg_map->re, 0, &str);
+  reg_map->re_extra = pcre_study(reg_map->re, RE_STUDY_OPTIONS, &str);
   if ((reg_map->re_extra == NULL) && (str != NULL)) {
     Warning("pcre_study failed with message [%s]", str);
     goto lFail;
@@ -837,7 +873,7 @@ process_regex_mapping_config(const char *from_host_lower, url_mapping *new_mappi
     reg_map->re = NULL;
   }
   if (reg_map->re_extra) {
-    pcre_free(reg_map->re_extra);
+    regex_free_study(reg_map->re_extra);
     reg_map->re_extra = NULL;
   }
   if (reg_map->to_url_host_template) {
@@ -848,6 +884,105 @@ process_regex_mapping_config(const char *from_host_lower, url_mapping *new_mappi
   return false;
 }
 
+struct regex_compile_job
+{
+  remap_pending_regex **rules;
+  int count;
+  volatile int next;
+};
+
+static void *
+regex_compile_worker(void *data)
+{
+  regex_compile_job *job = static_cast<regex_compile_job *>(data);
+  int i;
+
+  // take the rules a few at a time, so that one slow regex does not hold up a whole share
+  while ((i = ink_atomic_increment(&job->next, 8)) < job->count) {
+    for (int end = MIN(i + 8, job->count); i < end; i++) {
+      remap_pending_regex *p = job->rules[i];
+
+      p->compiled = process_regex_mapping_config(p->from_host, p->reg_map);
+      if (p->compiled) {
+        Debug("url_rewrite_regex", "Configured regex rule for host [%s]", p->from_host);
+      }
+    }
+  }
+  return NULL;
+}
+
+static void
+free_pending_regexes(remap_pending_regex *list)
+{
+  while (list) {
+    remap_pending_regex *next = list->next;
+
+    ats_free(list->from_host);
+    ats_free(list->path);
+    delete list;
+    list = next;
+  }
+}
+
+// Compiles the regexes of all the regex rules, on as many threads as there
+// are processors for a big configuration. Any regex that does not compile
+// fails the whole configuration, like a parse error does.
+static bool
+remap_compile_regexes(remap_pending_regex *list)
+{
+  regex_compile_job job;
+  ink_thread threads[64];
+  int nthreads = 0;
+  int n = 0;
+  bool alarm_already = false;
+
+  for (remap_pending_regex *p = list; p; p = p->next) {
+    n++;
+  }
+  if (n == 0) {
+    return true;
+  }
+
+  job.rules = static_cast<remap_pending_regex **>(ats_malloc(n * sizeof(remap_pending_regex *)));
+  job.count = n;
+  job.next = 0;
+  // the list was built by pushing, so fill the array from the end to keep the file order
+  for (remap_pending_regex *p = list; p; p = p->next) {
+    job.rules[--n] = p;
+  }
+
+  int want = MIN(MIN(ink_number_of_processors(), (int) countof(threads) + 1), job.count / REGEX_COMPILE_MIN_RULES);
+  for (int i = 1; i < want; i++) {
+    if ((threads[nthreads] = ink_thread_create(regex_compile_worker, &job)) != 0) {
+      nthreads++;
+    }
+  }
+  ink_hrtime start = ink_get_hrtime_internal();
+  regex_compile_worker(&job);
+  for (int i = 0; i < nthreads; i++) {
+    ink_thread_join(threads[i]);
+  }
+  Debug("url_rewrite", "[%s] compiled %d regex rules on %d threads in %" PRId64 " ms", __func__, job.count,
+        nthreads + 1, (int64_t) ink_hrtime_to_msec(ink_get_hrtime_internal() - start));
+
+  bool ok = true;
+  for (int i = 0; i < job.count && ok; i++) {
+    remap_pending_regex *p = job.rules[i];
+
+    if (!p->compiled) {
+      char errBuf[1024];
+
+      Warning("Could not add rule at line #%d; Aborting!", p->line + 1);
+      snprintf(errBuf, sizeof(errBuf), "%s Could not process regex mapping config line at line %d of %s",
+               modulePrefix, p->line + 1, p->path);
+      SignalError(errBuf, alarm_already);
+      ok = false;
+    }
+  }
+  ats_free(job.rules);
+  return ok;
+}
+
 static bool
 remap_parse_config_bti(const char * path, BUILD_TABLE_INFO * bti)
 {
@@ -1157,12 +1292,9 @@ remap_parse_config_bti(const char * path, BUILD_TABLE_INFO * bti)
 
     reg_map = NULL;
     if (is_cur_mapping_regex) {
+      // the regex is compiled by remap_compile_regexes() after the parse
       reg_map = new UrlRewrite::RegexMapping();
-      if (!process_regex_mapping_config(fromHost_lower, new_mapping, reg_map)) {
-        errStr = "Could not process regex mapping config line";
-        goto MAP_ERROR;
-      }
-      Debug("url_rewrite_regex", "Configured regex rule for host [%s]", fromHost_lower);
+      init_regex_mapping(new_mapping, reg_map);
     }
 
     // If a TS receives a request on a port which is set to tunnel mode
@@ -1237,6 +1369,18 @@ remap_parse_config_bti(const char * path, BUILD_TABLE_INFO * bti)
       goto MAP_ERROR;
     }
 
+    if (reg_map) {
+      remap_pending_regex *pending = new remap_pending_regex;
+
+      pending->reg_map = reg_map;
+      pending->from_host = ats_strdup(fromHost_lower);
+      pending->path = ats_strdup(path);
+      pending->line = cln;
+      pending->compiled = false;
+      pending->next = bti->pending_regexes;
+      bti->pending_regexes = pending;
+    }
+
     fromHost_lower_ptr = (char *)ats_free_null(fromHost_lower_ptr);
 
     cur_line = tokLine(NULL, &tok_state, '\\');
@@ -1260,7 +1404,11 @@ bool
 remap_parse_config(const char * path, UrlRewrite * rewrite)
 {
     BUILD_TABLE_INFO bti;
+    bool success;
 
     bti.rewrite = rewrite;
-    return remap_parse_config_bti(path, &bti);
+    success = remap_parse_config_bti(path, &bti) && remap_compile_regexes(bti.pending_regexes);
+    // the rules themselves belong to the table now
+    free_pending_regexes(bti.pending_regexes);
+    return success;
 }
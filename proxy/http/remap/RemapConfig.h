@@ -27,6 +27,7 @@
 #include "AclFiltering.h"
 
 class UrlRewrite;
+struct remap_pending_regex;
 
 #define BUILD_TABLE_MAX_ARGS 2048
 
@@ -54,6 +55,7 @@ struct BUILD_TABLE_INFO
 
   acl_filter_rule *rules_list;  // all rules defined in config files as .define_filter foobar @src_ip=.....
   UrlRewrite *  rewrite;        // Pointer to the UrlRewrite object we are parsing for.
+  remap_pending_regex *pending_regexes; // regex rules to compile once all the files are parsed
 
   // Clear the argument vector.
   void reset();
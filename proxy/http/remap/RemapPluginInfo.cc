@@ -22,6 +22,7 @@
  */
 
 #include "RemapPluginInfo.h"
+#include "I_Layout.h"
 
 remap_plugin_info::remap_plugin_info(char *_path)
   :  next(0), path(NULL), path_size(0), dlh(NULL), fp_tsremap_init(NULL), fp_tsremap_done(NULL), fp_tsremap_new_instance(NULL),
@@ -31,15 +32,148 @@ remap_plugin_info::remap_plugin_info(char *_path)
   // coverity[ctor_dtor_leak]
   if (_path && likely((path = ats_strdup(_path)) > 0))
     path_size = strlen(path);
+  ink_mutex_init(&instances_mutex, "remap_plugin_info::instances");
 }
 
 remap_plugin_info::~remap_plugin_info()
 {
+  TSHashTable<IhHashing>::iterator spot = instances_by_ih.begin();
+
+  while (spot != instances_by_ih.end()) {
+    Instance *inst = &*spot;
+
+    ++spot;
+    ats_free(inst->key);
+    delete inst;
+  }
+  instances_by_ih.clear();
+  instances_by_key.clear();
+  ink_mutex_destroy(&instances_mutex);
   ats_free(path);
   if (dlh)
     dlclose(dlh);
 }
 
+// Appends the modification time and size of the file a parameter names,
+// either as a whole or after a '=', as given or relative to the
+// configuration directory. An edited configuration file of the plugin
+// then gets a new instance even though remap.config did not change.
+static int
+instance_file_stamp(const char *param, char *buf, int bufsize)
+{
+  const char *names[2] = { param, strchr(param, '=') };
+  char file[PATH_NAME_MAX];
+  struct stat st;
+
+  if (names[1])
+    names[1]++;
+  for (unsigned i = 0; i < countof(names); i++) {
+    if (!names[i] || !*names[i])
+      continue;
+    if (*names[i] == '/')
+      ink_strlcpy(file, names[i], sizeof(file));
+    else
+      Layout::relative_to(file, sizeof(file), Layout::get()->sysconfdir, names[i]);
+    if (stat(file, &st) == 0 && S_ISREG(st.st_mode))
+      return snprintf(buf, bufsize, "%d:%" PRId64 ".%" PRId64 ":%" PRId64, i, (int64_t) st.st_mtim.tv_sec,
+                      (int64_t) st.st_mtim.tv_nsec, (int64_t) st.st_size);
+  }
+  return 0;
+}
+
+TSReturnCode
+remap_plugin_info::new_instance(int argc, char *argv[], void **ih, char *errbuf, int errbuf_size, bool reuse,
+                                bool *reused)
+{
+  static const int STAMP_SIZE = 64;
+  int key_len = 0, key_size = 0;
+  char *key;
+  Instance *inst;
+  TSReturnCode res;
+
+  *reused = false;
+  if (!reuse)
+    return fp_tsremap_new_instance(argc, argv, ih, errbuf, errbuf_size);
+
+  for (int i = 0; i < argc; i++)
+    key_size += strlen(argv[i]) + 1 + STAMP_SIZE;
+  key = (char *)ats_malloc(key_size);
+  for (int i = 0; i < argc; i++) {
+    int len = strlen(argv[i]);
+
+    memcpy(key + key_len, argv[i], len + 1);
+    key_len += len + 1;
+    key_len += instance_file_stamp(argv[i], key + key_len, STAMP_SIZE);
+    key[key_len++] = '\0';
+  }
+
+  InstanceKey k = { key, key_len };
+
+  ink_mutex_acquire(&instances_mutex);
+  TSHashTable<KeyHashing>::Location spot = instances_by_key.find(k);
+
+  inst = spot.isValid() ? &*spot : NULL;
+  if (inst) {
+    inst->refcount++;
+    *ih = inst->ih;
+    *reused = true;
+  }
+  ink_mutex_release(&instances_mutex);
+
+  if (inst) {
+    Debug("remap_plugin", "reusing instance %p of %s", *ih, path);
+    ats_free(key);
+    return TS_SUCCESS;
+  }
+
+  // Only the remap.config reload makes instances, so no one else can
+  // make this one while we are not holding the lock.
+  res = fp_tsremap_new_instance(argc, argv, ih, errbuf, errbuf_size);
+  if (res != TS_SUCCESS) {
+    ats_free(key);
+    return res;
+  }
+
+  inst = new Instance;
+  inst->key = key;
+  inst->key_len = key_len;
+  inst->ih = *ih;
+  inst->refcount = 1;
+  ink_mutex_acquire(&instances_mutex);
+  instances_by_key.insert(inst);
+  instances_by_ih.insert(inst);
+  ink_mutex_release(&instances_mutex);
+  return TS_SUCCESS;
+}
+
+void
+remap_plugin_info::delete_instance(void *ih)
+{
+  Instance *inst;
+
+  ink_mutex_acquire(&instances_mutex);
+  TSHashTable<IhHashing>::Location spot = instances_by_ih.find(ih);
+
+  inst = spot.isValid() ? &*spot : NULL;
+  if (inst) {
+    if (--inst->refcount > 0) {
+      ink_mutex_release(&instances_mutex);
+      return;
+    }
+    instances_by_ih.remove(spot);
+    instances_by_key.remove(instances_by_key.find(inst));
+  }
+  ink_mutex_release(&instances_mutex);
+
+  if (inst) {
+    ats_free(inst->key);
+    delete inst;
+  }
+  // not shared (made without reuse), or the last rule using it
+  if (fp_tsremap_delete_instance)
+    fp_tsremap_delete_instance(ih);
+}
+
 
 //
 // Find a plugin by path from our linked list
@@ -24,6 +24,7 @@
 #if !defined (_REMAPPLUGININFO_h_)
 #define _REMAPPLUGININFO_h_
 #include "libts.h"
+#include "HashFNV.h"
 #include "api/ts/ts.h"
 #include "api/ts/remap.h"
 
@@ -66,6 +67,71 @@ public:
   remap_plugin_info *find_by_path(char *_path);
   void add_to_list(remap_plugin_info * pi);
   void delete_my_list();
+
+  // With reuse, an instance made earlier with the same parameters (and the
+  // same files behind them), for this or an older remap table, is handed
+  // out again instead of calling TSRemapNewInstance. *reused says which.
+  TSReturnCode new_instance(int argc, char *argv[], void **ih, char *errbuf, int errbuf_size, bool reuse,
+                            bool *reused);
+  // Calls TSRemapDeleteInstance once the last rule using ih is gone.
+  void delete_instance(void *ih);
+
+private:
+  struct Instance
+  {
+    char *key;
+    int key_len;
+    void *ih;
+    int refcount;
+
+    LINK(Instance, key_link);
+    LINK(Instance, ih_link);
+  };
+
+  struct InstanceKey
+  {
+    const char *data;
+    int len;
+  };
+
+  /// Interface class for the map of instances by parameters.
+  struct KeyHashing
+  {
+    typedef uint32_t ID;
+    typedef InstanceKey Key;
+    typedef Instance Value;
+    typedef DList(Instance, key_link) ListHead;
+
+    static ID hash(Key key) {
+      ATSHash32FNV1a h;
+
+      h.update(key.data, key.len);
+      h.final();
+      return h.get();
+    }
+    static Key key(Value const* value) {
+      InstanceKey k = { value->key, value->key_len };
+      return k;
+    }
+    static bool equal(Key lhs, Key rhs) { return lhs.len == rhs.len && memcmp(lhs.data, rhs.data, lhs.len) == 0; }
+  };
+
+  /// Interface class for the map of instances by handle.
+  struct IhHashing
+  {
+    typedef uint32_t ID;
+    typedef void *Key;
+    typedef Instance Value;
+    typedef DList(Instance, ih_link) ListHead;
+
+    static ID hash(Key key) { return (uint32_t) ((uintptr_t) key >> 4) ^ (uint32_t) ((uint64_t) (uintptr_t) key >> 32); }
+    static Key key(Value const* value) { return value->ih; }
+    static bool equal(Key lhs, Key rhs) { return lhs == rhs; }
+  };
+
+  TSHashTable<KeyHashing> instances_by_key;
+  TSHashTable<IhHashing> instances_by_ih;
+  ink_mutex instances_mutex;
 };
 
 
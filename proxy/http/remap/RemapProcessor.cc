@@ -54,16 +54,21 @@ RemapProcessor::setup_for_remap(HttpTransact::State *s)
   int request_host_len;
   int request_port;
   bool proxy_request = false;
+  UrlRewrite *table;
 
-  s->reverse_proxy = rewrite_table->reverse_proxy;
+  // The transaction keeps this table, whatever reloads happen meanwhile.
+  release_url_rewrite(s->url_rewrite_table);
+  s->url_rewrite_table = table = acquire_url_rewrite();
+
+  s->reverse_proxy = table->reverse_proxy;
   s->url_map.set(s->hdr_info.client_request.m_heap);
 
   ink_assert(redirect_url != NULL);
 
-  if (unlikely((rewrite_table->num_rules_forward == 0) &&
-               (rewrite_table->num_rules_forward_with_recv_port == 0))) {
-    ink_assert(rewrite_table->forward_mappings.empty() &&
-               rewrite_table->forward_mappings_with_recv_port.empty());
+  if (unlikely((table->num_rules_forward == 0) &&
+               (table->num_rules_forward_with_recv_port == 0))) {
+    ink_assert(table->forward_mappings.empty() &&
+               table->forward_mappings_with_recv_port.empty());
     Debug("url_rewrite", "[lookup] No forward mappings found; Skipping...");
     return false;
   }
@@ -88,30 +93,30 @@ RemapProcessor::setup_for_remap(HttpTransact::State *s)
 
   Debug("url_rewrite", "[lookup] attempting %s lookup", proxy_request ? "proxy" : "normal");
 
-  if (rewrite_table->num_rules_forward_with_recv_port) {
+  if (table->num_rules_forward_with_recv_port) {
     Debug("url_rewrite", "[lookup] forward mappings with recv port found; Using recv port %d",
           s->client_info.port);
-    if (rewrite_table->forwardMappingWithRecvPortLookup(request_url, s->client_info.port,
+    if (table->forwardMappingWithRecvPortLookup(request_url, s->client_info.port,
                                                          request_host, request_host_len, s->url_map)) {
       Debug("url_rewrite", "Found forward mapping with recv port");
       mapping_found = true;
-    } else if (rewrite_table->num_rules_forward == 0) {
-      ink_assert(rewrite_table->forward_mappings.empty());
+    } else if (table->num_rules_forward == 0) {
+      ink_assert(table->forward_mappings.empty());
       Debug("url_rewrite", "No forward mappings left");
       return false;
     }
   }
 
   if (!mapping_found) {
-    mapping_found = rewrite_table->forwardMappingLookup(request_url, request_port, request_host, request_host_len, s->url_map);
+    mapping_found = table->forwardMappingLookup(request_url, request_port, request_host, request_host_len, s->url_map);
   }
 
   // If no rules match and we have a host, check empty host rules since
   // they function as default rules for server requests.
   // If there's no host, we've already done this.
-  if (!mapping_found && rewrite_table->nohost_rules && request_host_len) {
+  if (!mapping_found && table->nohost_rules && request_host_len) {
     Debug("url_rewrite", "[lookup] nothing matched");
-    mapping_found = rewrite_table->forwardMappingLookup(request_url, 0, "", 0, s->url_map);
+    mapping_found = table->forwardMappingLookup(request_url, 0, "", 0, s->url_map);
   }
 
   if (!proxy_request) { // do extra checks on a server request
@@ -153,13 +158,14 @@ RemapProcessor::finish_remap(HttpTransact::State *s)
   int from_len;
   bool remap_found = false;
   referer_info *ri;
+  UrlRewrite *table = s->url_rewrite_table;
 
   map = s->url_map.getMapping();
   if (!map) {
     return false;
   }
   // Do fast ACL filtering (it is safe to check map here)
-  rewrite_table->PerformACLFiltering(s, map);
+  table->PerformACLFiltering(s, map);
 
   // Check referer filtering rules
   if ((s->filter_mask & URL_REMAP_FILTER_REFERER) != 0 && (ri = map->referer_list) != 0) {
@@ -221,12 +227,12 @@ RemapProcessor::finish_remap(HttpTransact::State *s)
           *redirect_url = ats_strdup(tmp_redirect_buf);
         }
       } else {
-        *redirect_url = ats_strdup(rewrite_table->http_default_redirect_url);
+        *redirect_url = ats_strdup(table->http_default_redirect_url);
       }
 
       if (*redirect_url == NULL) {
         *redirect_url = ats_strdup(map->filter_redirect_url ? map->filter_redirect_url :
-                                   rewrite_table->http_default_redirect_url);
+                                   table->http_default_redirect_url);
       }
 
       return false;
@@ -78,8 +78,8 @@ url_mapping::delete_instance(unsigned int index)
   void *ih = get_instance(index);
   remap_plugin_info* p = get_plugin(index);
 
-  if (ih && p && p->fp_tsremap_delete_instance) {
-    p->fp_tsremap_delete_instance(ih);
+  if (ih && p) {
+    p->delete_instance(ih);
   }
 }
 
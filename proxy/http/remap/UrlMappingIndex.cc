@@ -0,0 +1,141 @@
+/** @file
+
+    Index of the remap rules of a store that are not regular expressions.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#include "UrlMappingIndex.h"
+
+#define KEY_HEADER_LEN     5    // '\0', scheme and port after the host
+
+UrlMappingIndex::~UrlMappingIndex()
+{
+  url_mapping *mapping;
+
+  m_trie.Clear();
+  while ((mapping = m_mappings.pop()))
+    delete mapping;
+}
+
+int
+UrlMappingIndex::_SchemeIndex(URL *url, int port)
+{
+  int idx = url->scheme_get_wksidx();
+
+  // If the scheme is empty (e.g. because of a CONNECT method), guess it
+  // based on port
+  if (idx == -1) {
+    idx = (port == 80) ? URL_WKSIDX_HTTP : URL_WKSIDX_HTTPS;
+  }
+  return idx;
+}
+
+int
+UrlMappingIndex::_MakeKey(char *buf, const char *host, int host_len, int scheme, int port, const char *path,
+                          int path_len)
+{
+  memcpy(buf, host, host_len);
+  buf += host_len;
+  buf[0] = '\0';
+  buf[1] = (scheme >> 8) & 0xff;
+  buf[2] = scheme & 0xff;
+  buf[3] = (port >> 8) & 0xff;
+  buf[4] = port & 0xff;
+  if (path_len > 0) {
+    memcpy(buf + KEY_HEADER_LEN, path, path_len);
+  }
+  return host_len + KEY_HEADER_LEN + path_len;
+}
+
+bool
+UrlMappingIndex::Insert(url_mapping *mapping, const char *src_host)
+{
+  int port = mapping->fromURL.port_get();
+  int scheme = _SchemeIndex(&mapping->fromURL, port);
+  int host_len = src_host ? strlen(src_host) : 0;
+  int path_len;
+  const char *path = mapping->fromURL.path_get(&path_len);
+  char *key = static_cast<char *>(ats_malloc(host_len + KEY_HEADER_LEN + path_len));
+  int key_len = _MakeKey(key, src_host, host_len, scheme, port, path, path_len);
+  bool inserted = m_trie.Insert(key, key_len, mapping, mapping->getRank());
+
+  ats_free(key);
+  if (!inserted) {
+    Debug("url_rewrite", "Duplicate mapping for host [%s], scheme index %d, port %d, path [%.*s]",
+          src_host ? src_host : "", scheme, port, path_len, path);
+    return false;
+  }
+
+  m_mappings.enqueue(mapping);
+  if (key_len > m_max_key_len) {
+    m_max_key_len = key_len;
+  }
+  // the rules without a host are searched as if they had the scheme and
+  // port that sort first
+  if (host_len == 0 && (m_nohost_scheme < 0 || scheme < m_nohost_scheme ||
+                        (scheme == m_nohost_scheme && port < m_nohost_port))) {
+    m_nohost_scheme = scheme;
+    m_nohost_port = port;
+  }
+  return true;
+}
+
+url_mapping *
+UrlMappingIndex::Search(URL *request_url, int request_port, const char *request_host, int request_host_len) const
+{
+  char buf[1024];
+  char *key = buf;
+  int scheme, path_len;
+  const char *path = request_url->path_get(&path_len);
+  url_mapping *mapping;
+
+  if (request_host_len) {
+    scheme = _SchemeIndex(request_url, request_port);
+  } else if (m_nohost_scheme >= 0) {
+    scheme = m_nohost_scheme;
+    request_port = m_nohost_port;
+  } else {
+    return NULL;
+  }
+
+  // Bytes past the longest key can't change the result.
+  if (request_host_len + KEY_HEADER_LEN + path_len > m_max_key_len) {
+    path_len = m_max_key_len - request_host_len - KEY_HEADER_LEN;
+    if (path_len < 0) {
+      return NULL;
+    }
+  }
+  if (request_host_len + KEY_HEADER_LEN + path_len > (int) sizeof(buf)) {
+    key = static_cast<char *>(ats_malloc(request_host_len + KEY_HEADER_LEN + path_len));
+  }
+
+  mapping = m_trie.Search(key, _MakeKey(key, request_host, request_host_len, scheme, request_port, path, path_len));
+
+  if (key != buf) {
+    ats_free(key);
+  }
+  return mapping;
+}
+
+void
+UrlMappingIndex::Print()
+{
+  forl_LL(url_mapping, iter, m_mappings)
+    iter->Print();
+}
@@ -0,0 +1,82 @@
+/** @file
+
+    Index of the remap rules of a store that are not regular expressions.
+
+    @section license License
+
+    Licensed to the Apache Software Foundation (ASF) under one
+    or more contributor license agreements.  See the NOTICE file
+    distributed with this work for additional information
+    regarding copyright ownership.  The ASF licenses this file
+    to you under the Apache License, Version 2.0 (the
+    "License"); you may not use this file except in compliance
+    with the License.  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+#ifndef _URL_MAPPING_INDEX_H
+#define _URL_MAPPING_INDEX_H
+
+#include "libts.h"
+#include "RadixTrie.h"
+
+#include "URL.h"
+#include "UrlMapping.h"
+
+/**
+  All the rules are in one radix trie, keyed by
+
+    host '\0' scheme(2 bytes) port(2 bytes) path
+
+  so that a lookup matches the host, scheme and port exactly and the path by
+  prefix in a single walk: a host can't hold a NUL, and the scheme and port
+  have a fixed size, so no key of another host, scheme or port can be a
+  prefix of the request's key. Of the rules whose path is a prefix of the
+  request path, the first one in remap.config (the lowest rank) wins.
+
+  The index owns the mappings inserted into it.
+*/
+class UrlMappingIndex
+{
+public:
+  UrlMappingIndex()
+    : m_max_key_len(0), m_nohost_scheme(-1), m_nohost_port(0)
+  { }
+
+  ~UrlMappingIndex();
+
+  bool Insert(url_mapping *mapping, const char *src_host);
+
+  // request_host must be lowercase. For an empty host the rules without a
+  // host are searched whatever the scheme and port, as if the request had
+  // those of the first of them.
+  url_mapping *Search(URL *request_url, int request_port, const char *request_host, int request_host_len) const;
+
+  bool HasNoHostRules() const { return m_nohost_scheme >= 0; }
+  int Count() const { return m_trie.Count(); }
+  void Print();
+
+private:
+  RadixTrie<url_mapping> m_trie;
+  Queue<url_mapping> m_mappings;
+  int m_max_key_len;
+  int m_nohost_scheme;
+  int m_nohost_port;
+
+  static int _SchemeIndex(URL *url, int port);
+  static int _MakeKey(char *buf, const char *host, int host_len, int scheme, int port, const char *path,
+                      int path_len);
+
+  // make copy-constructor and assignment operator private
+  // till we properly implement them
+  UrlMappingIndex(const UrlMappingIndex &);
+  UrlMappingIndex &operator =(const UrlMappingIndex &);
+};
+
+#endif // _URL_MAPPING_INDEX_H
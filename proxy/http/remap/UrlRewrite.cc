@@ -24,12 +24,13 @@
 #include "UrlRewrite.h"
 #include "ProxyConfig.h"
 #include "ReverseProxy.h"
-#include "UrlMappingPathIndex.h"
 #include "RemapConfig.h"
 #include "I_Layout.h"
 
 #define modulePrefix "[ReverseProxy]"
 
+RecRawStatBlock *url_rewrite_rsb = NULL;
+
 /**
   Determines where we are in a situation where a virtual path is
   being mapped to a server home page. If it is, we set a special flag
@@ -59,9 +60,17 @@ UrlRewrite::UrlRewrite()
    num_rules_redirect_temporary(0), num_rules_forward_with_recv_port(0), _valid(false)
 {
 
-  forward_mappings.hash_lookup = reverse_mappings.hash_lookup =
-    permanent_redirects.hash_lookup = temporary_redirects.hash_lookup =
-    forward_mappings_with_recv_port.hash_lookup = NULL;
+  forward_mappings.index = reverse_mappings.index =
+    permanent_redirects.index = temporary_redirects.index =
+    forward_mappings_with_recv_port.index = NULL;
+
+  n_thread_refs = eventProcessor.n_ethreads + 1;
+  thread_refs = (ThreadRefs *) ats_memalign(sizeof(ThreadRefs), n_thread_refs * sizeof(ThreadRefs));
+  memset(thread_refs, 0, n_thread_refs * sizeof(ThreadRefs));
+
+  if (url_rewrite_rsb) {
+    RecIncrGlobalRawStatSum(url_rewrite_rsb, url_rewrite_tables_stat, 1);
+  }
 
   char * config_file = NULL;
   char * config_file_path = NULL;
@@ -99,6 +108,11 @@ UrlRewrite::UrlRewrite()
   config_file_path = Layout::relative_to(Layout::get()->sysconfdir, config_file);
 
   if (0 == this->BuildTable(config_file_path)) {
+    forward_mappings.regex_prefilter.compile();
+    reverse_mappings.regex_prefilter.compile();
+    permanent_redirects.regex_prefilter.compile();
+    temporary_redirects.regex_prefilter.compile();
+    forward_mappings_with_recv_port.regex_prefilter.compile();
     _valid = true;
     if (is_debug_tag_set("url_rewrite")) {
       Print();
@@ -121,7 +135,24 @@ UrlRewrite::~UrlRewrite()
   DestroyStore(permanent_redirects);
   DestroyStore(temporary_redirects);
   DestroyStore(forward_mappings_with_recv_port);
+  ats_memalign_free(thread_refs);
   _valid = false;
+
+  if (url_rewrite_rsb) {
+    RecIncrGlobalRawStatSum(url_rewrite_rsb, url_rewrite_tables_stat, -1);
+  }
+}
+
+/** The references taken minus the ones given back, on all the threads. */
+int64_t
+UrlRewrite::thread_refs_sum() const
+{
+  int64_t sum = 0;
+
+  for (int i = 0; i < n_thread_refs; i++) {
+    sum += thread_refs[i].count;
+  }
+  return sum;
 }
 
 /** Sets the reverse proxy flag. */
@@ -188,25 +219,6 @@ UrlRewrite::SetupBackdoorMapping()
   return mapping;
 }
 
-/** Deallocated a hash table and all the url_mappings in it. */
-void
-UrlRewrite::_destroyTable(InkHashTable *h_table)
-{
-  InkHashTableEntry *ht_entry;
-  InkHashTableIteratorState ht_iter;
-  UrlMappingPathIndex *item;
-
-  if (h_table != NULL) {        // Iterate over the hash tabel freeing up the all the url_mappings
-    //   contained with in
-    for (ht_entry = ink_hash_table_iterator_first(h_table, &ht_iter); ht_entry != NULL;) {
-      item = (UrlMappingPathIndex *)ink_hash_table_entry_value(h_table, ht_entry);
-      delete item;
-      ht_entry = ink_hash_table_iterator_next(h_table, &ht_iter);
-    }
-    ink_hash_table_destroy(h_table);
-  }
-}
-
 /** Debugging Method. */
 void
 UrlRewrite::Print()
@@ -239,16 +251,8 @@ UrlRewrite::Print()
 void
 UrlRewrite::PrintStore(MappingsStore &store)
 {
-  if (store.hash_lookup != NULL) {
-    InkHashTableEntry *ht_entry;
-    InkHashTableIteratorState ht_iter;
-    UrlMappingPathIndex *value;
-
-    for (ht_entry = ink_hash_table_iterator_first(store.hash_lookup, &ht_iter); ht_entry != NULL;) {
-      value = (UrlMappingPathIndex *) ink_hash_table_entry_value(store.hash_lookup, ht_entry);
-      value->Print();
-      ht_entry = ink_hash_table_iterator_next(store.hash_lookup, &ht_iter);
-    }
+  if (store.index != NULL) {
+    store.index->Print();
   }
 
   if (!store.regex_list.empty()) {
@@ -259,28 +263,6 @@ UrlRewrite::PrintStore(MappingsStore &store)
   }
 }
 
-/**
-  If a remapping is found, returns a pointer to it otherwise NULL is
-  returned.
-
-*/
-url_mapping *
-UrlRewrite::_tableLookup(InkHashTable *h_table, URL *request_url,
-                        int request_port, char *request_host, int request_host_len)
-{
-  UrlMappingPathIndex *ht_entry;
-  url_mapping *um = NULL;
-  int ht_result;
-
-  ht_result = ink_hash_table_lookup(h_table, request_host, (void **) &ht_entry);
-
-  if (likely(ht_result && ht_entry)) {
-    // for empty host don't do a normal search, get a mapping arbitrarily
-    um = ht_entry->Search(request_url, request_port, request_host_len ? true : false);
-  }
-  return um;
-}
-
 // This is only used for redirects and reverse rules, and the homepageredirect flag
 // can never be set. The end result is that request_url is modified per remap container.
 void
@@ -579,10 +561,11 @@ UrlRewrite::_addToStore(MappingsStore &store, url_mapping *new_mapping, RegexMap
 {
   bool retval;
   if (is_cur_mapping_regex) {
+    reg_map->prefilter_id = store.regex_prefilter.add(src_host);
     store.regex_list.enqueue(reg_map);
     retval = true;
   } else {
-    retval = TableInsert(store.hash_lookup, new_mapping, src_host);
+    retval = TableInsert(store.index, new_mapping, src_host);
   }
   if (retval) {
     ++count;
@@ -639,9 +622,9 @@ UrlRewrite::InsertForwardMapping(mapping_type maptype, url_mapping * mapping, co
   bool success;
 
   if (maptype == FORWARD_MAP_WITH_RECV_PORT) {
-    success = TableInsert(forward_mappings_with_recv_port.hash_lookup, mapping, src_host);
+    success = TableInsert(forward_mappings_with_recv_port.index, mapping, src_host);
   } else {
-    success = TableInsert(forward_mappings.hash_lookup, mapping, src_host);
+    success = TableInsert(forward_mappings.index, mapping, src_host);
   }
 
   if (success) {
@@ -686,11 +669,11 @@ UrlRewrite::BuildTable(const char * path)
   ink_assert(num_rules_forward_with_recv_port == 0);
 
 
-  forward_mappings.hash_lookup = ink_hash_table_create(InkHashTableKeyType_String);
-  reverse_mappings.hash_lookup = ink_hash_table_create(InkHashTableKeyType_String);
-  permanent_redirects.hash_lookup = ink_hash_table_create(InkHashTableKeyType_String);
-  temporary_redirects.hash_lookup = ink_hash_table_create(InkHashTableKeyType_String);
-  forward_mappings_with_recv_port.hash_lookup = ink_hash_table_create(InkHashTableKeyType_String);
+  forward_mappings.index = new UrlMappingIndex();
+  reverse_mappings.index = new UrlMappingIndex();
+  permanent_redirects.index = new UrlMappingIndex();
+  temporary_redirects.index = new UrlMappingIndex();
+  forward_mappings_with_recv_port.index = new UrlMappingIndex();
 
   if (!remap_parse_config(path, this)) {
     // XXX handle file reload error
@@ -702,7 +685,7 @@ UrlRewrite::BuildTable(const char * path)
   // since this is more specific
   if (unlikely(backdoor_enabled)) {
     new_mapping = SetupBackdoorMapping();
-    if (TableInsert(forward_mappings.hash_lookup, new_mapping, "")) {
+    if (TableInsert(forward_mappings.index, new_mapping, "")) {
       num_rules_forward++;
     } else {
       Warning("Could not insert backdoor mapping into store");
@@ -714,7 +697,7 @@ UrlRewrite::BuildTable(const char * path)
   //  if we need it
   if (default_to_pac) {
     new_mapping = SetupPacMapping();
-    if (TableInsert(forward_mappings.hash_lookup, new_mapping, "")) {
+    if (TableInsert(forward_mappings.index, new_mapping, "")) {
       num_rules_forward++;
     } else {
       Warning("Could not insert pac mapping into store");
@@ -724,70 +707,55 @@ UrlRewrite::BuildTable(const char * path)
   }
   // Destroy unused tables
   if (num_rules_forward == 0) {
-    forward_mappings.hash_lookup = ink_hash_table_destroy(forward_mappings.hash_lookup);
+    delete forward_mappings.index;
+    forward_mappings.index = NULL;
   } else {
-    if (ink_hash_table_isbound(forward_mappings.hash_lookup, "")) {
+    if (forward_mappings.index->HasNoHostRules()) {
       nohost_rules = 1;
     }
   }
 
   if (num_rules_reverse == 0) {
-    reverse_mappings.hash_lookup = ink_hash_table_destroy(reverse_mappings.hash_lookup);
+    delete reverse_mappings.index;
+    reverse_mappings.index = NULL;
   }
 
   if (num_rules_redirect_permanent == 0) {
-    permanent_redirects.hash_lookup = ink_hash_table_destroy(permanent_redirects.hash_lookup);
+    delete permanent_redirects.index;
+    permanent_redirects.index = NULL;
   }
 
   if (num_rules_redirect_temporary == 0) {
-    temporary_redirects.hash_lookup = ink_hash_table_destroy(temporary_redirects.hash_lookup);
+    delete temporary_redirects.index;
+    temporary_redirects.index = NULL;
   }
 
   if (num_rules_forward_with_recv_port == 0) {
-    forward_mappings_with_recv_port.hash_lookup = ink_hash_table_destroy(
-      forward_mappings_with_recv_port.hash_lookup);
+    delete forward_mappings_with_recv_port.index;
+    forward_mappings_with_recv_port.index = NULL;
   }
 
   return 0;
 }
 
 /**
-  Inserts arg mapping in h_table with key src_host chaining the mapping
-  of existing entries bound to src_host if necessary.
+  Inserts arg mapping in index with key src_host. Fails if there is
+  already a mapping for the same host, scheme, port and path.
 
 */
 bool
-UrlRewrite::TableInsert(InkHashTable *h_table, url_mapping *mapping, const char *src_host)
+UrlRewrite::TableInsert(UrlMappingIndex *index, url_mapping *mapping, const char *src_host)
 {
-  char src_host_tmp_buf[1];
-  UrlMappingPathIndex *ht_contents;
-
-  if (!src_host) {
-    src_host = &src_host_tmp_buf[0];
-    src_host_tmp_buf[0] = 0;
-  }
-  // Insert the new_mapping into hash table
-  if (ink_hash_table_lookup(h_table, src_host, (void**) &ht_contents)) {
-    // There is already a path index for this host
-    if (ht_contents == NULL) {
-      // why should this happen?
-      Warning("Found entry cannot be null!");
-      return false;
-    }
-  } else {
-    ht_contents = new UrlMappingPathIndex();
-    ink_hash_table_insert(h_table, src_host, ht_contents);
-  }
-  if (!ht_contents->Insert(mapping)) {
+  if (!index->Insert(mapping, src_host)) {
     Warning("Could not insert new mapping");
     return false;
   }
   return true;
 }
 
-/**  First looks up the hash table for "simple" mappings and then the
+/**  First looks up the index for "simple" mappings and then the
      regex mappings.  Only higher-ranked regex mappings are examined if
-     a hash mapping is found; or else all regex mappings are examined
+     a simple mapping is found; or else all regex mappings are examined
 
      Returns highest-ranked mapping on success, NULL on failure
 */
@@ -812,15 +780,18 @@ UrlRewrite::_mappingLookup(MappingsStore &mappings, URL *request_url,
 
   bool retval = false;
   int rank_ceiling = -1;
-  url_mapping *mapping = _tableLookup(mappings.hash_lookup, request_url, request_port, request_host_lower,
-                                      request_host_len);
+  url_mapping *mapping = NULL;
+
+  if (mappings.index != NULL) {
+    mapping = mappings.index->Search(request_url, request_port, request_host_lower, request_host_len);
+  }
   if (mapping != NULL) {
     rank_ceiling = mapping->getRank();
     Debug("url_rewrite", "Found 'simple' mapping with rank %d", rank_ceiling);
     mapping_container.set(mapping);
     retval = true;
   }
-  if (_regexMappingLookup(mappings.regex_list, request_url, request_port, request_host_lower, request_host_len,
+  if (_regexMappingLookup(mappings, request_url, request_port, request_host_lower, request_host_len,
                           rank_ceiling, mapping_container)) {
     Debug("url_rewrite", "Using regex mapping with rank %d", (mapping_container.getMapping())->getRank());
     retval = true;
@@ -878,7 +849,7 @@ UrlRewrite::_expandSubstitutions(int *matches_info, const RegexMapping *reg_map,
 }
 
 bool
-UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_url, int request_port,
+UrlRewrite::_regexMappingLookup(MappingsStore &mappings, URL *request_url, int request_port,
                                 const char *request_host, int request_host_len, int rank_ceiling,
                                 UrlMappingContainer &mapping_container)
 {
@@ -898,14 +869,22 @@ UrlRewrite::_regexMappingLookup(RegexMappingList &regex_mappings, URL *request_u
   int request_path_len, reg_map_path_len;
   const char *request_path = request_url->path_get(&request_path_len), *reg_map_path;
 
+  // One pass over the host finds the regexes that can match it at all
+  RegexPrefilter::Matches candidates;
+  mappings.regex_prefilter.scan(request_host, request_host_len, candidates);
+
   // Loop over the entire linked list, or until we're satisfied
-  forl_LL(RegexMapping, list_iter, regex_mappings) {
+  forl_LL(RegexMapping, list_iter, mappings.regex_list) {
     int reg_map_rank = list_iter->url_map->getRank();
 
     if (reg_map_rank > rank_ceiling) {
       break;
     }
 
+    if (!candidates.test(list_iter->prefilter_id)) {
+      continue;
+    }
+
     reg_map_scheme = list_iter->url_map->fromURL.scheme_get(&reg_map_scheme_len);
     if ((request_scheme_len != reg_map_scheme_len) ||
         strncmp(request_scheme, reg_map_scheme, request_scheme_len)) {
@@ -973,7 +952,7 @@ UrlRewrite::_destroyList(RegexMappingList &mappings)
       pcre_free(list_iter->re);
     }
     if (list_iter->re_extra) {
-      pcre_free(list_iter->re_extra);
+      regex_free_study(list_iter->re_extra);
     }
     if (list_iter->to_url_host_template) {
       ats_free(list_iter->to_url_host_template);
@@ -25,7 +25,9 @@
 #define _URL_REWRITE_H_
 
 #include "UrlMapping.h"
+#include "UrlMappingIndex.h"
 #include "HttpTransact.h"
+#include "Regex.h"
 
 #ifdef HAVE_PCRE_PCRE_H
 #include <pcre/pcre.h>
@@ -46,8 +48,23 @@ enum mapping_type
 { FORWARD_MAP, REVERSE_MAP, PERMANENT_REDIRECT, TEMPORARY_REDIRECT, FORWARD_MAP_REFERER,
   FORWARD_MAP_WITH_RECV_PORT, NONE };
 
+enum UrlRewrite_Stats
+{
+  url_rewrite_reloads_stat,
+  url_rewrite_reload_failures_stat,
+  url_rewrite_last_reload_msec_stat,
+  url_rewrite_last_reload_peak_rss_stat,
+  url_rewrite_last_reload_rss_growth_stat,
+  url_rewrite_tables_stat,
+  url_rewrite_plugin_instances_reused_stat,
+  url_rewrite_stat_count
+};
+
+extern RecRawStatBlock *url_rewrite_rsb;
+
 /**
- *
+ * A generation of the remap table. See acquire_url_rewrite() for how it
+ * is shared between reloads and transactions.
 **/
 class UrlRewrite
 {
@@ -63,6 +80,26 @@ public:
   bool is_valid() const { return _valid; };
 //  private:
 
+  // The references of the transactions, see acquire_url_rewrite(). Each
+  // regular event thread counts the ones it takes and gives back in its own
+  // slot, on a cache line of its own; the last slot is shared by all other
+  // threads. A slot can go negative when a reference is given back on
+  // another thread than the one that took it, only their sum means anything.
+  struct ThreadRefs
+  {
+    volatile int64_t count;
+    char pad[64 - sizeof(int64_t)];
+  };
+
+  ThreadRefs *thread_refs;
+  int n_thread_refs;
+
+  int thread_refs_slot(EThread *t) const
+  {
+    return (t && t->tt == REGULAR && t->id >= 0 && t->id < n_thread_refs - 1) ? t->id : n_thread_refs - 1;
+  }
+  int64_t thread_refs_sum() const;
+
   static const int MAX_REGEX_SUBS = 10;
 
   struct RegexMapping
@@ -70,6 +107,7 @@ public:
     url_mapping *url_map;
     pcre *re;
     pcre_extra *re_extra;
+    int prefilter_id;           // id in the regex_prefilter of the store
 
     // we store the host-string-to-substitute here; if a match is found,
     // the substitutions are made and the resulting url is stored
@@ -93,9 +131,10 @@ public:
 
   struct MappingsStore
   {
-    InkHashTable *hash_lookup;
+    UrlMappingIndex *index;
     RegexMappingList regex_list;
-    bool empty() { return ((hash_lookup == NULL) && regex_list.empty()); }
+    RegexPrefilter regex_prefilter;     // which regex_list entries can match a host
+    bool empty() { return ((index == NULL) && regex_list.empty()); }
   };
 
   void PerformACLFiltering(HttpTransact::State * s, url_mapping * mapping);
@@ -105,7 +144,8 @@ public:
 
   void DestroyStore(MappingsStore &store)
   {
-    _destroyTable(store.hash_lookup);
+    delete store.index;
+    store.index = NULL;
     _destroyList(store.regex_list);
   }
 
@@ -113,7 +153,7 @@ public:
   bool InsertMapping(mapping_type maptype, url_mapping *new_mapping, RegexMapping *reg_map,
                         const char * src_host, bool is_cur_mapping_regex);
 
-  bool TableInsert(InkHashTable *h_table, url_mapping *mapping, const char *src_host);
+  bool TableInsert(UrlMappingIndex *index, url_mapping *mapping, const char *src_host);
 
   MappingsStore forward_mappings;
   MappingsStore reverse_mappings;
@@ -175,14 +215,11 @@ private:
 
   bool _mappingLookup(MappingsStore &mappings, URL *request_url, int request_port, const char *request_host,
                       int request_host_len, UrlMappingContainer &mapping_container);
-  url_mapping *_tableLookup(InkHashTable * h_table, URL * request_url, int request_port, char *request_host,
-                            int request_host_len);
-  bool _regexMappingLookup(RegexMappingList &regex_mappings, URL * request_url, int request_port, const char *request_host,
+  bool _regexMappingLookup(MappingsStore &mappings, URL * request_url, int request_port, const char *request_host,
                            int request_host_len, int rank_ceiling,
                            UrlMappingContainer &mapping_container);
   int _expandSubstitutions(int *matches_info, const RegexMapping *reg_map, const char *matched_string, char *dest_buf,
                            int dest_buf_size);
-  void _destroyTable(InkHashTable *h_table);
   void _destroyList(RegexMappingList &regexes);
   inline bool _addToStore(MappingsStore &store, url_mapping *new_mapping, RegexMapping *reg_map, const char *src_host,
                           bool is_cur_mapping_regex, int &count);
@@ -41,6 +41,7 @@
 #include "LogObject.h"
 #include "LogConfig.h"
 #include "LogBuffer.h"
+#include "LogColumnar.h"
 #include "LogUtils.h"
 #include "LogSock.h"
 #include "LogPredefined.h"
@@ -54,6 +55,8 @@ static int follow_flag = 0;
 static int clf_flag = 0;
 static int elf_flag = 0;
 static int elf2_flag = 0;
+static int columnar_flag = 0;
+static int bench_flag = 0;
 static int auto_filenames = 0;
 static int overwrite_existing_file = 0;
 static char output_file[1024];
@@ -74,113 +77,321 @@ static const ArgumentDescription argument_descriptions[] = {
   {"overwrite_output", 'w', "Overwrite existing output file(s)", "T",
    &overwrite_existing_file, NULL, NULL},
   {"elf2", '2', "Convert to Extended2 Logging Format", "T", &elf2_flag, NULL,
-   NULL}
+   NULL},
+  {"columnar", 'c', "Convert to the columnar binary format", "T", &columnar_flag, NULL, NULL},
+  {"bench", 'b', "Compare converting to ASCII and to the columnar format", "T", &bench_flag, NULL, NULL}
 };
 
 static const char *USAGE_LINE = "Usage: " PROGRAM_NAME " [-o output-file | -a] [-CEhS"
 #ifdef DEBUG
   "T"
 #endif
-  "Vw2] [input-file ...]";
+  "Vw2cb] [input-file ...]";
 
 
 
+// Read exactly len bytes, waiting for more when following the file.
+static int
+read_fully(int in_fd, char *buf, int len)
+{
+  int nread = 0;
+
+  while (nread < len) {
+    int rc = read(in_fd, buf + nread, len - nread);
+
+    if (rc < 0 || (rc == 0 && !follow_flag))
+      return -1;
+    if (rc == 0)
+      usleep(10000);
+    nread += rc;
+  }
+  return nread;
+}
+
+static LogColumnar columnar;
+
+// Read the rest of a columnar block, whose first bytes are in buffer, and
+// decode it. The result is to be released with ats_free().
+static LogBufferHeader *
+read_columnar_block(int in_fd, char *buffer, unsigned first_read_size)
+{
+  LogColumnarHeader *block = (LogColumnarHeader *) buffer;
+
+  if (read_fully(in_fd, &buffer[first_read_size], sizeof(LogColumnarHeader) - first_read_size) < 0) {
+    fprintf(stderr, "Bad columnar block header read!\n");
+    return NULL;
+  }
+  if (!LogColumnar::valid_header(block)) {
+    fprintf(stderr, "Bad columnar block!\n");
+    return NULL;
+  }
+
+  LogColumnarHeader *whole = (LogColumnarHeader *) ats_malloc(sizeof(LogColumnarHeader) + block->body_len);
+  LogBufferHeader *header = NULL;
+
+  memcpy(whole, block, sizeof(LogColumnarHeader));
+  if (read_fully(in_fd, (char *) (whole + 1), block->body_len) < 0) {
+    fprintf(stderr, "Bad columnar block read!\n");
+  } else if ((header = columnar.decode(whole)) == NULL) {
+    fprintf(stderr, "Corrupt columnar block!\n");
+  }
+  ats_free(whole);
+  return header;
+}
+
+/*-------------------------------------------------------------------------
+  read_buffer
+
+  Read the next LogBuffer of a binary or of a columnar log file. Returns
+  1 at the end of the file, -1 on errors, and 0 with the buffer in
+  *pheader, which is either buffer or to be released with ats_free().
+  -------------------------------------------------------------------------*/
+
+static int
+read_buffer(int in_fd, char *buffer, LogBufferHeader **pheader)
+{
+  int nread, buffer_bytes;
+
+  // read the next buffer from file descriptor
+  //
+  Debug("logcat", "Reading buffer ...");
+  memset(buffer, 0, MAX_LOGBUFFER_SIZE);
+
+  // read the first 8 bytes of the header, which will give us the
+  // cookie and the version number.
+  //
+  unsigned first_read_size = sizeof(uint32_t) + sizeof(uint32_t);
+  unsigned header_size = sizeof(LogBufferHeader);
+  LogBufferHeader *header = (LogBufferHeader *) & buffer[0];
+
+  nread = read(in_fd, buffer, first_read_size);
+  if (!nread || nread == EOF)
+    return 1;
+
+  // a columnar block decodes to a LogBuffer
+  //
+  if (header->cookie == LOG_COLUMNAR_COOKIE) {
+    *pheader = read_columnar_block(in_fd, buffer, first_read_size);
+    return *pheader ? 0 : -1;
+  }
+
+  // ensure that this is a valid logbuffer header
+  //
+  if (header->cookie != LOG_SEGMENT_COOKIE) {
+    fprintf(stderr, "Bad LogBuffer!\n");
+    return -1;
+  }
+  // read the rest of the header
+  //
+  unsigned second_read_size = header_size - first_read_size;
+
+  nread = read(in_fd, &buffer[first_read_size], second_read_size);
+  if (!nread || nread == EOF) {
+    if (follow_flag)
+      return 1;
+
+    fprintf(stderr, "Bad LogBufferHeader read!\n");
+    return -1;
+  }
+  // read the rest of the buffer
+  //
+  uint32_t byte_count = header->byte_count;
+
+  if (byte_count > MAX_LOGBUFFER_SIZE) {
+    fprintf(stderr, "Buffer too large!\n");
+    return -1;
+  }
+  buffer_bytes = byte_count - header_size;
+  if (buffer_bytes == 0)
+    return 1;
+  if (buffer_bytes < 0) {
+    fprintf(stderr, "No buffer body!\n");
+    return -1;
+  }
+  // Read the next full buffer (allowing for "partial" reads)
+  nread = 0;
+  while (nread < buffer_bytes) {
+    int rc = read(in_fd, &buffer[header_size] + nread, buffer_bytes - nread);
+
+    if ((rc == EOF) && (!follow_flag)) {
+      fprintf(stderr, "Bad LogBuffer read!\n");
+      return -1;
+    }
+
+    if (rc > 0)
+      nread += rc;
+  }
+
+  if (nread > buffer_bytes) {
+    fprintf(stderr, "Read too many bytes!\n");
+    return -1;
+  }
+
+  *pheader = header;
+  return 0;
+}
+
+static const char *
+alternate_format()
+{
+  // see if there is an alternate format request from the command
+  // line
+  //
+  const char * alt_format = NULL;
+  if (squid_flag)
+    alt_format = PreDefinedFormatInfo::squid;
+  if (clf_flag)
+    alt_format = PreDefinedFormatInfo::common;
+  if (elf_flag)
+    alt_format = PreDefinedFormatInfo::extended;
+  if (elf2_flag)
+    alt_format = PreDefinedFormatInfo::extended2;
+  return alt_format;
+}
+
 static int
 process_file(int in_fd, int out_fd)
 {
   char buffer[MAX_LOGBUFFER_SIZE];
-  int nread, buffer_bytes;
+  const char *alt_format = alternate_format();
   unsigned bytes = 0;
 
   while (true) {
-    // read the next buffer from file descriptor
-    //
-    Debug("logcat", "Reading buffer ...");
-    memset(buffer, 0, sizeof(buffer));
+    LogBufferHeader *header = NULL;
+    int rc = read_buffer(in_fd, buffer, &header);
 
-    // read the first 8 bytes of the header, which will give us the
-    // cookie and the version number.
-    //
-    unsigned first_read_size = sizeof(uint32_t) + sizeof(uint32_t);
-    unsigned header_size = sizeof(LogBufferHeader);
-    LogBufferHeader *header = (LogBufferHeader *) & buffer[0];
+    if (rc)
+      return rc < 0 ? 1 : 0;
 
-    nread = read(in_fd, buffer, first_read_size);
-    if (!nread || nread == EOF)
-      return 0;
+    if (columnar_flag) {
+      // re-encode the buffer, as the traffic server would have
+      //
+      int len = 0;
+      LogColumnarHeader *block = columnar.encode(header, Log::config->columnar_compression_level, &len);
 
-    // ensure that this is a valid logbuffer header
-    //
-    if (header->cookie != LOG_SEGMENT_COOKIE) {
-      fprintf(stderr, "Bad LogBuffer!\n");
-      return 1;
+      if (block == NULL) {
+        fprintf(stderr, "Can't encode LogBuffer!\n");
+      } else {
+        if (write(out_fd, block, len) != len) {
+          fprintf(stderr, "Error writing columnar block: %s\n", strerror(errno));
+          rc = 1;
+        }
+        ats_free(block);
+      }
+    } else if (header->fmt_fieldlist()) {
+      // convert the buffer to ascii entries and place onto stdout
+      //
+      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format);
+    } else {
+      // TODO investigate why this buffer goes wonky
     }
-    // read the rest of the header
-    //
-    unsigned second_read_size = header_size - first_read_size;
 
-    nread = read(in_fd, &buffer[first_read_size], second_read_size);
-    if (!nread || nread == EOF) {
-      if (follow_flag)
-        return 0;
+    if (header != (LogBufferHeader *) buffer)
+      ats_free(header);
+    if (rc)
+      return rc;
+  }
+}
+
+/*-------------------------------------------------------------------------
+  bench_file
 
-      fprintf(stderr, "Bad LogBufferHeader read!\n");
-      return 1;
-    }
-    // read the rest of the buffer
-    //
-    uint32_t byte_count = header->byte_count;
+  Load the buffers of a log file, then time converting them to ASCII
+  (what the traffic server does for an ascii log) and encoding them as
+  columnar blocks at a few compression levels, and compare the rates and
+  the sizes of the results.
+  -------------------------------------------------------------------------*/
 
-    if (byte_count > sizeof(buffer)) {
-      fprintf(stderr, "Buffer too large!\n");
-      return 1;
+static int
+bench_file(int in_fd, const char *name)
+{
+  char buffer[MAX_LOGBUFFER_SIZE];
+  const char *alt_format = alternate_format();
+  DynArray<LogBufferHeader *> buffers(NULL, 0);
+  int nbuffers = 0;
+  int64_t entries = 0, binary_bytes = 0;
+  int rc;
+
+  while (true) {
+    LogBufferHeader *header = NULL;
+
+    if ((rc = read_buffer(in_fd, buffer, &header)) != 0)
+      break;
+    if (header == (LogBufferHeader *) buffer) {
+      header = (LogBufferHeader *) ats_malloc(header->byte_count);
+      memcpy(header, buffer, ((LogBufferHeader *) buffer)->byte_count);
     }
-    buffer_bytes = byte_count - header_size;
-    if (buffer_bytes == 0)
-      return 0;
-    if (buffer_bytes < 0) {
-      fprintf(stderr, "No buffer body!\n");
-      return 1;
+    if (header->fmt_fieldlist()) {
+      buffers(nbuffers++) = header;
+      entries += header->entry_count;
+      binary_bytes += header->byte_count;
+    } else {
+      ats_free(header);
     }
-    // Read the next full buffer (allowing for "partial" reads)
-    nread = 0;
-    while (nread < buffer_bytes) {
-      int rc = read(in_fd, &buffer[header_size] + nread, buffer_bytes - nread);
-
-      if ((rc == EOF) && (!follow_flag)) {
-        fprintf(stderr, "Bad LogBuffer read!\n");
-        return 1;
-      }
+  }
+  if (rc < 0 || entries == 0) {
+    fprintf(stderr, "%s: no usable LogBuffer\n", name);
+    for (int i = 0; i < nbuffers; i++)
+      ats_free(buffers[i]);
+    return rc < 0;
+  }
+
+  printf("%s: %d buffers, %" PRId64 " entries, %" PRId64 " bytes in binary\n", name, nbuffers, entries, binary_bytes);
 
-      if (rc > 0)
-        nread += rc;
+  // ascii
+  //
+  char line[LOG_MAX_FORMATTED_LINE];
+  int64_t ascii_bytes = 0;
+  ink_hrtime start = ink_get_hrtime_internal();
+
+  for (int i = 0; i < nbuffers; i++) {
+    LogBufferHeader *header = buffers[i];
+    LogBufferIterator iter(header);
+    LogEntryHeader *entry;
+
+    while ((entry = iter.next())) {
+      int len = LogBuffer::to_ascii(entry, (LogFormatType) header->format_type, line, sizeof(line),
+                                    header->fmt_fieldlist(), header->fmt_printf(), header->version, alt_format);
+      if (len > 0)
+        ascii_bytes += len + 1;
     }
+  }
 
-    if (nread > buffer_bytes) {
-      fprintf(stderr, "Read too many bytes!\n");
-      return 1;
+  ink_hrtime elapsed = ink_get_hrtime_internal() - start;
+
+  printf("  %-12s %12.0f entries/sec %12" PRId64 " bytes\n", "ascii", (double) entries * HRTIME_SECOND / (elapsed ? elapsed : 1),
+         ascii_bytes);
+
+  // columnar
+  //
+  static const int levels[] = { 0, 1, 6 };
+
+  for (unsigned l = 0; l < countof(levels); l++) {
+    int64_t columnar_bytes = 0;
+
+    start = ink_get_hrtime_internal();
+    for (int i = 0; i < nbuffers; i++) {
+      int len = 0;
+      LogColumnarHeader *block = columnar.encode(buffers[i], levels[l], &len);
+
+      columnar_bytes += len;
+      ats_free(block);
     }
-    // see if there is an alternate format request from the command
-    // line
-    //
-    const char * alt_format = NULL;
-    if (squid_flag)
-      alt_format = PreDefinedFormatInfo::squid;
-    if (clf_flag)
-      alt_format = PreDefinedFormatInfo::common;
-    if (elf_flag)
-      alt_format = PreDefinedFormatInfo::extended;
-    if (elf2_flag)
-      alt_format = PreDefinedFormatInfo::extended2;
-
-    // convert the buffer to ascii entries and place onto stdout
-    //
-    if (header->fmt_fieldlist()) {
-      bytes += LogFile::write_ascii_logbuffer(header, out_fd, ".", alt_format);
-    } else {
-      // TODO investigate why this buffer goes wonky
+    elapsed = ink_get_hrtime_internal() - start;
+
+    char label[32];
+    snprintf(label, sizeof(label), "columnar/%d", levels[l]);
+    printf("  %-12s %12.0f entries/sec %12" PRId64 " bytes", label,
+           (double) entries * HRTIME_SECOND / (elapsed ? elapsed : 1), columnar_bytes);
+    if (ascii_bytes > 0) {
+      printf(" (%.1f%% of ascii)", 100.0 * columnar_bytes / ascii_bytes);
     }
+    printf("\n");
   }
+
+  for (int i = 0; i < nbuffers; i++)
+    ats_free(buffers[i]);
+  return 0;
 }
 
 static int
@@ -282,8 +493,9 @@ main(int /* argc ATS_UNUSED */, char *argv[])
   int error = NO_ERROR;
 
   if (n_file_arguments) {
-    int bin_ext_len = strlen(LOG_FILE_BINARY_OBJECT_FILENAME_EXTENSION);
-    int ascii_ext_len = strlen(LOG_FILE_ASCII_OBJECT_FILENAME_EXTENSION);
+    const char *out_ext = columnar_flag ? LOG_FILE_COLUMNAR_OBJECT_FILENAME_EXTENSION :
+      LOG_FILE_ASCII_OBJECT_FILENAME_EXTENSION;
+    int out_ext_len = strlen(out_ext);
 
     for (unsigned i = 0; i < n_file_arguments; ++i) {
       int in_fd = open(file_arguments[i], O_RDONLY);
@@ -295,19 +507,32 @@ main(int /* argc ATS_UNUSED */, char *argv[])
 #if HAVE_POSIX_FADVISE
         posix_fadvise(in_fd, 0, 0, POSIX_FADV_DONTNEED);
 #endif
+        if (bench_flag) {
+          if (bench_file(in_fd, file_arguments[i]) != 0)
+            error = DATA_PROCESSING_ERROR;
+          close(in_fd);
+          continue;
+        }
         if (auto_filenames) {
-          // change .blog to .log
+          // change .blog (or .clog) to .log (or .clog)
           //
           int n = strlen(file_arguments[i]);
-          int copy_len = (n >= bin_ext_len ? (strcmp(&file_arguments[i][n - bin_ext_len],
-                                                     LOG_FILE_BINARY_OBJECT_FILENAME_EXTENSION) ==
-                                              0 ? n - bin_ext_len : n) : n);
+          int copy_len = n;
+          static const char *in_exts[] = { LOG_FILE_BINARY_OBJECT_FILENAME_EXTENSION,
+                                           LOG_FILE_COLUMNAR_OBJECT_FILENAME_EXTENSION };
+
+          for (unsigned e = 0; e < countof(in_exts); e++) {
+            int ext_len = strlen(in_exts[e]);
+
+            if (n >= ext_len && strcmp(&file_arguments[i][n - ext_len], in_exts[e]) == 0)
+              copy_len = n - ext_len;
+          }
 
-          char *out_filename = (char *)ats_malloc(copy_len + ascii_ext_len + 1);
+          char *out_filename = (char *)ats_malloc(copy_len + out_ext_len + 1);
 
           memcpy(out_filename, file_arguments[i], copy_len);
-          memcpy(&out_filename[copy_len], LOG_FILE_ASCII_OBJECT_FILENAME_EXTENSION, ascii_ext_len);
-          out_filename[copy_len + ascii_ext_len] = 0;
+          memcpy(&out_filename[copy_len], out_ext, out_ext_len);
+          out_filename[copy_len + out_ext_len] = 0;
 
           out_fd = open_output_file(out_filename);
           ats_free(out_filename);
@@ -58,6 +58,7 @@
 #include "ink_apidefs.h"
 
 #define PERIODIC_TASKS_INTERVAL 5 // TODO: Maybe this should be done as a config option
+#define FLUSH_MAX_IOVECS 64        // flush data written by one writev()
 
 // Log global objects
 inkcoreapi LogObject *Log::error_log = NULL;
@@ -1220,10 +1221,52 @@ Log::preproc_thread_main(void *args)
   return NULL;
 }
 
+/*-------------------------------------------------------------------------
+  LogFlushData
+  -------------------------------------------------------------------------*/
+
+LogFlushData::LogFlushData(LogFile *logfile, void *data, int len)
+  : m_logfile(logfile), m_data(data), m_len(len), m_queued_at(ink_get_hrtime_internal())
+{
+  RecIncrGlobalRawStatSum(log_rsb, log_stat_flush_backlog_stat, 1);
+  RecIncrGlobalRawStatSum(log_rsb, log_stat_flush_backlog_bytes_stat, size());
+}
+
+LogFlushData::~LogFlushData()
+{
+  RecIncrGlobalRawStatSum(log_rsb, log_stat_flush_backlog_stat, -1);
+  RecIncrGlobalRawStatSum(log_rsb, log_stat_flush_backlog_bytes_stat, -size());
+
+  switch (m_logfile->m_file_format) {
+  case LOG_FILE_BINARY:
+    logbuffer = (LogBuffer *)m_data;
+    LogBuffer::destroy(logbuffer);
+    break;
+  case LOG_FILE_ASCII:
+  case LOG_FILE_PIPE:
+    free(m_data);
+    break;
+  case LOG_FILE_COLUMNAR:
+    ats_free(m_data);
+    break;
+  case N_LOGFILE_TYPES:
+  default:
+    ink_release_assert(!"Unknown file format type!");
+  }
+}
+
+int64_t
+LogFlushData::size() const
+{
+  if (m_logfile->m_file_format == LOG_FILE_BINARY) {
+    return ((LogBuffer *)m_data)->header()->byte_count;
+  }
+  return m_len;
+}
+
 void *
 Log::flush_thread_main(void * /* args ATS_UNUSED */)
 {
-  char *buf;
   LogFile *logfile;
   LogBuffer *logbuffer;
   LogFlushData *fdata;
@@ -1243,29 +1286,46 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
     while ((fdata = link.pop()))
       invert_link.push(fdata);
 
-    // process each flush data
+    // process each flush data; the data queued for the same file one
+    // after the other is written with a single writev()
     //
     while ((fdata = invert_link.pop())) {
-      buf = NULL;
-      bytes_written = 0;
+      LogFlushData *batch[FLUSH_MAX_IOVECS];
+      struct iovec iov[FLUSH_MAX_IOVECS];
+      int nbatch = 0;
+
       logfile = fdata->m_logfile;
+      total_bytes = 0;
+      bytes_written = 0;
 
-      if (logfile->m_file_format == LOG_FILE_BINARY) {
+      while (true) {
+        if (logfile->m_file_format == LOG_FILE_BINARY) {
 
-        logbuffer = (LogBuffer *)fdata->m_data;
-        LogBufferHeader *buffer_header = logbuffer->header();
+          logbuffer = (LogBuffer *)fdata->m_data;
+          LogBufferHeader *buffer_header = logbuffer->header();
 
-        buf = (char *)buffer_header;
-        total_bytes = buffer_header->byte_count;
+          iov[nbatch].iov_base = (char *)buffer_header;
+          iov[nbatch].iov_len = buffer_header->byte_count;
 
-      } else if (logfile->m_file_format == LOG_FILE_ASCII
-                 || logfile->m_file_format == LOG_FILE_PIPE){
+        } else if (logfile->m_file_format == LOG_FILE_ASCII
+                   || logfile->m_file_format == LOG_FILE_PIPE
+                   || logfile->m_file_format == LOG_FILE_COLUMNAR){
 
-        buf = (char *)fdata->m_data;
-        total_bytes = fdata->m_len;
+          iov[nbatch].iov_base = (char *)fdata->m_data;
+          iov[nbatch].iov_len = fdata->m_len;
 
-      } else {
-        ink_release_assert(!"Unknown file format type!");
+        } else {
+          ink_release_assert(!"Unknown file format type!");
+        }
+        total_bytes += iov[nbatch].iov_len;
+        batch[nbatch++] = fdata;
+
+        // a pipe gets one buffer at a time, like write_ascii_logbuffer3()
+        // fills them, so as not to overflow the pipe buffer
+        if (nbatch == FLUSH_MAX_IOVECS || logfile->m_file_format == LOG_FILE_PIPE ||
+            !invert_link.head || invert_link.head->m_logfile != logfile)
+          break;
+        fdata = invert_link.pop();
       }
 
       // make sure we're open & ready to write
@@ -1277,13 +1337,31 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
         RecIncrRawStat(log_rsb, mutex->thread_holding,
                        log_stat_bytes_lost_before_written_to_disk_stat,
                        total_bytes);
-        delete fdata;
+        for (int i = 0; i < nbatch; i++)
+          delete batch[i];
         continue;
       }
 
       // write *all* data to target file as much as possible
       //
-      while (total_bytes - bytes_written) {
+      struct iovec *v = iov;
+      int vcnt = nbatch;
+
+      if (logfile->is_compressed()) {
+        // the file counts the (compressed) bytes it writes itself
+        if (Log::config->logging_space_exhausted) {
+          Debug("log", "logging space exhausted, failed to write file:%s, have dropped (%d) bytes.",
+                logfile->get_name(), total_bytes);
+          RecIncrRawStat(log_rsb, mutex->thread_holding,
+                         log_stat_bytes_lost_before_written_to_disk_stat, total_bytes);
+        } else if (logfile->write_compressed(iov, nbatch) < 0) {
+          RecIncrRawStat(log_rsb, mutex->thread_holding,
+                         log_stat_bytes_lost_before_written_to_disk_stat, total_bytes);
+        }
+        vcnt = 0;
+      }
+
+      while (vcnt && total_bytes - bytes_written) {
         if (Log::config->logging_space_exhausted) {
           Debug("log", "logging space exhausted, failed to write file:%s, have dropped (%d) bytes.",
                   logfile->get_name(), (total_bytes - bytes_written));
@@ -1294,8 +1372,7 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
           break;
         }
 
-        len = ::write(logfile->m_fd, &buf[bytes_written],
-                      total_bytes - bytes_written);
+        len = ::writev(logfile->m_fd, v, vcnt);
         if (len < 0) {
           Error("Failed to write log to %s: [tried %d, wrote %d, %s]",
                 logfile->get_name(), total_bytes - bytes_written,
@@ -1307,14 +1384,32 @@ Log::flush_thread_main(void * /* args ATS_UNUSED */)
           break;
         }
         bytes_written += len;
+
+        // skip what was written
+        while (vcnt && (size_t) len >= v->iov_len) {
+          len -= v->iov_len;
+          ++v;
+          --vcnt;
+        }
+        if (vcnt) {
+          v->iov_base = (char *)v->iov_base + len;
+          v->iov_len -= len;
+        }
       }
 
-      RecIncrRawStat(log_rsb, mutex->thread_holding,
-                     log_stat_bytes_written_to_disk_stat, bytes_written);
+      if (bytes_written) {
+        RecIncrRawStat(log_rsb, mutex->thread_holding,
+                       log_stat_bytes_written_to_disk_stat, bytes_written);
 
-      ink_atomic_increment(&logfile->m_bytes_written, bytes_written);
+        ink_atomic_increment(&logfile->m_bytes_written, bytes_written);
+      }
 
-      delete fdata;
+      now = ink_get_hrtime_internal();
+      for (int i = 0; i < nbatch; i++) {
+        RecIncrRawStat(log_rsb, mutex->thread_holding,
+                       log_stat_flush_latency_stat, now - batch[i]->m_queued_at);
+        delete batch[i];
+      }
     }
 
     // Time to work on periodic events??
@@ -1477,7 +1572,8 @@ Log::match_logobject(LogBufferHeader * header)
 
     if (fmt->valid()) {
       LogFileFormat file_format = header->log_object_flags & LogObject::BINARY ? LOG_FILE_BINARY :
-        (header->log_object_flags & LogObject::WRITES_TO_PIPE ? LOG_FILE_PIPE : LOG_FILE_ASCII);
+        (header->log_object_flags & LogObject::WRITES_TO_PIPE ? LOG_FILE_PIPE :
+         (header->log_object_flags & LogObject::COLUMNAR ? LOG_FILE_COLUMNAR : LOG_FILE_ASCII));
 
       obj = new LogObject(fmt, Log::config->logfile_dir,
                           header->log_filename(), file_format, NULL,
@@ -320,28 +320,15 @@ public:
   LogBuffer *logbuffer;
   void *m_data;
   int m_len;
+  ink_hrtime m_queued_at;       // when it was handed to the flush thread
 
-  LogFlushData(LogFile *logfile, void *data, int len = -1):
-    m_logfile(logfile), m_data(data), m_len(len)
-  {
-  }
+  // The flush backlog stats count the LogFlushData that exist, since they
+  // are all waiting for the flush thread.
+  LogFlushData(LogFile *logfile, void *data, int len = -1);
+  ~LogFlushData();
 
-  ~LogFlushData()
-  {
-    switch (m_logfile->m_file_format) {
-    case LOG_FILE_BINARY:
-      logbuffer = (LogBuffer *)m_data;
-      LogBuffer::destroy(logbuffer);
-      break;
-    case LOG_FILE_ASCII:
-    case LOG_FILE_PIPE:
-      free(m_data);
-      break;
-    case N_LOGFILE_TYPES:
-    default:
-      ink_release_assert(!"Unknown file format type!");
-    }
-  }
+private:
+  int64_t size() const;
 };
 
 /**
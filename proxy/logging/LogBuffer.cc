@@ -293,6 +293,26 @@ LogBuffer::LB_ResultCode LogBuffer::checkout_write(size_t * write_offset, size_t
   return ret_val;
 }
 
+/*-------------------------------------------------------------------------
+  LogBuffer::extend_if_empty
+
+  If nothing has been written to the buffer, push its expiration time back
+  and return true. A writer checking out at the same time only has its
+  entry wait for the new expiration time, as it would in a new buffer.
+  -------------------------------------------------------------------------*/
+
+bool
+LogBuffer::extend_if_empty(long time_now)
+{
+  LB_State s(m_state);
+
+  if (s.s.num_entries || s.s.num_writers || s.s.full)
+    return false;
+
+  m_expiration_time = time_now + Log::config->max_secs_per_buffer;
+  return true;
+}
+
 /*-------------------------------------------------------------------------
   LogBuffer::checkin_write
   -------------------------------------------------------------------------*/
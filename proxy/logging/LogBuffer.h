@@ -166,6 +166,8 @@ public:
 
   LogBufferHeader *header() { return m_header; }
   long expiration_time() { return m_expiration_time; }
+  /// Give an empty buffer another max_secs_per_buffer, rather than hand it off.
+  bool extend_if_empty(long time_now);
 
   // this should only be called when buffer is ready to be flushed
   void update_header_data();
@@ -0,0 +1,488 @@
+/** @file
+
+  Columnar binary log files, see LogColumnar.h.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#include "libts.h"
+
+#include <zlib.h>
+
+#include "LogLimits.h"
+#include "LogField.h"
+#include "LogFormat.h"
+#include "LogBuffer.h"
+#include "LogColumnar.h"
+
+// Limits on what a block may claim, so that a corrupt one is not believed
+#define LOG_COLUMNAR_MAX_COLUMNS 1024
+#define LOG_COLUMNAR_MAX_BODY    (64 * LOG_MEGABYTE)
+
+// Zeroed bytes after a body being decoded, so that reading a value of a
+// corrupt block can not run off the end of it
+#define LOG_COLUMNAR_GUARD       64
+
+LogColumnar::LogColumnar()
+  : m_symbols(NULL), m_raw(NULL), m_raw_size(0), m_columns(NULL), m_cursors(NULL), m_max_columns(0)
+{
+}
+
+LogColumnar::~LogColumnar()
+{
+  ats_free(m_symbols);
+  ats_free(m_raw);
+  ats_free(m_columns);
+  ats_free(m_cursors);
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::fields_for
+
+  The fields of the symbol string @a symbols. The list of the last symbol
+  string is kept, since all the buffers of a log file have the same.
+  -------------------------------------------------------------------------*/
+
+LogFieldList *
+LogColumnar::fields_for(const char *symbols)
+{
+  if (m_symbols == NULL || strcmp(m_symbols, symbols) != 0) {
+    bool contains_aggregates = false;
+
+    m_fields.clear();
+    ats_free(m_symbols);
+    m_symbols = ats_strdup(symbols);
+    LogFormat::parse_symbol_string(symbols, &m_fields, &contains_aggregates);
+  }
+  return &m_fields;
+}
+
+char *
+LogColumnar::raw_space(size_t size)
+{
+  if (size > m_raw_size) {
+    ats_free(m_raw);
+    m_raw_size = INK_ALIGN(size, 4096);
+    m_raw = (char *) ats_malloc(m_raw_size);
+  }
+  return m_raw;
+}
+
+uint32_t *
+LogColumnar::column_space(int ncolumns)
+{
+  if (ncolumns > m_max_columns) {
+    ats_free(m_columns);
+    ats_free(m_cursors);
+    m_max_columns = ncolumns;
+    m_columns = (uint32_t *) ats_malloc(ncolumns * sizeof(uint32_t));
+    // the current position in each column, then its end
+    m_cursors = (char **) ats_malloc(2 * ncolumns * sizeof(char *));
+  }
+  memset(m_columns, 0, ncolumns * sizeof(uint32_t));
+  return m_columns;
+}
+
+bool
+LogColumnar::valid_header(const LogColumnarHeader *block)
+{
+  return block->cookie == LOG_COLUMNAR_COOKIE && block->version == LOG_COLUMNAR_VERSION &&
+    block->column_count >= 2 && block->column_count <= LOG_COLUMNAR_MAX_COLUMNS &&
+    block->body_len <= LOG_COLUMNAR_MAX_BODY && block->raw_len <= LOG_COLUMNAR_MAX_BODY;
+}
+
+// true if the entries of @a buffer are within it
+static bool
+valid_entries(LogBufferHeader *buffer)
+{
+  char *p = (char *) buffer + buffer->data_offset;
+  char *end = (char *) buffer + buffer->byte_count;
+
+  for (uint32_t n = 0; n < buffer->entry_count; n++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+
+    if ((size_t) (end - p) < sizeof(LogEntryHeader) || entry->entry_len < sizeof(LogEntryHeader) ||
+        entry->entry_len > (size_t) (end - p)) {
+      return false;
+    }
+    p += entry->entry_len;
+  }
+  return true;
+}
+
+// Add the length of each field of @a fields in the entries of @a buffer to
+// @a columns (from the third one on), or return false if an entry is not
+// made of exactly these fields.
+static bool
+size_fields(LogBufferHeader *buffer, LogFieldList *fields, uint32_t *columns)
+{
+  char *p = (char *) buffer + buffer->data_offset;
+
+  for (uint32_t n = 0; n < buffer->entry_count; n++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+    char *data = p + sizeof(LogEntryHeader);
+    uint32_t *column = columns + 2;
+    LogField *f;
+
+    p += entry->entry_len;
+    for (f = fields->first(); f && data < p; f = fields->next(f)) {
+      unsigned len = f->marshalled_len(data);
+
+      *column++ += len;
+      data += len;
+    }
+    if (f || data != p) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::encode
+  -------------------------------------------------------------------------*/
+
+LogColumnarHeader *
+LogColumnar::encode(LogBufferHeader *buffer, int level, int *len)
+{
+  if (buffer->version != LOG_SEGMENT_VERSION || buffer->data_offset < sizeof(LogBufferHeader) ||
+      buffer->data_offset > buffer->byte_count || !valid_entries(buffer)) {
+    return NULL;
+  }
+
+  const char *dictionary[LOG_COLUMNAR_DICTIONARY_SIZE] = {
+    buffer->fmt_name(), buffer->fmt_fieldlist(), buffer->fmt_printf(), buffer->src_hostname(), buffer->log_filename()
+  };
+  uint32_t entry_count = buffer->entry_count;
+  LogFieldList *fields = NULL;
+  uint32_t *columns = NULL;
+  int ncolumns = 0;
+
+  if (buffer->format_type != LOG_FORMAT_TEXT && dictionary[LOG_COLUMNAR_FMT_FIELDLIST]) {
+    fields = fields_for(dictionary[LOG_COLUMNAR_FMT_FIELDLIST]);
+    ncolumns = 2 + fields->count();
+    columns = column_space(ncolumns);
+    if (ncolumns == 2 || !size_fields(buffer, fields, columns)) {
+      fields = NULL;
+    }
+  }
+  if (fields == NULL) {
+    char *p = (char *) buffer + buffer->data_offset;
+
+    ncolumns = 4;
+    columns = column_space(ncolumns);
+    columns[2] = entry_count * sizeof(uint32_t);
+    for (uint32_t n = 0; n < entry_count; n++) {
+      uint32_t entry_len = ((LogEntryHeader *) p)->entry_len;
+
+      columns[3] += entry_len - sizeof(LogEntryHeader);
+      p += entry_len;
+    }
+  }
+  columns[0] = entry_count * sizeof(int64_t);
+  columns[1] = entry_count * sizeof(int32_t);
+
+  // lay out the body
+  uint32_t mask = 0;
+  size_t dictionary_len = 0;
+
+  for (int i = 0; i < LOG_COLUMNAR_DICTIONARY_SIZE; i++) {
+    if (dictionary[i]) {
+      mask |= 1 << i;
+      dictionary_len += strlen(dictionary[i]) + 1;
+    }
+  }
+
+  size_t columns_offset = INK_ALIGN_DEFAULT(INK_ALIGN(dictionary_len, 4) + ncolumns * sizeof(uint32_t));
+  size_t raw_len = columns_offset;
+
+  for (int c = 0; c < ncolumns; c++) {
+    raw_len += INK_ALIGN_DEFAULT(columns[c]);
+  }
+  if (raw_len > LOG_COLUMNAR_MAX_BODY) {
+    return NULL;
+  }
+
+  // without compression the body is written right into the block
+  size_t room = level > 0 ? compressBound(raw_len) : raw_len;
+  LogColumnarHeader *block = (LogColumnarHeader *) ats_malloc(sizeof(LogColumnarHeader) + room);
+  char *body = level > 0 ? raw_space(raw_len) : (char *) (block + 1);
+  char *q = body;
+
+  memset(body, 0, raw_len);     // the padding
+  for (int i = 0; i < LOG_COLUMNAR_DICTIONARY_SIZE; i++) {
+    if (dictionary[i]) {
+      size_t n = strlen(dictionary[i]) + 1;
+
+      memcpy(q, dictionary[i], n);
+      q += n;
+    }
+  }
+  memcpy(body + INK_ALIGN(dictionary_len, 4), columns, ncolumns * sizeof(uint32_t));
+
+  char **cursors = m_cursors;
+
+  q = body + columns_offset;
+  for (int c = 0; c < ncolumns; c++) {
+    cursors[c] = q;
+    q += INK_ALIGN_DEFAULT(columns[c]);
+  }
+
+  // and move each value to its column
+  char *p = (char *) buffer + buffer->data_offset;
+
+  for (uint32_t n = 0; n < entry_count; n++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+    char *data = p + sizeof(LogEntryHeader);
+
+    memcpy(cursors[0], &entry->timestamp, sizeof(int64_t));
+    cursors[0] += sizeof(int64_t);
+    memcpy(cursors[1], &entry->timestamp_usec, sizeof(int32_t));
+    cursors[1] += sizeof(int32_t);
+    p += entry->entry_len;
+
+    if (fields) {
+      char **cursor = cursors + 2;
+
+      for (LogField *f = fields->first(); f; f = fields->next(f), cursor++) {
+        unsigned len = f->marshalled_len(data);
+
+        memcpy(*cursor, data, len);
+        *cursor += len;
+        data += len;
+      }
+    } else {
+      uint32_t data_len = entry->entry_len - sizeof(LogEntryHeader);
+
+      memcpy(cursors[2], &data_len, sizeof(uint32_t));
+      cursors[2] += sizeof(uint32_t);
+      memcpy(cursors[3], data, data_len);
+      cursors[3] += data_len;
+    }
+  }
+
+  block->cookie = LOG_COLUMNAR_COOKIE;
+  block->version = LOG_COLUMNAR_VERSION;
+  block->flags = fields ? 0 : LOG_COLUMNAR_ROWS;
+  block->body_len = raw_len;
+  block->raw_len = raw_len;
+  block->entry_count = entry_count;
+  block->column_count = ncolumns;
+  block->dictionary = mask;
+  block->format_type = buffer->format_type;
+  block->low_timestamp = buffer->low_timestamp;
+  block->high_timestamp = buffer->high_timestamp;
+  block->log_object_flags = buffer->log_object_flags;
+  block->log_object_signature = buffer->log_object_signature;
+
+  if (level > 0) {
+    uLongf deflated_len = room;
+
+    if (compress2((Bytef *) (block + 1), &deflated_len, (const Bytef *) body, raw_len, level > 9 ? 9 : level) == Z_OK &&
+        deflated_len < raw_len) {
+      block->flags |= LOG_COLUMNAR_DEFLATED;
+      block->body_len = deflated_len;
+    } else {
+      memcpy(block + 1, body, raw_len);
+    }
+  }
+
+  *len = sizeof(LogColumnarHeader) + block->body_len;
+  return block;
+}
+
+/*-------------------------------------------------------------------------
+  LogColumnar::decode
+  -------------------------------------------------------------------------*/
+
+LogBufferHeader *
+LogColumnar::decode(LogColumnarHeader *block)
+{
+  if (!valid_header(block)) {
+    return NULL;
+  }
+
+  uint32_t raw_len = block->raw_len;
+  char *raw = raw_space(raw_len + LOG_COLUMNAR_GUARD);
+
+  if (block->flags & LOG_COLUMNAR_DEFLATED) {
+    uLongf inflated_len = raw_len;
+
+    if (uncompress((Bytef *) raw, &inflated_len, (const Bytef *) (block + 1), block->body_len) != Z_OK ||
+        inflated_len != raw_len) {
+      return NULL;
+    }
+  } else {
+    if (block->body_len != raw_len) {
+      return NULL;
+    }
+    memcpy(raw, block + 1, raw_len);
+  }
+  memset(raw + raw_len, 0, LOG_COLUMNAR_GUARD);
+
+  // the dictionary
+  const char *dictionary[LOG_COLUMNAR_DICTIONARY_SIZE];
+  size_t header_len = sizeof(LogBufferHeader);
+  char *q = raw;
+
+  for (int i = 0; i < LOG_COLUMNAR_DICTIONARY_SIZE; i++) {
+    dictionary[i] = NULL;
+    if (block->dictionary & (1 << i)) {
+      size_t n = strlen(q) + 1;
+
+      dictionary[i] = q;
+      header_len += n;
+      q += n;
+    }
+  }
+  if (q > raw + raw_len) {
+    return NULL;
+  }
+  header_len = INK_ALIGN_DEFAULT(header_len);
+
+  // the columns
+  bool rows = (block->flags & LOG_COLUMNAR_ROWS) != 0;
+  int ncolumns = block->column_count;
+  uint32_t entry_count = block->entry_count;
+  LogFieldList *fields = NULL;
+  size_t dictionary_len = q - raw;
+  size_t offset = INK_ALIGN_DEFAULT(INK_ALIGN(dictionary_len, 4) + ncolumns * sizeof(uint32_t));
+
+  if (rows) {
+    if (ncolumns != 4) {
+      return NULL;
+    }
+  } else {
+    if (!dictionary[LOG_COLUMNAR_FMT_FIELDLIST]) {
+      return NULL;
+    }
+    fields = fields_for(dictionary[LOG_COLUMNAR_FMT_FIELDLIST]);
+    if ((int) fields->count() + 2 != ncolumns) {
+      return NULL;
+    }
+  }
+  if (offset > raw_len) {
+    return NULL;
+  }
+
+  uint32_t *columns = column_space(ncolumns);
+  char **cursors = m_cursors;
+  char **ends = m_cursors + ncolumns;
+  size_t size = header_len + (size_t) entry_count * sizeof(LogEntryHeader);
+
+  memcpy(columns, raw + INK_ALIGN(dictionary_len, 4), ncolumns * sizeof(uint32_t));
+  for (int c = 0; c < ncolumns; c++) {
+    cursors[c] = raw + offset;
+    ends[c] = cursors[c] + columns[c];
+    offset += INK_ALIGN_DEFAULT((size_t) columns[c]);
+    if (offset > raw_len) {
+      return NULL;
+    }
+    if (c >= (rows ? 3 : 2)) {
+      size += columns[c];
+    }
+  }
+  if (columns[0] != entry_count * sizeof(int64_t) || columns[1] != entry_count * sizeof(int32_t) ||
+      (rows && columns[2] != entry_count * sizeof(uint32_t)) || size > UINT32_MAX) {
+    return NULL;
+  }
+
+  // the LogBuffer
+  LogBufferHeader *buffer = (LogBufferHeader *) ats_malloc(size);
+  uint32_t *offsets[LOG_COLUMNAR_DICTIONARY_SIZE] = {
+    &buffer->fmt_name_offset, &buffer->fmt_fieldlist_offset, &buffer->fmt_printf_offset,
+    &buffer->src_hostname_offset, &buffer->log_filename_offset
+  };
+
+  memset(buffer, 0, header_len);
+  buffer->cookie = LOG_SEGMENT_COOKIE;
+  buffer->version = LOG_SEGMENT_VERSION;
+  buffer->format_type = block->format_type;
+  buffer->byte_count = size;
+  buffer->entry_count = entry_count;
+  buffer->low_timestamp = block->low_timestamp;
+  buffer->high_timestamp = block->high_timestamp;
+  buffer->log_object_flags = block->log_object_flags;
+  buffer->log_object_signature = block->log_object_signature;
+  buffer->data_offset = header_len;
+
+  q = (char *) buffer + sizeof(LogBufferHeader);
+  for (int i = 0; i < LOG_COLUMNAR_DICTIONARY_SIZE; i++) {
+    if (dictionary[i]) {
+      size_t n = strlen(dictionary[i]) + 1;
+
+      *offsets[i] = q - (char *) buffer;
+      memcpy(q, dictionary[i], n);
+      q += n;
+    }
+  }
+
+  // put each entry back together
+  char *p = (char *) buffer + header_len;
+  char *end = (char *) buffer + size;
+
+  for (uint32_t n = 0; n < entry_count; n++) {
+    LogEntryHeader *entry = (LogEntryHeader *) p;
+    char *data = p + sizeof(LogEntryHeader);
+
+    memcpy(&entry->timestamp, cursors[0], sizeof(int64_t));
+    cursors[0] += sizeof(int64_t);
+    memcpy(&entry->timestamp_usec, cursors[1], sizeof(int32_t));
+    cursors[1] += sizeof(int32_t);
+
+    if (fields) {
+      char **cursor = cursors + 2;
+      char **cursor_end = ends + 2;
+
+      for (LogField *f = fields->first(); f; f = fields->next(f), cursor++, cursor_end++) {
+        unsigned len = *cursor < *cursor_end ? f->marshalled_len(*cursor) : 0;
+
+        if (len == 0 || len > (size_t) (*cursor_end - *cursor) || len > (size_t) (end - data)) {
+          ats_free(buffer);
+          return NULL;
+        }
+        memcpy(data, *cursor, len);
+        *cursor += len;
+        data += len;
+      }
+    } else {
+      uint32_t data_len;
+
+      memcpy(&data_len, cursors[2], sizeof(uint32_t));
+      cursors[2] += sizeof(uint32_t);
+      if (data_len > (size_t) (ends[3] - cursors[3])) {
+        ats_free(buffer);
+        return NULL;
+      }
+      memcpy(data, cursors[3], data_len);
+      cursors[3] += data_len;
+      data += data_len;
+    }
+    entry->entry_len = data - p;
+    p = data;
+  }
+
+  for (int c = 0; c < ncolumns; c++) {
+    if (cursors[c] != ends[c]) {
+      ats_free(buffer);
+      return NULL;
+    }
+  }
+  return buffer;
+}
@@ -0,0 +1,134 @@
+/** @file
+
+  Columnar binary log files.
+
+  A columnar log file is a sequence of blocks, one per LogBuffer. Each
+  block is a LogColumnarHeader followed by its body, deflated unless it
+  was written with a compression level of 0. The body holds
+
+  - the dictionary of the block: the format name, the field symbols, the
+    printf string, the host name and the log file name of the LogBuffer
+    (those it had), each terminated by a NUL, so that a block can be
+    decoded on its own, even after the formats were changed;
+  - the length of each column, as uint32_t, aligned on 4 bytes;
+  - the columns, each aligned on 8 bytes: the entry timestamps (int64_t),
+    their microseconds (int32_t), then, for each field, the marshalled
+    values of that field for every entry, one after the other.
+
+  Values of one field sit next to each other, which deflates much better
+  than whole entries, and nothing is converted to text: encoding a
+  LogBuffer only moves the marshalled values around. Decoding puts the
+  entries back together, so a block turns back into the LogBuffer it was
+  made of and the usual LogBuffer code can read it.
+
+  If the fields of an entry can not be told apart (text logs, or entries
+  that do not match their field list), the block is written in rows: the
+  third column holds the length of each entry (uint32_t) and the fourth
+  the entries themselves.
+
+  @section license License
+
+  Licensed to the Apache Software Foundation (ASF) under one
+  or more contributor license agreements.  See the NOTICE file
+  distributed with this work for additional information
+  regarding copyright ownership.  The ASF licenses this file
+  to you under the Apache License, Version 2.0 (the
+  "License"); you may not use this file except in compliance
+  with the License.  You may obtain a copy of the License at
+
+      http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+ */
+
+#ifndef LOG_COLUMNAR_H
+#define LOG_COLUMNAR_H
+
+#include "libts.h"
+#include "LogField.h"
+
+struct LogBufferHeader;
+
+#define LOG_COLUMNAR_COOKIE 0xc01face
+#define LOG_COLUMNAR_VERSION 1
+
+// LogColumnarHeader::flags
+#define LOG_COLUMNAR_DEFLATED 0x1       // the body is deflated
+#define LOG_COLUMNAR_ROWS     0x2       // the entries are not split in fields
+
+// The strings of the dictionary, in this order
+enum
+{
+  LOG_COLUMNAR_FMT_NAME = 0,
+  LOG_COLUMNAR_FMT_FIELDLIST,
+  LOG_COLUMNAR_FMT_PRINTF,
+  LOG_COLUMNAR_SRC_HOSTNAME,
+  LOG_COLUMNAR_LOG_FILENAME,
+  LOG_COLUMNAR_DICTIONARY_SIZE
+};
+
+struct LogColumnarHeader
+{
+  uint32_t cookie;              // LOG_COLUMNAR_COOKIE
+  uint32_t version;             // LOG_COLUMNAR_VERSION
+  uint32_t flags;
+  uint32_t body_len;            // bytes of the body, which follows
+  uint32_t raw_len;             // bytes of the body once inflated
+  uint32_t entry_count;
+  uint32_t column_count;
+  uint32_t dictionary;          // bit i is set if the body has string i of the dictionary
+
+  // from the LogBufferHeader
+  uint32_t format_type;
+  uint32_t low_timestamp;
+  uint32_t high_timestamp;
+  uint32_t log_object_flags;
+  uint64_t log_object_signature;
+};
+
+class LogColumnar
+{
+public:
+  LogColumnar();
+  ~LogColumnar();
+
+  /** Encode the entries of @a buffer as a block, deflated at zlib
+      @a level (0 to store it as is).
+      @return A block of @a *len bytes, to release with ats_free(), or
+      @c NULL if @a buffer is not a valid LogBuffer.
+  */
+  LogColumnarHeader *encode(LogBufferHeader *buffer, int level, int *len);
+
+  /** Rebuild the LogBuffer @a block was made of. The body of @a block
+      must follow it.
+      @return A LogBufferHeader followed by its entries, to release with
+      ats_free(), or @c NULL if the block is corrupt.
+  */
+  LogBufferHeader *decode(LogColumnarHeader *block);
+
+  /// @c true if @a block looks like the header of a block.
+  static bool valid_header(const LogColumnarHeader *block);
+
+private:
+  LogFieldList *fields_for(const char *symbols);
+  char *raw_space(size_t size);
+  uint32_t *column_space(int ncolumns);
+
+  char *m_symbols;              // the symbols of m_fields
+  LogFieldList m_fields;
+  char *m_raw;                  // room for a body
+  size_t m_raw_size;
+  uint32_t *m_columns;          // room for the lengths of the columns
+  char **m_cursors;             // and for a pointer in each of them
+  int m_max_columns;
+
+  // -- member functions not allowed --
+  LogColumnar(const LogColumnar &);
+  LogColumnar & operator=(const LogColumnar &);
+};
+
+#endif
@@ -78,6 +78,7 @@ LogConfig::setup_default_values()
 
   log_buffer_size = (int) (10 * LOG_KILOBYTE);
   max_secs_per_buffer = 5;
+  per_thread_buffers = true;
   max_space_mb_for_logs = 100;
   max_space_mb_for_orphan_logs = 25;
   max_space_mb_headroom = 10;
@@ -157,6 +158,9 @@ LogConfig::setup_default_values()
 
   ascii_buffer_size = 4 * 9216;
   max_line_size = 9216;         // size of pipe buffer for SunOS 5.6
+  columnar_compression_level = 1;
+  ascii_compression = LOG_FILE_COMPRESSION_NONE;
+  ascii_compression_level = 1;
 }
 
 void *
@@ -184,6 +188,9 @@ LogConfig::read_configuration_variables()
     max_secs_per_buffer = val;
   }
 
+  val = (int) REC_ConfigReadInteger("proxy.config.log.per_thread_buffers");
+  per_thread_buffers = (val != 0);
+
   val = (int) REC_ConfigReadInteger("proxy.config.log.max_space_mb_for_logs");
   if (val > 0) {
     max_space_mb_for_logs = val;
@@ -459,6 +466,29 @@ LogConfig::read_configuration_variables()
     max_line_size = val;
   }
 
+  // COLUMNAR FILES
+  val = (int) REC_ConfigReadInteger("proxy.config.log.columnar_compression_level");
+  if (val >= 0 && val <= 9) {
+    columnar_compression_level = val;
+  }
+
+  // COMPRESSED ASCII FILES
+  val = (int) REC_ConfigReadInteger("proxy.config.log.ascii_compression");
+  if (val >= LOG_FILE_COMPRESSION_NONE && val < N_LOG_FILE_COMPRESSIONS) {
+    ascii_compression = (LogFileCompression) val;
+  }
+#if !TS_HAS_ZSTD
+  if (ascii_compression == LOG_FILE_COMPRESSION_ZSTD) {
+    Warning("zstd not available for log compression, using gzip");
+    ascii_compression = LOG_FILE_COMPRESSION_GZIP;
+  }
+#endif
+
+  val = (int) REC_ConfigReadInteger("proxy.config.log.ascii_compression_level");
+  if (val >= 1 && val <= 19) {
+    ascii_compression_level = val;
+  }
+
 /* The following variables are initialized after reading the     */
 /* variable values from records.config                           */
 
@@ -825,6 +855,9 @@ LogConfig::create_predefined_object(const PreDefinedFormatInfo * pdi, size_t num
       case LOG_FILE_BINARY:
         ink_string_append(obj_filt_fname, (char *)LOG_FILE_BINARY_OBJECT_FILENAME_EXTENSION, PATH_NAME_MAX);
         break;
+      case LOG_FILE_COLUMNAR:
+        ink_string_append(obj_filt_fname, (char *)LOG_FILE_COLUMNAR_OBJECT_FILENAME_EXTENSION, PATH_NAME_MAX);
+        break;
       default:
         break;
     }
@@ -1118,6 +1151,7 @@ LogConfig::register_config_callbacks()
   static const char * names[] = {
     "proxy.config.log.log_buffer_size",
     "proxy.config.log.max_secs_per_buffer",
+    "proxy.config.log.per_thread_buffers",
     "proxy.config.log.max_space_mb_for_logs",
     "proxy.config.log.max_space_mb_for_orphan_logs",
     "proxy.config.log.max_space_mb_headroom",
@@ -1166,6 +1200,9 @@ LogConfig::register_config_callbacks()
     "proxy.config.log.search_server_ip_addr",
     "proxy.config.log.search_server_port",
     "proxy.config.log.search_url_filter",
+    "proxy.config.log.columnar_compression_level",
+    "proxy.config.log.ascii_compression",
+    "proxy.config.log.ascii_compression_level",
   };
 
 
@@ -1260,6 +1297,27 @@ LogConfig::register_stat_callbacks()
                      "proxy.process.log.bytes_lost_before_written_to_disk",
                      RECD_INT, RECP_PERSISTENT, (int) log_stat_bytes_lost_before_written_to_disk_stat, RecRawStatSyncSum);
   //
+  // buffers
+  //
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.buffer_checkout_retries",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) log_stat_buffer_checkout_retries_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.buffers_handed_off",
+                     RECD_COUNTER, RECP_NON_PERSISTENT, (int) log_stat_buffers_handed_off_stat, RecRawStatSyncSum);
+  //
+  // flush
+  //
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.flush_backlog",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) log_stat_flush_backlog_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.flush_backlog_bytes",
+                     RECD_INT, RECP_NON_PERSISTENT, (int) log_stat_flush_backlog_bytes_stat, RecRawStatSyncSum);
+  RecRegisterRawStat(log_rsb, RECT_PROCESS,
+                     "proxy.process.log.flush_latency",
+                     RECD_FLOAT, RECP_NON_PERSISTENT, (int) log_stat_flush_latency_stat, RecRawStatSyncHrTimeAvg);
+  //
   // I/O
   //
   RecRegisterRawStat(log_rsb, RECT_PROCESS,
@@ -2065,9 +2123,13 @@ LogConfig::read_xml_log_config(int from_memory)
       LogFileFormat file_type = LOG_FILE_ASCII;      // default value
       if (mode.count()) {
         char *mode_str = mode.dequeue();
-        file_type = (strncasecmp(mode_str, "bin", 3) == 0 ||
-                     (mode_str[0] == 'b' && mode_str[1] == 0) ?
-                     LOG_FILE_BINARY : (strcasecmp(mode_str, "ascii_pipe") == 0 ? LOG_FILE_PIPE : LOG_FILE_ASCII));
+        if (strncasecmp(mode_str, "bin", 3) == 0 || (mode_str[0] == 'b' && mode_str[1] == 0)) {
+          file_type = LOG_FILE_BINARY;
+        } else if (strcasecmp(mode_str, "ascii_pipe") == 0) {
+          file_type = LOG_FILE_PIPE;
+        } else if (strcasecmp(mode_str, "columnar") == 0) {
+          file_type = LOG_FILE_COLUMNAR;
+        }
       }
       // rolling
       //
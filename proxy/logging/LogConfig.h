@@ -29,6 +29,7 @@
 #include "libts.h"
 #include "P_RecProcess.h"
 #include "ProxyConfig.h"
+#include "LogFile.h"
 
 /* Instead of enumerating the stats in DynamicStats.h, each module needs
    to enumerate its stats separately and register them with librecords
@@ -65,6 +66,15 @@ enum
   log_stat_bytes_written_to_disk_stat,
   log_stat_bytes_lost_before_written_to_disk_stat,
 
+  // Logging Buffers
+  log_stat_buffer_checkout_retries_stat,
+  log_stat_buffers_handed_off_stat,
+
+  // Logging Flush
+  log_stat_flush_backlog_stat,
+  log_stat_flush_backlog_bytes_stat,
+  log_stat_flush_latency_stat,
+
   // Logging I/O
   log_stat_log_files_open_stat,
   log_stat_log_files_space_used_stat,
@@ -164,6 +174,7 @@ public:
 
   int log_buffer_size;
   int max_secs_per_buffer;
+  bool per_thread_buffers;
   int max_space_mb_for_logs;
   int max_space_mb_for_orphan_logs;
   int max_space_mb_headroom;
@@ -207,6 +218,9 @@ public:
 
   int ascii_buffer_size;
   int max_line_size;
+  int columnar_compression_level;
+  LogFileCompression ascii_compression;
+  int ascii_compression_level;
 
   char *hostname;
   char *logfile_dir;
@@ -391,6 +391,50 @@ LogField::unmarshal(char **buf, char *dest, int len)
   }
 }
 
+/*-------------------------------------------------------------------------
+  LogField::marshalled_len
+
+  This routine returns the number of bytes taken by the value of this
+  field marshalled at buf, which is how far unmarshal() would move the
+  buffer pointer, without converting the value.
+  -------------------------------------------------------------------------*/
+unsigned
+LogField::marshalled_len(char *buf)
+{
+  if (m_agg_op != NO_AGGREGATE) {
+    return INK_MIN_ALIGN;
+  }
+
+  if (m_unmarshal_func == (UnmarshalFunc)LogAccess::unmarshal_str) {
+    return LogAccess::strlen(buf);
+  }
+  if (m_unmarshal_func == (UnmarshalFunc)LogAccess::unmarshal_http_text) {
+    // method, url, then the version
+    unsigned len = LogAccess::strlen(buf);
+    len += LogAccess::strlen(buf + len);
+    return len + 2 * INK_MIN_ALIGN;
+  }
+  if (m_unmarshal_func == LogAccess::unmarshal_int_to_str) {
+    return INK_MIN_ALIGN;
+  }
+  if (m_unmarshal_func == LogAccess::unmarshal_record) {
+    return MARSHAL_RECORD_LENGTH;
+  }
+
+  switch (m_type) {
+  case sINT:
+    return INK_MIN_ALIGN;
+  case dINT:
+    return 2 * INK_MIN_ALIGN;
+  case IP: {
+      IpEndpoint ip;
+      return LogAccess::unmarshal_ip(&buf, &ip);
+    }
+  default:
+    return LogAccess::strlen(buf);
+  }
+}
+
 /*-------------------------------------------------------------------------
   LogField::display
   -------------------------------------------------------------------------*/
@@ -33,6 +33,13 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <zlib.h>
+#if TS_HAS_ZSTD
+#include <zstd.h>
+#endif
+#if TS_USE_LINUX_IO_URING
+#include <liburing.h>
+#endif
 
 #include "Error.h"
 
@@ -44,6 +51,7 @@
 #include "LogFilter.h"
 #include "LogFormat.h"
 #include "LogBuffer.h"
+#include "LogColumnar.h"
 #include "LogFile.h"
 #include "LogHost.h"
 #include "LogObject.h"
@@ -51,6 +59,375 @@
 #include "LogConfig.h"
 #include "Log.h"
 
+/*-------------------------------------------------------------------------
+  LogFileCompressor
+
+  Compresses what is written to a log file, as one gzip member or one zstd
+  frame each time the file is opened: both formats allow several of them
+  one after the other, so a file that is opened again after a restart is
+  still one valid compressed file, and a rolled file is compressed already.
+
+  The compressed data is gathered in a page aligned buffer and written when
+  the buffer is full, so the writes are few, large, and of whole pages. A
+  flush writes the rest of the buffer, after having the compressor emit
+  everything it was given (a sync flush), so that the file can be read up
+  to its last entry.
+
+  When io_uring AIO is built and proxy.config.aio.io_uring.enabled is set,
+  a full buffer is submitted to a ring of the compressor's own and the
+  compression goes on in a second buffer while it is written. Only one
+  write is in flight at a time, so the file is appended to in order.
+  -------------------------------------------------------------------------*/
+
+#define LOG_FILE_COMPRESS_BUFFER_SIZE (256 * LOG_KILOBYTE)
+
+class LogFileCompressor
+{
+public:
+  enum Mode
+  {
+    CONTINUE,
+    FLUSH,
+    FINISH
+  };
+
+  LogFileCompressor(LogFileCompression type, int level);
+  ~LogFileCompressor();
+
+  /// Start a new member (gzip) or frame (zstd).
+  bool start();
+
+  /** Compress @a len bytes of @a data and write the buffer to @a fd as it
+      fills up, or whatever there is if @a mode is not CONTINUE.
+      @return The number of bytes written to @a fd, or -1 on error.
+  */
+  int64_t compress(int fd, const void *data, size_t len, Mode mode);
+
+  bool pending() const { return m_pending; }
+  long pending_since() const { return m_pending_since; }
+
+private:
+  int64_t compress_stream(int fd, const void *data, size_t len, Mode mode);
+  int64_t write_out(int fd, bool wait);
+  int64_t write_all(int fd, const char *buf, size_t len);
+#if TS_USE_LINUX_IO_URING
+  int64_t reap(bool complete);
+#endif
+
+  LogFileCompression m_type;
+  int m_level;
+  z_stream m_zstream;
+  bool m_zstream_ready;
+#if TS_HAS_ZSTD
+  ZSTD_CStream *m_zstd;
+#endif
+  char *m_buffer;
+  size_t m_used;
+  bool m_pending;               // given data that was not flushed yet
+  long m_pending_since;
+#if TS_USE_LINUX_IO_URING
+  struct io_uring m_ring;
+  bool m_ring_ready;
+  char *m_inflight;             // the buffer being written, NULL if none
+  size_t m_inflight_len;
+  int m_inflight_fd;
+#endif
+
+  // -- member functions not allowed --
+  LogFileCompressor(const LogFileCompressor &);
+  LogFileCompressor & operator=(const LogFileCompressor &);
+};
+
+LogFileCompressor::LogFileCompressor(LogFileCompression type, int level)
+  : m_type(type), m_level(level), m_zstream_ready(false),
+#if TS_HAS_ZSTD
+    m_zstd(NULL),
+#endif
+    m_used(0), m_pending(false), m_pending_since(0)
+#if TS_USE_LINUX_IO_URING
+    , m_ring_ready(false), m_inflight(NULL), m_inflight_len(0), m_inflight_fd(-1)
+#endif
+{
+#if !TS_HAS_ZSTD
+  ink_release_assert(m_type != LOG_FILE_COMPRESSION_ZSTD);
+#endif
+  if (m_type == LOG_FILE_COMPRESSION_GZIP && m_level > 9) {
+    m_level = 9;
+  }
+  memset(&m_zstream, 0, sizeof(m_zstream));
+  m_buffer = (char *)ats_memalign(ats_pagesize(), LOG_FILE_COMPRESS_BUFFER_SIZE);
+
+#if TS_USE_LINUX_IO_URING
+  RecInt io_uring = 0;
+
+  RecGetRecordInt("proxy.config.aio.io_uring.enabled", &io_uring);
+  if (io_uring) {
+    int ret = io_uring_queue_init(2, &m_ring, 0);
+
+    if (ret < 0) {
+      Warning("io_uring_queue_init failed: %s, writing compressed logs synchronously", strerror(-ret));
+    } else {
+      m_ring_ready = true;
+      m_inflight = (char *)ats_memalign(ats_pagesize(), LOG_FILE_COMPRESS_BUFFER_SIZE);
+    }
+  }
+#endif
+}
+
+LogFileCompressor::~LogFileCompressor()
+{
+  if (m_zstream_ready) {
+    deflateEnd(&m_zstream);
+  }
+#if TS_HAS_ZSTD
+  if (m_zstd) {
+    ZSTD_freeCStream(m_zstd);
+  }
+#endif
+#if TS_USE_LINUX_IO_URING
+  if (m_ring_ready) {
+    reap(false);
+    io_uring_queue_exit(&m_ring);
+    // m_inflight is the spare buffer when nothing is in flight
+    ats_memalign_free(m_inflight);
+  }
+#endif
+  ats_memalign_free(m_buffer);
+}
+
+bool
+LogFileCompressor::start()
+{
+#if TS_USE_LINUX_IO_URING
+  // a write left from a stream that failed belongs to a file that is closed now
+  if (m_ring_ready) {
+    reap(false);
+  }
+#endif
+  m_used = 0;
+  m_pending = false;
+
+  switch (m_type) {
+  case LOG_FILE_COMPRESSION_GZIP:
+    if (m_zstream_ready) {
+      return deflateReset(&m_zstream) == Z_OK;
+    }
+    // 16 + MAX_WBITS for a gzip header and trailer
+    m_zstream_ready = (deflateInit2(&m_zstream, m_level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+    return m_zstream_ready;
+#if TS_HAS_ZSTD
+  case LOG_FILE_COMPRESSION_ZSTD:
+    if (!m_zstd && (m_zstd = ZSTD_createCStream()) == NULL) {
+      return false;
+    }
+    return !ZSTD_isError(ZSTD_initCStream(m_zstd, m_level));
+#endif
+  default:
+    return false;
+  }
+}
+
+int64_t
+LogFileCompressor::write_all(int fd, const char *buf, size_t len)
+{
+  size_t done = 0;
+
+  while (done < len) {
+    ssize_t n = ::write(fd, buf + done, len - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    done += n;
+  }
+  return done;
+}
+
+#if TS_USE_LINUX_IO_URING
+/** Wait for the write in flight, and finish it if it was short and @a complete.
+    @return The number of bytes written, or -1 on error.
+*/
+int64_t
+LogFileCompressor::reap(bool complete)
+{
+  struct io_uring_cqe *cqe;
+  int64_t res;
+  int ret;
+
+  if (!m_inflight_len) {
+    return 0;
+  }
+  while ((ret = io_uring_wait_cqe(&m_ring, &cqe)) == -EINTR)
+    ;
+  if (ret < 0) {
+    errno = -ret;
+    return -1;
+  }
+  res = cqe->res;
+  io_uring_cqe_seen(&m_ring, cqe);
+
+  size_t len = m_inflight_len;
+  m_inflight_len = 0;
+  if (res < 0) {
+    errno = -res;
+    return -1;
+  }
+  if (complete && (size_t)res < len) {
+    int64_t n = write_all(m_inflight_fd, m_inflight + res, len - res);
+    if (n < 0) {
+      return -1;
+    }
+    res += n;
+  }
+  return res;
+}
+#endif
+
+/** Write the buffer out, waiting for it to be written if @a wait.
+    @return The number of bytes known to be written, or -1 on error.
+*/
+int64_t
+LogFileCompressor::write_out(int fd, bool wait)
+{
+  int64_t n;
+
+#if TS_USE_LINUX_IO_URING
+  if (m_ring_ready) {
+    int64_t done = 0;
+
+    // one write at a time, the file is appended to in order
+    if ((n = reap(true)) < 0) {
+      return -1;
+    }
+    done += n;
+    if (m_used) {
+      struct io_uring_sqe *sqe = io_uring_get_sqe(&m_ring);
+      char *buf = m_buffer;
+      int ret;
+
+      // the file is opened O_APPEND, the offset is not used
+      io_uring_prep_write(sqe, fd, buf, m_used, 0);
+      if ((ret = io_uring_submit(&m_ring)) < 0) {
+        errno = -ret;
+        return -1;
+      }
+      // compress into the other buffer while this one is written
+      m_buffer = m_inflight;
+      m_inflight = buf;
+      m_inflight_len = m_used;
+      m_inflight_fd = fd;
+      m_used = 0;
+    }
+    if (wait) {
+      if ((n = reap(true)) < 0) {
+        return -1;
+      }
+      done += n;
+    }
+    return done;
+  }
+#else
+  (void)wait;
+#endif
+
+  if ((n = write_all(fd, m_buffer, m_used)) < 0) {
+    return -1;
+  }
+  m_used = 0;
+  return n;
+}
+
+int64_t
+LogFileCompressor::compress(int fd, const void *data, size_t len, Mode mode)
+{
+  int64_t written = compress_stream(fd, data, len, mode);
+
+#if TS_USE_LINUX_IO_URING
+  // the stream is lost, don't leave a write behind for a file that will be closed
+  if (written < 0 && m_ring_ready) {
+    int saved = errno;
+    reap(false);
+    errno = saved;
+  }
+#endif
+  return written;
+}
+
+int64_t
+LogFileCompressor::compress_stream(int fd, const void *data, size_t len, Mode mode)
+{
+  int64_t written = 0, n;
+
+  if (m_type == LOG_FILE_COMPRESSION_GZIP) {
+    int flush = (mode == FINISH ? Z_FINISH : (mode == FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH));
+
+    m_zstream.next_in = (Bytef *)data;
+    m_zstream.avail_in = len;
+    while (true) {
+      m_zstream.next_out = (Bytef *)m_buffer + m_used;
+      m_zstream.avail_out = LOG_FILE_COMPRESS_BUFFER_SIZE - m_used;
+      if (deflate(&m_zstream, flush) == Z_STREAM_ERROR) {
+        return -1;
+      }
+      m_used = LOG_FILE_COMPRESS_BUFFER_SIZE - m_zstream.avail_out;
+      // if the buffer is not full, all the input was taken and,
+      // for a flush, all the output was produced
+      if (m_zstream.avail_out) {
+        break;
+      }
+      if ((n = write_out(fd, false)) < 0) {
+        return -1;
+      }
+      written += n;
+    }
+  }
+#if TS_HAS_ZSTD
+  else if (m_type == LOG_FILE_COMPRESSION_ZSTD) {
+    ZSTD_inBuffer in = { data, len, 0 };
+
+    while (true) {
+      ZSTD_outBuffer out = { m_buffer, LOG_FILE_COMPRESS_BUFFER_SIZE, m_used };
+      size_t left = 0;
+
+      if (in.pos < in.size || mode == CONTINUE) {
+        left = ZSTD_compressStream(m_zstd, &out, &in);
+      } else if (mode == FLUSH) {
+        left = ZSTD_flushStream(m_zstd, &out);
+      } else {
+        left = ZSTD_endStream(m_zstd, &out);
+      }
+      if (ZSTD_isError(left)) {
+        return -1;
+      }
+      m_used = out.pos;
+      if (m_used == LOG_FILE_COMPRESS_BUFFER_SIZE) {
+        if ((n = write_out(fd, false)) < 0) {
+          return -1;
+        }
+        written += n;
+      } else if (in.pos == in.size && (mode == CONTINUE || left == 0)) {
+        break;
+      }
+    }
+  }
+#endif
+
+  if (mode != CONTINUE) {
+    if ((n = write_out(fd, true)) < 0) {
+      return -1;
+    }
+    written += n;
+    m_pending = false;
+  } else if (len && !m_pending) {
+    m_pending = true;
+    m_pending_since = LogUtils::timestamp();
+  }
+
+  return written;
+}
+
 /*-------------------------------------------------------------------------
   LogFile::LogFile
 
@@ -59,13 +436,18 @@
   -------------------------------------------------------------------------*/
 
 LogFile::LogFile(const char *name, const char *header, LogFileFormat format,
-                 uint64_t signature, size_t ascii_buffer_size, size_t max_line_size)
+                 uint64_t signature, size_t ascii_buffer_size, size_t max_line_size,
+                 LogFileCompression compression, int compression_level)
   : m_file_format(format),
     m_name(ats_strdup(name)),
     m_header(ats_strdup(header)),
     m_signature(signature),
     m_meta_info(NULL),
-    m_max_line_size(max_line_size)
+    m_max_line_size(max_line_size),
+    m_compression(format == LOG_FILE_ASCII ? compression : LOG_FILE_COMPRESSION_NONE),
+    m_compression_level(compression_level),
+    m_compressor(NULL),
+    m_compressing(false)
 {
   delete m_meta_info;
   m_meta_info = NULL;
@@ -96,7 +478,11 @@ LogFile::LogFile (const LogFile& copy)
     m_fd (-1),
     m_start_time (0L),
     m_end_time (0L),
-    m_bytes_written (0)
+    m_bytes_written (0),
+    m_compression (copy.m_compression),
+    m_compression_level (copy.m_compression_level),
+    m_compressor (NULL),
+    m_compressing (false)
 {
     ink_release_assert(m_ascii_buffer_size >= m_max_line_size);
 
@@ -115,6 +501,7 @@ LogFile::~LogFile()
   ats_free(m_name);
   ats_free(m_header);
   delete m_meta_info;
+  delete m_compressor;
   Debug("log-file", "exiting LogFile destructor, this=%p", this);
 }
 
@@ -234,6 +621,19 @@ LogFile::open_file()
 
   Debug("log-file", "LogFile %s is now open (fd=%d)", m_name, m_fd);
 
+  if (m_compression != LOG_FILE_COMPRESSION_NONE) {
+    if (!m_compressor) {
+      m_compressor = new LogFileCompressor(m_compression, m_compression_level);
+    }
+    if (!m_compressor->start()) {
+      Error("Could not start compressing log file %s", m_name);
+      ::close(m_fd);
+      m_fd = -1;
+      return LOG_FILE_COULD_NOT_OPEN_FILE;
+    }
+    m_compressing = true;
+  }
+
   //
   // If we've opened the file and it didn't already exist, then this is a
   // "new" file and we need to make some initializations.  This is the
@@ -241,9 +641,25 @@ LogFile::open_file()
   // file.
   //
   if (!file_exists) {
-    if (m_file_format != LOG_FILE_BINARY && m_header != NULL) {
+    if (m_file_format != LOG_FILE_BINARY && m_file_format != LOG_FILE_COLUMNAR && m_header != NULL) {
       Debug("log-file", "writing header to LogFile %s", m_name);
-      writeln(m_header, strlen(m_header), m_fd, m_name);
+      if (is_compressed()) {
+        struct iovec wvec[2];
+        int vcnt = 1;
+
+        wvec[0].iov_base = m_header;
+        wvec[0].iov_len = strlen(m_header);
+        if (wvec[0].iov_len && m_header[wvec[0].iov_len - 1] != '\n') {
+          wvec[1].iov_base = (void *) "\n";
+          wvec[1].iov_len = 1;
+          vcnt++;
+        }
+        if (write_compressed(wvec, vcnt) < 0) {
+          return LOG_FILE_COULD_NOT_OPEN_FILE;
+        }
+      } else {
+        writeln(m_header, strlen(m_header), m_fd, m_name);
+      }
     }
   }
 
@@ -262,6 +678,11 @@ LogFile::open_file()
 void
 LogFile::close_file()
 {
+  // end the compressed stream; if that fails, the file gets closed
+  if (is_compressed()) {
+    flush_compressed(true);
+  }
+
   if (is_open()) {
     ::close(m_fd);
     Debug("log-file", "LogFile %s (fd=%d) is closed", m_name, m_fd);
@@ -285,16 +706,45 @@ bool LogFile::rolled_logfile(char *path)
     target_len = (int) strlen(LOGFILE_ROLLED_EXTENSION);
   int
     len = (int) strlen(path);
+
+  // a compressed log file keeps its compression extension once rolled
+  for (int i = LOG_FILE_COMPRESSION_NONE + 1; i < N_LOG_FILE_COMPRESSIONS; i++) {
+    int ext_len = (int) strlen(compression_extension((LogFileCompression) i));
+    if (len > ext_len && !strcmp(&path[len - ext_len], compression_extension((LogFileCompression) i))) {
+      len -= ext_len;
+      break;
+    }
+  }
+
   if (len > target_len) {
     char *
       str = &path[len - target_len];
-    if (!strcmp(str, LOGFILE_ROLLED_EXTENSION)) {
+    if (!strncmp(str, LOGFILE_ROLLED_EXTENSION, target_len)) {
       return true;
     }
   }
   return false;
 }
 
+/*-------------------------------------------------------------------------
+  LogFile::compression_extension
+
+  The extension of the files compressed with the given compression.
+  -------------------------------------------------------------------------*/
+
+const char *
+LogFile::compression_extension(LogFileCompression compression)
+{
+  switch (compression) {
+  case LOG_FILE_COMPRESSION_GZIP:
+    return LOGFILE_GZIP_EXTENSION;
+  case LOG_FILE_COMPRESSION_ZSTD:
+    return LOGFILE_ZSTD_EXTENSION;
+  default:
+    return "";
+  }
+}
+
 /*-------------------------------------------------------------------------
   LogFile::roll
 
@@ -346,6 +796,10 @@ LogFile::roll(long interval_start, long interval_end)
   //
   //    "squid.log.mymachine.19980712.12h00m00s-19980713.12h00m00s.old"
   //
+  // The extension of a compressed file goes after the rolled extension:
+  //
+  //    "squid.log.mymachine.19980712.12h00m00s-19980713.12h00m00s.old.gz"
+  //
   char roll_name[MAXPATHLEN];
   char start_time_ext[64];
   char end_time_ext[64];
@@ -394,10 +848,17 @@ LogFile::roll(long interval_start, long interval_end)
   //
   LogUtils::timestamp_to_str((long) start, start_time_ext, 64);
   LogUtils::timestamp_to_str((long) end, end_time_ext, 64);
-  snprintf(roll_name, MAXPATHLEN, "%s%s%s.%s-%s%s",
-               m_name,
+
+  const char *zext = compression_extension(m_compression);
+  int name_len = (int) strlen(m_name), zext_len = (int) strlen(zext);
+  if (zext_len && name_len > zext_len && !strcmp(&m_name[name_len - zext_len], zext)) {
+    name_len -= zext_len;
+  }
+
+  snprintf(roll_name, MAXPATHLEN, "%.*s%s%s.%s-%s%s%s",
+               name_len, m_name,
                LOGFILE_SEPARATOR_STRING,
-               Machine::instance()->hostname, start_time_ext, end_time_ext, LOGFILE_ROLLED_EXTENSION);
+               Machine::instance()->hostname, start_time_ext, end_time_ext, LOGFILE_ROLLED_EXTENSION, zext);
 
   //
   // It may be possible that the file we want to roll into already
@@ -409,10 +870,10 @@ LogFile::roll(long interval_start, long interval_end)
   while (LogFile::exists(roll_name)) {
     Note("The rolled file %s already exists; adding version "
          "tag %d to avoid clobbering the existing file.", roll_name, version);
-    snprintf(roll_name, MAXPATHLEN, "%s%s%s.%s-%s.%d%s",
-                 m_name,
+    snprintf(roll_name, MAXPATHLEN, "%.*s%s%s.%s-%s.%d%s%s",
+                 name_len, m_name,
                  LOGFILE_SEPARATOR_STRING,
-                 Machine::instance()->hostname, start_time_ext, end_time_ext, version, LOGFILE_ROLLED_EXTENSION);
+                 Machine::instance()->hostname, start_time_ext, end_time_ext, version, LOGFILE_ROLLED_EXTENSION, zext);
     version++;
   }
 
@@ -506,6 +967,10 @@ LogFile::preproc_and_try_delete(LogBuffer * lb)
     write_ascii_logbuffer3(buffer_header);
     ret = 0;
   }
+  else if (m_file_format == LOG_FILE_COLUMNAR) {
+    write_columnar_logbuffer(buffer_header);
+    ret = 0;
+  }
   else {
     Note("Cannot write LogBuffer to LogFile %s; invalid file format: %d",
          m_name, m_file_format);
@@ -693,6 +1158,63 @@ LogFile::write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt
   return total_bytes;
 }
 
+/*-------------------------------------------------------------------------
+  LogFile::write_columnar_logbuffer
+
+  This routine encodes the given LogBuffer as a columnar block and sends
+  the block to the flush thread. The entries are not converted to text,
+  their fields are only moved into columns (see LogColumnar.h).
+  -------------------------------------------------------------------------*/
+
+// Several preproc threads may write buffers to the same file, so each
+// has its own encoder.
+static __thread LogColumnar *columnar_encoder;
+
+int
+LogFile::write_columnar_logbuffer(LogBufferHeader * buffer_header)
+{
+  ink_assert(buffer_header != NULL);
+
+  ProxyMutex *mutex = this_thread()->mutex;
+  int len = 0;
+
+  if (columnar_encoder == NULL) {
+    columnar_encoder = new LogColumnar;
+  }
+
+  LogColumnarHeader *block = columnar_encoder->encode(buffer_header, Log::config->columnar_compression_level, &len);
+
+  if (block == NULL) {
+    Error("Failed to encode LogBuffer for %s, have dropped (%" PRIu32 ") entries.",
+          m_name, buffer_header->entry_count);
+
+    RecIncrRawStat(log_rsb, mutex->thread_holding,
+                   log_stat_num_lost_before_flush_to_disk_stat,
+                   buffer_header->entry_count);
+
+    RecIncrRawStat(log_rsb, mutex->thread_holding,
+                   log_stat_bytes_lost_before_flush_to_disk_stat,
+                   buffer_header->byte_count);
+    return 0;
+  }
+
+  // send the block to flush thread
+  //
+  LogFlushData *flush_data = new LogFlushData(this, block, len);
+
+  RecIncrRawStat(log_rsb, mutex->thread_holding, log_stat_num_flush_to_disk_stat,
+                 buffer_header->entry_count);
+
+  RecIncrRawStat(log_rsb, mutex->thread_holding, log_stat_bytes_flush_to_disk_stat,
+                 len);
+
+  ink_atomiclist_push(Log::flush_data_list, flush_data);
+
+  Log::flush_notify->signal();
+
+  return len;
+}
+
 /*-------------------------------------------------------------------------
   LogFile::writeln
 
@@ -736,6 +1258,73 @@ LogFile::writeln(char *data, int len, int fd, const char *path)
   return total_bytes;
 }
 
+/*-------------------------------------------------------------------------
+  LogFile::write_compressed
+
+  Compress the given data into the file. Only whole buffers of compressed
+  data are written here; the rest waits for more data, for
+  check_compressed_expiration() or for the file to be closed.
+
+  If writing fails, the compressed stream is lost, so the file is closed and
+  a new stream starts when it is opened again.
+  -------------------------------------------------------------------------*/
+
+int
+LogFile::write_compressed(const struct iovec *iov, int vcnt)
+{
+  for (int i = 0; i < vcnt; i++) {
+    if (!is_compressed()) {
+      return -1;
+    }
+    int64_t n = m_compressor->compress(m_fd, iov[i].iov_base, iov[i].iov_len, LogFileCompressor::CONTINUE);
+    if (_compressed_written(n) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int
+LogFile::flush_compressed(bool finish)
+{
+  if (!is_compressed()) {
+    return 0;
+  }
+
+  int64_t n = m_compressor->compress(m_fd, NULL, 0, finish ? LogFileCompressor::FINISH : LogFileCompressor::FLUSH);
+  if (finish) {
+    m_compressing = false;
+  }
+  return _compressed_written(n);
+}
+
+void
+LogFile::check_compressed_expiration(long time_now)
+{
+  if (is_compressed() && m_compressor->pending() &&
+      time_now - m_compressor->pending_since() >= Log::config->max_secs_per_buffer) {
+    flush_compressed(false);
+  }
+}
+
+int
+LogFile::_compressed_written(int64_t n)
+{
+  if (n < 0) {
+    Error("Failed to write compressed log to %s: %s", m_name, strerror(errno));
+    m_compressing = false;
+    close_file();
+    return -1;
+  }
+
+  if (n > 0) {
+    ink_atomic_increment(&m_bytes_written, n);
+    RecIncrRawStat(log_rsb, this_thread()->mutex->thread_holding,
+                   log_stat_bytes_written_to_disk_stat, n);
+  }
+  return 0;
+}
+
 /*-------------------------------------------------------------------------
   LogFile::check_fd
 
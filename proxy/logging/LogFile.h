@@ -36,9 +36,21 @@ class LogSock;
 class LogBuffer;
 struct LogBufferHeader;
 class LogObject;
+class LogFileCompressor;
 
 #define LOGFILE_ROLLED_EXTENSION ".old"
 #define LOGFILE_SEPARATOR_STRING "_"
+#define LOGFILE_GZIP_EXTENSION ".gz"
+#define LOGFILE_ZSTD_EXTENSION ".zst"
+
+// Stream compression of ASCII log files
+enum LogFileCompression
+{
+  LOG_FILE_COMPRESSION_NONE = 0,
+  LOG_FILE_COMPRESSION_GZIP,
+  LOG_FILE_COMPRESSION_ZSTD,
+  N_LOG_FILE_COMPRESSIONS
+};
 
 /*-------------------------------------------------------------------------
   MetaInfo
@@ -126,7 +138,8 @@ class LogFile:public LogBufferSink, public RefCountObj
 {
 public:
   LogFile(const char *name, const char *header, LogFileFormat format, uint64_t signature,
-          size_t ascii_buffer_size = 4 * 9216, size_t max_line_size = 9216);
+          size_t ascii_buffer_size = 4 * 9216, size_t max_line_size = 9216,
+          LogFileCompression compression = LOG_FILE_COMPRESSION_NONE, int compression_level = 0);
   LogFile(const LogFile &);
   ~LogFile();
 
@@ -151,12 +164,15 @@ public:
 
   LogFileFormat get_format() const { return m_file_format; }
   const char *get_format_name() const {
-    return (m_file_format == LOG_FILE_BINARY ? "binary" : (m_file_format == LOG_FILE_PIPE ? "ascii_pipe" : "ascii"));
+    return (m_file_format == LOG_FILE_BINARY ? "binary" : (m_file_format == LOG_FILE_PIPE ? "ascii_pipe" :
+                                                           (m_file_format == LOG_FILE_COLUMNAR ? "columnar" : "ascii")));
   }
 
   static int write_ascii_logbuffer(LogBufferHeader * buffer_header, int fd, const char *path, const char *alt_format = NULL);
   int write_ascii_logbuffer3(LogBufferHeader * buffer_header, const char *alt_format = NULL);
+  int write_columnar_logbuffer(LogBufferHeader * buffer_header);
   static bool rolled_logfile(char *file);
+  static const char *compression_extension(LogFileCompression compression);
   static bool exists(const char *pathname);
 
   void display(FILE * fd = stdout);
@@ -171,6 +187,15 @@ public:
 
   void check_fd();
   static int writeln(char *data, int len, int fd, const char *path);
+
+  // Compressed files are written with the following, from the flush
+  // thread. Whole blocks of compressed data are written as they fill up;
+  // flush_compressed() writes what is left, so that the file can be read
+  // up to the last entry, and ends the compressed stream if @a finish.
+  bool is_compressed() const { return m_compressor != NULL && m_compressing; }
+  int write_compressed(const struct iovec *iov, int vcnt);
+  int flush_compressed(bool finish);
+  void check_compressed_expiration(long time_now);
   void read_metadata();
 
 public:
@@ -191,10 +216,17 @@ public:
   volatile uint64_t m_bytes_written;
   off_t m_size_bytes;           // current size of file in bytes
 
+  LogFileCompression m_compression;
+  int m_compression_level;
+  LogFileCompressor *m_compressor;
+  bool m_compressing;           // a compressed stream was started in the open file
+
 public:
   Link<LogFile> link;
 
 private:
+  int _compressed_written(int64_t n);
+
   // -- member functions not allowed --
   LogFile();
   LogFile & operator=(const LogFile &);
@@ -377,7 +377,7 @@ LogFormat::format_from_specification(char *spec, char **file_name, char **file_h
   *file_name = ats_strdup(token);
 
   //
-  // Next should be the file type, either "ASCII" or "BINARY"
+  // Next should be the file type, "ASCII", "BINARY" or "COLUMNAR"
   //
   token = tok.getNext();
   if (token == NULL) {
@@ -388,8 +388,10 @@ LogFormat::format_from_specification(char *spec, char **file_name, char **file_h
     *file_type = LOG_FILE_ASCII;
   } else if (!strcasecmp(token, "BINARY")) {
     *file_type = LOG_FILE_BINARY;
+  } else if (!strcasecmp(token, "COLUMNAR")) {
+    *file_type = LOG_FILE_COLUMNAR;
   } else {
-    Debug("log-format", "%s is not a valid file format (ASCII or BINARY)", token);
+    Debug("log-format", "%s is not a valid file format (ASCII, BINARY or COLUMNAR)", token);
     return NULL;
   }
 
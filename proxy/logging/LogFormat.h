@@ -43,6 +43,7 @@ enum LogFileFormat
   LOG_FILE_BINARY,
   LOG_FILE_ASCII,
   LOG_FILE_PIPE, // ie. ASCII pipe
+  LOG_FILE_COLUMNAR,
   N_LOGFILE_TYPES
 };
 
@@ -31,6 +31,7 @@
 
 #include "Error.h"
 #include "P_EventSystem.h"
+#include "P_Net.h"
 #include "LogUtils.h"
 #include "LogField.h"
 #include "LogObject.h"
@@ -110,6 +111,8 @@ LogObject::LogObject(const LogFormat *format, const char *log_dir,
         m_flags |= BINARY;
     } else if (file_format == LOG_FILE_PIPE) {
         m_flags |= WRITES_TO_PIPE;
+    } else if (file_format == LOG_FILE_COLUMNAR) {
+        m_flags |= COLUMNAR;
     }
 
     generate_filenames(log_dir, basename, file_format);
@@ -123,11 +126,14 @@ LogObject::LogObject(const LogFormat *format, const char *log_dir,
     m_logFile = new LogFile(m_filename, header, file_format,
                             m_signature,
                             Log::config->ascii_buffer_size,
-                            Log::config->max_line_size);
+                            Log::config->max_line_size,
+                            Log::config->ascii_compression,
+                            Log::config->ascii_compression_level);
 
     LogBuffer *b = new LogBuffer (this, Log::config->log_buffer_size);
     ink_assert(b);
     SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+    _setup_staging();
 
     _setup_rolling(rolling_enabled, rolling_interval_sec, rolling_offset_hr, rolling_size_mb);
 
@@ -171,6 +177,7 @@ LogObject::LogObject(LogObject& rhs)
     LogBuffer *b = new LogBuffer (this, Log::config->log_buffer_size);
     ink_assert(b);
     SET_FREELIST_POINTER_VERSION(m_log_buffer, b, 0);
+    _setup_staging();
 
     Debug("log-config", "exiting LogObject copy constructor, "
           "filename=%s this=%p", m_filename, this);
@@ -194,6 +201,10 @@ LogObject::~LogObject()
   delete m_format;
   delete[] m_buffer_manager;
   delete (LogBuffer*)FREELIST_POINTER(m_log_buffer);
+  for (int i = 0; i < m_staging_slots; i++) {
+    delete (LogBuffer*)FREELIST_POINTER(m_staging[i].buffer);
+  }
+  ats_free(m_staging);
 }
 
 //-----------------------------------------------------------------------------
@@ -207,6 +218,8 @@ LogObject::~LogObject()
 // 3.- if there is a '.' at the end of the name, then do not add an extension
 //     and remove the '.'. To have a dot at the end of the filename, specify
 //     two ('..').
+// 4.- ascii logs that are compressed also get the extension of their
+//     compression (.gz or .zst), unless the name already ends with it
 //
 void
 LogObject::generate_filenames(const char *log_dir, const char *basename, LogFileFormat file_format)
@@ -241,13 +254,27 @@ LogObject::generate_filenames(const char *log_dir, const char *basename, LogFile
       ext = LOG_FILE_PIPE_OBJECT_FILENAME_EXTENSION;
       ext_len = 5;
       break;
+    case LOG_FILE_COLUMNAR:
+      ext = LOG_FILE_COLUMNAR_OBJECT_FILENAME_EXTENSION;
+      ext_len = 5;
+      break;
     default:
       ink_assert(!"unknown file format");
     }
   }
 
+  const char *zext = 0;
+  int zext_len = 0;
+  if (file_format == LOG_FILE_ASCII) {
+    zext = LogFile::compression_extension(Log::config->ascii_compression);
+    zext_len = (int) strlen(zext);
+    if (!ext_len && len >= zext_len && !strncmp(&basename[len - zext_len], zext, zext_len)) {
+      zext_len = 0;
+    }
+  }
+
   int dir_len = (int) strlen(log_dir);
-  int basename_len = len + ext_len + 1; // include null terminator
+  int basename_len = len + ext_len + zext_len + 1; // include null terminator
   int total_len = dir_len + 1 + basename_len;   // include '/'
 
   m_filename = (char *)ats_malloc(total_len);
@@ -262,6 +289,10 @@ LogObject::generate_filenames(const char *log_dir, const char *basename, LogFile
     memcpy(&m_filename[dir_len + len], ext, ext_len);
     memcpy(&m_basename[len], ext, ext_len);
   }
+  if (zext_len) {
+    memcpy(&m_filename[dir_len + len + ext_len], zext, zext_len);
+    memcpy(&m_basename[len + ext_len], zext, zext_len);
+  }
   m_filename[total_len - 1] = 0;
   m_basename[basename_len - 1] = 0;
 }
@@ -393,12 +424,102 @@ LogObject::displayAsXML(FILE * fd, bool extended)
 }
 
 
+/*-------------------------------------------------------------------------
+  LogObject::_setup_staging
+
+  Give each ET_NET thread a work buffer of its own, so that the threads
+  logging to this object do not all fight over the LB_State of m_log_buffer
+  and over m_log_buffer itself. The buffers are allocated as the threads
+  first use them. Threads that are not ET_NET threads (and every thread if
+  proxy.config.log.per_thread_buffers is 0) keep sharing m_log_buffer.
+
+  Each buffer is handed to the preproc threads whole, when it fills up or
+  expires, like m_log_buffer. The entries of a buffer come from a single
+  thread and are in timestamp order, and its header records the lowest
+  and highest timestamps, so the buffers of the different threads can
+  still be merged by timestamp.
+  -------------------------------------------------------------------------*/
+
+void
+LogObject::_setup_staging()
+{
+  m_staging = NULL;
+  m_staging_slots = 0;
+
+  if (Log::config->per_thread_buffers && eventProcessor.n_threads_for_type[ET_NET] > 0) {
+    m_staging_slots = eventProcessor.n_threads_for_type[ET_NET];
+    m_staging = (LogStagingSlot *) ats_memalign(LOG_STAGING_SLOT_SIZE, m_staging_slots * sizeof(LogStagingSlot));
+    memset(m_staging, 0, m_staging_slots * sizeof(LogStagingSlot));
+  }
+}
+
+// index of the calling thread among the ET_NET threads, -1 if it is not
+// one of them, or -2 if that is not known yet
+static __thread int staging_index = -2;
+
+volatile head_p *
+LogObject::_work_buffer()
+{
+  if (!m_staging) {
+    return &m_log_buffer;
+  }
+
+  if (staging_index == -2) {
+    Thread *t = this_thread();
+
+    staging_index = -1;
+    for (int i = 0; i < eventProcessor.n_threads_for_type[ET_NET]; i++) {
+      if (eventProcessor.eventthread[ET_NET][i] == t) {
+        staging_index = i;
+        break;
+      }
+    }
+  }
+
+  if (staging_index < 0 || staging_index >= m_staging_slots) {
+    return &m_log_buffer;
+  }
+
+  volatile head_p *head = &m_staging[staging_index].buffer;
+
+  // the first buffer of a slot is installed by its thread, nobody else
+  // replaces a NULL buffer
+  if (FREELIST_POINTER(*head) == NULL) {
+    head_p h, new_h;
+    LogBuffer *b = new LogBuffer(this, Log::config->log_buffer_size);
+
+    INK_QUEUE_LD(h, *head);
+    SET_FREELIST_POINTER_VERSION(new_h, b, 0);
+    INK_WRITE_MEMORY_BARRIER;
+#if TS_HAS_128BIT_CAS
+    ink_atomic_cas((__int128_t*) &head->data, h.data, new_h.data);
+#else
+    ink_atomic_cas((int64_t *) &head->data, h.data, new_h.data);
+#endif
+  }
+
+  return head;
+}
+
+void
+LogObject::force_new_buffer()
+{
+  _checkout_write(&m_log_buffer, NULL, 0);
+
+  for (int i = 0; i < m_staging_slots; i++) {
+    if (FREELIST_POINTER(m_staging[i].buffer)) {
+      _checkout_write(&m_staging[i].buffer, NULL, 0);
+    }
+  }
+}
+
 LogBuffer *
-LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
+LogObject::_checkout_write(volatile head_p * head, size_t * write_offset, size_t bytes_needed) {
   LogBuffer::LB_ResultCode result_code;
   LogBuffer *buffer;
   LogBuffer *new_buffer;
   bool retry = true;
+  int64_t retries = 0;
 
   do {
     // To avoid a race condition, we keep a count of held references in
@@ -406,14 +527,16 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
     head_p h;
     int result = 0;
     do {
-      INK_QUEUE_LD(h, m_log_buffer);
+      INK_QUEUE_LD(h, *head);
       head_p new_h;
       SET_FREELIST_POINTER_VERSION(new_h, FREELIST_POINTER(h), FREELIST_VERSION(h) + 1);
 #if TS_HAS_128BIT_CAS
-       result = ink_atomic_cas((__int128_t*) &m_log_buffer.data, h.data, new_h.data);
+       result = ink_atomic_cas((__int128_t*) &head->data, h.data, new_h.data);
 #else
-       result = ink_atomic_cas((int64_t *) &m_log_buffer.data, h.data, new_h.data);
+       result = ink_atomic_cas((int64_t *) &head->data, h.data, new_h.data);
 #endif
+      if (!result)
+        retries++;
     } while (!result);
     buffer = (LogBuffer*)FREELIST_POINTER(h);
     result_code = buffer->checkout_write(write_offset, bytes_needed);
@@ -435,7 +558,7 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
       INK_WRITE_MEMORY_BARRIER;
       head_p old_h;
       do {
-        INK_QUEUE_LD(old_h, m_log_buffer);
+        INK_QUEUE_LD(old_h, *head);
         if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h)) {
           ink_atomic_increment(&buffer->m_references, -1);
 
@@ -447,9 +570,9 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
         head_p tmp_h;
         SET_FREELIST_POINTER_VERSION(tmp_h, new_buffer, 0);
 #if TS_HAS_128BIT_CAS
-       result = ink_atomic_cas((__int128_t*) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((__int128_t*) &head->data, old_h.data, tmp_h.data);
 #else
-       result = ink_atomic_cas((int64_t *) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((int64_t *) &head->data, old_h.data, tmp_h.data);
 #endif
       } while (!result);
       if (FREELIST_POINTER(old_h) == FREELIST_POINTER(h)) {
@@ -459,6 +582,7 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
         Debug("log-logbuffer", "adding buffer %d to flush list after checkout", buffer->get_id());
         m_buffer_manager[idx].add_to_flush_queue(buffer);
         Log::preproc_notify[idx].signal();
+        RecIncrGlobalRawStat(log_rsb, log_stat_buffers_handed_off_stat, 1);
 
       }
       decremented = true;
@@ -468,6 +592,7 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
       // no more room, but another thread should be taking care of
       // creating a new buffer, so try again
       //
+      retries++;
       break;
 
     case LogBuffer::LB_BUFFER_TOO_SMALL:
@@ -485,15 +610,15 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
     if (!decremented) {
       head_p old_h;
       do {
-        INK_QUEUE_LD(old_h, m_log_buffer);
+        INK_QUEUE_LD(old_h, *head);
         if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h))
           break;
         head_p tmp_h;
         SET_FREELIST_POINTER_VERSION(tmp_h, FREELIST_POINTER(h), FREELIST_VERSION(old_h) - 1);
 #if TS_HAS_128BIT_CAS
-       result = ink_atomic_cas((__int128_t*) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((__int128_t*) &head->data, old_h.data, tmp_h.data);
 #else
-       result = ink_atomic_cas((int64_t *) &m_log_buffer.data, old_h.data, tmp_h.data);
+       result = ink_atomic_cas((int64_t *) &head->data, old_h.data, tmp_h.data);
 #endif
       } while (!result);
       if (FREELIST_POINTER(old_h) != FREELIST_POINTER(h))
@@ -504,6 +629,10 @@ LogObject::_checkout_write(size_t * write_offset, size_t bytes_needed) {
   // not want to write to the buffer
   // only to set it as full
 
+  if (retries) {
+    RecIncrGlobalRawStat(log_rsb, log_stat_buffer_checkout_retries_stat, retries);
+  }
+
   return buffer;
 }
 
@@ -614,7 +743,7 @@ LogObject::log(LogAccess * lad, const char *text_entry)
   }
 
   // Now try to place this entry in the current LogBuffer.
-  buffer = _checkout_write(&offset, bytes_needed);
+  buffer = _checkout_write(_work_buffer(), &offset, bytes_needed);
 
   if (!buffer) {
     Note("Skipping the current log entry for %s because its size (%zu) exceeds "
@@ -803,7 +932,21 @@ LogObject::check_buffer_expiration(long time_now)
 {
   LogBuffer *b = (LogBuffer*)FREELIST_POINTER(m_log_buffer);
   if (b && time_now > b->expiration_time()) {
-    force_new_buffer();
+    _checkout_write(&m_log_buffer, NULL, 0);
+  }
+
+  // a thread that logged nothing keeps its empty buffer, rather than
+  // having it handed off and a new one allocated on every pass
+  for (int i = 0; i < m_staging_slots; i++) {
+    b = (LogBuffer*)FREELIST_POINTER(m_staging[i].buffer);
+    if (b && time_now > b->expiration_time() && !b->extend_if_empty(time_now)) {
+      _checkout_write(&m_staging[i].buffer, NULL, 0);
+    }
+  }
+
+  // compressed data that has waited long enough goes to disk too
+  if (m_logFile) {
+    m_logFile->check_compressed_expiration(time_now);
   }
 }
 
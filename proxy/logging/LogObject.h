@@ -52,9 +52,13 @@
 #define LOG_FILE_ASCII_OBJECT_FILENAME_EXTENSION ".log"
 #define LOG_FILE_BINARY_OBJECT_FILENAME_EXTENSION ".blog"
 #define LOG_FILE_PIPE_OBJECT_FILENAME_EXTENSION ".pipe"
+#define LOG_FILE_COLUMNAR_OBJECT_FILENAME_EXTENSION ".clog"
 
 #define FLUSH_ARRAY_SIZE (512*4)
 
+// size of a LogStagingSlot, so that each one has its own cache line
+#define LOG_STAGING_SLOT_SIZE 64
+
 #define LOG_OBJECT_ARRAY_DELTA 8
 
 #define ACQUIRE_API_MUTEX(_f) \
@@ -82,6 +86,16 @@ class LogBufferManager
     size_t preproc_buffers(LogBufferSink *sink);
 };
 
+// The buffer an ET_NET thread writes the entries of a LogObject to. Only
+// that thread checks it out, so the CAS never fails because of another
+// writer; the buffer is still swapped with the same versioned pointer as
+// the shared buffer so that check_buffer_expiration() can seal it.
+struct LogStagingSlot
+{
+  volatile head_p buffer;
+  char pad[LOG_STAGING_SLOT_SIZE - sizeof(head_p)];
+};
+
 // LogObject is atomically reference counted, and the reference count is always owned by
 // one or more LogObjectManagers.
 class LogObject : public RefCountObj
@@ -93,12 +107,14 @@ public:
     REMOTE_DATA = 2,
     WRITES_TO_PIPE = 4,
     LOG_OBJECT_FMT_TIMESTAMP = 8, // always format a timestamp into each log line (for raw text logs)
+    COLUMNAR = 16,
   };
 
   // BINARY: log is written in binary format (rather than ascii)
   // REMOTE_DATA: object receives data from remote collation clients, so
   //              it should not be destroyed during a reconfiguration
   // WRITES_TO_PIPE: object writes to a named pipe rather than to a file
+  // COLUMNAR: log is written in the columnar binary format
 
   LogObject(const LogFormat *format, const char *log_dir, const char *basename,
                  LogFileFormat file_format, const char *header,
@@ -196,9 +212,7 @@ public:
 
   const char *get_format_string() { return (m_format ? m_format->format_string() : "<none>"); }
 
-  void force_new_buffer() {
-    _checkout_write(NULL, 0);
-  }
+  void force_new_buffer();
 
   bool operator==(LogObject & rhs);
   int do_filesystem_checks();
@@ -234,6 +248,8 @@ private:
   // its files
 
   volatile head_p m_log_buffer;     // current work buffer
+  LogStagingSlot *m_staging;        // work buffer of each ET_NET thread, or NULL
+  int m_staging_slots;
   unsigned m_buffer_manager_idx;
   LogBufferManager *m_buffer_manager;
 
@@ -241,7 +257,9 @@ private:
   void _setup_rolling(Log::RollingEnabledValues rolling_enabled, int rolling_interval_sec, int rolling_offset_hr, int rolling_size_mb);
   unsigned _roll_files(long interval_start, long interval_end);
 
-  LogBuffer *_checkout_write(size_t * write_offset, size_t write_size);
+  void _setup_staging();
+  volatile head_p *_work_buffer();
+  LogBuffer *_checkout_write(volatile head_p * head, size_t * write_offset, size_t write_size);
 
 private:
   // -- member functions not allowed --
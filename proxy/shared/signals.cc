@@ -71,6 +71,7 @@ public:
       sigusr1_received = 0;
       // TODO: TS-567 Integrate with debugging allocators "dump" features?
       ink_freelists_dump(stderr);
+      ink_freelists_dump_magazines(stderr);
       if (!end)
         end = (char *) sbrk(0);
       if (!snap)